@@ -281,6 +281,10 @@ po::options_description get_fscp_options()
 
 	result.add_options()
 	("fscp.hostname_resolution_protocol", po::value<fl::fscp_configuration::hostname_resolution_protocol_type>()->default_value(fl::fscp_configuration::HRP_IPV4), "The hostname resolution protocol to use.")
+	("fscp.hostname_resolution_threads", po::value<unsigned int>()->default_value(4), "The count of threads that resolve hostnames.")
+	("fscp.hostname_resolution_cache_ttl", po::value<millisecond_duration>()->default_value(300000), "The time during which a resolved hostname is not resolved again, in milliseconds.")
+	("fscp.hostname_resolution_negative_cache_ttl", po::value<millisecond_duration>()->default_value(30000), "The time during which a hostname that failed to resolve is not resolved again, in milliseconds.")
+	("fscp.hostname_resolution_stale_while_revalidate", po::value<bool>()->default_value(true, "yes"), "Whether an expired hostname resolution is still used while being refreshed.")
 	("fscp.listen_on", po::value<asiotap::endpoint>()->default_value(asiotap::ipv4_endpoint(boost::asio::ip::address_v4::any(), 12000)), "The endpoint to listen on.")
 	("fscp.listen_on_device", po::value<std::string>()->default_value(std::string()), "The endpoint to listen on.")
 	("fscp.hello_timeout", po::value<millisecond_duration>()->default_value(3000), "The default timeout for HELLO messages, in milliseconds.")
@@ -293,6 +297,10 @@ po::options_description get_fscp_options()
 	("fscp.elliptic_curve_capability", po::value<std::vector<fscp::elliptic_curve_type> >()->multitoken()->zero_tokens()->default_value(fscp::get_default_elliptic_curves(), ""), "A elliptic curve to allow.")
 	("fscp.upnp_enabled", po::value<bool>()->default_value(true, "yes"), "Enable UPnP.")
 	("fscp.max_unauthenticated_messages_per_second", po::value<size_t>()->default_value(1, "1"), "Maximum unauthenticated messages from one host per second.")
+	("fscp.session_renewal_period", po::value<millisecond_duration>()->default_value(fscp::SESSION_RENEWAL_PERIOD), "The maximum age of a session before it gets renewed, in milliseconds.")
+	("fscp.session_renewal_data_size", po::value<uint64_t>()->default_value(fscp::SESSION_RENEWAL_DATA_SIZE >> 20), "The maximum amount of data exchanged with a session before it gets renewed, in megabytes.")
+	("fscp.hash_only_presentation", po::value<bool>()->default_value(false, "no"), "Whether to only send the certificate hash when presenting to hosts that already know the certificate.")
+	("fscp.path_mtu_discovery", po::value<bool>()->default_value(true, "yes"), "Whether to probe the path MTU to each host and adapt the tunnel to it.")
 	;
 
 	return result;
@@ -313,6 +321,8 @@ po::options_description get_security_options()
 	("security.authority_certificate_file", po::value<std::vector<fs::path> >()->multitoken()->zero_tokens()->default_value(std::vector<fs::path>(), ""), "An authority certificate file to use.")
 	("security.certificate_revocation_validation_method", po::value<fl::security_configuration::certificate_revocation_validation_method_type>()->default_value(fl::security_configuration::CRVM_NONE), "The certificate revocation validation method.")
 	("security.certificate_revocation_list_file", po::value<std::vector<fs::path> >()->multitoken()->zero_tokens()->default_value(std::vector<fs::path>(), ""), "A certificate revocation list file to use.")
+	("security.certificate_validation_cache_positive_ttl", po::value<millisecond_duration>()->default_value(300000), "The time during which a certificate found valid is not validated again, in milliseconds.")
+	("security.certificate_validation_cache_negative_ttl", po::value<millisecond_duration>()->default_value(30000), "The time during which a certificate found invalid is not validated again, in milliseconds.")
 	;
 
 	return result;
@@ -444,6 +454,10 @@ void setup_configuration(const fscp::logger& logger, fl::configuration& configur
 
 	// FSCP options
 	configuration.fscp.hostname_resolution_protocol = vm["fscp.hostname_resolution_protocol"].as<fl::fscp_configuration::hostname_resolution_protocol_type>();
+	configuration.fscp.hostname_resolution_threads = vm["fscp.hostname_resolution_threads"].as<unsigned int>();
+	configuration.fscp.hostname_resolution_cache_ttl = vm["fscp.hostname_resolution_cache_ttl"].as<millisecond_duration>().to_time_duration();
+	configuration.fscp.hostname_resolution_negative_cache_ttl = vm["fscp.hostname_resolution_negative_cache_ttl"].as<millisecond_duration>().to_time_duration();
+	configuration.fscp.hostname_resolution_stale_while_revalidate = vm["fscp.hostname_resolution_stale_while_revalidate"].as<bool>();
 	configuration.fscp.listen_on = vm["fscp.listen_on"].as<asiotap::endpoint>();
 	configuration.fscp.listen_on_device = vm["fscp.listen_on_device"].as<std::string>();
 	configuration.fscp.hello_timeout = vm["fscp.hello_timeout"].as<millisecond_duration>().to_time_duration();
@@ -467,6 +481,10 @@ void setup_configuration(const fscp::logger& logger, fl::configuration& configur
 	configuration.fscp.elliptic_curve_capabilities = vm["fscp.elliptic_curve_capability"].as<std::vector<fscp::elliptic_curve_type>>();
 	configuration.fscp.upnp_enabled = vm["fscp.upnp_enabled"].as<bool>();
 	configuration.fscp.max_unauthenticated_messages_per_second = vm["fscp.max_unauthenticated_messages_per_second"].as<size_t>();
+	configuration.fscp.session_renewal_period = vm["fscp.session_renewal_period"].as<millisecond_duration>().to_time_duration();
+	configuration.fscp.session_renewal_data_size = vm["fscp.session_renewal_data_size"].as<uint64_t>() << 20;
+	configuration.fscp.hash_only_presentation = vm["fscp.hash_only_presentation"].as<bool>();
+	configuration.fscp.path_mtu_discovery = vm["fscp.path_mtu_discovery"].as<bool>();
 
 	// Security options
 	const std::string passphrase = vm["security.passphrase"].as<std::string>();
@@ -521,6 +539,9 @@ void setup_configuration(const fscp::logger& logger, fl::configuration& configur
 		}
 	}
 
+	configuration.security.certificate_validation_cache_positive_ttl = vm["security.certificate_validation_cache_positive_ttl"].as<millisecond_duration>().to_time_duration();
+	configuration.security.certificate_validation_cache_negative_ttl = vm["security.certificate_validation_cache_negative_ttl"].as<millisecond_duration>().to_time_duration();
+
 	// Tap adapter options
 	configuration.tap_adapter.type = vm["tap_adapter.type"].as<fl::tap_adapter_configuration::tap_adapter_type>();
 	configuration.tap_adapter.enabled = vm["tap_adapter.enabled"].as<bool>();
@@ -65,6 +65,14 @@
 
 namespace fs = boost::filesystem;
 
+#ifndef WINDOWS
+namespace
+{
+	// A script that runs for longer than this is killed, along with its own children, and considered failed.
+	const boost::posix_time::time_duration SCRIPT_TIMEOUT = boost::posix_time::minutes(2);
+}
+#endif
+
 #ifdef WINDOWS
 fs::path get_module_filename()
 {
@@ -191,17 +199,23 @@ int execute(const fscp::logger& logger, fs::path script, const std::vector<std::
 #if defined(WINDOWS)
 	const auto return_code = executeplus::execute(real_args, new_env);
 #else
-	std::ostringstream oss;
+	// The callers need the exit status before they proceed: the script runs to completion, or until it is killed, on this thread.
+	boost::system::error_code ec;
+	std::string output;
+	int return_code = executeplus::execute_with_timeout(real_args, new_env, SCRIPT_TIMEOUT, ec, &output);
 
-	const auto return_code = executeplus::execute(real_args, new_env, &oss);
+	if (ec)
+	{
+		logger(fscp::log_level::warning) << "Script " << script.string() << " failed: " << ec.message() << " (" << ec << ").";
+
+		return_code = (return_code == 0) ? EXIT_FAILURE : return_code;
+	}
 #endif
 
 	const auto log_level = (return_code == 0) ? fscp::log_level::debug : fscp::log_level::warning;
 	logger(log_level) << "Script " << script.string() << " returned " << return_code << ".";
 
 #if !defined(WINDOWS)
-	const auto output = oss.str();
-
 	if (!output.empty())
 	{
 		logger(fscp::log_level::debug) << "Output follows:\n" << output;
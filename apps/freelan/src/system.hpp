@@ -100,6 +100,8 @@ boost::filesystem::path get_temporary_directory();
  * \param args The parameters.
  * \param env Variables to inject into the environment.
  * \return The exit status.
+ *
+ * On POSIX systems, a script still running after two minutes is killed, along with its own children, and the returned status is non-zero. freelan.cfg documents this for each hook.
  */
 #if defined(WINDOWS) && defined(UNICODE)
 int execute(const fscp::logger& logger, boost::filesystem::path script, const std::vector<std::wstring>& args, const std::map<std::wstring, std::wstring>& env = std::map<std::wstring, std::wstring>());
@@ -47,6 +47,9 @@
 
 #include <string>
 #include <map>
+#include <set>
+#include <vector>
+#include <deque>
 #include <iostream>
 
 #include <boost/asio.hpp>
@@ -110,10 +113,7 @@ namespace asiotap
 
 					~entry_type_impl()
 					{
-						if (m_success)
-						{
-							m_route_manager.unregister_route(m_route);
-						}
+						m_route_manager.release_route(m_route);
 					}
 
 					entry_type_impl(const entry_type_impl&) = delete;
@@ -131,14 +131,12 @@ namespace asiotap
 
 					entry_type_impl(base_route_manager& route_manager, const route_type& _route) :
 						m_route_manager(route_manager),
-						m_route(_route),
-						m_success(m_route_manager.register_route(m_route))
+						m_route(_route)
 					{
 					}
 
 					base_route_manager& m_route_manager;
 					route_type m_route;
-					bool m_success;
 
 					friend class base_route_manager<RouteManagerType, RouteType>;
 			};
@@ -148,6 +146,42 @@ namespace asiotap
 			 */
 			typedef boost::shared_ptr<entry_type_impl> entry_type;
 
+			/**
+			 * \brief The entry list type.
+			 */
+			typedef std::vector<entry_type> entry_list_type;
+
+			/**
+			 * \brief Defers the unregistration of the released routes.
+			 *
+			 * While an instance exists, the routes whose last entry is released are not unregistered right away: they are all queued for unregistration at once when the last instance is destroyed. A released route that is requested again in the meantime is kept as is.
+			 */
+			class unregistration_batch
+			{
+				public:
+
+					explicit unregistration_batch(base_route_manager& route_manager) :
+						m_route_manager(route_manager)
+					{
+						++m_route_manager.m_unregistration_batch_depth;
+					}
+
+					~unregistration_batch()
+					{
+						if (--m_route_manager.m_unregistration_batch_depth == 0)
+						{
+							m_route_manager.flush_released_routes();
+						}
+					}
+
+					unregistration_batch(const unregistration_batch&) = delete;
+					unregistration_batch& operator=(const unregistration_batch&) = delete;
+
+				private:
+
+					base_route_manager& m_route_manager;
+			};
+
 			/**
 			 * \brief The registration success handler type.
 			 */
@@ -168,8 +202,17 @@ namespace asiotap
 			 */
 			typedef boost::function<void(const route_type&, const boost::system::system_error&)> route_unregistration_failure_handler_type;
 
+			/**
+			 * \brief The route batch handler type.
+			 *
+			 * The parameter holds the result of each operation, in the same order as the routes.
+			 */
+			typedef boost::function<void (const std::vector<boost::system::error_code>&)> route_batch_handler_type;
+
 			explicit base_route_manager(boost::asio::io_service& io_service_) :
-				m_io_service(io_service_)
+				m_io_service(io_service_),
+				m_strand(io_service_),
+				m_unregistration_batch_depth(0)
 			{
 			}
 
@@ -252,12 +295,24 @@ namespace asiotap
 				return true;
 			}
 
+			/**
+			 * \brief Get the entry for a route.
+			 * \param route The route.
+			 * \return The entry.
+			 *
+			 * If the route is not registered yet, its registration is queued and the entry is returned right away: the result is reported to the registration handlers, from an io_service thread.
+			 */
 			entry_type get_route_entry(const route_type& route)
 			{
 				entry_type entry = m_entry_table[route].lock();
 
 				if (!entry)
 				{
+					if (m_released_routes.erase(route) == 0)
+					{
+						queue_route_batch(route_batch_action::registration, std::vector<route_type>(1, route));
+					}
+
 					entry = boost::shared_ptr<entry_type_impl>(new entry_type_impl(*this, route));
 
 					m_entry_table[route] = entry;
@@ -266,14 +321,271 @@ namespace asiotap
 				return entry;
 			}
 
+			/**
+			 * \brief Get the entries for several routes at once.
+			 * \param routes The routes.
+			 * \return The entries, in the same order as the routes.
+			 *
+			 * The routes that are not registered yet are queued for registration together, which is faster than calling get_route_entry() for each of them.
+			 */
+			entry_list_type get_route_entries(const std::vector<route_type>& routes)
+			{
+				entry_list_type entries(routes.size());
+				std::vector<route_type> new_routes;
+
+				for (size_t i = 0; i < routes.size(); ++i)
+				{
+					entries[i] = m_entry_table[routes[i]].lock();
+
+					if (!entries[i])
+					{
+						if (m_released_routes.erase(routes[i]) == 0)
+						{
+							new_routes.push_back(routes[i]);
+						}
+
+						entries[i] = boost::shared_ptr<entry_type_impl>(new entry_type_impl(*this, routes[i]));
+
+						m_entry_table[routes[i]] = entries[i];
+					}
+				}
+
+				if (!new_routes.empty())
+				{
+					queue_route_batch(route_batch_action::registration, new_routes);
+				}
+
+				return entries;
+			}
+
 		protected:
 
 			typedef std::map<route_type, boost::weak_ptr<entry_type_impl>> entry_table_type;
 
+			/**
+			 * \brief Register several routes.
+			 * \param routes The routes.
+			 * \return The result of each registration.
+			 *
+			 * Route managers that can register several routes at once should hide this implementation.
+			 */
+			std::vector<boost::system::error_code> register_route_batch(const std::vector<route_type>& routes)
+			{
+				std::vector<boost::system::error_code> results(routes.size());
+
+				for (size_t i = 0; i < routes.size(); ++i)
+				{
+					try
+					{
+						static_cast<RouteManagerType*>(this)->register_route(routes[i]);
+					}
+					catch (boost::system::system_error& ex)
+					{
+						results[i] = ex.code();
+					}
+				}
+
+				return results;
+			}
+
+			/**
+			 * \brief Unregister several routes.
+			 * \param routes The routes.
+			 * \return The result of each unregistration.
+			 *
+			 * Route managers that can unregister several routes at once should hide this implementation.
+			 */
+			std::vector<boost::system::error_code> unregister_route_batch(const std::vector<route_type>& routes)
+			{
+				std::vector<boost::system::error_code> results(routes.size());
+
+				for (size_t i = 0; i < routes.size(); ++i)
+				{
+					try
+					{
+						static_cast<RouteManagerType*>(this)->unregister_route(routes[i]);
+					}
+					catch (boost::system::system_error& ex)
+					{
+						results[i] = ex.code();
+					}
+				}
+
+				return results;
+			}
+
+			/**
+			 * \brief Register several routes asynchronously.
+			 * \param routes The routes.
+			 * \param handler The handler to call with the result of each registration.
+			 *
+			 * Route managers that can register several routes without blocking should hide this implementation, which runs register_route_batch() on an io_service thread.
+			 */
+			void async_register_route_batch(const std::vector<route_type>& routes, route_batch_handler_type handler)
+			{
+				m_io_service.post([this, routes, handler] () {
+					handler(static_cast<RouteManagerType*>(this)->register_route_batch(routes));
+				});
+			}
+
+			/**
+			 * \brief Unregister several routes asynchronously.
+			 * \param routes The routes.
+			 * \param handler The handler to call with the result of each unregistration.
+			 *
+			 * Route managers that can unregister several routes without blocking should hide this implementation, which runs unregister_route_batch() on an io_service thread.
+			 */
+			void async_unregister_route_batch(const std::vector<route_type>& routes, route_batch_handler_type handler)
+			{
+				m_io_service.post([this, routes, handler] () {
+					handler(static_cast<RouteManagerType*>(this)->unregister_route_batch(routes));
+				});
+			}
+
 		private:
 
+			enum class route_batch_action
+			{
+				registration,
+				unregistration
+			};
+
+			struct route_batch_type
+			{
+				route_batch_action action;
+				std::vector<route_type> routes;
+			};
+
+			void release_route(const route_type& route)
+			{
+				if (m_unregistration_batch_depth > 0)
+				{
+					m_released_routes.insert(route);
+				}
+				else
+				{
+					queue_route_batch(route_batch_action::unregistration, std::vector<route_type>(1, route));
+				}
+			}
+
+			void flush_released_routes()
+			{
+				if (!m_released_routes.empty())
+				{
+					const std::vector<route_type> routes(m_released_routes.begin(), m_released_routes.end());
+					m_released_routes.clear();
+
+					queue_route_batch(route_batch_action::unregistration, routes);
+				}
+			}
+
+			void queue_route_batch(route_batch_action action, const std::vector<route_type>& routes)
+			{
+				const route_batch_type route_batch = { action, routes };
+
+				// The batches are applied one at a time and in order, so that the removal of a route never overtakes its addition, nor the other way around.
+				m_strand.post([this, route_batch] () {
+					m_route_batches.push_back(route_batch);
+
+					if (m_route_batches.size() == 1)
+					{
+						send_route_batch();
+					}
+				});
+			}
+
+			void send_route_batch()
+			{
+				// All calls to send_route_batch() are done within the m_strand, so the following is safe.
+				route_batch_type& route_batch = m_route_batches.front();
+				const route_batch_handler_type handler = m_strand.wrap([this] (const std::vector<boost::system::error_code>& results) {
+					handle_route_batch(results);
+				});
+
+				if (route_batch.action == route_batch_action::registration)
+				{
+					static_cast<RouteManagerType*>(this)->async_register_route_batch(route_batch.routes, handler);
+				}
+				else
+				{
+					// The routes that failed to register were never added: there is nothing to remove.
+					std::vector<route_type> routes;
+
+					for (auto&& route : route_batch.routes)
+					{
+						if (m_failed_routes.erase(route) == 0)
+						{
+							routes.push_back(route);
+						}
+					}
+
+					route_batch.routes = routes;
+
+					static_cast<RouteManagerType*>(this)->async_unregister_route_batch(route_batch.routes, handler);
+				}
+			}
+
+			void handle_route_batch(const std::vector<boost::system::error_code>& results)
+			{
+				// All calls to handle_route_batch() are done within the m_strand, so the following is safe.
+				const route_batch_type route_batch = m_route_batches.front();
+				m_route_batches.pop_front();
+
+				for (size_t i = 0; i < route_batch.routes.size(); ++i)
+				{
+					const route_type& route = route_batch.routes[i];
+
+					if (route_batch.action == route_batch_action::registration)
+					{
+						if (!results[i])
+						{
+							if (m_route_registration_success_handler)
+							{
+								m_route_registration_success_handler(route);
+							}
+						}
+						else
+						{
+							m_failed_routes.insert(route);
+
+							if (m_route_registration_failure_handler)
+							{
+								m_route_registration_failure_handler(route, boost::system::system_error(results[i]));
+							}
+						}
+					}
+					else
+					{
+						if (!results[i])
+						{
+							if (m_route_unregistration_success_handler)
+							{
+								m_route_unregistration_success_handler(route);
+							}
+						}
+						else
+						{
+							if (m_route_unregistration_failure_handler)
+							{
+								m_route_unregistration_failure_handler(route, boost::system::system_error(results[i]));
+							}
+						}
+					}
+				}
+
+				if (!m_route_batches.empty())
+				{
+					send_route_batch();
+				}
+			}
+
 			boost::asio::io_service& m_io_service;
+			boost::asio::io_service::strand m_strand;
+			std::deque<route_batch_type> m_route_batches;
+			std::set<route_type> m_failed_routes;
 			entry_table_type m_entry_table;
+			unsigned int m_unregistration_batch_depth;
+			std::set<route_type> m_released_routes;
 			route_registration_success_handler_type m_route_registration_success_handler;
 			route_registration_failure_handler_type m_route_registration_failure_handler;
 			route_unregistration_success_handler_type m_route_unregistration_success_handler;
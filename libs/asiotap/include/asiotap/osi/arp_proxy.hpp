@@ -51,10 +51,15 @@
 #include "arp_filter.hpp"
 #include "complex_filter.hpp"
 #include "ethernet_address.hpp"
+#include "negative_cache.hpp"
 
 #include <boost/optional.hpp>
+#include <boost/array.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
-#include <map>
+#include <iterator>
 
 namespace asiotap
 {
@@ -83,11 +88,23 @@ namespace asiotap
 				 */
 				typedef boost::function<bool (const boost::asio::ip::address_v4&, ethernet_address_type&)> arp_request_callback_type;
 
+				/**
+				 * \brief The size of an ARP reply frame, Ethernet header included.
+				 */
+				static const size_t REPLY_SIZE = sizeof(ethernet_frame) + sizeof(arp_frame);
+
+				/**
+				 * \brief The default time during which an address the callback could not resolve is not submitted to it again.
+				 */
+				static const boost::posix_time::time_duration DEFAULT_NEGATIVE_CACHE_TTL;
+
 				/**
 				 * \brief Create an ARP proxy.
 				 */
 				proxy() :
-					m_arp_request_callback(0)
+					m_entry_map(),
+					m_arp_request_callback(0),
+					m_negative_cache(DEFAULT_NEGATIVE_CACHE_TTL)
 				{
 				}
 
@@ -113,6 +130,22 @@ namespace asiotap
 				 */
 				bool remove_entry(const boost::asio::ip::address_v4& logical_address);
 
+				/**
+				 * \brief Replace all the proxy entries.
+				 * \param begin An iterator to the first entry_type to set.
+				 * \param end An iterator past the last entry_type to set.
+				 *
+				 * The table is sized once for all the entries. If several entries share a logical address, the first one is kept.
+				 */
+				template <typename ForwardIterator>
+				void set_entries(ForwardIterator begin, ForwardIterator end);
+
+				/**
+				 * \brief Set the time during which an address the callback could not resolve is not submitted to it again.
+				 * \param ttl The time to live of the unresolved addresses. A non-positive value disables the caching.
+				 */
+				void set_negative_cache_ttl(boost::posix_time::time_duration ttl);
+
 				/**
 				 * \brief Set the callback function when a ARP request is received.
 				 * \param callback The callback function.
@@ -125,21 +158,37 @@ namespace asiotap
 				 * \param arp_helper The ARP layer.
 				 * \param response_buffer The buffer to write the response to.
 				 * \return The buffer that contains the answer, if there is one.
+				 *
+				 * The reply is copied from the template of the matching entry and only the fields that depend on the request are patched.
 				 */
 				boost::optional<boost::asio::const_buffer> process_frame(const_helper<ethernet_frame> ethernet_helper, const_helper<arp_frame> arp_helper, boost::asio::mutable_buffer response_buffer) const;
 
 			private:
 
-				typedef std::map<boost::asio::ip::address_v4, ethernet_address_type> entry_map_type;
+				/**
+				 * \brief A prebuilt ARP reply, whose request dependent fields are left blank.
+				 */
+				typedef boost::array<uint8_t, REPLY_SIZE> reply_template_type;
+
+				struct address_hash
+				{
+					size_t operator()(const boost::asio::ip::address_v4& address) const
+					{
+						return boost::hash<unsigned long>()(address.to_ulong());
+					}
+				};
+
+				typedef boost::unordered_map<boost::asio::ip::address_v4, reply_template_type, address_hash> entry_map_type;
+
+				static void write_reply_template(boost::asio::mutable_buffer buf, const boost::asio::ip::address_v4& logical_address, const ethernet_address_type& hardware_address);
+				static void patch_reply(boost::asio::mutable_buffer buf, const_helper<ethernet_frame> ethernet_helper, const_helper<arp_frame> arp_helper);
 
 				entry_map_type m_entry_map;
 				arp_request_callback_type m_arp_request_callback;
-		};
 
-		inline bool proxy<arp_frame>::add_entry(const entry_type& entry)
-		{
-			return m_entry_map.insert(entry).second;
-		}
+				// The callback is only called from process_frame(), which is logically const.
+				mutable negative_cache<boost::asio::ip::address_v4, address_hash> m_negative_cache;
+		};
 
 		inline bool proxy<arp_frame>::add_entry(const boost::asio::ip::address_v4& logical_address, const ethernet_address_type& hardware_address)
 		{
@@ -151,9 +200,27 @@ namespace asiotap
 			return (m_entry_map.erase(logical_address) > 0);
 		}
 
+		template <typename ForwardIterator>
+		inline void proxy<arp_frame>::set_entries(ForwardIterator begin, ForwardIterator end)
+		{
+			m_entry_map.clear();
+			m_entry_map.reserve(std::distance(begin, end));
+
+			for (; begin != end; ++begin)
+			{
+				add_entry(*begin);
+			}
+		}
+
 		inline void proxy<arp_frame>::set_arp_request_callback(arp_request_callback_type callback)
 		{
 			m_arp_request_callback = callback;
+			m_negative_cache.clear();
+		}
+
+		inline void proxy<arp_frame>::set_negative_cache_ttl(boost::posix_time::time_duration ttl)
+		{
+			m_negative_cache.set_ttl(ttl);
 		}
 	}
 }
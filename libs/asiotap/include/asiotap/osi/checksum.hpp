@@ -47,12 +47,50 @@
 
 #include <boost/asio.hpp>
 
-#include "osi/checksum_helper.hpp"
+#include <stdint.h>
 
 namespace asiotap
 {
 	namespace osi
 	{
+		/**
+		 * \brief The implementations of the one's complement sum.
+		 */
+		enum checksum_implementation
+		{
+			CI_SCALAR, /**< Portable implementation. */
+			CI_SSE2, /**< SSE2 implementation. */
+			CI_AVX2, /**< AVX2 implementation. */
+			CI_NEON /**< NEON implementation. */
+		};
+
+		/**
+		 * \brief Get the implementation used to compute checksums.
+		 * \return The implementation in use.
+		 *
+		 * The fastest implementation supported by the CPU is selected on first use.
+		 */
+		checksum_implementation get_checksum_implementation();
+
+		/**
+		 * \brief Force the implementation used to compute checksums.
+		 * \param implementation The implementation to use.
+		 * \return true if implementation is supported by this build and this CPU, and was selected.
+		 *
+		 * This is meant for benchmarks and verification: all the implementations give the same results.
+		 */
+		bool set_checksum_implementation(checksum_implementation implementation);
+
+		/**
+		 * \brief Compute the one's complement sum of a buffer.
+		 * \param buf The buffer.
+		 * \param buf_len The length of buf, in bytes. If odd, the last byte is padded with zero.
+		 * \return The one's complement sum of the 16-bit words of buf, folded to 16 bits but not complemented.
+		 *
+		 * Words are summed in memory order: the result has the same byte order as the data.
+		 */
+		uint16_t ones_complement_sum(const void* buf, size_t buf_len);
+
 		/**
 		 * \brief Compute a checksum from the specified buffer.
 		 * \param buf The buffer from which to compute a checksum.
@@ -61,13 +99,50 @@ namespace asiotap
 		 */
 		uint16_t compute_checksum(const uint16_t* buf, size_t buf_len);
 
+		/**
+		 * \brief Update a checksum after a 16-bit word of the data changed.
+		 * \param checksum The current checksum.
+		 * \param old_value The previous value of the word.
+		 * \param new_value The new value of the word.
+		 * \return The checksum of the modified data.
+		 *
+		 * This implements equation 3 of RFC 1624. All the values must use the same byte order and the word must start at an even offset from the beginning of the checksummed data. A word at an odd offset can be handled by swapping the bytes of both values.
+		 */
+		uint16_t update_checksum(uint16_t checksum, uint16_t old_value, uint16_t new_value);
+
+		/**
+		 * \brief Update a checksum after a 32-bit field of the data changed.
+		 * \param checksum The current checksum.
+		 * \param old_value The previous value of the field.
+		 * \param new_value The new value of the field.
+		 * \return The checksum of the modified data.
+		 *
+		 * The same restrictions as for update_checksum() apply.
+		 */
+		uint16_t update_checksum_32(uint16_t checksum, uint32_t old_value, uint32_t new_value);
+
 		inline uint16_t compute_checksum(const uint16_t* buf, size_t buf_len)
 		{
-			checksum_helper helper;
+			return static_cast<uint16_t>(~ones_complement_sum(buf, buf_len));
+		}
 
-			helper.update(buf, buf_len);
+		inline uint16_t update_checksum(uint16_t checksum, uint16_t old_value, uint16_t new_value)
+		{
+			uint32_t sum = static_cast<uint16_t>(~checksum);
+			sum += static_cast<uint16_t>(~old_value);
+			sum += new_value;
+
+			sum = (sum & 0xFFFF) + (sum >> 16);
+			sum = (sum & 0xFFFF) + (sum >> 16);
+
+			return static_cast<uint16_t>(~sum);
+		}
+
+		inline uint16_t update_checksum_32(uint16_t checksum, uint32_t old_value, uint32_t new_value)
+		{
+			checksum = update_checksum(checksum, static_cast<uint16_t>(old_value >> 16), static_cast<uint16_t>(new_value >> 16));
 
-			return helper.compute();
+			return update_checksum(checksum, static_cast<uint16_t>(old_value & 0xFFFF), static_cast<uint16_t>(new_value & 0xFFFF));
 		}
 	}
 }
@@ -47,12 +47,16 @@
 
 #include <boost/asio.hpp>
 
+#include "osi/checksum.hpp"
+
 namespace asiotap
 {
 	namespace osi
 	{
 		/**
 		 * \brief A checksum helper class.
+		 *
+		 * The checksummed data can be given in several calls to update(), with any length: buffers that start at an odd offset are accounted for.
 		 */
 		class checksum_helper
 		{
@@ -79,12 +83,12 @@ namespace asiotap
 			private:
 
 				uint32_t m_checksum;
-				uint8_t m_left;
+				bool m_odd;
 		};
 
 		inline checksum_helper::checksum_helper() :
 			m_checksum(0),
-			m_left(0)
+			m_odd(false)
 		{
 		}
 	}
@@ -79,6 +79,8 @@ namespace asiotap
 
 		/**
 		 * \brief A base filter class.
+		 *
+		 * Filters hold no parsing state: the result of a parse is only returned to its caller and given to the handlers. Once its callbacks are set up, a filter can be used from several threads at once.
 		 */
 		template <typename OSIFrameType>
 		class _base_filter
@@ -129,43 +131,21 @@ namespace asiotap
 					m_const_handlers.push_back(callback);
 				}
 
-				/**
-				 * \brief Get the last helper.
-				 * \return The last helper, if any.
-				 */
-				boost::optional<mutable_helper<frame_type> > get_last_helper() const {
-					return m_last_helper;
-				}
-
-				/**
-				* \brief Get the last const helper.
-				* \return The last const helper, if any.
-				*/
-				boost::optional<const_helper<frame_type> > get_last_const_helper() const {
-					return m_last_const_helper;
-				}
-
-				/**
-				 * \brief Clear the last helper.
-				 */
-				void clear_last_helper() const {
-					m_last_helper = boost::none;
-					m_last_const_helper = boost::none;
-				}
-
 			protected:
 
 				/**
 				 * \brief Do the parsing.
 				 * \param buf buffer to parse.
+				 * \return The helper of the frame, if it was handled.
 				 */
-				void do_parse(boost::asio::const_buffer buf) const;
+				boost::optional<const_helper<frame_type> > do_parse(boost::asio::const_buffer buf) const;
 
 				/**
 				 * \brief Do the parsing.
 				 * \param buf buffer to parse.
+				 * \return The helper of the frame, if it was handled.
 				 */
-				void do_parse(boost::asio::mutable_buffer buf) const;
+				boost::optional<mutable_helper<frame_type> > do_parse(boost::asio::mutable_buffer buf) const;
 
 				/**
 				 * \brief Check if the frame has to be handled.
@@ -189,11 +169,9 @@ namespace asiotap
 				 * \param helper frame type helper.
 				 */
 				void frame_handled(const_helper<frame_type> helper) const {
-					m_last_const_helper = helper;
-
 					for (auto&& handler : m_const_handlers)
 					{
-						handler(*m_last_const_helper);
+						handler(helper);
 					}
 				}
 
@@ -202,11 +180,9 @@ namespace asiotap
 				 * \param helper frame type helper.
 				 */
 				void frame_handled(mutable_helper<frame_type> helper) const {
-					m_last_helper = helper;
-
 					for (auto&& handler : m_handlers)
 					{
-						handler(*m_last_helper);
+						handler(helper);
 					}
 				}
 
@@ -215,8 +191,6 @@ namespace asiotap
 				std::vector<frame_filter_callback> m_filters;
 				std::vector<frame_handler_callback> m_handlers;
 				std::vector<frame_const_handler_callback> m_const_handlers;
-				mutable boost::optional<mutable_helper<frame_type> > m_last_helper;
-				mutable boost::optional<const_helper<frame_type> > m_last_const_helper;
 		};
 
 		/**
@@ -253,14 +227,16 @@ namespace asiotap
 				/**
 				 * \brief Parse a frame.
 				 * \param parent The parent frame.
+				 * \return The helper of the frame, if it was handled.
 				 */
-				void parse(const_helper<typename ParentFilterType::frame_type> parent) const;
+				boost::optional<const_helper<OSIFrameType> > parse(const_helper<typename ParentFilterType::frame_type> parent) const;
 
 				/**
 				 * \brief Parse a frame.
 				 * \param parent The parent frame.
+				 * \return The helper of the frame, if it was handled.
 				 */
-				void parse(mutable_helper<typename ParentFilterType::frame_type> parent) const;
+				boost::optional<mutable_helper<OSIFrameType> > parse(mutable_helper<typename ParentFilterType::frame_type> parent) const;
 
 			protected:
 
@@ -293,14 +269,16 @@ namespace asiotap
 				/**
 				 * \brief Parse the specified buffer.
 				 * \param buf The buffer to parse.
+				 * \return The helper of the frame, if it was handled.
 				 */
-				void parse(boost::asio::const_buffer buf) const;
+				boost::optional<const_helper<OSIFrameType> > parse(boost::asio::const_buffer buf) const;
 
 				/**
 				 * \brief Parse the specified buffer.
 				 * \param buf The buffer to parse.
+				 * \return The helper of the frame, if it was handled.
 				 */
-				void parse(boost::asio::mutable_buffer buf) const;
+				boost::optional<mutable_helper<OSIFrameType> > parse(boost::asio::mutable_buffer buf) const;
 		};
 
 		/**
@@ -328,47 +306,44 @@ namespace asiotap
 		 */
 		template <typename OSIFrameType>
 		inline bool check_frame(mutable_helper<OSIFrameType> frame) {
-			return check_frame<OSIFrameType>(const_helper<OSIFrameType>(frame));
+			// No explicit template argument: the non-template overloads of the frame types must be found too.
+			return check_frame(const_helper<OSIFrameType>(frame));
 		}
 
 		template <typename OSIFrameType>
-		inline void _base_filter<OSIFrameType>::do_parse(boost::asio::const_buffer buf) const
+		inline boost::optional<const_helper<OSIFrameType> > _base_filter<OSIFrameType>::do_parse(boost::asio::const_buffer buf) const
 		{
-			try
-			{
-				const_helper<OSIFrameType> helper(buf);
+			const boost::optional<const_helper<OSIFrameType> > helper = try_helper<OSIFrameType>(buf);
 
-				if (check_frame(helper))
+			if (helper && check_frame(*helper))
+			{
+				if (_base_filter<OSIFrameType>::filter_frame(*helper))
 				{
-					if (_base_filter<OSIFrameType>::filter_frame(helper))
-					{
-						_base_filter<OSIFrameType>::frame_handled(helper);
-					}
+					_base_filter<OSIFrameType>::frame_handled(*helper);
+
+					return helper;
 				}
 			}
-			catch (std::logic_error&)
-			{
-			}
+
+			return boost::none;
 		}
 
 		template <typename OSIFrameType>
-		inline void _base_filter<OSIFrameType>::do_parse(boost::asio::mutable_buffer buf) const
+		inline boost::optional<mutable_helper<OSIFrameType> > _base_filter<OSIFrameType>::do_parse(boost::asio::mutable_buffer buf) const
 		{
-			try
-			{
-				mutable_helper<OSIFrameType> helper(buf);
+			const boost::optional<mutable_helper<OSIFrameType> > helper = try_helper<OSIFrameType>(buf);
 
-				if (check_frame(helper))
+			if (helper && check_frame(*helper))
+			{
+				if (_base_filter<OSIFrameType>::filter_frame(*helper))
 				{
-					if (_base_filter<OSIFrameType>::filter_frame(helper))
-					{
-						_base_filter<OSIFrameType>::frame_handled(helper);
-					}
+					_base_filter<OSIFrameType>::frame_handled(*helper);
+
+					return helper;
 				}
 			}
-			catch (std::logic_error&)
-			{
-			}
+
+			return boost::none;
 		}
 
 		template <typename OSIFrameType, typename ParentFilterType>
@@ -378,8 +353,8 @@ namespace asiotap
 			typedef _filter<OSIFrameType, ParentFilterType> filter_type;
 			typedef typename ParentFilterType::frame_type parent_frame_type;
 
-			const auto mutable_parse = static_cast<void (filter_type::*)(mutable_helper<parent_frame_type>) const>(&filter_type::parse);
-			const auto const_parse = static_cast<void (filter_type::*)(const_helper<parent_frame_type>) const>(&filter_type::parse);
+			const auto mutable_parse = static_cast<boost::optional<mutable_helper<OSIFrameType> > (filter_type::*)(mutable_helper<parent_frame_type>) const>(&filter_type::parse);
+			const auto const_parse = static_cast<boost::optional<const_helper<OSIFrameType> > (filter_type::*)(const_helper<parent_frame_type>) const>(&filter_type::parse);
 
 			m_parent.add_handler(boost::bind(mutable_parse, this, _1));
 			m_parent.add_const_handler(boost::bind(const_parse, this, _1));
@@ -407,75 +382,63 @@ namespace asiotap
 		}
 
 		template <typename OSIFrameType, typename ParentFilterType>
-		inline void _filter<OSIFrameType, ParentFilterType>::parse(const_helper<typename ParentFilterType::frame_type> parent_helper) const
+		inline boost::optional<const_helper<OSIFrameType> > _filter<OSIFrameType, ParentFilterType>::parse(const_helper<typename ParentFilterType::frame_type> parent_helper) const
 		{
-			_base_filter<OSIFrameType>::clear_last_helper();
-
 			if (frame_parent_match<OSIFrameType, typename ParentFilterType::frame_type>(parent_helper))
 			{
-				try
-				{
-					const_helper<OSIFrameType> helper(parent_helper.payload());
+				const boost::optional<const_helper<OSIFrameType> > helper = try_helper<OSIFrameType>(parent_helper.payload());
 
-					if (check_frame(helper))
+				if (helper && check_frame(*helper))
+				{
+					if (_base_filter<OSIFrameType>::filter_frame(*helper))
 					{
-						if (_base_filter<OSIFrameType>::filter_frame(helper))
+						if (bridge_filter_frame(parent_helper, *helper))
 						{
-							if (bridge_filter_frame(parent_helper, helper))
-							{
-								_base_filter<OSIFrameType>::frame_handled(helper);
-							}
+							_base_filter<OSIFrameType>::frame_handled(*helper);
+
+							return helper;
 						}
 					}
 				}
-				catch (std::logic_error&)
-				{
-				}
 			}
+
+			return boost::none;
 		}
 
 		template <typename OSIFrameType, typename ParentFilterType>
-		inline void _filter<OSIFrameType, ParentFilterType>::parse(mutable_helper<typename ParentFilterType::frame_type> parent_helper) const
+		inline boost::optional<mutable_helper<OSIFrameType> > _filter<OSIFrameType, ParentFilterType>::parse(mutable_helper<typename ParentFilterType::frame_type> parent_helper) const
 		{
-			_base_filter<OSIFrameType>::clear_last_helper();
-
 			if (frame_parent_match<OSIFrameType, typename ParentFilterType::frame_type>(parent_helper))
 			{
-				try
-				{
-					mutable_helper<OSIFrameType> helper(parent_helper.payload());
+				const boost::optional<mutable_helper<OSIFrameType> > helper = try_helper<OSIFrameType>(parent_helper.payload());
 
-					if (check_frame(helper))
+				if (helper && check_frame(*helper))
+				{
+					if (_base_filter<OSIFrameType>::filter_frame(*helper))
 					{
-						if (_base_filter<OSIFrameType>::filter_frame(helper))
+						if (bridge_filter_frame(parent_helper, *helper))
 						{
-							if (bridge_filter_frame(parent_helper, helper))
-							{
-								_base_filter<OSIFrameType>::frame_handled(helper);
-							}
+							_base_filter<OSIFrameType>::frame_handled(*helper);
+
+							return helper;
 						}
 					}
 				}
-				catch (std::logic_error&)
-				{
-				}
 			}
+
+			return boost::none;
 		}
 
 		template <typename OSIFrameType>
-		inline void _filter<OSIFrameType, void>::parse(boost::asio::const_buffer buf) const
+		inline boost::optional<const_helper<OSIFrameType> > _filter<OSIFrameType, void>::parse(boost::asio::const_buffer buf) const
 		{
-			_base_filter<OSIFrameType>::clear_last_helper();
-
-			_base_filter<OSIFrameType>::do_parse(buf);
+			return _base_filter<OSIFrameType>::do_parse(buf);
 		}
 
 		template <typename OSIFrameType>
-		inline void _filter<OSIFrameType, void>::parse(boost::asio::mutable_buffer buf) const
+		inline boost::optional<mutable_helper<OSIFrameType> > _filter<OSIFrameType, void>::parse(boost::asio::mutable_buffer buf) const
 		{
-			_base_filter<OSIFrameType>::clear_last_helper();
-
-			_base_filter<OSIFrameType>::do_parse(buf);
+			return _base_filter<OSIFrameType>::do_parse(buf);
 		}
 	}
 }
@@ -0,0 +1,85 @@
+/*
+ * libasiotap - A portable TAP adapter extension for Boost::ASIO.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libasiotap.
+ *
+ * libasiotap is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libasiotap is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libasiotap in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file icmp_error.hpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief ICMP and ICMPv6 "packet too big" error messages.
+ */
+
+#ifndef ASIOTAP_OSI_ICMP_ERROR_HPP
+#define ASIOTAP_OSI_ICMP_ERROR_HPP
+
+#include <boost/asio.hpp>
+
+#include <stdint.h>
+
+namespace asiotap
+{
+	namespace osi
+	{
+		/**
+		 * \brief The minimum MTU every IPv6 link must support.
+		 */
+		const size_t IPV6_MINIMUM_MTU = 1280;
+
+		/**
+		 * \brief Write an ICMP "fragmentation needed and DF set" message in response to an IPv4 packet.
+		 * \param buf The buffer to write the message to. It must not overlap packet.
+		 * \param packet The IPv4 packet that was too big.
+		 * \param mtu The MTU to advertise.
+		 * \return The size of the written IPv4 packet, or 0 if packet is not a valid IPv4 packet or buf is too small.
+		 *
+		 * The message goes from the destination of packet to its source, as if the remote host had emitted it: it quotes the IPv4 header and the first 8 bytes of payload of packet.
+		 */
+		size_t write_ipv4_fragmentation_needed(boost::asio::mutable_buffer buf, boost::asio::const_buffer packet, uint16_t mtu);
+
+		/**
+		 * \brief Write an ICMPv6 "packet too big" message in response to an IPv6 packet.
+		 * \param buf The buffer to write the message to. It must not overlap packet.
+		 * \param packet The IPv6 packet that was too big.
+		 * \param mtu The MTU to advertise.
+		 * \return The size of the written IPv6 packet, or 0 if packet is not a valid IPv6 packet or buf is too small.
+		 *
+		 * The message goes from the destination of packet to its source and quotes as much of packet as fits in IPV6_MINIMUM_MTU bytes.
+		 */
+		size_t write_ipv6_packet_too_big(boost::asio::mutable_buffer buf, boost::asio::const_buffer packet, uint32_t mtu);
+	}
+}
+
+#endif /* ASIOTAP_OSI_ICMP_ERROR_HPP */
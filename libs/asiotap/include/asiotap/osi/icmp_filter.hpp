@@ -114,7 +114,7 @@ namespace asiotap
 		template <>
 		inline bool frame_parent_match<icmp_frame>(const_helper<ipv4_frame> parent)
 		{
-			return ((parent.protocol() == ICMP_PROTOCOL) && (parent.tos() == 0));
+			return ((parent.protocol() == ICMP_PROTOCOL) && (parent.tos() == 0) && (parent.position_fragment() == 0));
 		}
 
 		template <>
@@ -70,6 +70,16 @@ namespace asiotap
 		 */
 		const uint8_t ICMP_ECHO_REQUEST = 0x08;
 
+		/**
+		 * \brief The ICMP destination unreachable message type.
+		 */
+		const uint8_t ICMP_DESTINATION_UNREACHABLE = 0x03;
+
+		/**
+		 * \brief The ICMP "fragmentation needed and DF set" destination unreachable code.
+		 */
+		const uint8_t ICMP_FRAGMENTATION_NEEDED = 0x04;
+
 		/**
 		 * \brief An ICMP frame structure.
 		 */
@@ -87,9 +87,7 @@ namespace asiotap
 		template <>
 		inline bool frame_parent_match<icmpv6_frame>(const_helper<ipv6_frame> parent)
 		{
-			// Okay, things might be a little more complex if we wanted to handle things perfectly.
-			// TODO: Handle the cases were the ICMPV6_HEADER is not the first and sole next-header.
-			return (parent.next_header() == ICMPV6_HEADER);
+			return has_upper_layer(parent, ICMPV6_HEADER);
 		}
 
 		/**
@@ -55,6 +55,11 @@ namespace asiotap
 		 */
 		const uint8_t ICMPV6_HEADER = 0x3A;
 
+		/**
+		 * \brief The packet too big type.
+		 */
+		const uint8_t ICMPV6_PACKET_TOO_BIG = 0x02;
+
 		/**
 		 * \brief The neighbor solicitation type.
 		 */
@@ -162,7 +162,7 @@ namespace asiotap
 				*/
 				typename _base_helper_impl::buffer_type payload_length(const_helper<ipv6_frame> parent_frame) const
 				{
-					return parent_frame.payload_length() - header_length();
+					return parent_frame.upper_layer_length() - header_length();
 				}
 
 		protected:
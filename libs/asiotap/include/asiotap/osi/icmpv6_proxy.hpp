@@ -49,8 +49,15 @@
 #include "ipv6_filter.hpp"
 #include "icmpv6_filter.hpp"
 #include "ethernet_address.hpp"
+#include "negative_cache.hpp"
 
 #include <boost/optional.hpp>
+#include <boost/array.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <iterator>
 
 namespace asiotap
 {
@@ -74,11 +81,33 @@ namespace asiotap
 				 */
 				typedef boost::function<bool (const boost::asio::ip::address_v6&, ethernet_address_type&)> neighbor_solicitation_callback_type;
 
+				/**
+				 * \brief The entry type.
+				 */
+				typedef std::pair<boost::asio::ip::address_v6, ethernet_address_type> entry_type;
+
+				/**
+				 * \brief The size of the target link-layer address option of a neighbor advertisement.
+				 */
+				static const size_t TARGET_LINK_LAYER_ADDRESS_OPTION_SIZE = 8;
+
+				/**
+				 * \brief The size of a neighbor advertisement, IPv6 header included.
+				 */
+				static const size_t REPLY_SIZE = sizeof(ipv6_frame) + sizeof(icmpv6_frame) + TARGET_LINK_LAYER_ADDRESS_OPTION_SIZE;
+
+				/**
+				 * \brief The default time during which an address the callback could not resolve is not submitted to it again.
+				 */
+				static const boost::posix_time::time_duration DEFAULT_NEGATIVE_CACHE_TTL;
+
 				/**
 				 * \brief Create an ARP proxy.
 				 */
 				proxy() :
-					m_neighbor_solicitation_callback()
+					m_entry_map(),
+					m_neighbor_solicitation_callback(),
+					m_negative_cache(DEFAULT_NEGATIVE_CACHE_TTL)
 				{
 				}
 
@@ -89,6 +118,63 @@ namespace asiotap
 				void set_neighbor_solicitation_callback(neighbor_solicitation_callback_type callback)
 				{
 					m_neighbor_solicitation_callback = callback;
+					m_negative_cache.clear();
+				}
+
+				/**
+				 * \brief Add a proxy entry.
+				 * \param entry The entry to add.
+				 * \return If an entry for the specified logical address already exists, nothing is done and the call returns false. Otherwise, the call returns true.
+				 */
+				bool add_entry(const entry_type& entry);
+
+				/**
+				 * \brief Add a proxy entry.
+				 * \param logical_address The logical address.
+				 * \param hardware_address The hardware address.
+				 * \return If an entry for the specified logical address already exists, nothing is done and the call returns false. Otherwise, the call returns true.
+				 */
+				bool add_entry(const boost::asio::ip::address_v6& logical_address, const ethernet_address_type& hardware_address)
+				{
+					return add_entry(std::make_pair(logical_address, hardware_address));
+				}
+
+				/**
+				 * \brief Delete a proxy entry.
+				 * \param logical_address The logical address.
+				 * \return If an entry was deleted, true is returned. Otherwise, the call returns false.
+				 */
+				bool remove_entry(const boost::asio::ip::address_v6& logical_address)
+				{
+					return (m_entry_map.erase(logical_address) > 0);
+				}
+
+				/**
+				 * \brief Replace all the proxy entries.
+				 * \param begin An iterator to the first entry_type to set.
+				 * \param end An iterator past the last entry_type to set.
+				 *
+				 * The table is sized once for all the entries. If several entries share a logical address, the first one is kept.
+				 */
+				template <typename ForwardIterator>
+				void set_entries(ForwardIterator begin, ForwardIterator end)
+				{
+					m_entry_map.clear();
+					m_entry_map.reserve(std::distance(begin, end));
+
+					for (; begin != end; ++begin)
+					{
+						add_entry(*begin);
+					}
+				}
+
+				/**
+				 * \brief Set the time during which an address the callback could not resolve is not submitted to it again.
+				 * \param ttl The time to live of the unresolved addresses. A non-positive value disables the caching.
+				 */
+				void set_negative_cache_ttl(boost::posix_time::time_duration ttl)
+				{
+					m_negative_cache.set_ttl(ttl);
 				}
 
 				/**
@@ -97,12 +183,38 @@ namespace asiotap
 				 * \param icmpv6_helper The ICMPv6 layer.
 				 * \param response_buffer The buffer to write the response to.
 				 * \return The buffer that contains the answer, if there is one.
+				 *
+				 * The neighbor advertisement is copied from the template of the matching entry and only the fields that depend on the solicitation are patched.
 				 */
 				boost::optional<boost::asio::const_buffer> process_frame(const_helper<ipv6_frame> ipv6_helper, const_helper<icmpv6_frame> icmpv6_helper,  boost::asio::mutable_buffer response_buffer) const;
 
 			private:
 
+				/**
+				 * \brief A prebuilt neighbor advertisement, sent to the unspecified address and checksummed as such.
+				 */
+				typedef boost::array<uint8_t, REPLY_SIZE> reply_template_type;
+
+				struct address_hash
+				{
+					size_t operator()(const boost::asio::ip::address_v6& address) const
+					{
+						const boost::asio::ip::address_v6::bytes_type bytes = address.to_bytes();
+
+						return boost::hash_range(bytes.begin(), bytes.end());
+					}
+				};
+
+				typedef boost::unordered_map<boost::asio::ip::address_v6, reply_template_type, address_hash> entry_map_type;
+
+				static void write_reply_template(boost::asio::mutable_buffer buf, const boost::asio::ip::address_v6& logical_address, const ethernet_address_type& hardware_address);
+				static void patch_reply(boost::asio::mutable_buffer buf, const_helper<ipv6_frame> ipv6_helper);
+
+				entry_map_type m_entry_map;
 				neighbor_solicitation_callback_type m_neighbor_solicitation_callback;
+
+				// The callback is only called from process_frame(), which is logically const.
+				mutable negative_cache<boost::asio::ip::address_v6, address_hash> m_negative_cache;
 		};
 	}
 }
@@ -119,7 +119,12 @@ namespace asiotap
 		 * \return true on success.
 		 */
 		inline bool check_frame(const_helper<ipv4_frame> frame) {
-			return ((frame.version() == IP_PROTOCOL_VERSION_4) && (frame.ihl() >= 5));
+			return (
+			           (frame.version() == IP_PROTOCOL_VERSION_4) &&
+			           (frame.ihl() >= 5) &&
+			           (frame.header_length() <= boost::asio::buffer_size(frame.buffer())) &&
+			           (frame.total_length() >= frame.header_length())
+			       );
 		}
 	}
 }
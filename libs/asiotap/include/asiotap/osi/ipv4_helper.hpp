@@ -307,13 +307,13 @@ namespace asiotap
 		template <class HelperTag>
 		inline uint8_t _base_helper_impl<HelperTag, ipv4_frame>::flags() const
 		{
-			return static_cast<uint8_t>((this->frame().flags_fragment & 0xE000) >> 13);
+			return static_cast<uint8_t>((ntohs(this->frame().flags_fragment) & 0xE000) >> 13);
 		}
 
 		template <class HelperTag>
 		inline uint16_t _base_helper_impl<HelperTag, ipv4_frame>::position_fragment() const
 		{
-			return (this->frame().flags_fragment & 0x1FFF);
+			return (ntohs(this->frame().flags_fragment) & 0x1FFF);
 		}
 
 		template <class HelperTag>
@@ -385,12 +385,12 @@ namespace asiotap
 
 		inline void _helper_impl<mutable_helper_tag, ipv4_frame>::set_flags(uint8_t _flags) const
 		{
-			this->frame().flags_fragment = (this->frame().flags_fragment & 0x1FFF) | ((static_cast<uint16_t>(_flags) & 0x0007) << 13);
+			this->frame().flags_fragment = htons(static_cast<uint16_t>((ntohs(this->frame().flags_fragment) & 0x1FFF) | ((static_cast<uint16_t>(_flags) & 0x0007) << 13)));
 		}
 
 		inline void _helper_impl<mutable_helper_tag, ipv4_frame>::set_position_fragment(uint16_t _position_fragment) const
 		{
-			this->frame().flags_fragment = (this->frame().flags_fragment & 0xE000) | (_position_fragment & 0x1FFF);
+			this->frame().flags_fragment = htons(static_cast<uint16_t>((ntohs(this->frame().flags_fragment) & 0xE000) | (_position_fragment & 0x1FFF)));
 		}
 
 		inline void _helper_impl<mutable_helper_tag, ipv4_frame>::set_ttl(uint8_t _ttl) const
@@ -61,6 +61,43 @@ namespace asiotap
 		 */
 		const uint8_t IP_PROTOCOL_VERSION_6 = 0x06;
 
+		/**
+		 * \brief The IPv6 hop-by-hop options extension header.
+		 */
+		const uint8_t IPV6_HOP_BY_HOP_OPTIONS_HEADER = 0x00;
+
+		/**
+		 * \brief The IPv6 routing extension header.
+		 */
+		const uint8_t IPV6_ROUTING_HEADER = 0x2B;
+
+		/**
+		 * \brief The IPv6 fragment extension header.
+		 */
+		const uint8_t IPV6_FRAGMENT_HEADER = 0x2C;
+
+		/**
+		 * \brief The IPv6 authentication extension header.
+		 */
+		const uint8_t IPV6_AUTHENTICATION_HEADER = 0x33;
+
+		/**
+		 * \brief The IPv6 "no next header" value.
+		 */
+		const uint8_t IPV6_NO_NEXT_HEADER = 0x3B;
+
+		/**
+		 * \brief The IPv6 destination options extension header.
+		 */
+		const uint8_t IPV6_DESTINATION_OPTIONS_HEADER = 0x3C;
+
+		/**
+		 * \brief The maximum count of extension headers walked before giving up on a packet.
+		 *
+		 * Legitimate packets rarely carry more than two or three: the bound keeps crafted chains from costing more than a few reads.
+		 */
+		const unsigned int IPV6_MAX_EXTENSION_HEADERS = 8;
+
 #ifdef MSV
 #pragma pack(push, 1)
 #endif
@@ -52,6 +52,26 @@ namespace asiotap
 {
 	namespace osi
 	{
+		/**
+		 * \brief The upper-layer header of an IPv6 packet, past its extension headers.
+		 */
+		struct ipv6_upper_layer
+		{
+			uint8_t protocol; /**< The upper-layer protocol */
+			size_t offset; /**< The offset of the upper-layer header, from the start of the IPv6 header */
+			bool fragment; /**< Whether a fragment extension header was found */
+			bool first_fragment; /**< Whether the packet is unfragmented or the first fragment: only then does offset point to a real upper-layer header */
+		};
+
+		/**
+		 * \brief Walk the extension headers of an IPv6 packet.
+		 * \param buf The IPv6 packet, starting at its fixed header.
+		 * \return The upper-layer header, or nothing if the chain is truncated or longer than IPV6_MAX_EXTENSION_HEADERS. This never throws.
+		 *
+		 * The walk stops at the first fragment extension header of a non-first fragment, as what follows it is not a header.
+		 */
+		boost::optional<ipv6_upper_layer> find_ipv6_upper_layer(boost::asio::const_buffer buf);
+
 		/**
 		 * \brief The base ipv6 helper implementation class.
 		 */
@@ -108,13 +128,30 @@ namespace asiotap
 				 */
 				boost::asio::ip::address_v6 destination() const;
 
+				/**
+				 * \brief Get the upper-layer header.
+				 * \return The upper-layer header, or nothing if the extension headers chain cannot be walked.
+				 */
+				boost::optional<ipv6_upper_layer> upper_layer() const
+				{
+					return find_ipv6_upper_layer(this->buffer());
+				}
+
+				/**
+				 * \brief Get the upper-layer length, as used in the pseudo-header of upper-layer checksums.
+				 * \return The payload length, minus the extension headers.
+				 */
+				size_t upper_layer_length() const;
+
 				/**
 				 * \brief Get the payload buffer.
-				 * \return The payload.
+				 * \return The payload, past any extension header.
 				 */
 				typename _base_helper_impl::buffer_type payload() const
 				{
-					return this->buffer() + header_length();
+					const boost::optional<ipv6_upper_layer> _upper_layer = upper_layer();
+
+					return this->buffer() + (_upper_layer ? _upper_layer->offset : header_length());
 				}
 
 				/**
@@ -255,6 +292,15 @@ namespace asiotap
 			return address_v6(raw);
 		}
 
+		template <class HelperTag>
+		inline size_t _base_helper_impl<HelperTag, ipv6_frame>::upper_layer_length() const
+		{
+			const boost::optional<ipv6_upper_layer> _upper_layer = upper_layer();
+			const size_t extension_headers_length = _upper_layer ? (_upper_layer->offset - header_length()) : 0;
+
+			return (payload_length() > extension_headers_length) ? (payload_length() - extension_headers_length) : 0;
+		}
+
 		template <class HelperTag>
 		inline size_t _base_helper_impl<HelperTag, ipv6_frame>::header_length() const
 		{
@@ -311,6 +357,25 @@ namespace asiotap
 			_base_helper_impl<mutable_helper_tag, ipv6_frame>(buf)
 		{
 		}
+
+		/**
+		 * \brief Check if an IPv6 packet carries a given upper-layer header.
+		 * \param helper The IPv6 packet.
+		 * \param protocol The upper-layer protocol.
+		 * \return true if the upper-layer header past the extension headers is of the specified protocol and is actually present, that is if the packet is not a non-first fragment.
+		 */
+		inline bool has_upper_layer(const_helper<ipv6_frame> helper, uint8_t protocol)
+		{
+			// Most packets have no extension header at all: don't walk the chain for them.
+			if (helper.next_header() == protocol)
+			{
+				return true;
+			}
+
+			const boost::optional<ipv6_upper_layer> upper_layer = helper.upper_layer();
+
+			return (upper_layer && upper_layer->first_fragment && (upper_layer->protocol == protocol));
+		}
 	}
 }
 
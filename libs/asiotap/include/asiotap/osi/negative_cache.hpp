@@ -0,0 +1,211 @@
+/*
+ * libasiotap - A portable TAP adapter extension for Boost::ASIO.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libasiotap.
+ *
+ * libasiotap is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libasiotap is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libasiotap in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file negative_cache.hpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief A cache of the addresses a proxy recently failed to resolve.
+ */
+
+#ifndef ASIOTAP_OSI_NEGATIVE_CACHE_HPP
+#define ASIOTAP_OSI_NEGATIVE_CACHE_HPP
+
+#include <boost/unordered_map.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+namespace asiotap
+{
+	namespace osi
+	{
+		/**
+		 * \brief A cache of the keys that recently had no answer.
+		 *
+		 * Each key is remembered for a fixed time to live. The cache never holds more than a maximum count of keys: when it is full, the expired keys are purged and, if that is not enough, the whole cache is dropped.
+		 */
+		template <typename KeyType, typename Hash = boost::hash<KeyType> >
+		class negative_cache
+		{
+			public:
+
+				/**
+				 * \brief The default maximum count of keys.
+				 */
+				static const size_t DEFAULT_MAX_SIZE = 4096;
+
+				/**
+				 * \brief Create a negative cache.
+				 * \param ttl The time to live of the keys. A non-positive value disables the cache.
+				 * \param max_size The maximum count of keys.
+				 */
+				explicit negative_cache(boost::posix_time::time_duration ttl, size_t max_size = DEFAULT_MAX_SIZE) :
+					m_ttl(ttl),
+					m_max_size(max_size),
+					m_expirations()
+				{
+				}
+
+				/**
+				 * \brief Get the time to live of the keys.
+				 * \return The time to live of the keys.
+				 */
+				boost::posix_time::time_duration ttl() const
+				{
+					return m_ttl;
+				}
+
+				/**
+				 * \brief Set the time to live of the keys.
+				 * \param ttl The time to live of the keys. A non-positive value disables the cache.
+				 *
+				 * The keys already in the cache keep their expiration.
+				 */
+				void set_ttl(boost::posix_time::time_duration ttl)
+				{
+					m_ttl = ttl;
+
+					if (!is_enabled())
+					{
+						clear();
+					}
+				}
+
+				/**
+				 * \brief Check if the cache is enabled.
+				 * \return true if the keys are remembered.
+				 */
+				bool is_enabled() const
+				{
+					return (m_ttl > boost::posix_time::time_duration());
+				}
+
+				/**
+				 * \brief Check if a key is in the cache.
+				 * \param key The key.
+				 * \param now The current time.
+				 * \return true if the key is in the cache and did not expire yet. An expired key is removed.
+				 */
+				bool contains(const KeyType& key, const boost::posix_time::ptime& now)
+				{
+					const typename expiration_map_type::iterator entry = m_expirations.find(key);
+
+					if (entry == m_expirations.end())
+					{
+						return false;
+					}
+
+					if (now < entry->second)
+					{
+						return true;
+					}
+
+					m_expirations.erase(entry);
+
+					return false;
+				}
+
+				/**
+				 * \brief Add a key to the cache.
+				 * \param key The key.
+				 * \param now The current time.
+				 */
+				void insert(const KeyType& key, const boost::posix_time::ptime& now)
+				{
+					if (!is_enabled() || (m_max_size == 0))
+					{
+						return;
+					}
+
+					if (m_expirations.size() >= m_max_size)
+					{
+						purge(now);
+
+						// Requests for that many distinct unknown keys are likely a scan: remembering them is pointless.
+						if (m_expirations.size() >= m_max_size)
+						{
+							clear();
+						}
+					}
+
+					m_expirations[key] = now + m_ttl;
+				}
+
+				/**
+				 * \brief Remove a key from the cache.
+				 * \param key The key.
+				 */
+				void erase(const KeyType& key)
+				{
+					m_expirations.erase(key);
+				}
+
+				/**
+				 * \brief Remove all the keys from the cache.
+				 */
+				void clear()
+				{
+					m_expirations.clear();
+				}
+
+			private:
+
+				typedef boost::unordered_map<KeyType, boost::posix_time::ptime, Hash> expiration_map_type;
+
+				void purge(const boost::posix_time::ptime& now)
+				{
+					for (typename expiration_map_type::iterator entry = m_expirations.begin(); entry != m_expirations.end();)
+					{
+						if (now < entry->second)
+						{
+							++entry;
+						}
+						else
+						{
+							entry = m_expirations.erase(entry);
+						}
+					}
+				}
+
+				boost::posix_time::time_duration m_ttl;
+				size_t m_max_size;
+				expiration_map_type m_expirations;
+		};
+	}
+}
+
+#endif /* ASIOTAP_OSI_NEGATIVE_CACHE_HPP */
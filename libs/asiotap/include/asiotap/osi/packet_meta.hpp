@@ -0,0 +1,201 @@
+/*
+ * libasiotap - A portable TAP adapter extension for Boost::ASIO.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libasiotap.
+ *
+ * libasiotap is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libasiotap is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libasiotap in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file packet_meta.hpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief A packet metadata descriptor, computed once per frame.
+ */
+
+#ifndef ASIOTAP_OSI_PACKET_META_HPP
+#define ASIOTAP_OSI_PACKET_META_HPP
+
+#include <boost/asio.hpp>
+#include <boost/array.hpp>
+
+#include <stdint.h>
+
+namespace asiotap
+{
+	namespace osi
+	{
+		/**
+		 * \brief The metadata of a frame, as seen when it entered the system.
+		 *
+		 * It is computed in a single pass by parse_ethernet_packet_meta() or parse_ip_packet_meta() and then travels alongside the frame, so that switching, routing and TCP MSS clamping read it instead of parsing the frame again.
+		 *
+		 * Offsets are relative to the start of the frame buffer and only meaningful if the matching has_*() method returns true. Multi-byte values are in host byte order. The meta does not refer to the buffer: it stays valid as long as the frame bytes it was computed from are not moved or resized.
+		 */
+		struct packet_meta
+		{
+			/**
+			 * \brief The ethernet header was found.
+			 */
+			static const uint8_t LAYER_2 = 0x01;
+
+			/**
+			 * \brief A valid IPv4 or IPv6 header was found.
+			 */
+			static const uint8_t LAYER_3 = 0x02;
+
+			/**
+			 * \brief A complete transport header was found.
+			 */
+			static const uint8_t LAYER_4 = 0x04;
+
+			/**
+			 * \brief The IPv4 or IPv6 packet is a fragment.
+			 *
+			 * Only the first fragment of a packet carries its transport header: the others never have LAYER_4 set. The flow hash of fragments ignores the ports, so that all the fragments of a packet get the same one.
+			 */
+			static const uint8_t FRAGMENT = 0x08;
+
+			/**
+			 * \brief Create an empty metadata descriptor.
+			 */
+			packet_meta() :
+				layers(0),
+				ip_version(0),
+				protocol(0),
+				ethertype(0),
+				l2_offset(0),
+				l3_offset(0),
+				l4_offset(0),
+				source_port(0),
+				destination_port(0),
+				flow_hash(0),
+				ethernet_target(),
+				ethernet_sender(),
+				source(),
+				destination()
+			{
+			}
+
+			/**
+			 * \brief Check if the ethernet header was found.
+			 * \return true if it was.
+			 */
+			bool has_l2() const
+			{
+				return ((layers & LAYER_2) != 0);
+			}
+
+			/**
+			 * \brief Check if an IP header was found.
+			 * \return true if it was.
+			 */
+			bool has_l3() const
+			{
+				return ((layers & LAYER_3) != 0);
+			}
+
+			/**
+			 * \brief Check if a transport header was found.
+			 * \return true if it was.
+			 */
+			bool has_l4() const
+			{
+				return ((layers & LAYER_4) != 0);
+			}
+
+			/**
+			 * \brief Check if the packet is a fragment.
+			 * \return true if it is.
+			 */
+			bool is_fragment() const
+			{
+				return ((layers & FRAGMENT) != 0);
+			}
+
+			/**
+			 * \brief Get the IPv4 source address.
+			 * \return The IPv4 source address. Only meaningful when ip_version is 4.
+			 */
+			boost::asio::ip::address_v4 ipv4_source() const;
+
+			/**
+			 * \brief Get the IPv4 destination address.
+			 * \return The IPv4 destination address. Only meaningful when ip_version is 4.
+			 */
+			boost::asio::ip::address_v4 ipv4_destination() const;
+
+			/**
+			 * \brief Get the IPv6 source address.
+			 * \return The IPv6 source address. Only meaningful when ip_version is 6.
+			 */
+			boost::asio::ip::address_v6 ipv6_source() const;
+
+			/**
+			 * \brief Get the IPv6 destination address.
+			 * \return The IPv6 destination address. Only meaningful when ip_version is 6.
+			 */
+			boost::asio::ip::address_v6 ipv6_destination() const;
+
+			uint8_t layers; /**< The LAYER_* and FRAGMENT flags */
+			uint8_t ip_version; /**< The IP version: 4, 6 or 0 if there is no IP header */
+			uint8_t protocol; /**< The IPv4 protocol or the IPv6 upper-layer protocol, past the extension headers */
+			uint16_t ethertype; /**< The ethernet protocol, or the one matching the IP version for frames without an ethernet header */
+			uint16_t l2_offset; /**< The offset of the ethernet header */
+			uint16_t l3_offset; /**< The offset of the IP header */
+			uint16_t l4_offset; /**< The offset of the transport header, past the IPv6 extension headers if any */
+			uint16_t source_port; /**< The TCP or UDP source port */
+			uint16_t destination_port; /**< The TCP or UDP destination port */
+			uint32_t flow_hash; /**< A hash of the protocol, addresses and ports, identical for both directions of a flow */
+			boost::array<uint8_t, 6> ethernet_target; /**< The destination MAC address */
+			boost::array<uint8_t, 6> ethernet_sender; /**< The source MAC address */
+			boost::array<uint8_t, 16> source; /**< The source IP address. IPv4 addresses use the first 4 bytes */
+			boost::array<uint8_t, 16> destination; /**< The destination IP address. IPv4 addresses use the first 4 bytes */
+		};
+
+		/**
+		 * \brief Compute the metadata of an ethernet frame.
+		 * \param buf The frame.
+		 * \return The metadata. Layers that are missing or malformed are left unset: this never throws.
+		 */
+		packet_meta parse_ethernet_packet_meta(boost::asio::const_buffer buf);
+
+		/**
+		 * \brief Compute the metadata of an IPv4 or IPv6 packet, as read on a TUN adapter.
+		 * \param buf The packet.
+		 * \return The metadata. Layers that are missing or malformed are left unset: this never throws.
+		 */
+		packet_meta parse_ip_packet_meta(boost::asio::const_buffer buf);
+	}
+}
+
+#endif /* ASIOTAP_OSI_PACKET_META_HPP */
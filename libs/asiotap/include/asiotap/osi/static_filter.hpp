@@ -0,0 +1,242 @@
+/*
+ * libasiotap - A portable TAP adapter extension for Boost::ASIO.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libasiotap.
+ *
+ * libasiotap is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libasiotap is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libasiotap in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file static_filter.hpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief An OSI filter pipeline composed at compile time.
+ */
+
+#ifndef ASIOTAP_OSI_STATIC_FILTER_HPP
+#define ASIOTAP_OSI_STATIC_FILTER_HPP
+
+#include "filter.hpp"
+
+#include <tuple>
+#include <type_traits>
+
+namespace asiotap
+{
+	namespace osi
+	{
+		/**
+		 * \brief A static filter handler that accepts every frame.
+		 */
+		struct accept_frame
+		{
+			/**
+			 * \brief Accept a frame.
+			 * \return true.
+			 */
+			template <typename... HelperTypes>
+			bool operator()(HelperTypes...) const
+			{
+				return true;
+			}
+		};
+
+		/**
+		 * \brief An OSI filter whose handler and children are fixed at compile time.
+		 *
+		 * This is the static counterpart of filter<>: the whole tree of filters is a single type, so that parsing a frame involves no indirect call and can be inlined entirely.
+		 *
+		 * The handler is called with the helper of the frame, followed by the helpers of its parent frames, from the closest to the root one. It returns true if the frame must be handed to the children filters. A frame that does not pass check_frame() never reaches the handler.
+		 *
+		 * Every child filter whose frame_parent_match() accepts the frame parses its payload, like filter<> does.
+		 *
+		 * Example, for an ethernet to ARP or IPv4, UDP, BOOTP and DHCP chain:
+		 *
+		 * \code
+		 * auto pipeline = make_static_filter<ethernet_frame>(
+		 *     accept_frame(),
+		 *     make_static_filter<arp_frame>(arp_handler),
+		 *     make_static_filter<ipv4_frame>(
+		 *         accept_frame(),
+		 *         make_static_filter<udp_frame>(
+		 *             accept_frame(),
+		 *             make_static_filter<bootp_frame>(
+		 *                 accept_frame(),
+		 *                 make_static_filter<dhcp_frame>(dhcp_handler)
+		 *             )
+		 *         )
+		 *     )
+		 * );
+		 *
+		 * pipeline.parse(buffer);
+		 * \endcode
+		 */
+		template <typename OSIFrameType, typename HandlerType = accept_frame, typename... ChildTypes>
+		class static_filter
+		{
+			public:
+
+				/**
+				 * \brief The frame type.
+				 */
+				typedef OSIFrameType frame_type;
+
+				/**
+				 * \brief The handler type.
+				 */
+				typedef HandlerType handler_type;
+
+				/**
+				 * \brief The children filters type.
+				 */
+				typedef std::tuple<ChildTypes...> children_type;
+
+				/**
+				 * \brief Create a static filter.
+				 * \param _handler The handler.
+				 * \param children The children filters.
+				 */
+				explicit static_filter(handler_type _handler = handler_type(), ChildTypes... children) :
+					m_handler(_handler),
+					m_children(children...)
+				{
+				}
+
+				/**
+				 * \brief Get the handler.
+				 * \return The handler.
+				 */
+				handler_type& handler()
+				{
+					return m_handler;
+				}
+
+				/**
+				 * \brief Get a child filter.
+				 * \return The child filter at the specified index.
+				 */
+				template <size_t Index>
+				typename std::tuple_element<Index, children_type>::type& child()
+				{
+					return std::get<Index>(m_children);
+				}
+
+				/**
+				 * \brief Parse the specified buffer.
+				 * \param buf The buffer to parse.
+				 * \return true if the frame was handled.
+				 */
+				bool parse(boost::asio::const_buffer buf)
+				{
+					const boost::optional<const_helper<frame_type> > helper = try_helper<frame_type>(buf);
+
+					return helper && handle(*helper);
+				}
+
+				/**
+				 * \brief Parse the specified buffer.
+				 * \param buf The buffer to parse.
+				 * \return true if the frame was handled.
+				 */
+				bool parse(boost::asio::mutable_buffer buf)
+				{
+					const boost::optional<mutable_helper<frame_type> > helper = try_helper<frame_type>(buf);
+
+					return helper && handle(*helper);
+				}
+
+				/**
+				 * \brief Parse the payload of a parent frame.
+				 * \param parent The parent frame.
+				 * \param ancestors The ancestors of the parent frame, from the closest to the root one.
+				 * \return true if the frame was handled.
+				 */
+				template <typename ParentHelperType, typename... AncestorHelperTypes>
+				bool parse_payload(ParentHelperType parent, AncestorHelperTypes... ancestors)
+				{
+					if (!frame_parent_match<frame_type, typename ParentHelperType::frame_type>(parent))
+					{
+						return false;
+					}
+
+					const auto helper = try_helper<frame_type>(parent.payload());
+
+					return helper && handle(*helper, parent, ancestors...);
+				}
+
+			private:
+
+				template <typename HelperType, typename... ParentHelperTypes>
+				bool handle(HelperType helper, ParentHelperTypes... parents)
+				{
+					if (!check_frame(helper) || !m_handler(helper, parents...))
+					{
+						return false;
+					}
+
+					dispatch<0>(helper, parents...);
+
+					return true;
+				}
+
+				template <size_t Index, typename... HelperTypes>
+				typename std::enable_if<(Index < sizeof...(ChildTypes))>::type dispatch(HelperTypes... helpers)
+				{
+					std::get<Index>(m_children).parse_payload(helpers...);
+
+					dispatch<Index + 1>(helpers...);
+				}
+
+				template <size_t Index, typename... HelperTypes>
+				typename std::enable_if<(Index == sizeof...(ChildTypes))>::type dispatch(HelperTypes...)
+				{
+				}
+
+				handler_type m_handler;
+				children_type m_children;
+		};
+
+		/**
+		 * \brief Create a static filter.
+		 * \param handler The handler.
+		 * \param children The children filters.
+		 * \return The static filter.
+		 */
+		template <typename OSIFrameType, typename HandlerType, typename... ChildTypes>
+		inline static_filter<OSIFrameType, HandlerType, ChildTypes...> make_static_filter(HandlerType handler, ChildTypes... children)
+		{
+			return static_filter<OSIFrameType, HandlerType, ChildTypes...>(handler, children...);
+		}
+	}
+}
+
+#endif /* ASIOTAP_OSI_STATIC_FILTER_HPP */
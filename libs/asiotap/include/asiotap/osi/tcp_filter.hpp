@@ -96,7 +96,8 @@ namespace asiotap
 		 */
 		template <>
 		inline bool frame_parent_match<tcp_frame>(const_helper<ipv4_frame> parent) {
-			return (parent.protocol() == TCP_PROTOCOL);
+			// Only the first fragment carries the TCP header.
+			return ((parent.protocol() == TCP_PROTOCOL) && (parent.position_fragment() == 0));
 		}
 
 		/**
@@ -106,7 +107,16 @@ namespace asiotap
 		 */
 		template <>
 		inline bool frame_parent_match<tcp_frame>(const_helper<ipv6_frame> parent) {
-			return (parent.next_header() == TCP_PROTOCOL);
+			return has_upper_layer(parent, TCP_PROTOCOL);
+		}
+
+		/**
+		 * \brief Check if a frame is valid.
+		 * \param frame The frame.
+		 * \return true on success.
+		 */
+		inline bool check_frame(const_helper<tcp_frame> frame) {
+			return ((frame.offset() >= sizeof(tcp_frame)) && (frame.offset() <= boost::asio::buffer_size(frame.buffer())));
 		}
 	}
 }
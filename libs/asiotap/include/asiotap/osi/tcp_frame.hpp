@@ -59,6 +59,11 @@ namespace asiotap
 		 */
 		const uint8_t TCP_PROTOCOL = 0x06;
 
+		/**
+		 * \brief The TCP SYN flag, in the 14th byte of the header.
+		 */
+		const uint8_t TCP_FLAG_SYN = 0x02;
+
 		/**
 		 * \brief The TCP end option.
 		 */
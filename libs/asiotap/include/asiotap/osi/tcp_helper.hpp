@@ -87,11 +87,12 @@ namespace asiotap
 									break;
 							}
 
-							if (buf_size < 1) {
+							if (buf_size < 2) {
 								return false;
 							}
 
-							if (size() > buf_size) {
+							// A length smaller than 2 would make next_option() loop forever.
+							if ((size() < 2) || (size() > buf_size)) {
 								return false;
 							}
 
@@ -252,7 +253,10 @@ namespace asiotap
 				 */
 				typename _base_helper_impl::buffer_type options_payload() const
 				{
-					return boost::asio::buffer(this->buffer() + sizeof(typename _base_helper_impl<HelperTag, tcp_frame>::frame_type), offset());
+					const size_t _offset = offset();
+					const size_t options_size = (_offset > sizeof(typename _base_helper_impl<HelperTag, tcp_frame>::frame_type)) ? (_offset - sizeof(typename _base_helper_impl<HelperTag, tcp_frame>::frame_type)) : 0;
+
+					return boost::asio::buffer(this->buffer() + sizeof(typename _base_helper_impl<HelperTag, tcp_frame>::frame_type), options_size);
 				}
 
 				/**
@@ -48,7 +48,9 @@
 #include "ipv4_helper.hpp"
 #include "ipv6_helper.hpp"
 
-#include <boost/optional.hpp>
+#include <atomic>
+
+#include <boost/noncopyable.hpp>
 
 namespace asiotap
 {
@@ -56,20 +58,84 @@ namespace asiotap
 	{
 		/**
 		 * \brief An TCP MSS morpher class.
+		 *
+		 * The morpher may be used from several threads at once, and its max MSS changed while it is.
 		 */
-		class tcp_mss_morpher
+		class tcp_mss_morpher : public boost::noncopyable
 		{
 			public:
 
+				/**
+				 * \brief The direction of a segment, as seen from the TAP adapter.
+				 */
+				enum class direction
+				{
+					outgoing, /**< The segment was read from the TAP adapter. */
+					incoming /**< The segment is to be written to the TAP adapter. */
+				};
+
+				/**
+				 * \brief The statistics type.
+				 */
+				struct statistics_type
+				{
+					uint64_t outgoing_clamped; /**< The count of outgoing SYN segments whose MSS was clamped. */
+					uint64_t incoming_clamped; /**< The count of incoming SYN segments whose MSS was clamped. */
+				};
+
 				/**
 				 * \brief Create a TCP MSS morpher.
-				 * \brief The max MSS value.
+				 * \param max_mss The max MSS value. 0 disables the clamping.
+				 */
+				explicit tcp_mss_morpher(size_t max_mss = 0) :
+					m_max_mss(max_mss),
+					m_outgoing_clamped(0),
+					m_incoming_clamped(0)
+				{
+				}
+
+				/**
+				 * \brief Get the max MSS value.
+				 * \return The max MSS value. 0 means the clamping is disabled.
+				 */
+				size_t max_mss() const
+				{
+					return m_max_mss.load(std::memory_order_relaxed);
+				}
+
+				/**
+				 * \brief Set the max MSS value.
+				 * \param max_mss The max MSS value. 0 disables the clamping.
 				 */
-				tcp_mss_morpher(size_t max_mss) :
-					m_max_mss(max_mss)
+				void set_max_mss(size_t max_mss)
 				{
+					m_max_mss.store(max_mss, std::memory_order_relaxed);
 				}
 
+				/**
+				 * \brief Handle a TCP segment.
+				 * \param tcp_segment The TCP segment, starting at its header.
+				 * \param _direction The direction of the segment.
+				 * \return true if the MSS option of the segment was clamped.
+				 *
+				 * Non-SYN segments, which are the vast majority, are told apart from the flags byte alone: nothing else is read for them. The checksum of clamped segments is updated incrementally.
+				 */
+				bool handle(boost::asio::mutable_buffer tcp_segment, direction _direction = direction::outgoing)
+				{
+					return handle(tcp_segment, _direction, 0);
+				}
+
+				/**
+				 * \brief Handle a TCP segment, with an additional limit.
+				 * \param tcp_segment The TCP segment, starting at its header.
+				 * \param _direction The direction of the segment.
+				 * \param limit The max MSS for this segment only, usually derived from the MTU of its destination. 0 means no additional limit.
+				 * \return true if the MSS option of the segment was clamped.
+				 *
+				 * The MSS is clamped to the smallest of limit and max_mss(), ignoring the ones that are 0.
+				 */
+				bool handle(boost::asio::mutable_buffer tcp_segment, direction _direction, size_t limit);
+
 				/**
 				 * \brief Handle a TCP frame.
 				 * \param ipv4_helper The IPv4 helper.
@@ -84,8 +150,16 @@ namespace asiotap
 				*/
 				void handle(const_helper<ipv6_frame> ipv6_helper, mutable_helper<tcp_frame> tcp_helper);
 
+				/**
+				 * \brief Get the statistics.
+				 * \return The count of clamped SYN segments, per direction.
+				 */
+				statistics_type get_statistics() const;
+
 			private:
-				size_t m_max_mss;
+				std::atomic<size_t> m_max_mss;
+				std::atomic<uint64_t> m_outgoing_clamped;
+				std::atomic<uint64_t> m_incoming_clamped;
 		};
 	}
 }
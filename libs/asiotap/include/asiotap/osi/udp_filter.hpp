@@ -96,7 +96,8 @@ namespace asiotap
 		 */
 		template <>
 		inline bool frame_parent_match<udp_frame>(const_helper<ipv4_frame> parent) {
-			return (parent.protocol() == UDP_PROTOCOL);
+			// Only the first fragment carries the UDP header.
+			return ((parent.protocol() == UDP_PROTOCOL) && (parent.position_fragment() == 0));
 		}
 
 		/**
@@ -106,7 +107,7 @@ namespace asiotap
 		 */
 		template <>
 		inline bool frame_parent_match<udp_frame>(const_helper<ipv6_frame> parent) {
-			return (parent.next_header() == UDP_PROTOCOL);
+			return has_upper_layer(parent, UDP_PROTOCOL);
 		}
 
 		/**
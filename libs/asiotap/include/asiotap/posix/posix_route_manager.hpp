@@ -67,7 +67,8 @@ namespace asiotap
 				base_route_manager<posix_route_manager, posix_routing_table_entry>(io_service_)
 #else
 				base_route_manager<posix_route_manager, posix_routing_table_entry>(io_service_),
-				m_netlink_manager(io_service_)
+				m_netlink_manager(io_service_),
+				m_route_batch_netlink_manager(io_service_)
 #endif
 			{
 			}
@@ -89,11 +90,22 @@ namespace asiotap
 			void register_route(const route_type& route);
 			void unregister_route(const route_type& route);
 
+#if defined(LINUX) && !defined(FREELAN_DISABLE_NETLINK)
+			void async_register_route_batch(const std::vector<route_type>& routes, route_batch_handler_type handler);
+			void async_unregister_route_batch(const std::vector<route_type>& routes, route_batch_handler_type handler);
+
+		private:
+
+			void async_set_route_batch(netlinkplus::route_operation::action_type action, const std::vector<route_type>& routes, route_batch_handler_type handler);
+#endif
+
 		friend class base_route_manager<posix_route_manager, posix_routing_table_entry>;
 
 #ifdef LINUX
 		private:
 			netlinkplus::manager m_netlink_manager;
+			// The route batches are applied asynchronously: they get their own socket so that their acknowledgements are never mixed with the ones of the synchronous requests.
+			netlinkplus::manager m_route_batch_netlink_manager;
 #endif
 	};
 }
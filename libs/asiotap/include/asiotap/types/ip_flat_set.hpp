@@ -0,0 +1,546 @@
+/*
+ * libasiotap - A portable TAP adapter extension for Boost::ASIO.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libasiotap.
+ *
+ * libasiotap is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libasiotap is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libasiotap in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file ip_flat_set.hpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief Flat sets of IP routes and IP addresses.
+ */
+
+#ifndef ASIOTAP_IP_FLAT_SET_HPP
+#define ASIOTAP_IP_FLAT_SET_HPP
+
+#include "ip_route.hpp"
+#include "ip_endpoint.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <vector>
+
+namespace asiotap
+{
+	/**
+	 * \brief Call a visitor with the effective value of an IP route.
+	 * \param visitor The visitor.
+	 * \param value The IP route.
+	 */
+	template <typename Visitor>
+	inline void visit_ip_value(Visitor& visitor, const ip_route& value)
+	{
+		boost::apply_visitor(visitor, value);
+	}
+
+	/**
+	 * \brief Call a visitor with the effective value of an IP address.
+	 * \param visitor The visitor.
+	 * \param value The IP address.
+	 */
+	template <typename Visitor>
+	inline void visit_ip_value(Visitor& visitor, const ip_address& value)
+	{
+		const boost::asio::ip::address address = value.value();
+
+		if (address.is_v4())
+		{
+			visitor(address.to_v4());
+		}
+		else
+		{
+			visitor(address.to_v6());
+		}
+	}
+
+	/**
+	 * \brief A sorted set of IPv4 and IPv6 values stored in two contiguous arrays.
+	 *
+	 * The values are kept in the same order as in a std::set of VariantType: all the IPv4 values first, then all the IPv6 values.
+	 *
+	 * Unlike the node-based std::set, copying, comparing and walking a flat set only touches contiguous memory and lookups for one family never look at the other. Single insertions and removals are linear: prefer the bulk operations when changing many values at once.
+	 */
+	template <typename IPv4Type, typename IPv6Type, typename VariantType>
+	class basic_ip_flat_set
+	{
+		public:
+
+			/**
+			 * \brief The IPv4 value type.
+			 */
+			typedef IPv4Type ipv4_type;
+
+			/**
+			 * \brief The IPv6 value type.
+			 */
+			typedef IPv6Type ipv6_type;
+
+			/**
+			 * \brief The generic value type.
+			 */
+			typedef VariantType value_type;
+
+			/**
+			 * \brief The IPv4 values list type.
+			 */
+			typedef std::vector<ipv4_type> ipv4_list_type;
+
+			/**
+			 * \brief The IPv6 values list type.
+			 */
+			typedef std::vector<ipv6_type> ipv6_list_type;
+
+			/**
+			 * \brief The equivalent node-based set type.
+			 */
+			typedef std::set<value_type> set_type;
+
+			/**
+			 * \brief Create an empty set.
+			 */
+			basic_ip_flat_set() :
+				m_ipv4(),
+				m_ipv6()
+			{
+			}
+
+			/**
+			 * \brief Create a set from a node-based set.
+			 * \param values The values. As they are already sorted, this takes linear time.
+			 */
+			explicit basic_ip_flat_set(const set_type& values) :
+				m_ipv4(),
+				m_ipv6()
+			{
+				appender visitor(*this);
+
+				for (auto&& value : values)
+				{
+					visit_ip_value(visitor, value);
+				}
+			}
+
+			/**
+			 * \brief Create a set from arbitrary values.
+			 * \param first An iterator to the first value.
+			 * \param last An iterator past the last value.
+			 */
+			template <typename InputIterator>
+			basic_ip_flat_set(InputIterator first, InputIterator last) :
+				m_ipv4(),
+				m_ipv6()
+			{
+				appender visitor(*this);
+
+				for (; first != last; ++first)
+				{
+					visit_ip_value(visitor, *first);
+				}
+
+				normalize(m_ipv4);
+				normalize(m_ipv6);
+			}
+
+			/**
+			 * \brief Convert the set to a node-based set.
+			 * \return The equivalent node-based set.
+			 */
+			set_type to_set() const
+			{
+				set_type result;
+
+				for (auto&& value : m_ipv4)
+				{
+					result.insert(result.end(), value_type(value));
+				}
+
+				for (auto&& value : m_ipv6)
+				{
+					result.insert(result.end(), value_type(value));
+				}
+
+				return result;
+			}
+
+			/**
+			 * \brief Get the IPv4 values.
+			 * \return The sorted IPv4 values.
+			 */
+			const ipv4_list_type& ipv4() const
+			{
+				return m_ipv4;
+			}
+
+			/**
+			 * \brief Get the IPv6 values.
+			 * \return The sorted IPv6 values.
+			 */
+			const ipv6_list_type& ipv6() const
+			{
+				return m_ipv6;
+			}
+
+			/**
+			 * \brief Get the count of values.
+			 * \return The count of values.
+			 */
+			size_t size() const
+			{
+				return m_ipv4.size() + m_ipv6.size();
+			}
+
+			/**
+			 * \brief Check if the set is empty.
+			 * \return true if the set is empty.
+			 */
+			bool empty() const
+			{
+				return (m_ipv4.empty() && m_ipv6.empty());
+			}
+
+			/**
+			 * \brief Remove all the values.
+			 */
+			void clear()
+			{
+				m_ipv4.clear();
+				m_ipv6.clear();
+			}
+
+			/**
+			 * \brief Check if the set contains a value.
+			 * \param value The value.
+			 * \return true if the set contains value.
+			 */
+			bool contains(const ipv4_type& value) const
+			{
+				return std::binary_search(m_ipv4.begin(), m_ipv4.end(), value);
+			}
+
+			/**
+			 * \brief Check if the set contains a value.
+			 * \param value The value.
+			 * \return true if the set contains value.
+			 */
+			bool contains(const ipv6_type& value) const
+			{
+				return std::binary_search(m_ipv6.begin(), m_ipv6.end(), value);
+			}
+
+			/**
+			 * \brief Insert a value.
+			 * \param value The value.
+			 * \return true if the value was inserted, false if it was already there.
+			 */
+			bool insert(const ipv4_type& value)
+			{
+				return insert_into(m_ipv4, value);
+			}
+
+			/**
+			 * \brief Insert a value.
+			 * \param value The value.
+			 * \return true if the value was inserted, false if it was already there.
+			 */
+			bool insert(const ipv6_type& value)
+			{
+				return insert_into(m_ipv6, value);
+			}
+
+			/**
+			 * \brief Insert a value.
+			 * \param value The value.
+			 * \return true if the value was inserted, false if it was already there.
+			 */
+			bool insert(const value_type& value)
+			{
+				inserter visitor(*this);
+				visit_ip_value(visitor, value);
+
+				return visitor.result;
+			}
+
+			/**
+			 * \brief Remove a value.
+			 * \param value The value.
+			 * \return true if the value was removed, false if it was not there.
+			 */
+			bool erase(const ipv4_type& value)
+			{
+				return erase_from(m_ipv4, value);
+			}
+
+			/**
+			 * \brief Remove a value.
+			 * \param value The value.
+			 * \return true if the value was removed, false if it was not there.
+			 */
+			bool erase(const ipv6_type& value)
+			{
+				return erase_from(m_ipv6, value);
+			}
+
+			/**
+			 * \brief Call a function on every value, in order.
+			 * \param func The function. It must accept both an ipv4_type and an ipv6_type.
+			 */
+			template <typename Function>
+			void for_each(Function func) const
+			{
+				std::for_each(m_ipv4.begin(), m_ipv4.end(), func);
+				std::for_each(m_ipv6.begin(), m_ipv6.end(), func);
+			}
+
+			/**
+			 * \brief Get the values that match a predicate.
+			 * \param predicate The predicate. It must accept both an ipv4_type and an ipv6_type.
+			 * \return The matching values.
+			 */
+			template <typename Predicate>
+			basic_ip_flat_set filter(Predicate predicate) const
+			{
+				basic_ip_flat_set result;
+
+				std::copy_if(m_ipv4.begin(), m_ipv4.end(), std::back_inserter(result.m_ipv4), predicate);
+				std::copy_if(m_ipv6.begin(), m_ipv6.end(), std::back_inserter(result.m_ipv6), predicate);
+
+				return result;
+			}
+
+			/**
+			 * \brief Get the union of two sets.
+			 * \param lhs The left set.
+			 * \param rhs The right set.
+			 * \return The values that are in any of the two sets.
+			 */
+			static basic_ip_flat_set set_union(const basic_ip_flat_set& lhs, const basic_ip_flat_set& rhs)
+			{
+				basic_ip_flat_set result;
+
+				result.m_ipv4.reserve(lhs.m_ipv4.size() + rhs.m_ipv4.size());
+				result.m_ipv6.reserve(lhs.m_ipv6.size() + rhs.m_ipv6.size());
+				std::set_union(lhs.m_ipv4.begin(), lhs.m_ipv4.end(), rhs.m_ipv4.begin(), rhs.m_ipv4.end(), std::back_inserter(result.m_ipv4));
+				std::set_union(lhs.m_ipv6.begin(), lhs.m_ipv6.end(), rhs.m_ipv6.begin(), rhs.m_ipv6.end(), std::back_inserter(result.m_ipv6));
+
+				return result;
+			}
+
+			/**
+			 * \brief Get the difference of two sets.
+			 * \param lhs The left set.
+			 * \param rhs The right set.
+			 * \return The values of lhs that are not in rhs.
+			 */
+			static basic_ip_flat_set set_difference(const basic_ip_flat_set& lhs, const basic_ip_flat_set& rhs)
+			{
+				basic_ip_flat_set result;
+
+				std::set_difference(lhs.m_ipv4.begin(), lhs.m_ipv4.end(), rhs.m_ipv4.begin(), rhs.m_ipv4.end(), std::back_inserter(result.m_ipv4));
+				std::set_difference(lhs.m_ipv6.begin(), lhs.m_ipv6.end(), rhs.m_ipv6.begin(), rhs.m_ipv6.end(), std::back_inserter(result.m_ipv6));
+
+				return result;
+			}
+
+			/**
+			 * \brief Get the intersection of two sets.
+			 * \param lhs The left set.
+			 * \param rhs The right set.
+			 * \return The values that are in both sets.
+			 */
+			static basic_ip_flat_set set_intersection(const basic_ip_flat_set& lhs, const basic_ip_flat_set& rhs)
+			{
+				basic_ip_flat_set result;
+
+				std::set_intersection(lhs.m_ipv4.begin(), lhs.m_ipv4.end(), rhs.m_ipv4.begin(), rhs.m_ipv4.end(), std::back_inserter(result.m_ipv4));
+				std::set_intersection(lhs.m_ipv6.begin(), lhs.m_ipv6.end(), rhs.m_ipv6.begin(), rhs.m_ipv6.end(), std::back_inserter(result.m_ipv6));
+
+				return result;
+			}
+
+		private:
+
+			class appender : public boost::static_visitor<>
+			{
+				public:
+
+					explicit appender(basic_ip_flat_set& set) : m_set(set) {}
+
+					void operator()(const ipv4_type& value) { m_set.m_ipv4.push_back(value); }
+					void operator()(const ipv6_type& value) { m_set.m_ipv6.push_back(value); }
+
+				private:
+
+					basic_ip_flat_set& m_set;
+			};
+
+			class inserter : public boost::static_visitor<>
+			{
+				public:
+
+					explicit inserter(basic_ip_flat_set& set) : result(false), m_set(set) {}
+
+					void operator()(const ipv4_type& value) { result = m_set.insert(value); }
+					void operator()(const ipv6_type& value) { result = m_set.insert(value); }
+
+					bool result;
+
+				private:
+
+					basic_ip_flat_set& m_set;
+			};
+
+			template <typename ListType>
+			static void normalize(ListType& values)
+			{
+				std::sort(values.begin(), values.end());
+				values.erase(std::unique(values.begin(), values.end()), values.end());
+			}
+
+			template <typename ListType>
+			static bool insert_into(ListType& values, const typename ListType::value_type& value)
+			{
+				const auto position = std::lower_bound(values.begin(), values.end(), value);
+
+				if ((position != values.end()) && !(value < *position))
+				{
+					return false;
+				}
+
+				values.insert(position, value);
+
+				return true;
+			}
+
+			template <typename ListType>
+			static bool erase_from(ListType& values, const typename ListType::value_type& value)
+			{
+				const auto position = std::lower_bound(values.begin(), values.end(), value);
+
+				if ((position == values.end()) || (value < *position))
+				{
+					return false;
+				}
+
+				values.erase(position);
+
+				return true;
+			}
+
+			friend bool operator==(const basic_ip_flat_set& lhs, const basic_ip_flat_set& rhs)
+			{
+				return ((lhs.m_ipv4 == rhs.m_ipv4) && (lhs.m_ipv6 == rhs.m_ipv6));
+			}
+
+			friend bool operator!=(const basic_ip_flat_set& lhs, const basic_ip_flat_set& rhs)
+			{
+				return !(lhs == rhs);
+			}
+
+			ipv4_list_type m_ipv4;
+			ipv6_list_type m_ipv6;
+	};
+
+	/**
+	 * \brief A flat IP route set type.
+	 */
+	typedef basic_ip_flat_set<ipv4_route, ipv6_route, ip_route> ip_route_flat_set;
+
+	/**
+	 * \brief A flat IP address set type.
+	 */
+	typedef basic_ip_flat_set<boost::asio::ip::address_v4, boost::asio::ip::address_v6, ip_address> ip_address_flat_set;
+
+	/**
+	 * \brief A predicate that checks if values belong to a network.
+	 */
+	class in_network_predicate : public boost::static_visitor<bool>
+	{
+		public:
+
+			/**
+			 * \brief Create a predicate.
+			 * \param network The network.
+			 */
+			explicit in_network_predicate(const ip_network_address& network) :
+				m_network(network)
+			{
+			}
+
+			/**
+			 * \brief Check if a route belongs to the network.
+			 * \param route The route.
+			 * \return true if the network of the route is the network or one of its subnets.
+			 */
+			template <typename AddressType>
+			bool operator()(const base_ip_route<AddressType>& route) const
+			{
+				const auto network = boost::get<base_ip_network_address<AddressType> >(&m_network);
+
+				return (network && (route.network_address().prefix_length() >= network->prefix_length()) && network->has_address(route.network_address().address()));
+			}
+
+			/**
+			 * \brief Check if an address belongs to the network.
+			 * \param address The address.
+			 * \return true if the address belongs to the network.
+			 */
+			template <typename AddressType>
+			bool operator()(const AddressType& address) const
+			{
+				const auto network = boost::get<base_ip_network_address<AddressType> >(&m_network);
+
+				return (network && network->has_address(address));
+			}
+
+		private:
+
+			ip_network_address m_network;
+	};
+
+	/**
+	 * \brief Get the values of a flat set that belong to a network.
+	 * \param values The values.
+	 * \param network The network.
+	 * \return The routes whose network is the network or one of its subnets, or the addresses that belong to the network.
+	 */
+	template <typename IPv4Type, typename IPv6Type, typename VariantType>
+	inline basic_ip_flat_set<IPv4Type, IPv6Type, VariantType> filter_by_network(const basic_ip_flat_set<IPv4Type, IPv6Type, VariantType>& values, const ip_network_address& network)
+	{
+		return values.filter(in_network_predicate(network));
+	}
+}
+
+#endif /* ASIOTAP_IP_FLAT_SET_HPP */
@@ -54,56 +54,102 @@ namespace asiotap
 {
 	namespace osi
 	{
+		const boost::posix_time::time_duration proxy<arp_frame>::DEFAULT_NEGATIVE_CACHE_TTL = boost::posix_time::seconds(5);
+
+		bool proxy<arp_frame>::add_entry(const entry_type& entry)
+		{
+			const std::pair<entry_map_type::iterator, bool> result = m_entry_map.insert(std::make_pair(entry.first, reply_template_type()));
+
+			if (result.second)
+			{
+				write_reply_template(boost::asio::buffer(result.first->second), entry.first, entry.second);
+				m_negative_cache.erase(entry.first);
+			}
+
+			return result.second;
+		}
+
 		boost::optional<boost::asio::const_buffer> proxy<arp_frame>::process_frame(const_helper<ethernet_frame> ethernet_helper, const_helper<arp_frame> arp_helper, boost::asio::mutable_buffer response_buffer) const
 		{
-			if (arp_helper.operation() == ARP_REQUEST_OPERATION)
+			if ((arp_helper.operation() == ARP_REQUEST_OPERATION) && (boost::asio::buffer_size(response_buffer) >= REPLY_SIZE))
 			{
-				const entry_map_type::const_iterator entry_it = m_entry_map.find(arp_helper.target_logical_address());
+				const boost::asio::mutable_buffer reply = response_buffer + (boost::asio::buffer_size(response_buffer) - REPLY_SIZE);
 
-				ethernet_address_type eth_addr;
+				const entry_map_type::const_iterator entry_it = m_entry_map.find(arp_helper.target_logical_address());
 
 				bool should_answer = false;
 
 				if (entry_it != m_entry_map.end())
 				{
-					eth_addr = entry_it->second;
+					boost::asio::buffer_copy(reply, boost::asio::buffer(entry_it->second));
 					should_answer = true;
 				}
-				else
+				else if (m_arp_request_callback)
 				{
-					if (m_arp_request_callback)
+					const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+
+					if (!m_negative_cache.contains(arp_helper.target_logical_address(), now))
 					{
-						should_answer = m_arp_request_callback(arp_helper.target_logical_address(), eth_addr);
+						ethernet_address_type eth_addr;
+
+						if (m_arp_request_callback(arp_helper.target_logical_address(), eth_addr))
+						{
+							write_reply_template(reply, arp_helper.target_logical_address(), eth_addr);
+							should_answer = true;
+						}
+						else
+						{
+							m_negative_cache.insert(arp_helper.target_logical_address(), now);
+						}
 					}
 				}
 
 				if (should_answer)
 				{
-					size_t payload_size;
+					patch_reply(reply, ethernet_helper, arp_helper);
+
+					return boost::make_optional<boost::asio::const_buffer>(reply);
+				}
+			}
 
-					builder<arp_frame> arp_builder(response_buffer);
+			return boost::optional<boost::asio::const_buffer>();
+		}
 
-					payload_size = arp_builder.write(
-					                   ARP_REPLY_OPERATION,
-					                   boost::asio::buffer(eth_addr.data()),
-					                   arp_helper.target_logical_address(),
-					                   arp_helper.sender_hardware_address(),
-					                   arp_helper.sender_logical_address()
-					               );
+		void proxy<arp_frame>::write_reply_template(boost::asio::mutable_buffer buf, const boost::asio::ip::address_v4& logical_address, const ethernet_address_type& hardware_address)
+		{
+			const ethernet_address_type::data_type unknown_hardware_address = ethernet_address_type::null().data();
 
-					builder<ethernet_frame> ethernet_builder(response_buffer, payload_size);
+			size_t payload_size;
 
-					payload_size = ethernet_builder.write(
-					                   ethernet_helper.sender(),
-					                   ethernet_helper.target(),
-					                   ethernet_helper.protocol()
-					               );
+			builder<arp_frame> arp_builder(buf);
 
-					return boost::make_optional<boost::asio::const_buffer>(response_buffer + (boost::asio::buffer_size(response_buffer) - payload_size));
-				}
-			}
+			payload_size = arp_builder.write(
+			                   ARP_REPLY_OPERATION,
+			                   boost::asio::buffer(hardware_address.data()),
+			                   logical_address,
+			                   boost::asio::buffer(unknown_hardware_address),
+			                   boost::asio::ip::address_v4::any()
+			               );
 
-			return boost::optional<boost::asio::const_buffer>();
+			builder<ethernet_frame> ethernet_builder(buf, payload_size);
+
+			ethernet_builder.write(
+			    boost::asio::buffer(unknown_hardware_address),
+			    boost::asio::buffer(unknown_hardware_address),
+			    ARP_PROTOCOL
+			);
+		}
+
+		void proxy<arp_frame>::patch_reply(boost::asio::mutable_buffer buf, const_helper<ethernet_frame> ethernet_helper, const_helper<arp_frame> arp_helper)
+		{
+			// The reply keeps the addresses of the request Ethernet header, swapped.
+			const mutable_helper<ethernet_frame> reply_ethernet_helper(buf);
+			const mutable_helper<arp_frame> reply_arp_helper(buf + sizeof(ethernet_frame));
+
+			boost::asio::buffer_copy(reply_ethernet_helper.target(), ethernet_helper.sender());
+			boost::asio::buffer_copy(reply_ethernet_helper.sender(), ethernet_helper.target());
+			boost::asio::buffer_copy(reply_arp_helper.target_hardware_address(), arp_helper.sender_hardware_address());
+			reply_arp_helper.set_target_logical_address(arp_helper.sender_logical_address());
 		}
 	}
 }
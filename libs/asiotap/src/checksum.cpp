@@ -44,9 +44,276 @@
 
 #include "osi/checksum.hpp"
 
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define ASIOTAP_CHECKSUM_HAS_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#define ASIOTAP_CHECKSUM_HAS_AVX2
+#define ASIOTAP_CHECKSUM_TARGET_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__GNUC__)
+#define ASIOTAP_CHECKSUM_HAS_AVX2
+#define ASIOTAP_CHECKSUM_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ASIOTAP_CHECKSUM_HAS_NEON
+#include <arm_neon.h>
+#endif
+
 namespace asiotap
 {
 	namespace osi
 	{
+		namespace
+		{
+			typedef uint64_t (*sum_function_type)(const uint8_t*, size_t);
+
+			// Each vector lane receives at most two 16-bit words per block: flushing the 32-bit lanes after that many blocks prevents them from overflowing.
+			const size_t MAX_BLOCKS_PER_FLUSH = 0x8000;
+
+			uint16_t fold(uint64_t sum)
+			{
+				while (sum >> 16)
+				{
+					sum = (sum & 0xFFFF) + (sum >> 16);
+				}
+
+				return static_cast<uint16_t>(sum);
+			}
+
+			// Any multiple of 16 bits folds back to the sum of the 16-bit words, whatever the host byte order.
+			uint64_t scalar_sum(const uint8_t* buf, size_t buf_len)
+			{
+				uint64_t sum = 0;
+
+				while (buf_len >= sizeof(uint32_t))
+				{
+					uint32_t value;
+					std::memcpy(&value, buf, sizeof(value));
+					sum += value;
+					buf += sizeof(uint32_t);
+					buf_len -= sizeof(uint32_t);
+				}
+
+				if (buf_len >= sizeof(uint16_t))
+				{
+					uint16_t value;
+					std::memcpy(&value, buf, sizeof(value));
+					sum += value;
+					buf += sizeof(uint16_t);
+					buf_len -= sizeof(uint16_t);
+				}
+
+				if (buf_len > 0)
+				{
+					uint16_t value = 0;
+					std::memcpy(&value, buf, 1);
+					sum += value;
+				}
+
+				return sum;
+			}
+
+#ifdef ASIOTAP_CHECKSUM_HAS_SSE2
+			uint64_t sse2_sum(const uint8_t* buf, size_t buf_len)
+			{
+				const __m128i low_mask = _mm_set1_epi32(0xFFFF);
+				uint64_t sum = 0;
+
+				while (buf_len >= sizeof(__m128i))
+				{
+					__m128i acc = _mm_setzero_si128();
+
+					for (size_t blocks = 0; (blocks < MAX_BLOCKS_PER_FLUSH) && (buf_len >= sizeof(__m128i)); ++blocks)
+					{
+						const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf));
+						acc = _mm_add_epi32(acc, _mm_and_si128(value, low_mask));
+						acc = _mm_add_epi32(acc, _mm_srli_epi32(value, 16));
+						buf += sizeof(__m128i);
+						buf_len -= sizeof(__m128i);
+					}
+
+					uint32_t lanes[4];
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+					sum += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+				}
+
+				return sum + scalar_sum(buf, buf_len);
+			}
+#endif
+
+#ifdef ASIOTAP_CHECKSUM_HAS_AVX2
+			ASIOTAP_CHECKSUM_TARGET_AVX2 uint64_t avx2_sum(const uint8_t* buf, size_t buf_len)
+			{
+				const __m256i low_mask = _mm256_set1_epi32(0xFFFF);
+				uint64_t sum = 0;
+
+				while (buf_len >= sizeof(__m256i))
+				{
+					__m256i acc = _mm256_setzero_si256();
+
+					for (size_t blocks = 0; (blocks < MAX_BLOCKS_PER_FLUSH) && (buf_len >= sizeof(__m256i)); ++blocks)
+					{
+						const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf));
+						acc = _mm256_add_epi32(acc, _mm256_and_si256(value, low_mask));
+						acc = _mm256_add_epi32(acc, _mm256_srli_epi32(value, 16));
+						buf += sizeof(__m256i);
+						buf_len -= sizeof(__m256i);
+					}
+
+					uint32_t lanes[8];
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+
+					for (unsigned int i = 0; i < 8; ++i)
+					{
+						sum += lanes[i];
+					}
+				}
+
+				return sum + scalar_sum(buf, buf_len);
+			}
+
+			bool cpu_supports_avx2()
+			{
+#if defined(_MSC_VER)
+				int info[4];
+
+				__cpuid(info, 0);
+
+				if (info[0] < 7)
+				{
+					return false;
+				}
+
+				__cpuid(info, 1);
+
+				const bool osxsave = (info[2] & (1 << 27)) != 0;
+				const bool avx = (info[2] & (1 << 28)) != 0;
+
+				if (!osxsave || !avx || ((_xgetbv(0) & 0x6) != 0x6))
+				{
+					return false;
+				}
+
+				__cpuidex(info, 7, 0);
+
+				return (info[1] & (1 << 5)) != 0;
+#else
+				__builtin_cpu_init();
+
+				return __builtin_cpu_supports("avx2") != 0;
+#endif
+			}
+#endif
+
+#ifdef ASIOTAP_CHECKSUM_HAS_NEON
+			uint64_t neon_sum(const uint8_t* buf, size_t buf_len)
+			{
+				uint64_t sum = 0;
+
+				while (buf_len >= sizeof(uint16x8_t))
+				{
+					uint32x4_t acc = vdupq_n_u32(0);
+
+					for (size_t blocks = 0; (blocks < MAX_BLOCKS_PER_FLUSH) && (buf_len >= sizeof(uint16x8_t)); ++blocks)
+					{
+						acc = vpadalq_u16(acc, vreinterpretq_u16_u8(vld1q_u8(buf)));
+						buf += sizeof(uint16x8_t);
+						buf_len -= sizeof(uint16x8_t);
+					}
+
+					sum += vgetq_lane_u64(vpaddlq_u32(acc), 0) + vgetq_lane_u64(vpaddlq_u32(acc), 1);
+				}
+
+				return sum + scalar_sum(buf, buf_len);
+			}
+#endif
+
+			sum_function_type get_sum_function(checksum_implementation implementation)
+			{
+				switch (implementation)
+				{
+					case CI_SCALAR:
+						return &scalar_sum;
+#ifdef ASIOTAP_CHECKSUM_HAS_SSE2
+					case CI_SSE2:
+						return &sse2_sum;
+#endif
+#ifdef ASIOTAP_CHECKSUM_HAS_AVX2
+					case CI_AVX2:
+						return cpu_supports_avx2() ? &avx2_sum : NULL;
+#endif
+#ifdef ASIOTAP_CHECKSUM_HAS_NEON
+					case CI_NEON:
+						return &neon_sum;
+#endif
+					default:
+						return NULL;
+				}
+			}
+
+			checksum_implementation get_best_implementation()
+			{
+				const checksum_implementation candidates[] = { CI_AVX2, CI_SSE2, CI_NEON };
+
+				for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); ++i)
+				{
+					if (get_sum_function(candidates[i]))
+					{
+						return candidates[i];
+					}
+				}
+
+				return CI_SCALAR;
+			}
+
+			std::atomic<checksum_implementation>& current_implementation()
+			{
+				static std::atomic<checksum_implementation> implementation(get_best_implementation());
+
+				return implementation;
+			}
+
+			std::atomic<sum_function_type>& current_sum_function()
+			{
+				static std::atomic<sum_function_type> function(get_sum_function(current_implementation().load()));
+
+				return function;
+			}
+		}
+
+		checksum_implementation get_checksum_implementation()
+		{
+			return current_implementation().load();
+		}
+
+		bool set_checksum_implementation(checksum_implementation implementation)
+		{
+			const sum_function_type function = get_sum_function(implementation);
+
+			if (!function)
+			{
+				return false;
+			}
+
+			current_implementation().store(implementation);
+			current_sum_function().store(function);
+
+			return true;
+		}
+
+		uint16_t ones_complement_sum(const void* buf, size_t buf_len)
+		{
+			const sum_function_type function = current_sum_function().load(std::memory_order_relaxed);
+
+			return fold(function(static_cast<const uint8_t*>(buf), buf_len));
+		}
 	}
 }
@@ -52,34 +52,22 @@ namespace asiotap
 		{
 			if (buf_len > 0)
 			{
-				if (m_left != 0)
-				{
-					m_checksum += (static_cast<uint16_t>(m_left) << 8 | *reinterpret_cast<const uint8_t*>(buf));
-					buf_len -= sizeof(uint8_t);
-					m_left = 0;
-				}
+				uint16_t sum = ones_complement_sum(buf, buf_len);
 
-				while (buf_len > 1)
+				// Data that starts at an odd offset has its bytes paired the other way around: its sum is byte-swapped.
+				if (m_odd)
 				{
-					m_checksum += *buf++;
-					buf_len -= sizeof(uint16_t);
+					sum = static_cast<uint16_t>((sum << 8) | (sum >> 8));
 				}
 
-				if (buf_len > 0)
-				{
-					m_left = *reinterpret_cast<const uint8_t*>(buf);
-				}
+				m_checksum += sum;
+				m_checksum = (m_checksum & 0xFFFF) + (m_checksum >> 16);
+				m_odd = (m_odd != ((buf_len & 1) != 0));
 			}
 		}
 
 		uint32_t checksum_helper::compute()
 		{
-			if (m_left != 0)
-			{
-				m_checksum += m_left;
-				m_left = 0;
-			}
-
 			while (m_checksum >> 16)
 			{
 				m_checksum = (m_checksum & 0xFFFF) + (m_checksum >> 16);
@@ -83,6 +83,11 @@ namespace asiotap
 				return result;
 			}
 
+			bool has_value_of_size(const dhcp_option_helper<const_helper_tag>& option_helper, size_t size)
+			{
+				return (option_helper.has_length() && (boost::asio::buffer_size(option_helper.value()) == size));
+			}
+
 			boost::asio::ip::address_v4 prefix_length_to_netmask_v4(unsigned int netmask)
 			{
 				if (netmask <= 0)
@@ -128,7 +133,8 @@ namespace asiotap
 				{
 					const_helper<dhcp_frame>::const_iterator message_type_option = dhcp_helper.find(dhcp_option::dhcp_message_type);
 
-					if (message_type_option != dhcp_helper.end())
+					// Options with a wrong length are ignored: reading them with value_as() would throw.
+					if ((message_type_option != dhcp_helper.end()) && has_value_of_size(*message_type_option, sizeof(uint8_t)))
 					{
 						bool info = false;
 
@@ -145,7 +151,7 @@ namespace asiotap
 								break;
 
 							case DHCP_REQUEST_MESSAGE:
-								if (requested_ip_address_option != dhcp_helper.end())
+								if ((requested_ip_address_option != dhcp_helper.end()) && has_value_of_size(*requested_ip_address_option, sizeof(uint32_t)))
 								{
 									const boost::asio::ip::address_v4 requested_ip_address(ntohl(requested_ip_address_option->value_as<uint32_t>()));
 
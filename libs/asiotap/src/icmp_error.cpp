@@ -0,0 +1,182 @@
+/*
+ * libasiotap - A portable TAP adapter extension for Boost::ASIO.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libasiotap.
+ *
+ * libasiotap is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libasiotap is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libasiotap in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file icmp_error.cpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief ICMP and ICMPv6 "packet too big" error messages.
+ */
+
+#include "osi/icmp_error.hpp"
+
+#include "osi/checksum_helper.hpp"
+#include "osi/icmp_frame.hpp"
+#include "osi/icmpv6_frame.hpp"
+#include "osi/ipv4_frame.hpp"
+#include "osi/ipv6_frame.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace asiotap
+{
+	namespace osi
+	{
+		namespace
+		{
+			const size_t IPV4_HEADER_LENGTH = 20;
+			const size_t IPV6_HEADER_LENGTH = 40;
+			const size_t ICMP_ERROR_HEADER_LENGTH = 8;
+
+			void write_uint16(uint8_t* data, uint16_t value)
+			{
+				data[0] = static_cast<uint8_t>(value >> 8);
+				data[1] = static_cast<uint8_t>(value);
+			}
+
+			void write_uint32(uint8_t* data, uint32_t value)
+			{
+				write_uint16(data, static_cast<uint16_t>(value >> 16));
+				write_uint16(data + 2, static_cast<uint16_t>(value));
+			}
+
+			// The checksum is stored as computed: it has the same byte order as the data.
+			void write_checksum(uint8_t* data, uint16_t checksum)
+			{
+				std::memcpy(data, &checksum, sizeof(checksum));
+			}
+		}
+
+		size_t write_ipv4_fragmentation_needed(boost::asio::mutable_buffer buf, boost::asio::const_buffer packet, uint16_t mtu)
+		{
+			const uint8_t* const original = boost::asio::buffer_cast<const uint8_t*>(packet);
+			const size_t original_size = boost::asio::buffer_size(packet);
+
+			if ((original_size < IPV4_HEADER_LENGTH) || ((original[0] >> 4) != IP_PROTOCOL_VERSION_4))
+			{
+				return 0;
+			}
+
+			const size_t original_header_length = (original[0] & 0x0F) * 4;
+
+			if ((original_header_length < IPV4_HEADER_LENGTH) || (original_header_length > original_size))
+			{
+				return 0;
+			}
+
+			const size_t quoted_size = std::min(original_size, original_header_length + 8);
+			const size_t size = IPV4_HEADER_LENGTH + ICMP_ERROR_HEADER_LENGTH + quoted_size;
+
+			if (boost::asio::buffer_size(buf) < size)
+			{
+				return 0;
+			}
+
+			uint8_t* const ip = boost::asio::buffer_cast<uint8_t*>(buf);
+			uint8_t* const icmp = ip + IPV4_HEADER_LENGTH;
+
+			std::memset(ip, 0x00, IPV4_HEADER_LENGTH + ICMP_ERROR_HEADER_LENGTH);
+			ip[0] = (IP_PROTOCOL_VERSION_4 << 4) | (IPV4_HEADER_LENGTH / 4);
+			write_uint16(ip + 2, static_cast<uint16_t>(size));
+			ip[8] = 64;
+			ip[9] = ICMP_PROTOCOL;
+			std::memcpy(ip + 12, original + 16, 4);
+			std::memcpy(ip + 16, original + 12, 4);
+			write_checksum(ip + 10, compute_checksum(reinterpret_cast<const uint16_t*>(ip), IPV4_HEADER_LENGTH));
+
+			icmp[0] = ICMP_DESTINATION_UNREACHABLE;
+			icmp[1] = ICMP_FRAGMENTATION_NEEDED;
+			write_uint16(icmp + 6, mtu);
+			std::memcpy(icmp + ICMP_ERROR_HEADER_LENGTH, original, quoted_size);
+
+			checksum_helper chk;
+			chk.update(reinterpret_cast<const uint16_t*>(icmp), ICMP_ERROR_HEADER_LENGTH + quoted_size);
+			write_checksum(icmp + 2, static_cast<uint16_t>(chk.compute()));
+
+			return size;
+		}
+
+		size_t write_ipv6_packet_too_big(boost::asio::mutable_buffer buf, boost::asio::const_buffer packet, uint32_t mtu)
+		{
+			const uint8_t* const original = boost::asio::buffer_cast<const uint8_t*>(packet);
+			const size_t original_size = boost::asio::buffer_size(packet);
+
+			if ((original_size < IPV6_HEADER_LENGTH) || ((original[0] >> 4) != IP_PROTOCOL_VERSION_6))
+			{
+				return 0;
+			}
+
+			const size_t quoted_size = std::min(original_size, IPV6_MINIMUM_MTU - IPV6_HEADER_LENGTH - ICMP_ERROR_HEADER_LENGTH);
+			const size_t payload_size = ICMP_ERROR_HEADER_LENGTH + quoted_size;
+			const size_t size = IPV6_HEADER_LENGTH + payload_size;
+
+			if (boost::asio::buffer_size(buf) < size)
+			{
+				return 0;
+			}
+
+			uint8_t* const ip = boost::asio::buffer_cast<uint8_t*>(buf);
+			uint8_t* const icmpv6 = ip + IPV6_HEADER_LENGTH;
+
+			std::memset(ip, 0x00, IPV6_HEADER_LENGTH + ICMP_ERROR_HEADER_LENGTH);
+			ip[0] = IP_PROTOCOL_VERSION_6 << 4;
+			write_uint16(ip + 4, static_cast<uint16_t>(payload_size));
+			ip[6] = ICMPV6_HEADER;
+			ip[7] = 64;
+			std::memcpy(ip + 8, original + 24, 16);
+			std::memcpy(ip + 24, original + 8, 16);
+
+			icmpv6[0] = ICMPV6_PACKET_TOO_BIG;
+			write_uint32(icmpv6 + 4, mtu);
+			std::memcpy(icmpv6 + ICMP_ERROR_HEADER_LENGTH, original, quoted_size);
+
+			icmpv6_ipv6_pseudo_header pseudo_header {};
+			std::memcpy(&pseudo_header.ipv6_source, ip + 8, 16);
+			std::memcpy(&pseudo_header.ipv6_destination, ip + 24, 16);
+			pseudo_header.upper_layer_length = htonl(static_cast<uint32_t>(payload_size));
+			pseudo_header.ipv6_next_header = ICMPV6_HEADER;
+
+			checksum_helper chk;
+			chk.update(reinterpret_cast<const uint16_t*>(&pseudo_header), sizeof(pseudo_header));
+			chk.update(reinterpret_cast<const uint16_t*>(icmpv6), payload_size);
+			write_checksum(icmpv6 + 2, static_cast<uint16_t>(chk.compute()));
+
+			return size;
+		}
+	}
+}
@@ -50,62 +50,131 @@
 #include "osi/ipv6_builder.hpp"
 #include "osi/icmpv6_builder.hpp"
 
+#include "osi/checksum.hpp"
+
+#include <cstddef>
+#include <cstring>
+
 namespace asiotap
 {
 	namespace osi
 	{
+		const boost::posix_time::time_duration proxy<icmpv6_frame>::DEFAULT_NEGATIVE_CACHE_TTL = boost::posix_time::seconds(5);
+
+		bool proxy<icmpv6_frame>::add_entry(const entry_type& entry)
+		{
+			const std::pair<entry_map_type::iterator, bool> result = m_entry_map.insert(std::make_pair(entry.first, reply_template_type()));
+
+			if (result.second)
+			{
+				write_reply_template(boost::asio::buffer(result.first->second), entry.first, entry.second);
+				m_negative_cache.erase(entry.first);
+			}
+
+			return result.second;
+		}
+
 		boost::optional<boost::asio::const_buffer> proxy<icmpv6_frame>::process_frame(const_helper<ipv6_frame> ipv6_helper, const_helper<icmpv6_frame> icmpv6_helper, boost::asio::mutable_buffer response_buffer) const
 		{
-			if (icmpv6_helper.type() == ICMPV6_NEIGHBOR_SOLICITATION)
+			if ((icmpv6_helper.type() == ICMPV6_NEIGHBOR_SOLICITATION) && (boost::asio::buffer_size(response_buffer) >= REPLY_SIZE))
 			{
-				ethernet_address_type eth_addr;
+				const boost::asio::mutable_buffer reply = response_buffer + (boost::asio::buffer_size(response_buffer) - REPLY_SIZE);
+
+				const entry_map_type::const_iterator entry_it = m_entry_map.find(icmpv6_helper.target());
 
 				bool should_answer = false;
 
-				if (m_neighbor_solicitation_callback)
+				if (entry_it != m_entry_map.end())
 				{
-					should_answer = m_neighbor_solicitation_callback(icmpv6_helper.target(), eth_addr);
+					boost::asio::buffer_copy(reply, boost::asio::buffer(entry_it->second));
+					should_answer = true;
+				}
+				else if (m_neighbor_solicitation_callback)
+				{
+					const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+
+					if (!m_negative_cache.contains(icmpv6_helper.target(), now))
+					{
+						ethernet_address_type eth_addr;
+
+						if (m_neighbor_solicitation_callback(icmpv6_helper.target(), eth_addr))
+						{
+							write_reply_template(reply, icmpv6_helper.target(), eth_addr);
+							should_answer = true;
+						}
+						else
+						{
+							m_negative_cache.insert(icmpv6_helper.target(), now);
+						}
+					}
 				}
 
 				if (should_answer)
 				{
-					// We hardcode the structure for the ICMPv6 option because it just works.
-					size_t payload_size = 8;
-					uint8_t* const target_link_layer_address_option_buffer = boost::asio::buffer_cast<uint8_t*>(response_buffer + (boost::asio::buffer_size(response_buffer) - payload_size));
-
-					target_link_layer_address_option_buffer[0] = ICMPV6_OPTION_TARGET_LINK_LAYER_ADDRESS; // The option type.
-					target_link_layer_address_option_buffer[1] = 0x01; // The size, in multiples of 8 bytes.
-					::memcpy(&target_link_layer_address_option_buffer[2], &eth_addr.data()[0], eth_addr.data().size()); // The ethernet address.
-
-					builder<icmpv6_frame> icmpv6_builder(response_buffer, payload_size);
-
-					payload_size = icmpv6_builder.write(
-					    ICMPV6_NEIGHBOR_ADVERTISEMENT,
-						0,
-						false,
-						true,
-						true,
-						icmpv6_helper.target()
-					);
-
-					builder<ipv6_frame> ipv6_builder(response_buffer, payload_size);
-
-					payload_size = ipv6_builder.write(
-						ipv6_helper._class(),
-						ipv6_helper.label(),
-						ICMPV6_HEADER,
-						0xFF,
-						icmpv6_helper.target(),
-						ipv6_helper.source()
-					);
-
-					icmpv6_builder.update_checksum(ipv6_builder.get_helper());
-
-					return boost::make_optional<boost::asio::const_buffer>(response_buffer + (boost::asio::buffer_size(response_buffer) - payload_size));
+					patch_reply(reply, ipv6_helper);
+
+					return boost::make_optional<boost::asio::const_buffer>(reply);
 				}
 			}
 
 			return boost::optional<boost::asio::const_buffer>();
 		}
+
+		void proxy<icmpv6_frame>::write_reply_template(boost::asio::mutable_buffer buf, const boost::asio::ip::address_v6& logical_address, const ethernet_address_type& hardware_address)
+		{
+			// We hardcode the structure for the ICMPv6 option because it just works.
+			size_t payload_size = TARGET_LINK_LAYER_ADDRESS_OPTION_SIZE;
+			uint8_t* const target_link_layer_address_option_buffer = boost::asio::buffer_cast<uint8_t*>(buf + (boost::asio::buffer_size(buf) - payload_size));
+
+			target_link_layer_address_option_buffer[0] = ICMPV6_OPTION_TARGET_LINK_LAYER_ADDRESS; // The option type.
+			target_link_layer_address_option_buffer[1] = 0x01; // The size, in multiples of 8 bytes.
+			::memcpy(&target_link_layer_address_option_buffer[2], &hardware_address.data()[0], hardware_address.data().size()); // The ethernet address.
+
+			builder<icmpv6_frame> icmpv6_builder(buf, payload_size);
+
+			payload_size = icmpv6_builder.write(
+			    ICMPV6_NEIGHBOR_ADVERTISEMENT,
+				0,
+				false,
+				true,
+				true,
+				logical_address
+			);
+
+			builder<ipv6_frame> ipv6_builder(buf, payload_size);
+
+			ipv6_builder.write(
+				0,
+				0,
+				ICMPV6_HEADER,
+				0xFF,
+				logical_address,
+				boost::asio::ip::address_v6::any()
+			);
+
+			icmpv6_builder.update_checksum(ipv6_builder.get_helper());
+		}
+
+		void proxy<icmpv6_frame>::patch_reply(boost::asio::mutable_buffer buf, const_helper<ipv6_frame> ipv6_helper)
+		{
+			const mutable_helper<ipv6_frame> reply_ipv6_helper(buf);
+			const mutable_helper<icmpv6_frame> reply_icmpv6_helper(buf + sizeof(ipv6_frame));
+
+			// The version, class and label word of the solicitation is copied as is. It is not part of the pseudo-header: only the destination affects the checksum.
+			boost::asio::buffer_copy(buf, ipv6_helper.buffer(), sizeof(uint32_t));
+			reply_ipv6_helper.set_destination(ipv6_helper.source());
+
+			uint16_t destination[sizeof(in6_addr) / sizeof(uint16_t)];
+			std::memcpy(destination, boost::asio::buffer_cast<const uint8_t*>(buf) + offsetof(ipv6_frame, destination), sizeof(destination));
+
+			uint16_t checksum = reply_icmpv6_helper.checksum();
+
+			for (size_t i = 0; i < sizeof(destination) / sizeof(destination[0]); ++i)
+			{
+				checksum = update_checksum(checksum, 0x0000, destination[i]);
+			}
+
+			reply_icmpv6_helper.set_checksum(checksum);
+		}
 	}
 }
@@ -48,5 +48,76 @@ namespace asiotap
 {
 	namespace osi
 	{
+		boost::optional<ipv6_upper_layer> find_ipv6_upper_layer(boost::asio::const_buffer buf)
+		{
+			const uint8_t* const data = boost::asio::buffer_cast<const uint8_t*>(buf);
+			const size_t size = boost::asio::buffer_size(buf);
+
+			if (size < sizeof(ipv6_frame))
+			{
+				return boost::none;
+			}
+
+			ipv6_upper_layer result;
+			result.protocol = data[6];
+			result.offset = sizeof(ipv6_frame);
+			result.fragment = false;
+			result.first_fragment = true;
+
+			for (unsigned int count = 0; ; ++count)
+			{
+				switch (result.protocol)
+				{
+					case IPV6_HOP_BY_HOP_OPTIONS_HEADER:
+					case IPV6_ROUTING_HEADER:
+					case IPV6_FRAGMENT_HEADER:
+					case IPV6_AUTHENTICATION_HEADER:
+					case IPV6_DESTINATION_OPTIONS_HEADER:
+						break;
+					default:
+						return result;
+				}
+
+				// Every extension header starts with its next header and its length: we need at least those.
+				if ((count == IPV6_MAX_EXTENSION_HEADERS) || (size - result.offset < 8))
+				{
+					return boost::none;
+				}
+
+				const uint8_t* const header = data + result.offset;
+				size_t header_length = 8;
+
+				if (result.protocol == IPV6_FRAGMENT_HEADER)
+				{
+					result.fragment = true;
+
+					// Non-first fragments carry the continuation of the upper-layer payload: there is no header past this one.
+					if ((((header[2] << 8) | header[3]) & 0xFFF8) != 0)
+					{
+						result.first_fragment = false;
+						result.protocol = header[0];
+						result.offset += header_length;
+
+						return result;
+					}
+				}
+				else if (result.protocol == IPV6_AUTHENTICATION_HEADER)
+				{
+					header_length = (header[1] + 2) * 4;
+				}
+				else
+				{
+					header_length = (header[1] + 1) * 8;
+				}
+
+				if (header_length > size - result.offset)
+				{
+					return boost::none;
+				}
+
+				result.protocol = header[0];
+				result.offset += header_length;
+			}
+		}
 	}
 }
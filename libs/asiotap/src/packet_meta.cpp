@@ -0,0 +1,333 @@
+/*
+ * libasiotap - A portable TAP adapter extension for Boost::ASIO.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libasiotap.
+ *
+ * libasiotap is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libasiotap is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libasiotap in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file packet_meta.cpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief A packet metadata descriptor, computed once per frame.
+ */
+
+#include "osi/packet_meta.hpp"
+
+#include "osi/ethernet_frame.hpp"
+#include "osi/ipv4_frame.hpp"
+#include "osi/ipv6_helper.hpp"
+#include "osi/tcp_frame.hpp"
+#include "osi/udp_frame.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace asiotap
+{
+	namespace osi
+	{
+		namespace
+		{
+			// The frames are read byte per byte: the buffers are not guaranteed to be aligned.
+			uint16_t read_uint16(const uint8_t* data)
+			{
+				return static_cast<uint16_t>((data[0] << 8) | data[1]);
+			}
+
+			uint32_t fnv1a(uint32_t hash, const uint8_t* data, size_t size)
+			{
+				for (size_t i = 0; i < size; ++i)
+				{
+					hash = (hash ^ data[i]) * 16777619u;
+				}
+
+				return hash;
+			}
+
+			uint32_t compute_flow_hash(const packet_meta& meta)
+			{
+				const size_t address_size = (meta.ip_version == 4) ? 4 : 16;
+
+				const uint8_t* low_address = meta.source.data();
+				const uint8_t* high_address = meta.destination.data();
+				uint16_t low_port = meta.is_fragment() ? 0 : meta.source_port;
+				uint16_t high_port = meta.is_fragment() ? 0 : meta.destination_port;
+
+				// Ordering the endpoints gives both directions of a flow the same hash.
+				const int order = std::memcmp(low_address, high_address, address_size);
+
+				if ((order > 0) || ((order == 0) && (low_port > high_port)))
+				{
+					std::swap(low_address, high_address);
+					std::swap(low_port, high_port);
+				}
+
+				const uint8_t ports[4] = {
+					static_cast<uint8_t>(low_port >> 8),
+					static_cast<uint8_t>(low_port),
+					static_cast<uint8_t>(high_port >> 8),
+					static_cast<uint8_t>(high_port)
+				};
+
+				uint32_t hash = 2166136261u;
+
+				hash = fnv1a(hash, &meta.protocol, 1);
+				hash = fnv1a(hash, low_address, address_size);
+				hash = fnv1a(hash, high_address, address_size);
+				hash = fnv1a(hash, ports, sizeof(ports));
+
+				// FNV-1a leaves the low bits poorly mixed for short keys: finish with the MurmurHash3 finalizer.
+				hash ^= hash >> 16;
+				hash *= 0x85ebca6bu;
+				hash ^= hash >> 13;
+				hash *= 0xc2b2ae35u;
+				hash ^= hash >> 16;
+
+				return hash;
+			}
+
+			void parse_l4(const uint8_t* data, size_t size, size_t offset, packet_meta& meta)
+			{
+				const size_t available = size - offset;
+
+				switch (meta.protocol)
+				{
+					case TCP_PROTOCOL:
+					{
+						if (available < sizeof(tcp_frame))
+						{
+							return;
+						}
+
+						const size_t header_length = ((data[offset + 12] & 0xf0) >> 4) * 4;
+
+						if ((header_length < sizeof(tcp_frame)) || (header_length > available))
+						{
+							return;
+						}
+
+						meta.source_port = read_uint16(data + offset);
+						meta.destination_port = read_uint16(data + offset + 2);
+
+						break;
+					}
+					case UDP_PROTOCOL:
+					{
+						if (available < sizeof(udp_frame))
+						{
+							return;
+						}
+
+						meta.source_port = read_uint16(data + offset);
+						meta.destination_port = read_uint16(data + offset + 2);
+
+						break;
+					}
+					default:
+					{
+						// Other protocols have no ports: we only check that there is something past the IP header.
+						if (available == 0)
+						{
+							return;
+						}
+
+						break;
+					}
+				}
+
+				meta.l4_offset = static_cast<uint16_t>(offset);
+				meta.layers |= packet_meta::LAYER_4;
+			}
+
+			void parse_ipv4(const uint8_t* data, size_t size, size_t offset, packet_meta& meta)
+			{
+				const uint8_t* const header = data + offset;
+				const size_t header_length = (header[0] & 0x0f) * 4;
+
+				if ((header_length < sizeof(ipv4_frame)) || (header_length > size - offset) || (read_uint16(header + 2) < header_length))
+				{
+					return;
+				}
+
+				meta.ip_version = 4;
+				meta.protocol = header[9];
+				meta.l3_offset = static_cast<uint16_t>(offset);
+				meta.layers |= packet_meta::LAYER_3;
+				std::memcpy(meta.source.data(), header + 12, 4);
+				std::memcpy(meta.destination.data(), header + 16, 4);
+
+				const uint16_t flags_fragment = read_uint16(header + 6);
+				const bool more_fragments = ((flags_fragment & 0x2000) != 0);
+				const uint16_t fragment_offset = (flags_fragment & 0x1fff);
+
+				if (more_fragments || (fragment_offset != 0))
+				{
+					meta.layers |= packet_meta::FRAGMENT;
+				}
+
+				// Only the first fragment carries the transport header.
+				if (fragment_offset == 0)
+				{
+					parse_l4(data, size, offset + header_length, meta);
+				}
+			}
+
+			void parse_ipv6(const uint8_t* data, size_t size, size_t offset, packet_meta& meta)
+			{
+				const uint8_t* const header = data + offset;
+				const boost::optional<ipv6_upper_layer> upper_layer = find_ipv6_upper_layer(boost::asio::buffer(header, size - offset));
+
+				meta.ip_version = 6;
+				meta.protocol = upper_layer ? upper_layer->protocol : header[6];
+				meta.l3_offset = static_cast<uint16_t>(offset);
+				meta.layers |= packet_meta::LAYER_3;
+				std::memcpy(meta.source.data(), header + 8, 16);
+				std::memcpy(meta.destination.data(), header + 24, 16);
+
+				if (!upper_layer)
+				{
+					// The extension headers chain is truncated or too long: the packet is still routable, but we can't tell its transport.
+					return;
+				}
+
+				if (upper_layer->fragment)
+				{
+					meta.layers |= packet_meta::FRAGMENT;
+				}
+
+				if (upper_layer->first_fragment)
+				{
+					parse_l4(data, size, offset + upper_layer->offset, meta);
+				}
+			}
+
+			void parse_ip(const uint8_t* data, size_t size, size_t offset, packet_meta& meta)
+			{
+				if (size - offset < sizeof(ipv4_frame))
+				{
+					return;
+				}
+
+				const uint8_t version = (data[offset] >> 4);
+
+				if ((version == IP_PROTOCOL_VERSION_4) && ((meta.ethertype == 0) || (meta.ethertype == IP_PROTOCOL)))
+				{
+					meta.ethertype = IP_PROTOCOL;
+					parse_ipv4(data, size, offset, meta);
+				}
+				else if ((version == IP_PROTOCOL_VERSION_6) && ((meta.ethertype == 0) || (meta.ethertype == IPV6_PROTOCOL)) && (size - offset >= sizeof(ipv6_frame)))
+				{
+					meta.ethertype = IPV6_PROTOCOL;
+					parse_ipv6(data, size, offset, meta);
+				}
+
+				if (meta.has_l3())
+				{
+					meta.flow_hash = compute_flow_hash(meta);
+				}
+			}
+		}
+
+		const uint8_t packet_meta::LAYER_2;
+		const uint8_t packet_meta::LAYER_3;
+		const uint8_t packet_meta::LAYER_4;
+		const uint8_t packet_meta::FRAGMENT;
+
+		boost::asio::ip::address_v4 packet_meta::ipv4_source() const
+		{
+			boost::asio::ip::address_v4::bytes_type bytes;
+			std::copy(source.begin(), source.begin() + bytes.size(), bytes.begin());
+
+			return boost::asio::ip::address_v4(bytes);
+		}
+
+		boost::asio::ip::address_v4 packet_meta::ipv4_destination() const
+		{
+			boost::asio::ip::address_v4::bytes_type bytes;
+			std::copy(destination.begin(), destination.begin() + bytes.size(), bytes.begin());
+
+			return boost::asio::ip::address_v4(bytes);
+		}
+
+		boost::asio::ip::address_v6 packet_meta::ipv6_source() const
+		{
+			boost::asio::ip::address_v6::bytes_type bytes;
+			std::copy(source.begin(), source.end(), bytes.begin());
+
+			return boost::asio::ip::address_v6(bytes);
+		}
+
+		boost::asio::ip::address_v6 packet_meta::ipv6_destination() const
+		{
+			boost::asio::ip::address_v6::bytes_type bytes;
+			std::copy(destination.begin(), destination.end(), bytes.begin());
+
+			return boost::asio::ip::address_v6(bytes);
+		}
+
+		packet_meta parse_ethernet_packet_meta(boost::asio::const_buffer buf)
+		{
+			packet_meta meta;
+
+			const uint8_t* const data = boost::asio::buffer_cast<const uint8_t*>(buf);
+			const size_t size = boost::asio::buffer_size(buf);
+
+			if (size < sizeof(ethernet_frame))
+			{
+				return meta;
+			}
+
+			std::copy(data, data + ETHERNET_ADDRESS_SIZE, meta.ethernet_target.begin());
+			std::copy(data + ETHERNET_ADDRESS_SIZE, data + 2 * ETHERNET_ADDRESS_SIZE, meta.ethernet_sender.begin());
+			meta.ethertype = read_uint16(data + 2 * ETHERNET_ADDRESS_SIZE);
+			meta.layers = packet_meta::LAYER_2;
+
+			if ((meta.ethertype == IP_PROTOCOL) || (meta.ethertype == IPV6_PROTOCOL))
+			{
+				parse_ip(data, size, sizeof(ethernet_frame), meta);
+			}
+
+			return meta;
+		}
+
+		packet_meta parse_ip_packet_meta(boost::asio::const_buffer buf)
+		{
+			packet_meta meta;
+
+			parse_ip(boost::asio::buffer_cast<const uint8_t*>(buf), boost::asio::buffer_size(buf), 0, meta);
+
+			return meta;
+		}
+	}
+}
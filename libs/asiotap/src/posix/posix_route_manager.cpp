@@ -272,4 +272,60 @@ namespace asiotap
 				set_route(route_action::remove, route_entry.interface, ina);
 		}
 	}
+
+#if defined(LINUX) && !defined(FREELAN_DISABLE_NETLINK)
+	void posix_route_manager::async_register_route_batch(const std::vector<route_type>& routes, route_batch_handler_type handler)
+	{
+		async_set_route_batch(netlinkplus::route_operation::action_type::add, routes, handler);
+	}
+
+	void posix_route_manager::async_unregister_route_batch(const std::vector<route_type>& routes, route_batch_handler_type handler)
+	{
+		async_set_route_batch(netlinkplus::route_operation::action_type::remove, routes, handler);
+	}
+
+	void posix_route_manager::async_set_route_batch(netlinkplus::route_operation::action_type action, const std::vector<route_type>& routes, route_batch_handler_type handler)
+	{
+		// Hundreds of routes can come at once: they are sent in a few netlink datagrams rather than one round-trip each.
+		std::vector<boost::system::error_code> results(routes.size());
+		std::vector<netlinkplus::route_operation> operations;
+		std::vector<size_t> positions;
+
+		for (size_t i = 0; i < routes.size(); ++i)
+		{
+			const auto ina = network_address(routes[i].route);
+
+			try
+			{
+				operations.push_back(netlinkplus::route_operation(action, netlinkplus::interface_entry(routes[i].interface), to_ip_address(ina), to_prefix_length(ina), gateway(routes[i].route)));
+				positions.push_back(i);
+			}
+			catch (boost::system::system_error& ex)
+			{
+				results[i] = ex.code();
+			}
+		}
+
+		if (operations.empty())
+		{
+			io_service().post([results, handler] () {
+				handler(results);
+			});
+
+			return;
+		}
+
+		// The base class applies one batch at a time, so the manager never has two of them in flight.
+		m_route_batch_netlink_manager.async_set_routes(operations, [results, positions, handler] (const boost::system::error_code&, const netlinkplus::manager::batch_results_type& operation_results) {
+			std::vector<boost::system::error_code> _results = results;
+
+			for (size_t i = 0; i < positions.size(); ++i)
+			{
+				_results[positions[i]] = operation_results[i];
+			}
+
+			handler(_results);
+		});
+	}
+#endif
 }
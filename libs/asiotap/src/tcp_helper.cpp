@@ -85,7 +85,7 @@ namespace asiotap
 
 				pseudo_header.ipv6_source = parent_frame.frame().source;
 				pseudo_header.ipv6_destination = parent_frame.frame().destination;
-				pseudo_header.upper_layer_length = htonl(parent_frame.payload_length());
+				pseudo_header.upper_layer_length = htonl(static_cast<uint32_t>(parent_frame.upper_layer_length()));
 				pseudo_header.ipv6_next_header = TCP_PROTOCOL; // Must be this value, not the parent frame next-header as it could be different.
 
 				return pseudo_header;
@@ -43,45 +43,138 @@
  */
 
 #include "osi/tcp_mss_morpher.hpp"
+#include "osi/checksum.hpp"
+
+#include <algorithm>
 
 namespace asiotap
 {
 	namespace osi
 	{
-		namespace {
-			template <typename OSIHelperType>
-			void generic_handle(uint16_t max_mss, OSIHelperType ip_helper, mutable_helper<tcp_frame> tcp_helper) {
-				if (tcp_helper.syn_flag()) {
-					for (auto option = tcp_helper.first_option(); option.valid(); option = option.next_option()) {
-						if (option.kind() == TCP_OPTION_END) {
-							break;
-						}
-
-						if (option.kind() == TCP_OPTION_MSS) {
-							if (option.size() == 4) {
-								auto value = option.value();
-								uint16_t mss = ntohs(*boost::asio::buffer_cast<uint16_t*>(value));
-
-								if (mss > max_mss) {
-									*boost::asio::buffer_cast<uint16_t*>(value) = htons(max_mss);
-									tcp_helper.set_checksum(0x0000);
-									tcp_helper.set_checksum(tcp_helper.compute_checksum(ip_helper));
-								}
-							}
-
-							break;
-						}
+		bool tcp_mss_morpher::handle(boost::asio::mutable_buffer tcp_segment, direction _direction, size_t limit)
+		{
+			const size_t configured_max_mss = max_mss();
+			const size_t _max_mss = ((limit != 0) && ((configured_max_mss == 0) || (limit < configured_max_mss))) ? limit : configured_max_mss;
+			uint8_t* const segment = boost::asio::buffer_cast<uint8_t*>(tcp_segment);
+			const size_t size = boost::asio::buffer_size(tcp_segment);
+
+			// The flags are in the 14th byte of the header: this is the only read done for non-SYN segments.
+			if ((_max_mss == 0) || (size < sizeof(tcp_frame)) || ((segment[13] & TCP_FLAG_SYN) == 0))
+			{
+				return false;
+			}
+
+			const size_t header_length = ((segment[12] & 0xf0) >> 4) * 4;
+
+			// A SYN without options carries no MSS.
+			if ((header_length <= sizeof(tcp_frame)) || (header_length > size))
+			{
+				return false;
+			}
+
+			const uint16_t new_mss = static_cast<uint16_t>(std::min<size_t>(_max_mss, 0xFFFF));
+
+			for (size_t offset = sizeof(tcp_frame); offset < header_length;)
+			{
+				const uint8_t kind = segment[offset];
+
+				if (kind == TCP_OPTION_END)
+				{
+					break;
+				}
+
+				if (kind == TCP_OPTION_NOP)
+				{
+					++offset;
+
+					continue;
+				}
+
+				// Every other option has a length byte that accounts for the kind and itself: anything else is malformed and ends the scan.
+				if (header_length - offset < 2)
+				{
+					break;
+				}
+
+				const uint8_t option_size = segment[offset + 1];
+
+				if ((option_size < 2) || (option_size > header_length - offset))
+				{
+					break;
+				}
+
+				if (kind == TCP_OPTION_MSS)
+				{
+					if (option_size != 4)
+					{
+						break;
 					}
+
+					uint8_t* const value = segment + offset + 2;
+					const uint16_t mss = static_cast<uint16_t>((value[0] << 8) | value[1]);
+
+					if (mss <= new_mss)
+					{
+						break;
+					}
+
+					value[0] = static_cast<uint8_t>(new_mss >> 8);
+					value[1] = static_cast<uint8_t>(new_mss);
+
+					uint16_t checksum = static_cast<uint16_t>((segment[16] << 8) | segment[17]);
+
+					// Options may be preceded by padding: a value at an odd offset straddles two checksum words.
+					if ((offset + 2) % 2 == 0)
+					{
+						checksum = update_checksum(checksum, mss, new_mss);
+					}
+					else
+					{
+						const uint16_t old_value = static_cast<uint16_t>((mss << 8) | (mss >> 8));
+						const uint16_t new_value = static_cast<uint16_t>((new_mss << 8) | (new_mss >> 8));
+
+						checksum = update_checksum(checksum, old_value, new_value);
+					}
+
+					segment[16] = static_cast<uint8_t>(checksum >> 8);
+					segment[17] = static_cast<uint8_t>(checksum);
+
+					if (_direction == direction::outgoing)
+					{
+						m_outgoing_clamped.fetch_add(1, std::memory_order_relaxed);
+					}
+					else
+					{
+						m_incoming_clamped.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					return true;
 				}
+
+				offset += option_size;
 			}
+
+			return false;
 		}
 
-		void tcp_mss_morpher::handle(const_helper<ipv4_frame> ipv4_helper, mutable_helper<tcp_frame> tcp_helper) {
-			generic_handle(static_cast<uint16_t>(m_max_mss), ipv4_helper, tcp_helper);
+		void tcp_mss_morpher::handle(const_helper<ipv4_frame>, mutable_helper<tcp_frame> tcp_helper)
+		{
+			handle(tcp_helper.buffer());
 		}
 
-		void tcp_mss_morpher::handle(const_helper<ipv6_frame> ipv6_helper, mutable_helper<tcp_frame> tcp_helper) {
-			generic_handle(static_cast<uint16_t>(m_max_mss), ipv6_helper, tcp_helper);
+		void tcp_mss_morpher::handle(const_helper<ipv6_frame>, mutable_helper<tcp_frame> tcp_helper)
+		{
+			handle(tcp_helper.buffer());
+		}
+
+		tcp_mss_morpher::statistics_type tcp_mss_morpher::get_statistics() const
+		{
+			statistics_type result;
+
+			result.outgoing_clamped = m_outgoing_clamped.load(std::memory_order_relaxed);
+			result.incoming_clamped = m_incoming_clamped.load(std::memory_order_relaxed);
+
+			return result;
 		}
 	}
 }
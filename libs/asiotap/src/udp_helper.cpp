@@ -87,7 +87,7 @@ namespace asiotap
 
 				pseudo_header.ipv6_source = parent_frame.frame().source;
 				pseudo_header.ipv6_destination = parent_frame.frame().destination;
-				pseudo_header.ipv6_next_header = parent_frame.frame().next_header;
+				pseudo_header.ipv6_next_header = UDP_PROTOCOL; // Must be this value, not the parent frame next-header as it could be an extension header.
 				pseudo_header.udp_length = htons(udp_length);
 
 				return pseudo_header;
@@ -53,11 +53,34 @@
 #include <string>
 
 #include <boost/system/system_error.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <sys/types.h>
 
 namespace executeplus
 {
 	std::map<std::string, std::string> get_current_environment();
+	pid_t spawn(const std::vector<std::string>& args, const std::map<std::string, std::string>& env, int output_fd, boost::system::error_code& ec);
+	int wait_for_process(pid_t pid, boost::system::error_code& ec);
 	int execute(const std::vector<std::string>& args, const std::map<std::string, std::string>& env, boost::system::error_code& ec, std::ostream* output = nullptr);
+
+	/**
+	 * \brief The maximum count of output bytes that execute_with_timeout() keeps. The rest is discarded.
+	 */
+	const size_t MAX_OUTPUT_SIZE = 65536;
+
+	/**
+	 * \brief Execute a process and kill it if it runs for too long.
+	 * \param args The arguments. The first one is the path of the executable.
+	 * \param env The environment of the process.
+	 * \param timeout The time after which the process is killed, along with its own children. A special value disables the timeout.
+	 * \param ec The error, if any. If the process timed out, it is boost::system::errc::timed_out.
+	 * \param output If not null, receives the standard and error outputs of the process, up to MAX_OUTPUT_SIZE bytes.
+	 * \return The exit status of the process, or -1 if ec is set.
+	 *
+	 * The calling thread blocks until the process exits or is killed.
+	 */
+	int execute_with_timeout(const std::vector<std::string>& args, const std::map<std::string, std::string>& env, const boost::posix_time::time_duration& timeout, boost::system::error_code& ec, std::string* output = nullptr);
 	int execute(const std::vector<std::string>& args, const std::map<std::string, std::string>& env, std::ostream* output = nullptr);
 	void checked_execute(const std::vector<std::string>& args, const std::map<std::string, std::string>& env, std::ostream* output = nullptr);
 }
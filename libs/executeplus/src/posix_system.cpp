@@ -52,7 +52,17 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <spawn.h>
+#include <signal.h>
+#include <dirent.h>
+#include <poll.h>
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include <cstdlib>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -62,8 +72,189 @@
 
 extern char** environ;
 
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 34)))
+#define EXECUTEPLUS_HAS_ADDCLOSEFROM
+#endif
+
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#define EXECUTEPLUS_HAS_PIPE2
+#endif
+
+#if defined(__linux__) && defined(SYS_pidfd_open)
+#define EXECUTEPLUS_HAS_PIDFD
+#endif
+
 namespace executeplus
 {
+	namespace
+	{
+		std::vector<char*> to_c_strings(std::vector<std::string>& strings)
+		{
+			std::vector<char*> result;
+			result.reserve(strings.size() + 1);
+
+			for (auto&& str : strings)
+			{
+				result.push_back(&str[0]);
+			}
+
+			result.push_back(nullptr);
+
+			return result;
+		}
+
+		// The child must only keep its standard descriptors: it must not hold the tap adapter or the sockets of the parent.
+		void close_inherited_descriptors(posix_spawn_file_actions_t& actions, posix_spawnattr_t& attr, short& flags)
+		{
+#if defined(EXECUTEPLUS_HAS_ADDCLOSEFROM)
+			static_cast<void>(attr);
+			static_cast<void>(flags);
+
+			::posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1);
+#elif defined(POSIX_SPAWN_CLOEXEC_DEFAULT)
+			static_cast<void>(actions);
+			static_cast<void>(attr);
+
+			flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;
+#else
+			static_cast<void>(attr);
+			static_cast<void>(flags);
+
+			DIR* const dir = ::opendir("/dev/fd");
+
+			if (dir)
+			{
+				const int dir_fd = ::dirfd(dir);
+
+				while (const struct dirent* entry = ::readdir(dir))
+				{
+					const int fd = std::atoi(entry->d_name);
+
+					if ((fd > STDERR_FILENO) && (fd != dir_fd))
+					{
+						::posix_spawn_file_actions_addclose(&actions, fd);
+					}
+				}
+
+				::closedir(dir);
+			}
+#endif
+		}
+
+		// Processes spawned concurrently by other threads must not inherit our pipe, or its end would never be seen.
+		int make_pipe(int fds[2])
+		{
+#if defined(EXECUTEPLUS_HAS_PIPE2)
+			return ::pipe2(fds, O_CLOEXEC);
+#else
+			// Without pipe2(), a fork() from another thread can still slip between the two calls: our own spawns close every inherited descriptor anyway.
+			if (::pipe(fds) < 0)
+			{
+				return -1;
+			}
+
+			::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+			::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+			return 0;
+#endif
+		}
+
+		// Wait for the descriptor to be readable: return false if the deadline expired first.
+		bool wait_readable(int fd, const boost::posix_time::ptime& deadline)
+		{
+			for (;;)
+			{
+				int timeout_ms = -1;
+
+				if (!deadline.is_special())
+				{
+					const boost::posix_time::time_duration remaining = deadline - boost::posix_time::microsec_clock::universal_time();
+
+					if (remaining.is_negative())
+					{
+						return false;
+					}
+
+					timeout_ms = static_cast<int>(remaining.total_milliseconds()) + 1;
+				}
+
+				struct pollfd pfd = { fd, POLLIN, 0 };
+				const int result = ::poll(&pfd, 1, timeout_ms);
+
+				if (result > 0)
+				{
+					return true;
+				}
+
+				if ((result < 0) && (errno != EINTR))
+				{
+					// Let the caller find the error out when it reads.
+					return true;
+				}
+			}
+		}
+
+		// Read the output until the process and its children close it: return false if the deadline expired first.
+		bool read_output(int fd, const boost::posix_time::ptime& deadline, std::string* output)
+		{
+			char buffer[4096];
+
+			for (;;)
+			{
+				if (!wait_readable(fd, deadline))
+				{
+					return false;
+				}
+
+				const ssize_t cnt = ::read(fd, buffer, sizeof(buffer));
+
+				if (cnt < 0)
+				{
+					if ((errno == EINTR) || (errno == EAGAIN))
+					{
+						continue;
+					}
+
+					return true;
+				}
+
+				if (cnt == 0)
+				{
+					return true;
+				}
+
+				if (output && (output->size() < MAX_OUTPUT_SIZE))
+				{
+					output->append(buffer, std::min(static_cast<size_t>(cnt), MAX_OUTPUT_SIZE - output->size()));
+				}
+			}
+		}
+
+		// Wait for the process to exit: return false if the deadline expired first.
+		bool wait_exit(pid_t pid, const boost::posix_time::ptime& deadline)
+		{
+#if defined(EXECUTEPLUS_HAS_PIDFD)
+			const int pidfd = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+
+			if (pidfd >= 0)
+			{
+				const bool exited = wait_readable(pidfd, deadline);
+
+				::close(pidfd);
+
+				return exited;
+			}
+#else
+			static_cast<void>(pid);
+			static_cast<void>(deadline);
+#endif
+
+			// A process that closed its output most likely exited: the caller's blocking wait covers the rest.
+			return true;
+		}
+	}
+
 	std::map<std::string, std::string> get_current_environment()
 	{
 		std::map<std::string, std::string> result;
@@ -88,222 +279,220 @@ namespace executeplus
 		return result;
 	}
 
-	int execute(const std::vector<std::string>& args, const std::map<std::string, std::string>& env, boost::system::error_code& ec, std::ostream* output)
+	pid_t spawn(const std::vector<std::string>& args, const std::map<std::string, std::string>& env, int output_fd, boost::system::error_code& ec)
 	{
-#if FREELAN_DEBUG
-		std::cout << "Executing:";
+		if (args.empty())
+		{
+			ec = boost::system::error_code(EINVAL, boost::system::system_category());
 
-		for (auto&& arg : args)
+			return -1;
+		}
+
+		std::vector<std::string> arg_strings = args;
+		std::vector<std::string> env_strings;
+		env_strings.reserve(env.size());
+
+		for (auto&& pair : env)
 		{
-			std::cout << " " << arg;
+			env_strings.push_back(pair.first + "=" + pair.second);
 		}
 
-		std::cout << std::endl;
+		const std::vector<char*> argv = to_c_strings(arg_strings);
+		const std::vector<char*> envp = to_c_strings(env_strings);
 
-		std::cout << "Environment starts:" << std::endl;
+		posix_spawn_file_actions_t actions;
+		posix_spawnattr_t attr;
 
-		for (auto&& pair : env)
+		::posix_spawn_file_actions_init(&actions);
+		::posix_spawnattr_init(&attr);
+
+		::posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+
+		if (output_fd >= 0)
 		{
-			std::cout << pair.first << "=" << pair.second << std::endl;
+			::posix_spawn_file_actions_adddup2(&actions, output_fd, STDOUT_FILENO);
+			::posix_spawn_file_actions_adddup2(&actions, output_fd, STDERR_FILENO);
+		}
+		else
+		{
+			::posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+			::posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
 		}
 
-		std::cout << "Environment ends." << std::endl;
-#endif
+		// The child gets its own process group so that it can be killed along with its own children.
+		short flags = POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+
+		close_inherited_descriptors(actions, attr, flags);
 
-		int fd[2] = {0, 0};
+		sigset_t mask;
+		sigemptyset(&mask);
+		::posix_spawnattr_setsigmask(&attr, &mask);
 
-		if (::pipe(fd) < 0)
+		sigset_t defaults;
+		sigemptyset(&defaults);
+		sigaddset(&defaults, SIGPIPE);
+		::posix_spawnattr_setsigdefault(&attr, &defaults);
+
+		::posix_spawnattr_setpgroup(&attr, 0);
+		::posix_spawnattr_setflags(&attr, flags);
+
+		// Unlike fork(), posix_spawn() does not copy the address space of the parent: its cost does not depend on the size of our heap.
+		pid_t pid = -1;
+		const int result = ::posix_spawn(&pid, argv[0], &actions, &attr, &argv[0], &envp[0]);
+
+		::posix_spawnattr_destroy(&attr);
+		::posix_spawn_file_actions_destroy(&actions);
+
+		if (result != 0)
 		{
-			ec = boost::system::error_code(errno, boost::system::system_category());
+			ec = boost::system::error_code(result, boost::system::system_category());
 
 			return -1;
 		}
 
-		int output_fd[2] = {0, 0};
+		return pid;
+	}
 
-		if (output)
-		{
-			if (::pipe(output_fd) < 0)
-			{
-				ec = boost::system::error_code(errno, boost::system::system_category());
+	int wait_for_process(pid_t pid, boost::system::error_code& ec)
+	{
+		int status = 0;
+		pid_t result;
 
-				return -1;
-			}
+		do
+		{
+			result = ::waitpid(pid, &status, 0);
 		}
+		while ((result < 0) && (errno == EINTR));
 
-		const pid_t pid = fork();
+		if (result != pid)
+		{
+			ec = boost::system::error_code(errno, boost::system::system_category());
 
-		switch (pid)
+			return -1;
+		}
+
+		if (WIFEXITED(status))
 		{
-			case -1:
-				{
-					// fork() failed.
-					if (output)
-					{
-						::close(output_fd[0]);
-						::close(output_fd[1]);
-					}
+			const int exit_status = WEXITSTATUS(status);
 
-					::close(fd[0]);
-					::close(fd[1]);
+#if FREELAN_DEBUG
+			std::cout << "Exit status: " << exit_status << std::endl;
+#endif
 
-					ec = boost::system::error_code(errno, boost::system::system_category());
+			return exit_status;
+		}
 
-					return -1;
-				}
-			case 0:
-				{
-					// Child process
-					const int fdlimit = ::sysconf(_SC_OPEN_MAX);
+		return EXIT_FAILURE;
+	}
 
-					if (output)
-					{
-						::dup2(output_fd[1], STDOUT_FILENO);
-						::dup2(output_fd[1], STDERR_FILENO);
-						::close(output_fd[1]);
-					}
+	int execute(const std::vector<std::string>& args, const std::map<std::string, std::string>& env, boost::system::error_code& ec, std::ostream* output)
+	{
+#if FREELAN_DEBUG
+		std::cout << "Executing:";
 
-					for (int n = 0; n < fdlimit; ++n)
-					{
-						if ((n != fd[1]) && (!output || ((n != STDOUT_FILENO) && (n != STDERR_FILENO))))
-						{
-							::close(n);
-						}
-					}
+		for (auto&& arg : args)
+		{
+			std::cout << " " << arg;
+		}
 
-					fcntl(fd[1], F_SETFD, FD_CLOEXEC);
+		std::cout << std::endl;
 
-					// Estimate the required size for the argv buffer.
-					std::vector<char> argv_buffer;
-					std::vector<char*> argv(args.size() + 1, nullptr);
+		std::cout << "Environment starts:" << std::endl;
 
-					{
-						// One null-terminated byte per arg.
-						size_t buffer_size = args.size();
+		for (auto&& pair : env)
+		{
+			std::cout << pair.first << "=" << pair.second << std::endl;
+		}
 
-						for (auto&& arg : args)
-						{
-							buffer_size += arg.size();
-						}
+		std::cout << "Environment ends." << std::endl;
+#endif
 
-						argv_buffer.resize(buffer_size, 0x00);
-						auto offset = argv_buffer.begin();
+		int output_fd[2] = {-1, -1};
 
-						for (size_t i = 0; i != args.size(); ++i)
-						{
-							const auto& arg = args[i];
+		if (output)
+		{
+			if (make_pipe(output_fd) < 0)
+			{
+				ec = boost::system::error_code(errno, boost::system::system_category());
 
-							argv[i] = &*offset;
-							offset = std::copy(arg.begin(), arg.end(), offset);
-							*(offset++) = '\0';
-						}
-					}
+				return -1;
+			}
+		}
 
-					// Estimate the required size for the envp buffer.
-					std::vector<char> envp_buffer;
-					std::vector<char*> envp(env.size() + 1, nullptr);
+		const pid_t pid = spawn(args, env, output_fd[1], ec);
 
-					{
-						// One null-terminated byte per arg.
-						size_t buffer_size = env.size();
-
-						for (auto&& pair : env)
-						{
-							buffer_size += pair.first.size() + 1 + pair.second.size();
-						}
-
-						envp_buffer.resize(buffer_size, 0x00);
-						auto offset = envp_buffer.begin();
-
-						for (size_t i = 0; i != env.size(); ++i)
-						{
-							auto it = env.begin();
-							std::advance(it, i);
-							const auto& pair = *it;
-
-							envp[i] = &*offset;
-							offset = std::copy(pair.first.begin(), pair.first.end(), offset);
-							*(offset++) = '=';
-							offset = std::copy(pair.second.begin(), pair.second.end(), offset);
-							*(offset++) = '\0';
-						}
-					}
+		if (output)
+		{
+			::close(output_fd[1]);
+		}
 
-					// Execute the file specified
-					::execve(argv[0], &argv[0], &envp[0]);
+		if (pid < 0)
+		{
+			if (output)
+			{
+				::close(output_fd[0]);
+			}
 
-					// Something went wrong. Sending back errno to parent process then exiting.
-					if (::write(fd[1], &errno, sizeof(errno))) {}
+			return -1;
+		}
 
-					_exit(127);
+		if (output)
+		{
+			// This will take ownership of the file descriptor.
+			boost::iostreams::file_descriptor_source output_src(output_fd[0], boost::iostreams::close_handle);
+			boost::iostreams::stream<boost::iostreams::file_descriptor_source> output_is(output_src);
 
-					break;
-				}
-			default:
-				{
-					// Parent process
-					::close(fd[1]);
+			(*output) << output_is.rdbuf();
+		}
 
-					if (output)
-					{
-						::close(output_fd[1]);
-					}
+		return wait_for_process(pid, ec);
+	}
 
-					int child_errno = 0;
+	int execute_with_timeout(const std::vector<std::string>& args, const std::map<std::string, std::string>& env, const boost::posix_time::time_duration& timeout, boost::system::error_code& ec, std::string* output)
+	{
+		int output_fd[2] = {-1, -1};
 
-					if (output)
-					{
-						// This will take ownership of the file descriptor.
-						boost::iostreams::file_descriptor_source output_src(output_fd[0], boost::iostreams::close_handle);
-						boost::iostreams::stream<boost::iostreams::file_descriptor_source> output_is(output_src);
+		// The pipe is created even when the output is not wanted: its end tells us when the process exits without polling for it.
+		if (make_pipe(output_fd) < 0)
+		{
+			ec = boost::system::error_code(errno, boost::system::system_category());
 
-						(*output) << output_is.rdbuf();
-					}
+			return -1;
+		}
 
-					const ssize_t readcnt = ::read(fd[0], &child_errno, sizeof(child_errno));
+		const pid_t pid = spawn(args, env, output_fd[1], ec);
 
-					::close(fd[0]);
+		::close(output_fd[1]);
 
-					if (readcnt < 0)
-					{
-						ec = boost::system::error_code(errno, boost::system::system_category());
+		if (pid < 0)
+		{
+			::close(output_fd[0]);
 
-						return -1;
-					}
-					else if (readcnt == sizeof(child_errno))
-					{
-						ec = boost::system::error_code(child_errno, boost::system::system_category());
+			return -1;
+		}
 
-						return -1;
-					}
+		const boost::posix_time::ptime deadline = timeout.is_special() ? boost::posix_time::ptime(boost::posix_time::pos_infin) : boost::posix_time::microsec_clock::universal_time() + timeout;
 
-					int status = 0;
+		const bool exited = read_output(output_fd[0], deadline, output) && wait_exit(pid, deadline);
 
-					if (::waitpid(pid, &status, 0) != pid)
-					{
-						ec = boost::system::error_code(child_errno, boost::system::system_category());
+		::close(output_fd[0]);
 
-						return -1;
-					}
-					else
-					{
-						if (WIFEXITED(status))
-						{
-							const int result = WEXITSTATUS(status);
+		if (!exited)
+		{
+			// The process runs in its own group: its children are killed as well.
+			::kill(-pid, SIGKILL);
+		}
 
-#if FREELAN_DEBUG
-							std::cout << "Exit status: " << result << std::endl;
-#endif
+		const int exit_status = wait_for_process(pid, ec);
 
-							return result;
-						}
-					}
+		if (!exited)
+		{
+			ec = make_error_code(boost::system::errc::timed_out);
 
-					break;
-				}
+			return -1;
 		}
 
-		return EXIT_FAILURE;
+		return exit_status;
 	}
 
 	int execute(const std::vector<std::string>& args, const std::map<std::string, std::string>& env, std::ostream* output)
@@ -0,0 +1,161 @@
+/*
+ * libfreelan - A C++ library to establish peer-to-peer virtual private
+ * networks.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfreelan.
+ *
+ * libfreelan is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfreelan is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfreelan in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file certificate_validation_cache.hpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief A cache of certificate validation verdicts.
+ */
+
+#ifndef FREELAN_CERTIFICATE_VALIDATION_CACHE_HPP
+#define FREELAN_CERTIFICATE_VALIDATION_CACHE_HPP
+
+#include <fscp/constants.hpp>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/optional.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <map>
+#include <list>
+
+#include <stdint.h>
+
+namespace freelan
+{
+	/**
+	 * \brief A bounded cache of certificate validation verdicts, keyed by certificate fingerprint.
+	 *
+	 * Valid and invalid verdicts have separate time-to-live values. A verdict never outlives the certificate it applies to. When the cache is full, the least recently used verdict is evicted.
+	 *
+	 * All the public methods are thread-safe.
+	 */
+	class certificate_validation_cache : public boost::noncopyable
+	{
+		public:
+
+			/**
+			 * \brief The key type.
+			 */
+			typedef fscp::hash_type key_type;
+
+			/**
+			 * \brief The generation type.
+			 */
+			typedef uint64_t generation_type;
+
+			/**
+			 * \brief The statistics type.
+			 */
+			struct statistics_type
+			{
+				uint64_t hits;
+				uint64_t misses;
+			};
+
+			/**
+			 * \brief The default capacity.
+			 */
+			static const size_t DEFAULT_CAPACITY = 1024;
+
+			/**
+			 * \brief Create a certificate validation cache.
+			 * \param positive_ttl The time during which a valid verdict is kept. A null value disables caching of valid verdicts.
+			 * \param negative_ttl The time during which an invalid verdict is kept. A null value disables caching of invalid verdicts.
+			 * \param capacity The maximum count of verdicts to keep. Must be non-zero.
+			 */
+			certificate_validation_cache(const boost::posix_time::time_duration& positive_ttl, const boost::posix_time::time_duration& negative_ttl, size_t capacity = DEFAULT_CAPACITY);
+
+			/**
+			 * \brief Get a verdict.
+			 * \param key The certificate fingerprint.
+			 * \param generation The current generation of the cache, to give back to set().
+			 * \return The verdict, if one is cached and has not expired.
+			 */
+			boost::optional<bool> get(const key_type& key, generation_type& generation);
+
+			/**
+			 * \brief Set a verdict.
+			 * \param key The certificate fingerprint.
+			 * \param valid The verdict.
+			 * \param generation The generation returned by the get() call that preceded the validation. If the cache was invalidated since, the verdict is discarded.
+			 * \param not_after The end of the validity period of the certificate. The verdict expires at that time at the latest. A special value means no limit.
+			 * \return true if the verdict was cached.
+			 */
+			bool set(const key_type& key, bool valid, generation_type generation, const boost::posix_time::ptime& not_after = boost::posix_time::ptime());
+
+			/**
+			 * \brief Invalidate all the cached verdicts.
+			 *
+			 * Call this whenever the inputs of the validation change, like the CA store or the certificate revocation lists.
+			 */
+			void invalidate();
+
+			/**
+			 * \brief Get the cache statistics.
+			 * \return The count of hits and misses since the creation of the cache.
+			 */
+			statistics_type get_statistics() const;
+
+		private:
+
+			typedef std::list<key_type> lru_list_type;
+
+			struct entry_type
+			{
+				bool valid;
+				boost::posix_time::ptime expiration;
+				lru_list_type::iterator lru_position;
+			};
+
+			typedef std::map<key_type, entry_type> entry_map_type;
+
+			const boost::posix_time::time_duration m_positive_ttl;
+			const boost::posix_time::time_duration m_negative_ttl;
+			const size_t m_capacity;
+			mutable boost::mutex m_mutex;
+			entry_map_type m_entries;
+			lru_list_type m_lru_list;
+			generation_type m_generation;
+			statistics_type m_statistics;
+	};
+}
+
+#endif /* FREELAN_CERTIFICATE_VALIDATION_CACHE_HPP */
@@ -302,6 +302,26 @@ namespace freelan
 		 */
 		hostname_resolution_protocol_type hostname_resolution_protocol;
 
+		/**
+		 * \brief The count of threads that resolve hostnames.
+		 */
+		unsigned int hostname_resolution_threads;
+
+		/**
+		 * \brief The time during which a resolved hostname is not resolved again.
+		 */
+		boost::posix_time::time_duration hostname_resolution_cache_ttl;
+
+		/**
+		 * \brief The time during which a hostname that failed to resolve is not resolved again.
+		 */
+		boost::posix_time::time_duration hostname_resolution_negative_cache_ttl;
+
+		/**
+		 * \brief Whether an expired resolution is still used while being refreshed.
+		 */
+		bool hostname_resolution_stale_while_revalidate;
+
 		/**
 		 * \brief The hello timeout.
 		 */
@@ -323,9 +343,29 @@ namespace freelan
 		bool upnp_enabled;
 
 		/*
-		 * \brief Maximum HELLO/PRESENTATION message from one host per second.
+		 * \brief Maximum HELLO/PRESENTATION/SESSION_REQUEST/SESSION message from one host per second.
 		 */
 		size_t max_unauthenticated_messages_per_second;
+
+		/**
+		 * \brief The maximum age of a session before it gets renewed.
+		 */
+		boost::posix_time::time_duration session_renewal_period;
+
+		/**
+		 * \brief The maximum count of bytes exchanged with a session before it gets renewed.
+		 */
+		uint64_t session_renewal_data_size;
+
+		/**
+		 * \brief Whether to only send the certificate hash when presenting to hosts that already know the certificate.
+		 */
+		bool hash_only_presentation;
+
+		/**
+		 * \brief Whether to probe the path MTU to each host.
+		 */
+		bool path_mtu_discovery;
 	};
 
 	/**
@@ -406,6 +446,16 @@ namespace freelan
 		 * \brief The certificate revocation lists.
 		 */
 		crl_list_type certificate_revocation_list_list;
+
+		/**
+		 * \brief The time during which a certificate found valid is not validated again.
+		 */
+		boost::posix_time::time_duration certificate_validation_cache_positive_ttl;
+
+		/**
+		 * \brief The time during which a certificate found invalid is not validated again.
+		 */
+		boost::posix_time::time_duration certificate_validation_cache_negative_ttl;
 	};
 
 	/**
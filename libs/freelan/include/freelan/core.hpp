@@ -51,6 +51,10 @@
 #include "router.hpp"
 #include "message.hpp"
 #include "routes_message.hpp"
+#include "routes_delta_message.hpp"
+#include "certificate_validation_cache.hpp"
+#include "revocation_index.hpp"
+#include "hostname_resolver.hpp"
 
 #include <fscp/fscp.hpp>
 #include <fscp/logger.hpp>
@@ -60,8 +64,10 @@
 #include <asiotap/osi/arp_proxy.hpp>
 #include <asiotap/osi/tcp_mss_morpher.hpp>
 #include <asiotap/osi/dhcp_proxy.hpp>
+#include <asiotap/osi/icmp_error.hpp>
 #include <asiotap/osi/icmpv6_proxy.hpp>
-#include <asiotap/osi/complex_filter.hpp>
+#include <asiotap/osi/packet_meta.hpp>
+#include <asiotap/osi/static_filter.hpp>
 #include <asiotap/route_manager.hpp>
 #include <asiotap/dns_servers_manager.hpp>
 #include <asiotap/types/ip_route.hpp>
@@ -77,12 +83,14 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/thread.hpp>
 
+#include <deque>
 #include <queue>
 #include <set>
 
 namespace freelan
 {
 	class routes_request_message;
+	class routes_delta_request_message;
 	class web_server;
 	class web_client;
 
@@ -125,6 +133,11 @@ namespace freelan
 			 */
 			typedef security_configuration::crl_type crl_type;
 
+			/**
+			 * \brief The certificate revocation list list type.
+			 */
+			typedef security_configuration::crl_list_type crl_list_type;
+
 			/**
 			 * \brief The resolver type.
 			 */
@@ -266,6 +279,11 @@ namespace freelan
 			 */
 			static const boost::posix_time::time_duration ROUTES_REQUEST_PERIOD;
 
+			/**
+			 * \brief The count of local routes versions kept to answer routes delta requests.
+			 */
+			static const size_t LOCAL_ROUTES_HISTORY_SIZE;
+
 			/**
 			 * \brief The renew certificate warning period.
 			 */
@@ -396,6 +414,25 @@ namespace freelan
 			void set_certificate_validation_callback(certificate_validation_handler_type callback)
 			{
 				m_certificate_validation_callback = callback;
+				m_certificate_validation_cache.invalidate();
+			}
+
+			/**
+			 * \brief Get the certificate validation cache statistics.
+			 * \return The count of certificate validations that were answered from the cache (hits) and that had to be computed (misses).
+			 */
+			certificate_validation_cache::statistics_type get_certificate_validation_cache_statistics() const
+			{
+				return m_certificate_validation_cache.get_statistics();
+			}
+
+			/**
+			 * \brief Get the TCP MSS clamping statistics.
+			 * \return The count of SYN segments whose MSS was clamped, for the segments read from the tap adapter (outgoing) and received from the peers (incoming).
+			 */
+			asiotap::osi::tcp_mss_morpher::statistics_type get_tcp_mss_morpher_statistics() const
+			{
+				return m_tcp_mss_morpher.get_statistics();
 			}
 
 			/**
@@ -428,6 +465,15 @@ namespace freelan
 				m_dns_callback = callback;
 			}
 
+			/**
+			 * \brief Replace the certificate revocation lists.
+			 * \param crl_list The new certificate revocation lists.
+			 * \param handler The handler to call once the CA store and the revocation index were rebuilt.
+			 *
+			 * Only the revocation lists that changed are indexed again. The sessions that are already established are not affected.
+			 */
+			void async_reload_certificate_revocation_lists(const crl_list_type& crl_list, void_handler_type handler);
+
 			/**
 			 * \brief Open the core.
 			 * \see close
@@ -493,6 +539,12 @@ namespace freelan
 			void async_send_routes_request_to_all(multiple_endpoints_handler_type);
 			void async_send_routes_request_to_all();
 			void async_send_routes(const ep_type&, routes_message::version_type, const asiotap::ip_route_set&, const asiotap::ip_address_set& dns_servers, simple_handler_type);
+			void async_handle_routes_delta_request(const ep_type&, const routes_delta_request_message&);
+			void async_handle_routes_delta(const ep_type&, const routes_delta_message&);
+			void async_send_routes_delta_request(const ep_type&, const boost::optional<routes_message::version_type>&, simple_handler_type);
+			void async_send_routes_delta_request(const ep_type&, const boost::optional<routes_message::version_type>&);
+			void async_send_session_routes_requests(const ep_type&);
+			void async_send_routes_delta(const ep_type&, routes_message::version_type, routes_message::version_type, bool, const route_delta&, const routes_delta_message::dns_servers_delta&);
 
 			void do_contact(const ep_type&, duration_handler_type);
 
@@ -506,6 +558,7 @@ namespace freelan
 			void do_handle_request_session(const ep_type&, const boost::system::error_code&);
 			void do_handle_send_routes_request(const ep_type&, const boost::system::error_code&);
 			void do_handle_send_routes_request_to_all(const std::map<ep_type, boost::system::error_code>&);
+			void do_handle_send_routes_delta(const ep_type&, const boost::system::error_code&);
 
 			bool do_handle_hello_received(const ep_type&, bool);
 			bool do_handle_contact_request_received(const ep_type&, cert_type, hash_type, const ep_type&);
@@ -517,12 +570,16 @@ namespace freelan
 			void do_handle_session_error(const ep_type&, bool, const std::exception&);
 			void do_handle_session_established(const ep_type&, bool, const fscp::cipher_suite_type&, const fscp::elliptic_curve_type&);
 			void do_handle_session_lost(const ep_type&, fscp::server::session_loss_reason);
+			void do_handle_path_mtu_changed(const ep_type&, size_t);
 			void do_handle_data_received(const ep_type&, fscp::channel_number_type, fscp::SharedBuffer, boost::asio::const_buffer);
 			void do_handle_message(const ep_type&, fscp::SharedBuffer, const message&);
 			void do_handle_routes_request(const ep_type&);
 			void do_handle_routes(const asiotap::ip_network_address_list&, const ep_type&, routes_message::version_type, const asiotap::ip_route_set&, const asiotap::ip_address_set&);
+			void do_send_routes_requests(const std::set<ep_type>&);
+			void do_handle_routes_delta_request(const ep_type&, const boost::optional<routes_message::version_type>&);
 
 			boost::shared_ptr<fscp::server> m_fscp_server;
+			boost::scoped_ptr<hostname_resolver> m_hostname_resolver;
 			boost::asio::deadline_timer m_contact_timer;
 			boost::asio::deadline_timer m_dynamic_contact_timer;
 			boost::asio::deadline_timer m_routes_request_timer;
@@ -539,28 +596,31 @@ namespace freelan
 			};
 
 			void build_ca_store(build_ca_store_when);
+			void do_build_ca_store(build_ca_store_when);
 			bool certificate_validation_method(bool, cryptoplus::x509::store_context);
 			bool certificate_is_valid(cert_type);
+			bool validate_certificate(cert_type);
+
+			typedef boost::shared_ptr<const cryptoplus::x509::store> ca_store_snapshot_type;
 
-			cryptoplus::x509::store m_ca_store;
+			typedef boost::shared_ptr<const revocation_index> revocation_index_snapshot_type;
+
+			void do_reload_certificate_revocation_lists(const crl_list_type&, void_handler_type);
+
+			// The CA store is never modified once published: rebuilds swap in a new snapshot atomically.
+			// Readers only load the snapshots. The writers hold m_ca_store_mutex while they change the CA and CRL lists and rebuild from them.
 			boost::mutex m_ca_store_mutex;
+			ca_store_snapshot_type m_ca_store;
+			revocation_index_snapshot_type m_revocation_index;
+			certificate_validation_cache m_certificate_validation_cache;
 
 		private: /* TAP adapter */
 
-			typedef asiotap::osi::filter<asiotap::osi::ethernet_frame> ethernet_filter_type;
-			typedef asiotap::osi::complex_filter<asiotap::osi::arp_frame, asiotap::osi::ethernet_frame>::type arp_filter_type;
-			typedef asiotap::osi::complex_filter<asiotap::osi::ipv4_frame, asiotap::osi::ethernet_frame>::type ipv4_filter_type;
-			typedef asiotap::osi::complex_filter<asiotap::osi::ipv6_frame, asiotap::osi::ethernet_frame>::type ipv6_filter_type;
-			typedef asiotap::osi::complex_filter<asiotap::osi::udp_frame, asiotap::osi::ipv4_frame, asiotap::osi::ethernet_frame>::type udp_filter_type;
-			typedef asiotap::osi::complex_filter<asiotap::osi::tcp_frame, asiotap::osi::ipv4_frame, asiotap::osi::ethernet_frame>::type tcpv4_filter_type;
-			typedef asiotap::osi::complex_filter<asiotap::osi::tcp_frame, asiotap::osi::ipv6_frame, asiotap::osi::ethernet_frame>::type tcpv6_filter_type;
-			typedef asiotap::osi::complex_filter<asiotap::osi::bootp_frame, asiotap::osi::udp_frame, asiotap::osi::ipv4_frame, asiotap::osi::ethernet_frame>::type bootp_filter_type;
-			typedef asiotap::osi::complex_filter<asiotap::osi::dhcp_frame, asiotap::osi::bootp_frame, asiotap::osi::udp_frame, asiotap::osi::ipv4_frame, asiotap::osi::ethernet_frame>::type dhcp_filter_type;
-			typedef asiotap::osi::filter<asiotap::osi::ipv4_frame> tun_ipv4_filter_type;
-			typedef asiotap::osi::filter<asiotap::osi::ipv6_frame> tun_ipv6_filter_type;
-			typedef asiotap::osi::complex_filter<asiotap::osi::tcp_frame, asiotap::osi::ipv4_frame>::type tun_tcpv4_filter_type;
-			typedef asiotap::osi::complex_filter<asiotap::osi::tcp_frame, asiotap::osi::ipv6_frame>::type tun_tcpv6_filter_type;
-			typedef asiotap::osi::complex_filter<asiotap::osi::icmpv6_frame, asiotap::osi::ipv6_frame>::type tun_icmpv6_filter_type;
+			typedef asiotap::osi::const_helper<asiotap::osi::ethernet_frame> ethernet_helper_type;
+			typedef asiotap::osi::const_helper<asiotap::osi::ipv4_frame> ipv4_helper_type;
+			typedef asiotap::osi::const_helper<asiotap::osi::ipv6_frame> ipv6_helper_type;
+			typedef asiotap::osi::const_helper<asiotap::osi::udp_frame> udp_helper_type;
+			typedef asiotap::osi::const_helper<asiotap::osi::bootp_frame> bootp_helper_type;
 			typedef asiotap::osi::const_helper<asiotap::osi::arp_frame> arp_helper_type;
 			typedef asiotap::osi::const_helper<asiotap::osi::dhcp_frame> dhcp_helper_type;
 			typedef asiotap::osi::const_helper<asiotap::osi::icmpv6_frame> icmpv6_helper_type;
@@ -590,9 +650,14 @@ namespace freelan
 
 			void do_handle_tap_adapter_read(fscp::SharedBuffer, const boost::system::error_code&, size_t);
 			void do_handle_tap_adapter_write(const boost::system::error_code&);
-			void do_handle_arp_frame(const arp_helper_type&);
-			void do_handle_dhcp_frame(const dhcp_helper_type&);
-			void do_handle_icmpv6_frame(const icmpv6_helper_type&);
+			bool do_handle_tap_adapter_frame(boost::asio::mutable_buffer, const asiotap::osi::packet_meta&);
+			bool do_handle_tun_adapter_frame(boost::asio::mutable_buffer, const asiotap::osi::packet_meta&);
+			void do_handle_arp_frame(const ethernet_helper_type&, const arp_helper_type&);
+			void do_handle_dhcp_frame(const ethernet_helper_type&, const ipv4_helper_type&, const udp_helper_type&, const bootp_helper_type&, const dhcp_helper_type&);
+			void do_handle_icmpv6_frame(const ipv6_helper_type&, const icmpv6_helper_type&);
+			fscp::SharedBuffer get_proxy_buffer();
+			void release_proxy_buffer(fscp::SharedBuffer);
+			void do_write_proxy_response(fscp::SharedBuffer, boost::optional<boost::asio::const_buffer>);
 			bool do_handle_arp_request(const boost::asio::ip::address_v4&, ethernet_address_type&);
 			bool do_handle_icmpv6_neighbor_solicitation(const boost::asio::ip::address_v6&, ethernet_address_type&);
 
@@ -601,36 +666,66 @@ namespace freelan
 			boost::shared_ptr<asiotap::tap_adapter> m_tap_adapter;
 			std::queue<void_handler_type> m_tap_write_queue;
 			std::list<fscp::SharedBuffer> m_tap_adapter_buffers;
-
-			ethernet_filter_type m_ethernet_filter;
-			arp_filter_type m_arp_filter;
-			ipv4_filter_type m_ipv4_filter;
-			ipv6_filter_type m_ipv6_filter;
-			udp_filter_type m_udp_filter;
-			tcpv4_filter_type m_tcpv4_filter;
-			tcpv6_filter_type m_tcpv6_filter;
-			bootp_filter_type m_bootp_filter;
-			dhcp_filter_type m_dhcp_filter;
-			tun_ipv4_filter_type m_tun_ipv4_filter;
-			tun_ipv6_filter_type m_tun_ipv6_filter;
-			tun_tcpv4_filter_type m_tun_tcpv4_filter;
-			tun_tcpv6_filter_type m_tun_tcpv6_filter;
-			tun_icmpv6_filter_type m_tun_icmpv6_filter;
+			std::list<fscp::SharedBuffer> m_proxy_buffers;
 
 			boost::scoped_ptr<arp_proxy_type> m_arp_proxy;
 			boost::scoped_ptr<dhcp_proxy_type> m_dhcp_proxy;
 			boost::scoped_ptr<icmpv6_proxy_type> m_icmpv6_proxy;
 
-			boost::scoped_ptr<asiotap::osi::tcp_mss_morpher> m_tcp_mss_morpher;
+			// Always present, so that the threads that handle frames never see it go away: a max MSS of 0 disables it.
+			asiotap::osi::tcp_mss_morpher m_tcp_mss_morpher;
 
 		private: /* Switch & router */
 
 			typedef asiotap::route_manager::route_type route_type;
 
+			/**
+			 * \brief The routes delta fragments received so far for a given version.
+			 */
+			struct routes_delta_fragments_type
+			{
+				routes_delta_fragments_type() :
+					version(),
+					base_version(),
+					is_snapshot(false),
+					received_fragments(),
+					remaining_fragments(0),
+					routes(),
+					dns_servers()
+				{}
+
+				explicit routes_delta_fragments_type(const routes_delta_message& msg) :
+					version(msg.version()),
+					base_version(msg.base_version()),
+					is_snapshot(msg.is_snapshot()),
+					received_fragments(msg.fragment_count(), false),
+					remaining_fragments(msg.fragment_count()),
+					routes(msg.routes()),
+					dns_servers(msg.dns_servers())
+				{}
+
+				bool is_part_of(const routes_delta_fragments_type& other) const
+				{
+					return ((version == other.version) && (base_version == other.base_version) && (is_snapshot == other.is_snapshot) && (received_fragments.size() == other.received_fragments.size()));
+				}
+
+				routes_message::version_type version;
+				routes_message::version_type base_version;
+				bool is_snapshot;
+				std::vector<bool> received_fragments;
+				size_t remaining_fragments;
+				route_delta routes;
+				routes_delta_message::dns_servers_delta dns_servers;
+			};
+
 			struct client_router_info_type
 			{
 				client_router_info_type() :
 					version(),
+					routes(),
+					dns_servers(),
+					supports_routes_delta(false),
+					pending_routes_delta(),
 					system_route_entries(),
 					saved_system_route()
 				{}
@@ -641,6 +736,10 @@ namespace freelan
 				}
 
 				boost::optional<routes_message::version_type> version;
+				asiotap::ip_route_set routes;
+				asiotap::ip_address_set dns_servers;
+				bool supports_routes_delta;
+				boost::optional<routes_delta_fragments_type> pending_routes_delta;
 				std::vector<asiotap::route_manager::entry_type> system_route_entries;
 				asiotap::route_manager::entry_type saved_system_route;
 				std::vector<asiotap::dns_servers_manager::entry_type> dns_servers_entries;
@@ -648,6 +747,18 @@ namespace freelan
 
 			typedef std::map<ep_type, client_router_info_type> client_router_info_map_type;
 
+			struct local_routes_type
+			{
+				routes_message::version_type version;
+				asiotap::ip_route_set routes;
+				asiotap::ip_address_set dns_servers;
+			};
+
+			typedef boost::shared_ptr<const local_routes_type> local_routes_ptr_type;
+			typedef std::deque<local_routes_ptr_type> local_routes_history_type;
+
+			local_routes_ptr_type get_local_routes();
+
 			void async_register_switch_port(const ep_type& host, void_handler_type handler)
 			{
 				m_router_strand.post(boost::bind(&core::do_register_switch_port, this, host, handler));
@@ -678,16 +789,21 @@ namespace freelan
 				m_router_strand.post(boost::bind(&core::do_clear_client_router_info, this, host, handler));
 			}
 
+			void async_set_endpoint_mtu(const ep_type& host, size_t mtu)
+			{
+				m_router_strand.post(boost::bind(&core::do_set_endpoint_mtu, this, host, mtu));
+			}
+
 			template <typename WriteHandler>
-			void async_write_switch(const port_index_type& index, boost::asio::const_buffer data, WriteHandler handler)
+			void async_write_switch(const port_index_type& index, boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, WriteHandler handler)
 			{
-				m_router_strand.post(boost::bind(&core::do_write_switch, this, index, data, handler));
+				m_router_strand.post(boost::bind(&core::do_write_switch, this, index, data, meta, handler));
 			}
 
 			template <typename WriteHandler>
-			void async_write_router(const port_index_type& index, boost::asio::const_buffer data, WriteHandler handler)
+			void async_write_router(const port_index_type& index, boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, WriteHandler handler)
 			{
-				m_router_strand.post(boost::bind(&core::do_write_router, this, index, data, handler));
+				m_router_strand.post(boost::bind(&core::do_write_router, this, index, data, meta, handler));
 			}
 
 			void do_register_switch_port(const ep_type&, void_handler_type);
@@ -696,8 +812,13 @@ namespace freelan
 			void do_unregister_router_port(const ep_type&, void_handler_type);
 			void do_save_system_route(const ep_type&, const route_type&, void_handler_type);
 			void do_clear_client_router_info(const ep_type&, void_handler_type);
-			void do_write_switch(const port_index_type&, boost::asio::const_buffer, switch_::multi_write_handler_type);
-			void do_write_router(const port_index_type&, boost::asio::const_buffer, router::port_type::write_handler_type);
+			void do_update_proxy_entries();
+			void do_handle_routes_delta(const asiotap::ip_network_address_list&, const ep_type&, const routes_delta_fragments_type&, size_t);
+			void do_write_switch(const port_index_type&, boost::asio::const_buffer, const asiotap::osi::packet_meta&, switch_::multi_write_handler_type);
+			void do_write_router(const port_index_type&, boost::asio::const_buffer, const asiotap::osi::packet_meta&, router::port_type::write_handler_type);
+			void do_set_endpoint_mtu(const ep_type&, size_t);
+			void do_write_endpoint(const ep_type&, boost::asio::const_buffer, const asiotap::osi::packet_meta&, router::port_type::write_handler_type);
+			void do_send_packet_too_big(boost::asio::const_buffer, const asiotap::osi::packet_meta&, size_t);
 
 #if BOOST_ASIO_VERSION >= 101200 // Boost 1.66+
 			boost::asio::io_context::strand m_router_strand;
@@ -710,6 +831,15 @@ namespace freelan
 			asiotap::dns_servers_manager m_dns_servers_manager;
 			boost::optional<routes_message::version_type> m_local_routes_version;
 			client_router_info_map_type m_client_router_info_map;
+			local_routes_ptr_type m_local_routes;
+			local_routes_history_type m_local_routes_history;
+
+			// The largest frame each endpoint gets without fragmentation, for the endpoints whose path MTU is known.
+			typedef std::map<ep_type, size_t> endpoint_mtu_map_type;
+			endpoint_mtu_map_type m_endpoint_mtus;
+
+			// Set while the frame being written comes from the tap adapter: only those can be answered with an ICMP error.
+			bool m_writing_from_tap_adapter;
 
 		private:
 
@@ -0,0 +1,211 @@
+/*
+ * libfreelan - A C++ library to establish peer-to-peer virtual private
+ * networks.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfreelan.
+ *
+ * libfreelan is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfreelan is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfreelan in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file hostname_resolver.hpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief A caching hostname resolver backed by a thread pool.
+ */
+
+#ifndef FREELAN_HOSTNAME_RESOLVER_HPP
+#define FREELAN_HOSTNAME_RESOLVER_HPP
+
+#include <asiotap/types/endpoint.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/function.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace freelan
+{
+	/**
+	 * \brief A hostname resolver that caches its results and resolves several hostnames at once.
+	 *
+	 * The system resolver is blocking and the one of Boost.Asio only runs one query at a time: hostnames are instead resolved on a pool of threads. Concurrent requests for the same hostname share a single query.
+	 *
+	 * Successful resolutions are kept for the positive time-to-live and failures for the negative one. The system resolver does not expose the time-to-live of the DNS answers, hence the configured values. When stale-while-revalidate is enabled, an expired successful resolution is still given right away while it is refreshed in the background, and kept if the refresh fails.
+	 *
+	 * At most MAX_ENTRIES hostnames are cached: once the cache is full, the expired entries are dropped first, then the ones that expire the soonest.
+	 *
+	 * Numeric endpoints are resolved immediately, without any cache.
+	 *
+	 * Handlers are always called through the io_service given at construction. All the public methods are thread-safe.
+	 */
+	class hostname_resolver : public boost::noncopyable
+	{
+		public:
+
+			/**
+			 * \brief The endpoint type.
+			 */
+			typedef boost::asio::ip::udp::endpoint ep_type;
+
+			/**
+			 * \brief The resolver type.
+			 */
+			typedef boost::asio::ip::udp::resolver resolver_type;
+
+			/**
+			 * \brief The resolve handler type.
+			 */
+			typedef boost::function<void (const boost::system::error_code&, const ep_type&)> resolve_handler_type;
+
+			/**
+			 * \brief The statistics type.
+			 */
+			struct statistics_type
+			{
+				uint64_t hits;
+				uint64_t stale_hits;
+				uint64_t misses;
+			};
+
+			/**
+			 * \brief The maximum count of cached hostnames.
+			 */
+			static const size_t MAX_ENTRIES;
+
+			/**
+			 * \brief Create a hostname resolver.
+			 * \param io_service The io_service to call the handlers through.
+			 * \param protocol The protocol to resolve hostnames for.
+			 * \param flags The resolution flags.
+			 * \param default_service The service to use for endpoints that do not specify one.
+			 * \param thread_count The count of resolution threads. Must be non-zero.
+			 * \param positive_ttl The time during which a successful resolution is kept. A null value disables caching.
+			 * \param negative_ttl The time during which a failed resolution is kept. A null value disables caching of failures.
+			 * \param stale_while_revalidate Whether expired successful resolutions are still used while being refreshed.
+			 */
+			hostname_resolver(boost::asio::io_service& io_service, resolver_type::protocol_type protocol, resolver_type::query::flags flags, const std::string& default_service, size_t thread_count, const boost::posix_time::time_duration& positive_ttl, const boost::posix_time::time_duration& negative_ttl, bool stale_while_revalidate);
+
+			/**
+			 * \brief Destroy the hostname resolver.
+			 *
+			 * Queries that did not start yet are dropped without calling their handlers. The ones in progress are not waited for: the system resolver cannot be interrupted, so their threads finish them in the background and drop their results.
+			 */
+			~hostname_resolver();
+
+			/**
+			 * \brief Resolve an endpoint.
+			 * \param target The endpoint to resolve.
+			 * \param handler The handler to call with the first resolved endpoint.
+			 */
+			void async_resolve(const asiotap::endpoint& target, resolve_handler_type handler);
+
+			/**
+			 * \brief Forget all the cached resolutions.
+			 */
+			void clear();
+
+			/**
+			 * \brief Get the resolver statistics.
+			 * \return The count of fresh hits, stale hits and misses since the creation of the resolver.
+			 */
+			statistics_type get_statistics() const;
+
+		private:
+
+			typedef std::vector<resolve_handler_type> handler_list_type;
+
+			struct entry_type
+			{
+				entry_type() :
+					has_result(false),
+					error(),
+					endpoint(),
+					expiration(),
+					resolving(false),
+					handlers()
+				{}
+
+				bool has_result;
+				boost::system::error_code error;
+				ep_type endpoint;
+				boost::posix_time::ptime expiration;
+				bool resolving;
+				handler_list_type handlers;
+			};
+
+			typedef std::map<std::string, entry_type> entry_map_type;
+
+			/**
+			 * \brief The state shared with the pool threads.
+			 *
+			 * The pool threads are detached and keep the state alive until their last query returns.
+			 */
+			struct state_type : public boost::noncopyable
+			{
+				state_type(boost::asio::io_service& io_service, resolver_type::protocol_type protocol, resolver_type::query::flags flags, const std::string& default_service, const boost::posix_time::time_duration& positive_ttl, const boost::posix_time::time_duration& negative_ttl, bool stale_while_revalidate);
+
+				void run();
+				void make_room();
+				void start_resolution(const std::string& key, entry_type& entry, const asiotap::hostname_endpoint& target);
+				void do_resolve(const std::string& key, const asiotap::hostname_endpoint& target);
+
+				boost::asio::io_service& io_service;
+				const resolver_type::protocol_type protocol;
+				const resolver_type::query::flags flags;
+				const std::string default_service;
+				const boost::posix_time::time_duration positive_ttl;
+				const boost::posix_time::time_duration negative_ttl;
+				const bool stale_while_revalidate;
+				mutable boost::mutex mutex;
+				bool closed;
+				entry_map_type entries;
+				statistics_type statistics;
+				boost::asio::io_service pool_io_service;
+				boost::scoped_ptr<boost::asio::io_service::work> pool_work;
+			};
+
+			boost::shared_ptr<state_type> m_state;
+	};
+}
+
+#endif /* FREELAN_HOSTNAME_RESOLVER_HPP */
@@ -68,7 +68,9 @@ namespace freelan
 			enum message_type
 			{
 				MT_ROUTES_REQUEST = 0x01,
-				MT_ROUTES = 0x02
+				MT_ROUTES = 0x02,
+				MT_ROUTES_DELTA_REQUEST = 0x03,
+				MT_ROUTES_DELTA = 0x04
 			};
 
 			/**
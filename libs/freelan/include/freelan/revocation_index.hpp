@@ -0,0 +1,151 @@
+/*
+ * libfreelan - A C++ library to establish peer-to-peer virtual private
+ * networks.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfreelan.
+ *
+ * libfreelan is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfreelan is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfreelan in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file revocation_index.hpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief An index of revoked certificate serial numbers.
+ */
+
+#ifndef FREELAN_REVOCATION_INDEX_HPP
+#define FREELAN_REVOCATION_INDEX_HPP
+
+#include <cryptoplus/x509/certificate.hpp>
+#include <cryptoplus/x509/certificate_revocation_list.hpp>
+#include <cryptoplus/buffer.hpp>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_set.hpp>
+
+#include <vector>
+#include <map>
+#include <string>
+
+namespace freelan
+{
+	/**
+	 * \brief An index of the serial numbers revoked by a list of certificate revocation lists, grouped by issuer.
+	 *
+	 * An index is never modified once built: to take new revocation lists into account, build a new index from the previous one. Revocation lists that did not change are not parsed again and their entries are shared between the two indexes.
+	 *
+	 * As instances are immutable, their methods can be called concurrently.
+	 */
+	class revocation_index
+	{
+		public:
+
+			/**
+			 * \brief The certificate type.
+			 */
+			typedef cryptoplus::x509::certificate cert_type;
+
+			/**
+			 * \brief The certificate revocation list type.
+			 */
+			typedef cryptoplus::x509::certificate_revocation_list crl_type;
+
+			/**
+			 * \brief The certificate revocation list list type.
+			 */
+			typedef std::vector<crl_type> crl_list_type;
+
+			/**
+			 * \brief Create an empty index.
+			 */
+			revocation_index();
+
+			/**
+			 * \brief Create an index.
+			 * \param crl_list The certificate revocation lists to index.
+			 * \param previous A previous index whose entries are reused for the revocation lists that did not change. May be NULL.
+			 */
+			explicit revocation_index(const crl_list_type& crl_list, const revocation_index* previous = NULL);
+
+			/**
+			 * \brief Check whether a certificate was revoked by its issuer.
+			 * \param cert The certificate.
+			 * \return true if one of the indexed revocation lists of the certificate issuer contains its serial number.
+			 *
+			 * A false result does not mean the certificate is valid: the revocation lists themselves are not verified here.
+			 */
+			bool is_revoked(cert_type cert) const;
+
+			/**
+			 * \brief Get the count of indexed certificate revocation lists.
+			 * \return The count of indexed certificate revocation lists.
+			 */
+			size_t crl_count() const
+			{
+				return m_crls.size();
+			}
+
+			/**
+			 * \brief Get the count of indexed revoked serial numbers.
+			 * \return The count of indexed revoked serial numbers.
+			 */
+			size_t revoked_count() const;
+
+			/**
+			 * \brief Get the count of certificate revocation lists that were reused from the previous index.
+			 * \return The count of certificate revocation lists that were not parsed again.
+			 */
+			size_t reused_count() const
+			{
+				return m_reused_count;
+			}
+
+		private:
+
+			struct crl_entry_type
+			{
+				std::string issuer;
+				boost::unordered_set<std::string> serial_numbers;
+			};
+
+			typedef boost::shared_ptr<const crl_entry_type> crl_entry_ptr_type;
+
+			static crl_entry_ptr_type make_crl_entry(crl_type);
+
+			std::map<cryptoplus::buffer, crl_entry_ptr_type> m_crls;
+			std::multimap<std::string, crl_entry_ptr_type> m_issuers;
+			size_t m_reused_count;
+	};
+}
+
+#endif /* FREELAN_REVOCATION_INDEX_HPP */
@@ -0,0 +1,176 @@
+/*
+ * libfreelan - A C++ library to establish peer-to-peer virtual private
+ * networks.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfreelan.
+ *
+ * libfreelan is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfreelan is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfreelan in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file route_delta.hpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief The difference between two route sets.
+ */
+
+#ifndef FREELAN_ROUTE_DELTA_HPP
+#define FREELAN_ROUTE_DELTA_HPP
+
+#include <algorithm>
+#include <iterator>
+
+#include <asiotap/types/ip_route.hpp>
+#include <asiotap/types/ip_flat_set.hpp>
+
+namespace freelan
+{
+	/**
+	 * \brief The difference between two sorted sets.
+	 */
+	template <typename SetType>
+	struct set_delta
+	{
+		/**
+		 * \brief Create an empty delta.
+		 */
+		set_delta() :
+			added(),
+			removed()
+		{
+		}
+
+		/**
+		 * \brief Compute the delta between two sets.
+		 * \param from The old set.
+		 * \param to The new set.
+		 */
+		set_delta(const SetType& from, const SetType& to) :
+			added(),
+			removed()
+		{
+			std::set_difference(to.begin(), to.end(), from.begin(), from.end(), std::inserter(added, added.end()), from.key_comp());
+			std::set_difference(from.begin(), from.end(), to.begin(), to.end(), std::inserter(removed, removed.end()), from.key_comp());
+		}
+
+		/**
+		 * \brief Check if the delta is empty.
+		 * \return true if the two sets were equal.
+		 */
+		bool empty() const
+		{
+			return (added.empty() && removed.empty());
+		}
+
+		/**
+		 * \brief Apply the delta to a set.
+		 * \param set The old set, that becomes the new set.
+		 */
+		void apply_to(SetType& set) const
+		{
+			for (auto&& element : removed)
+			{
+				set.erase(element);
+			}
+
+			set.insert(added.begin(), added.end());
+		}
+
+		/**
+		 * \brief The elements that are in the new set only.
+		 */
+		SetType added;
+
+		/**
+		 * \brief The elements that are in the old set only.
+		 */
+		SetType removed;
+	};
+
+	/**
+	 * \brief The difference between two flat sets.
+	 */
+	template <typename FlatSetType>
+	struct flat_set_delta
+	{
+		/**
+		 * \brief Create an empty delta.
+		 */
+		flat_set_delta() :
+			added(),
+			removed()
+		{
+		}
+
+		/**
+		 * \brief Compute the delta between two flat sets.
+		 * \param from The old set.
+		 * \param to The new set.
+		 */
+		flat_set_delta(const FlatSetType& from, const FlatSetType& to) :
+			added(FlatSetType::set_difference(to, from)),
+			removed(FlatSetType::set_difference(from, to))
+		{
+		}
+
+		/**
+		 * \brief Check if the delta is empty.
+		 * \return true if the two sets were equal.
+		 */
+		bool empty() const
+		{
+			return (added.empty() && removed.empty());
+		}
+
+		/**
+		 * \brief The elements that are in the new set only.
+		 */
+		FlatSetType added;
+
+		/**
+		 * \brief The elements that are in the old set only.
+		 */
+		FlatSetType removed;
+	};
+
+	/**
+	 * \brief The route delta type.
+	 */
+	typedef set_delta<asiotap::ip_route_set> route_delta;
+
+	/**
+	 * \brief The flat route delta type.
+	 */
+	typedef flat_set_delta<asiotap::ip_route_flat_set> route_flat_delta;
+}
+
+#endif /* FREELAN_ROUTE_DELTA_HPP */
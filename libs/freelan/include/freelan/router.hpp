@@ -49,21 +49,20 @@
 #include <algorithm>
 #include <map>
 #include <set>
+#include <vector>
 
 #include <boost/asio.hpp>
 #include <boost/array.hpp>
 #include <boost/optional.hpp>
 #include <boost/make_shared.hpp>
 
-#include <asiotap/osi/ipv4_filter.hpp>
-#include <asiotap/osi/ipv6_filter.hpp>
-#include <asiotap/osi/ipv4_frame.hpp>
-#include <asiotap/osi/ipv6_frame.hpp>
+#include <asiotap/osi/packet_meta.hpp>
 #include <asiotap/types/ip_network_address.hpp>
 
 #include "configuration.hpp"
 #include "port_index.hpp"
 #include "routes_message.hpp"
+#include "route_delta.hpp"
 
 namespace freelan
 {
@@ -93,8 +92,10 @@ namespace freelan
 
 					/**
 					 * \brief A write function type.
+					 *
+					 * The metadata is the one the router computed for data: it is only valid during the call.
 					 */
-					typedef boost::function<void (boost::asio::const_buffer data, write_handler_type handler)> write_function_type;
+					typedef boost::function<void (boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, write_handler_type handler)> write_function_type;
 
 					/**
 					 * \brief Create a new default port.
@@ -156,14 +157,15 @@ namespace freelan
 					/**
 					 * \brief Write data to the port.
 					 * \param data The data to write.
+					 * \param meta The metadata of data.
 					 * \param handler The handler to call when the write is complete.
 					 */
-					void async_write(boost::asio::const_buffer data, write_handler_type handler) const
+					void async_write(boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, write_handler_type handler) const
 					{
-						m_write_function(data, handler);
+						m_write_function(data, meta, handler);
 					}
 
-					const asiotap::ip_route_set& local_routes() const
+					const asiotap::ip_route_flat_set& local_routes() const
 					{
 						return m_local_routes;
 					}
@@ -173,14 +175,25 @@ namespace freelan
 						return m_local_dns_servers;
 					}
 
-					void set_local_routes(const asiotap::ip_route_set& _local_routes)
+					/**
+					 * \brief Set the local routes.
+					 * \param _local_routes The local routes.
+					 * \return The routes that were added and removed.
+					 *
+					 * Only the routes that changed are updated in the router.
+					 */
+					route_flat_delta set_local_routes(const asiotap::ip_route_flat_set& _local_routes)
 					{
+						const route_flat_delta delta(m_local_routes, _local_routes);
+
 						m_local_routes = _local_routes;
 
 						if (m_router)
 						{
-							m_router->invalidate_routes();
+							m_router->update_routes(m_index, delta);
 						}
+
+						return delta;
 					}
 
 					void set_local_dns_servers(const asiotap::ip_address_set& _local_dns_servers)
@@ -195,9 +208,10 @@ namespace freelan
 
 				private:
 
-					void associate_to_router(router* _router)
+					void associate_to_router(router* _router, const port_index_type& index)
 					{
 						m_router = _router;
+						m_index = index;
 
 						if (m_router)
 						{
@@ -218,10 +232,11 @@ namespace freelan
 					friend class router;
 
 					write_function_type m_write_function;
-					asiotap::ip_route_set m_local_routes;
+					asiotap::ip_route_flat_set m_local_routes;
 					asiotap::ip_address_set m_local_dns_servers;
 					port_group_type m_group;
 					router* m_router;
+					port_index_type m_index;
 			};
 
 			/**
@@ -255,7 +270,7 @@ namespace freelan
 				port_type& local_port = (m_ports[index] = port);
 
 				// This takes care of automatically clearing the route cache whenever needed.
-				local_port.associate_to_router(this);
+				local_port.associate_to_router(this, index);
 			}
 
 			/**
@@ -304,9 +319,18 @@ namespace freelan
 			 */
 			void async_write(port_index_type index, boost::asio::const_buffer data, port_type::write_handler_type handler);
 
+			/**
+			 * \brief Receive data trough the specified port.
+			 * \param index The port from which the data comes.
+			 * \param data The data to write.
+			 * \param meta The metadata of data, as computed by asiotap::osi::parse_ip_packet_meta().
+			 * \param handler The handler to call when the write is complete.
+			 */
+			void async_write(port_index_type index, boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, port_type::write_handler_type handler);
+
 		private:
 
-			std::vector<const port_type*> get_targets_for(port_index_type, boost::asio::const_buffer);
+			std::vector<const port_type*> get_targets_for(port_index_type, const asiotap::osi::packet_meta&);
 
 			template <typename AddressType>
 			std::vector<const port_type*> get_targets_for(port_index_type, const AddressType&);
@@ -315,12 +339,28 @@ namespace freelan
 
 			port_list_type m_ports;
 
-			asiotap::osi::filter<asiotap::osi::ipv4_frame> m_ipv4_filter;
-			asiotap::osi::filter<asiotap::osi::ipv6_frame> m_ipv6_filter;
+			// The routes of each family are kept in a sorted contiguous array: lookups for a destination only walk the routes of its family.
+			typedef std::vector<std::pair<asiotap::ipv4_route, port_index_type> > ipv4_routes_port_type;
+			typedef std::vector<std::pair<asiotap::ipv6_route, port_index_type> > ipv6_routes_port_type;
+
+			struct routes_port_type
+			{
+				ipv4_routes_port_type ipv4;
+				ipv6_routes_port_type ipv6;
+
+				const ipv4_routes_port_type& for_address(const boost::asio::ip::address_v4&) const
+				{
+					return ipv4;
+				}
 
-			typedef std::multimap<asiotap::ip_route, port_index_type> routes_port_type;
+				const ipv6_routes_port_type& for_address(const boost::asio::ip::address_v6&) const
+				{
+					return ipv6;
+				}
+			};
 
 			const routes_port_type& routes() const;
+			void update_routes(const port_index_type&, const route_flat_delta&);
 			mutable boost::optional<routes_port_type> m_routes;
 	};
 }
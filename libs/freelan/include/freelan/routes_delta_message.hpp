@@ -0,0 +1,214 @@
+/*
+ * libfreelan - A C++ library to establish peer-to-peer virtual private
+ * networks.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfreelan.
+ *
+ * libfreelan is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfreelan is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfreelan in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file routes_delta_message.hpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief The routes delta messages exchanged by the peers.
+ */
+
+#ifndef FREELAN_ROUTES_DELTA_MESSAGE_HPP
+#define FREELAN_ROUTES_DELTA_MESSAGE_HPP
+
+#include <vector>
+
+#include <asiotap/types/ip_route.hpp>
+#include <asiotap/types/ip_endpoint.hpp>
+
+#include "message.hpp"
+#include "routes_message.hpp"
+#include "route_delta.hpp"
+
+namespace freelan
+{
+	/**
+	 * \brief A routes delta message.
+	 *
+	 * A routes delta message carries the routes and DNS servers that were
+	 * added or removed between a base version and a version. A snapshot
+	 * carries all the routes and DNS servers of a version instead.
+	 *
+	 * As a delta can be too large for a single message, it is split into
+	 * fragments that all share the same versions and fragment count. Each
+	 * fragment only contains whole entries and can be decoded on its own.
+	 */
+	class routes_delta_message : public message
+	{
+		public:
+
+			/**
+			 * \brief The version typedef.
+			 */
+			typedef routes_message::version_type version_type;
+
+			/**
+			 * \brief The DNS servers delta type.
+			 */
+			typedef set_delta<asiotap::ip_address_set> dns_servers_delta;
+
+			/**
+			 * \brief The encoded entries of a fragment.
+			 */
+			typedef std::vector<uint8_t> fragment_entries_type;
+
+			/**
+			 * \brief The encoded entries of all the fragments.
+			 */
+			typedef std::vector<fragment_entries_type> fragment_entries_list_type;
+
+			/**
+			 * \brief The maximum size of a fragment message, header included.
+			 */
+			static const size_t MAX_SIZE = 1200;
+
+			/**
+			 * \brief The maximum count of fragments of a delta.
+			 */
+			static const size_t MAX_FRAGMENT_COUNT = 0xffff;
+
+			/**
+			 * \brief Encode a delta and split it into fragments.
+			 * \param routes The routes delta.
+			 * \param dns_servers The DNS servers delta.
+			 * \return The encoded entries of each fragment. There is always at least one fragment, even for an empty delta.
+			 *
+			 * If the delta needs more than MAX_FRAGMENT_COUNT fragments, a std::runtime_error is thrown.
+			 */
+			static fragment_entries_list_type encode_fragments(const route_delta& routes, const dns_servers_delta& dns_servers);
+
+			/**
+			 * \brief Write a routes delta message to a buffer.
+			 * \param buf The buffer to write to. Writing a fragment never requires more than MAX_SIZE bytes.
+			 * \param buf_len The length of buf.
+			 * \param version The version.
+			 * \param base_version The version the delta applies to. Ignored for snapshots.
+			 * \param is_snapshot Whether the entries are a full snapshot of the version.
+			 * \param fragment_index The index of the fragment.
+			 * \param fragment_count The count of fragments.
+			 * \param entries The encoded entries of the fragment, as returned by encode_fragments().
+			 * \return The count of bytes written.
+			 */
+			static size_t write(void* buf, size_t buf_len, version_type version, version_type base_version, bool is_snapshot, size_t fragment_index, size_t fragment_count, const fragment_entries_type& entries);
+
+			/**
+			 * \brief Get the version.
+			 * \return The version.
+			 */
+			version_type version() const;
+
+			/**
+			 * \brief Get the base version.
+			 * \return The version the delta applies to.
+			 */
+			version_type base_version() const;
+
+			/**
+			 * \brief Check whether the message is part of a snapshot.
+			 * \return true if the entries are a full snapshot of the version.
+			 */
+			bool is_snapshot() const;
+
+			/**
+			 * \brief Get the fragment index.
+			 * \return The fragment index.
+			 */
+			size_t fragment_index() const;
+
+			/**
+			 * \brief Get the fragment count.
+			 * \return The fragment count.
+			 */
+			size_t fragment_count() const;
+
+			/**
+			 * \brief Get the routes delta contained in this fragment.
+			 * \return The routes delta.
+			 */
+			const route_delta& routes() const
+			{
+				return m_routes;
+			}
+
+			/**
+			 * \brief Get the DNS servers delta contained in this fragment.
+			 * \return The DNS servers delta.
+			 */
+			const dns_servers_delta& dns_servers() const
+			{
+				return m_dns_servers;
+			}
+
+			/**
+			 * \brief Create a routes_delta_message and map it on a buffer.
+			 * \param buf The buffer.
+			 * \param buf_len The buffer length.
+			 *
+			 * If the mapping fails, a std::runtime_error is thrown.
+			 */
+			routes_delta_message(const void* buf, size_t buf_len);
+
+			/**
+			 * \brief Create a routes_delta_message from a message.
+			 * \param message The message.
+			 */
+			routes_delta_message(const message& message);
+
+		private:
+
+			enum flag_type
+			{
+				FLAG_SNAPSHOT = 0x01
+			};
+
+			enum operation_type
+			{
+				OP_ADD = 0x00,
+				OP_REMOVE = 0x01
+			};
+
+			static const size_t DELTA_HEADER_LENGTH = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint16_t) + sizeof(uint16_t);
+
+			void read_entries();
+
+			route_delta m_routes;
+			dns_servers_delta m_dns_servers;
+	};
+}
+
+#endif /* FREELAN_ROUTES_DELTA_MESSAGE_HPP */
@@ -0,0 +1,114 @@
+/*
+ * libfreelan - A C++ library to establish peer-to-peer virtual private
+ * networks.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfreelan.
+ *
+ * libfreelan is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfreelan is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfreelan in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file routes_delta_request_message.hpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief The routes delta request messages exchanged by the peers.
+ */
+
+#ifndef FREELAN_ROUTES_DELTA_REQUEST_MESSAGE_HPP
+#define FREELAN_ROUTES_DELTA_REQUEST_MESSAGE_HPP
+
+#include <boost/optional.hpp>
+
+#include "message.hpp"
+#include "routes_message.hpp"
+
+namespace freelan
+{
+	/**
+	 * \brief A routes delta request message.
+	 *
+	 * The requester tells which routes version it last applied so that the
+	 * responder can answer with the changes since that version only.
+	 */
+	class routes_delta_request_message : public message
+	{
+		public:
+
+			/**
+			 * \brief The version typedef.
+			 */
+			typedef routes_message::version_type version_type;
+
+			/**
+			 * \brief Write a routes delta request message to a buffer.
+			 * \param buf The buffer to write to.
+			 * \param buf_len The length of buf.
+			 * \param known_version The last version the requester applied, if any. If none is specified, a full snapshot is requested.
+			 * \return The count of bytes written.
+			 */
+			static size_t write(void* buf, size_t buf_len, const boost::optional<version_type>& known_version);
+
+			/**
+			 * \brief Get the last version the requester applied.
+			 * \return The version, if there is one.
+			 */
+			boost::optional<version_type> known_version() const;
+
+			/**
+			 * \brief Create a routes_delta_request_message and map it on a buffer.
+			 * \param buf The buffer.
+			 * \param buf_len The buffer length.
+			 *
+			 * If the mapping fails, a std::runtime_error is thrown.
+			 */
+			routes_delta_request_message(const void* buf, size_t buf_len);
+
+			/**
+			 * \brief Create a routes_delta_request_message from a message.
+			 * \param message The message.
+			 */
+			routes_delta_request_message(const message& message);
+
+		private:
+
+			enum flag_type
+			{
+				FLAG_HAS_KNOWN_VERSION = 0x01
+			};
+
+			static const size_t PAYLOAD_LENGTH = sizeof(uint8_t) + sizeof(uint32_t);
+
+			void check_format() const;
+	};
+}
+
+#endif /* FREELAN_ROUTES_DELTA_REQUEST_MESSAGE_HPP */
@@ -46,6 +46,8 @@
 #ifndef FREELAN_ROUTES_MESSAGE_HPP
 #define FREELAN_ROUTES_MESSAGE_HPP
 
+#include <iterator>
+
 #include <boost/optional.hpp>
 
 #include <asiotap/types/ip_route.hpp>
@@ -77,21 +79,210 @@ namespace freelan
 			 */
 			static size_t write(void* buf, size_t buf_len, version_type version, const asiotap::ip_route_set& routes, const asiotap::ip_address_set& dns_servers);
 
+			/**
+			 * \brief An entry of a routes message: either a route or a DNS server.
+			 */
+			class entry
+			{
+				public:
+
+					/**
+					 * \brief Check whether the entry is a route.
+					 * \return true if the entry is a route, false if it is a DNS server.
+					 */
+					bool is_route() const
+					{
+						return m_is_route;
+					}
+
+					/**
+					 * \brief Get the route.
+					 * \return The route. Only meaningful if is_route() is true.
+					 */
+					const asiotap::ip_route& route() const
+					{
+						return m_route;
+					}
+
+					/**
+					 * \brief Get the DNS server.
+					 * \return The DNS server. Only meaningful if is_route() is false.
+					 */
+					const asiotap::ip_address& dns_server() const
+					{
+						return m_dns_server;
+					}
+
+				private:
+
+					entry() :
+						m_is_route(false),
+						m_route(),
+						m_dns_server()
+					{
+					}
+
+					bool m_is_route;
+					asiotap::ip_route m_route;
+					asiotap::ip_address m_dns_server;
+
+					friend class routes_message;
+			};
+
+			/**
+			 * \brief A forward iterator that decodes the entries straight from the message buffer.
+			 *
+			 * Iterating never allocates memory. The entries come in the order they were written, which is the order of the sets given to write().
+			 */
+			class entry_iterator
+			{
+				public:
+
+					typedef std::forward_iterator_tag iterator_category;
+					typedef entry value_type;
+					typedef std::ptrdiff_t difference_type;
+					typedef const entry* pointer;
+					typedef const entry& reference;
+
+					/**
+					 * \brief Create an end iterator.
+					 */
+					entry_iterator() :
+						m_buf(NULL),
+						m_buf_len(0),
+						m_entry()
+					{
+					}
+
+					reference operator*() const
+					{
+						return m_entry;
+					}
+
+					pointer operator->() const
+					{
+						return &m_entry;
+					}
+
+					entry_iterator& operator++()
+					{
+						read_next();
+
+						return *this;
+					}
+
+					entry_iterator operator++(int)
+					{
+						const entry_iterator result = *this;
+						read_next();
+
+						return result;
+					}
+
+					friend bool operator==(const entry_iterator& lhs, const entry_iterator& rhs)
+					{
+						return (lhs.m_buf == rhs.m_buf);
+					}
+
+					friend bool operator!=(const entry_iterator& lhs, const entry_iterator& rhs)
+					{
+						return !(lhs == rhs);
+					}
+
+				private:
+
+					entry_iterator(const uint8_t* buf, size_t buf_len) :
+						m_buf(buf),
+						m_buf_len(buf_len),
+						m_entry()
+					{
+						read_next();
+					}
+
+					void read_next();
+
+					// m_buf points right after the entry decoded in m_entry, or is NULL past the last entry.
+					const uint8_t* m_buf;
+					size_t m_buf_len;
+					entry m_entry;
+
+					friend class routes_message;
+			};
+
+			/**
+			 * \brief A view on the entries of a routes message.
+			 */
+			class entry_range
+			{
+				public:
+
+					entry_iterator begin() const
+					{
+						return m_begin;
+					}
+
+					entry_iterator end() const
+					{
+						return entry_iterator();
+					}
+
+				private:
+
+					explicit entry_range(const entry_iterator& _begin) :
+						m_begin(_begin)
+					{
+					}
+
+					entry_iterator m_begin;
+
+					friend class routes_message;
+			};
+
 			/**
 			 * \brief Get the version.
 			 * \return The version.
 			 */
 			version_type version() const;
 
+			/**
+			 * \brief Get a view on the entries.
+			 * \return The entries, decoded as they are iterated.
+			 *
+			 * Unlike routes() and dns_servers(), this does not copy the entries into sets.
+			 */
+			entry_range entries() const;
+
+			/**
+			 * \brief Get the count of routes.
+			 * \return The count of route entries.
+			 */
+			size_t route_count() const
+			{
+				return m_route_count;
+			}
+
+			/**
+			 * \brief Get the count of DNS servers.
+			 * \return The count of DNS server entries.
+			 */
+			size_t dns_server_count() const
+			{
+				return m_dns_server_count;
+			}
+
 			/**
 			 * \brief Get the routes.
 			 * \return The routes.
+			 *
+			 * The routes are decoded and cached on the first call.
 			 */
 			const asiotap::ip_route_set& routes() const;
 
 			/**
 			* \brief Get the DNS servers.
 			* \return The DNS servers.
+			*
+			* The DNS servers are decoded and cached on the first call.
 			*/
 			const asiotap::ip_address_set& dns_servers() const;
 
@@ -117,8 +308,11 @@ namespace freelan
 				asiotap::ip_address_set dns_servers;
 			};
 
+			void check_format();
 			void read_and_cache_results() const;
 
+			size_t m_route_count;
+			size_t m_dns_server_count;
 			mutable boost::optional<routes_and_dns_servers> m_results;
 	};
 }
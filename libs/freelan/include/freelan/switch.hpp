@@ -53,6 +53,8 @@
 #include <boost/asio.hpp>
 #include <boost/array.hpp>
 
+#include <asiotap/osi/packet_meta.hpp>
+
 #include "configuration.hpp"
 #include "port_index.hpp"
 
@@ -99,8 +101,10 @@ namespace freelan
 
 					/**
 					 * \brief A write function type.
+					 *
+					 * The metadata is the one the switch computed for data: it is only valid during the call.
 					 */
-					typedef boost::function<void (boost::asio::const_buffer data, write_handler_type handler)> write_function_type;
+					typedef boost::function<void (boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, write_handler_type handler)> write_function_type;
 
 					/**
 					 * \brief Create a new default port.
@@ -123,11 +127,12 @@ namespace freelan
 					/**
 					 * \brief Write data to the port.
 					 * \param data The data to write.
+					 * \param meta The metadata of data.
 					 * \param handler The handler to call when the write is complete.
 					 */
-					void async_write(boost::asio::const_buffer data, write_handler_type handler)
+					void async_write(boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, write_handler_type handler)
 					{
-						m_write_function(data, handler);
+						m_write_function(data, meta, handler);
 					}
 
 					port_group_type group() const
@@ -195,9 +200,18 @@ namespace freelan
 			 */
 			void async_write(port_index_type index, boost::asio::const_buffer data, multi_write_handler_type handler);
 
+			/**
+			 * \brief Receive data trough the specified port.
+			 * \param index The port from which the data comes.
+			 * \param data The data to write.
+			 * \param meta The metadata of data, as computed by asiotap::osi::parse_ethernet_packet_meta().
+			 * \param handler The handler to call when the write is complete.
+			 */
+			void async_write(port_index_type index, boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, multi_write_handler_type handler);
+
 		private:
 
-			std::set<port_index_type> get_targets_for(port_index_type, boost::asio::const_buffer);
+			std::set<port_index_type> get_targets_for(port_index_type, const asiotap::osi::packet_meta&);
 			std::set<port_index_type> get_targets_for(port_list_type::const_iterator);
 
 			switch_configuration m_configuration;
@@ -208,7 +222,6 @@ namespace freelan
 			typedef boost::array<uint8_t, 6> ethernet_address_type;
 			typedef std::map<ethernet_address_type, port_index_type> ethernet_address_map_type;
 
-			static ethernet_address_type to_ethernet_address(boost::asio::const_buffer);
 			static bool is_multicast_address(const ethernet_address_type&);
 
 			ethernet_address_map_type m_ethernet_address_map;
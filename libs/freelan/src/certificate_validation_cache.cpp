@@ -0,0 +1,160 @@
+/*
+ * libfreelan - A C++ library to establish peer-to-peer virtual private
+ * networks.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfreelan.
+ *
+ * libfreelan is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfreelan is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfreelan in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file certificate_validation_cache.cpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief A cache of certificate validation verdicts.
+ */
+
+#include "certificate_validation_cache.hpp"
+
+#include <cassert>
+
+namespace freelan
+{
+	certificate_validation_cache::certificate_validation_cache(const boost::posix_time::time_duration& positive_ttl, const boost::posix_time::time_duration& negative_ttl, size_t capacity) :
+		m_positive_ttl(positive_ttl),
+		m_negative_ttl(negative_ttl),
+		m_capacity(capacity),
+		m_generation(0),
+		m_statistics()
+	{
+		assert(m_capacity > 0);
+	}
+
+	boost::optional<bool> certificate_validation_cache::get(const key_type& key, generation_type& generation)
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		generation = m_generation;
+
+		const entry_map_type::iterator entry = m_entries.find(key);
+
+		if (entry != m_entries.end())
+		{
+			if (boost::posix_time::microsec_clock::universal_time() < entry->second.expiration)
+			{
+				m_lru_list.splice(m_lru_list.begin(), m_lru_list, entry->second.lru_position);
+				++m_statistics.hits;
+
+				return entry->second.valid;
+			}
+
+			m_lru_list.erase(entry->second.lru_position);
+			m_entries.erase(entry);
+		}
+
+		++m_statistics.misses;
+
+		return boost::none;
+	}
+
+	bool certificate_validation_cache::set(const key_type& key, bool valid, generation_type generation, const boost::posix_time::ptime& not_after)
+	{
+		const boost::posix_time::time_duration& ttl = valid ? m_positive_ttl : m_negative_ttl;
+
+		if (ttl <= boost::posix_time::time_duration())
+		{
+			return false;
+		}
+
+		const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+		boost::posix_time::ptime expiration = now + ttl;
+
+		if (!not_after.is_special() && (not_after < expiration))
+		{
+			// The certificate expires before the verdict would: past that date, the verdict no longer holds.
+			if (not_after <= now)
+			{
+				return false;
+			}
+
+			expiration = not_after;
+		}
+
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		if (generation != m_generation)
+		{
+			// The cache was invalidated while the verdict was computed: it may be stale already.
+			return false;
+		}
+
+		const entry_map_type::iterator entry = m_entries.find(key);
+
+		if (entry != m_entries.end())
+		{
+			entry->second.valid = valid;
+			entry->second.expiration = expiration;
+			m_lru_list.splice(m_lru_list.begin(), m_lru_list, entry->second.lru_position);
+
+			return true;
+		}
+
+		if (m_entries.size() >= m_capacity)
+		{
+			m_entries.erase(m_lru_list.back());
+			m_lru_list.pop_back();
+		}
+
+		m_lru_list.push_front(key);
+
+		const entry_type new_entry = { valid, expiration, m_lru_list.begin() };
+		m_entries[key] = new_entry;
+
+		return true;
+	}
+
+	void certificate_validation_cache::invalidate()
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		m_entries.clear();
+		m_lru_list.clear();
+		++m_generation;
+	}
+
+	certificate_validation_cache::statistics_type certificate_validation_cache::get_statistics() const
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		return m_statistics;
+	}
+}
@@ -79,7 +79,15 @@ namespace freelan
 		accept_contact_requests(true),
 		accept_contacts(true),
 		hostname_resolution_protocol(HRP_IPV4),
-		hello_timeout(boost::posix_time::seconds(3))
+		hostname_resolution_threads(4),
+		hostname_resolution_cache_ttl(boost::posix_time::minutes(5)),
+		hostname_resolution_negative_cache_ttl(boost::posix_time::seconds(30)),
+		hostname_resolution_stale_while_revalidate(true),
+		hello_timeout(boost::posix_time::seconds(3)),
+		session_renewal_period(fscp::SESSION_RENEWAL_PERIOD),
+		session_renewal_data_size(fscp::SESSION_RENEWAL_DATA_SIZE),
+		hash_only_presentation(false),
+		path_mtu_discovery(true)
 	{
 	}
 
@@ -89,7 +97,9 @@ namespace freelan
 		certificate_validation_script(),
 		certificate_authority_list(),
 		certificate_revocation_validation_method(CRVM_NONE),
-		certificate_revocation_list_list()
+		certificate_revocation_list_list(),
+		certificate_validation_cache_positive_ttl(boost::posix_time::minutes(5)),
+		certificate_validation_cache_negative_ttl(boost::posix_time::seconds(30))
 	{
 	}
 
@@ -51,6 +51,8 @@
 #include "client.hpp"
 #include "routes_request_message.hpp"
 #include "routes_message.hpp"
+#include "routes_delta_request_message.hpp"
+#include "routes_delta_message.hpp"
 
 #include "server.hpp"
 #include "client.hpp"
@@ -72,6 +74,7 @@
 #include <boost/date_time/c_local_time_adjustor.hpp>
 
 #include <cassert>
+#include <stdexcept>
 
 namespace freelan
 {
@@ -97,6 +100,31 @@ namespace freelan
 		{
 		}
 
+		boost::posix_time::ptime get_not_after(const cryptoplus::x509::certificate& cert)
+		{
+			// ASN1_TIME_diff() handles both the UTCTime and the GeneralizedTime formats, unlike asn1::utctime::to_ptime().
+			int days = 0;
+			int seconds = 0;
+
+			if (::ASN1_TIME_diff(&days, &seconds, NULL, X509_get_notAfter(cert.raw())) == 0)
+			{
+				return boost::posix_time::ptime();
+			}
+
+			return boost::posix_time::microsec_clock::universal_time() + boost::posix_time::hours(24 * days) + boost::posix_time::seconds(seconds);
+		}
+
+		// Get a mutable view of data, which must lie within shared_buffer.
+		boost::asio::mutable_buffer to_mutable_buffer(const fscp::SharedBuffer& shared_buffer, boost::asio::const_buffer data)
+		{
+			const boost::asio::mutable_buffer whole_buffer = fscp::buffer(shared_buffer);
+			const size_t offset = boost::asio::buffer_cast<const uint8_t*>(data) - boost::asio::buffer_cast<const uint8_t*>(whole_buffer);
+
+			assert(offset + boost::asio::buffer_size(data) <= boost::asio::buffer_size(whole_buffer));
+
+			return boost::asio::buffer(whole_buffer + offset, boost::asio::buffer_size(data));
+		}
+
 		asiotap::endpoint to_endpoint(const core::ep_type& host)
 		{
 			if (host.address().is_v4())
@@ -195,6 +223,10 @@ namespace freelan
 		static const unsigned int TAP_ADAPTERS_GROUP = 0;
 		static const unsigned int ENDPOINTS_GROUP = 1;
 
+		// The proxies replies are small: there is no need for more than a few spare buffers.
+		static const size_t PROXY_BUFFER_SIZE = 2048;
+		static const size_t PROXY_BUFFERS_POOL_SIZE = 16;
+
 		asiotap::ip_route_set filter_routes(const asiotap::ip_route_set& routes, router_configuration::internal_route_scope_type scope, unsigned int limit, const asiotap::ip_network_address_list& network_addresses)
 		{
 			asiotap::ip_route_set result;
@@ -414,6 +446,7 @@ namespace freelan
 	const boost::posix_time::time_duration core::CONTACT_PERIOD = boost::posix_time::seconds(30);
 	const boost::posix_time::time_duration core::DYNAMIC_CONTACT_PERIOD = boost::posix_time::seconds(45);
 	const boost::posix_time::time_duration core::ROUTES_REQUEST_PERIOD = boost::posix_time::seconds(180);
+	const size_t core::LOCAL_ROUTES_HISTORY_SIZE = 8;
 	const boost::posix_time::time_duration core::RENEW_CERTIFICATE_WARNING_PERIOD = boost::posix_time::hours(6);
 	const boost::posix_time::time_duration core::REGISTRATION_WARNING_PERIOD = boost::posix_time::minutes(5);
 	const boost::posix_time::time_duration core::GET_CONTACT_INFORMATION_UPDATE_PERIOD = boost::posix_time::minutes(5);
@@ -441,26 +474,16 @@ namespace freelan
 		m_contact_timer(m_io_service, CONTACT_PERIOD),
 		m_dynamic_contact_timer(m_io_service, DYNAMIC_CONTACT_PERIOD),
 		m_routes_request_timer(m_io_service, ROUTES_REQUEST_PERIOD),
+		m_certificate_validation_cache(m_configuration.security.certificate_validation_cache_positive_ttl, m_configuration.security.certificate_validation_cache_negative_ttl),
 		m_tap_adapter_io_service(),
 		m_tap_adapter_thread(),
-		m_arp_filter(m_ethernet_filter),
-		m_ipv4_filter(m_ethernet_filter),
-		m_ipv6_filter(m_ethernet_filter),
-		m_udp_filter(m_ipv4_filter),
-		m_tcpv4_filter(m_ipv4_filter),
-		m_tcpv6_filter(m_ipv6_filter),
-		m_bootp_filter(m_udp_filter),
-		m_dhcp_filter(m_bootp_filter),
-		m_tun_ipv4_filter(),
-		m_tun_ipv6_filter(),
-		m_tun_tcpv4_filter(m_tun_ipv4_filter),
-		m_tun_tcpv6_filter(m_tun_ipv6_filter),
-		m_tun_icmpv6_filter(m_tun_ipv6_filter),
 		m_router_strand(m_io_service),
 		m_switch(m_configuration.switch_),
 		m_router(m_configuration.router),
 		m_route_manager(m_io_service),
 		m_dns_servers_manager(m_io_service),
+		m_endpoint_mtus(),
+		m_writing_from_tap_adapter(false),
 		m_request_certificate(m_io_service, boost::posix_time::seconds(5), boost::posix_time::seconds(90)),
 		m_request_ca_certificate(m_io_service, boost::posix_time::seconds(5), boost::posix_time::seconds(90)),
 		m_renew_certificate_timer(m_io_service),
@@ -468,30 +491,6 @@ namespace freelan
 		m_set_contact_information_retry(m_io_service, boost::posix_time::seconds(5), boost::posix_time::seconds(35)),
 		m_get_contact_information_retry(m_io_service, boost::posix_time::seconds(5), boost::posix_time::seconds(35))
 	{
-		m_arp_filter.add_handler(boost::bind(&core::do_handle_arp_frame, this, _1));
-		m_dhcp_filter.add_handler(boost::bind(&core::do_handle_dhcp_frame, this, _1));
-		m_tun_icmpv6_filter.add_handler(boost::bind(&core::do_handle_icmpv6_frame, this, _1));
-		m_tcpv4_filter.add_handler([this](asiotap::osi::mutable_helper<asiotap::osi::tcp_frame> tcp_helper){
-			if (m_tcp_mss_morpher) {
-				m_tcp_mss_morpher->handle(*m_tcpv4_filter.parent().get_last_helper(), tcp_helper);
-			}
-		});
-		m_tcpv6_filter.add_handler([this](asiotap::osi::mutable_helper<asiotap::osi::tcp_frame> tcp_helper){
-			if (m_tcp_mss_morpher) {
-				m_tcp_mss_morpher->handle(*m_tcpv6_filter.parent().get_last_helper(), tcp_helper);
-			}
-		});
-		m_tun_tcpv4_filter.add_handler([this](asiotap::osi::mutable_helper<asiotap::osi::tcp_frame> tcp_helper){
-			if (m_tcp_mss_morpher) {
-				m_tcp_mss_morpher->handle(*m_tun_tcpv4_filter.parent().get_last_helper(), tcp_helper);
-			}
-		});
-		m_tun_tcpv6_filter.add_handler([this](asiotap::osi::mutable_helper<asiotap::osi::tcp_frame> tcp_helper){
-			if (m_tcp_mss_morpher) {
-				m_tcp_mss_morpher->handle(*m_tun_tcpv6_filter.parent().get_last_helper(), tcp_helper);
-			}
-		});
-
 		// Setup the route manager.
 		m_route_manager.set_route_registration_success_handler([this](const asiotap::route_manager::route_type& route){
 			m_logger(fscp::log_level::information) << "Added system route: " << route;
@@ -634,6 +633,11 @@ namespace freelan
 			m_fscp_server->set_elliptic_curves(m_configuration.fscp.elliptic_curve_capabilities);
 			m_fscp_server->set_hello_max_per_second(m_configuration.fscp.max_unauthenticated_messages_per_second);
 			m_fscp_server->set_presentation_max_per_second(m_configuration.fscp.max_unauthenticated_messages_per_second);
+			m_fscp_server->set_session_max_per_second(m_configuration.fscp.max_unauthenticated_messages_per_second);
+			m_fscp_server->set_session_renewal_period(m_configuration.fscp.session_renewal_period);
+			m_fscp_server->set_session_renewal_data_size(m_configuration.fscp.session_renewal_data_size);
+			m_fscp_server->set_hash_only_presentation(m_configuration.fscp.hash_only_presentation);
+			m_fscp_server->set_path_mtu_discovery_enabled(m_configuration.fscp.path_mtu_discovery);
 
 			m_fscp_server->set_hello_message_received_callback(boost::bind(&core::do_handle_hello_received, this, _1, _2));
 			m_fscp_server->set_contact_request_received_callback(boost::bind(&core::do_handle_contact_request_received, this, _1, _2, _3, _4));
@@ -645,6 +649,7 @@ namespace freelan
 			m_fscp_server->set_session_error_callback(boost::bind(&core::do_handle_session_error, this, _1, _2, _3));
 			m_fscp_server->set_session_established_callback(boost::bind(&core::do_handle_session_established, this, _1, _2, _3, _4));
 			m_fscp_server->set_session_lost_callback(boost::bind(&core::do_handle_session_lost, this, _1, _2));
+			m_fscp_server->set_path_mtu_changed_callback(boost::bind(&core::do_handle_path_mtu_changed, this, _1, _2));
 			m_fscp_server->set_data_received_callback(boost::bind(&core::do_handle_data_received, this, _1, _2, _3, _4));
 
 			resolver_type resolver(m_io_service);
@@ -699,6 +704,20 @@ namespace freelan
 			}
 #endif
 
+			// The resolver is rebuilt so that a reopen takes the current resolution settings into account. Destroying the previous one does not wait for the lookups it still runs.
+			m_hostname_resolver.reset(
+				new hostname_resolver(
+					m_io_service,
+					to_protocol(m_configuration.fscp.hostname_resolution_protocol),
+					resolver_query::address_configured,
+					DEFAULT_SERVICE,
+					std::max(m_configuration.fscp.hostname_resolution_threads, 1u),
+					m_configuration.fscp.hostname_resolution_cache_ttl,
+					m_configuration.fscp.hostname_resolution_negative_cache_ttl,
+					m_configuration.fscp.hostname_resolution_stale_while_revalidate
+				)
+			);
+
 			// We start the contact loop.
 			async_contact_all();
 
@@ -742,12 +761,10 @@ namespace freelan
 		// This is a ugly workaround for a bug in Boost::Variant (<1.55)
 		endpoint target1 = target;
 
-		const auto resolve_handler = [this, handler, target1] (const boost::system::error_code& ec, boost::asio::ip::udp::resolver::iterator it)
+		const auto resolve_handler = [this, handler, target1] (const boost::system::error_code& ec, const ep_type& host)
 		{
 			if (!ec)
 			{
-				const ep_type host = *it;
-
 				// This is a ugly workaround for a bug in Boost::Variant (<1.55)
 				endpoint target2 = target1;
 
@@ -775,16 +792,7 @@ namespace freelan
 			}
 		};
 
-		boost::apply_visitor(
-			asiotap::endpoint_async_resolve_visitor(
-				boost::make_shared<resolver_type>(m_io_service),
-				to_protocol(m_configuration.fscp.hostname_resolution_protocol),
-				resolver_query::address_configured,
-				DEFAULT_SERVICE,
-				resolve_handler
-			),
-			target
-		);
+		m_hostname_resolver->async_resolve(target, resolve_handler);
 	}
 
 	void core::async_contact(const endpoint& target)
@@ -864,21 +872,26 @@ namespace freelan
 	void core::async_handle_routes(const ep_type& sender, const routes_message& msg)
 	{
 		const auto version = msg.version();
-		const auto routes = msg.routes();
-		const auto dns_servers = msg.dns_servers();
+		const auto routes = boost::make_shared<asiotap::ip_route_set>();
+		const auto dns_servers = boost::make_shared<asiotap::ip_address_set>();
+
+		// The entries are decoded straight from the received buffer and shared with the handler rather than copied.
+		for (auto&& entry : msg.entries())
+		{
+			if (entry.is_route())
+			{
+				routes->insert(routes->end(), entry.route());
+			}
+			else
+			{
+				dns_servers->insert(dns_servers->end(), entry.dns_server());
+			}
+		}
 
 		async_get_tap_addresses([this, sender, version, routes, dns_servers](const asiotap::ip_network_address_list& ip_addresses){
-			m_router_strand.post(
-				boost::bind(
-					&core::do_handle_routes,
-					this,
-					ip_addresses,
-					sender,
-					version,
-					routes,
-					dns_servers
-				)
-			);
+			m_router_strand.post([this, ip_addresses, sender, version, routes, dns_servers](){
+				do_handle_routes(ip_addresses, sender, version, *routes, *dns_servers);
+			});
 		});
 	}
 
@@ -963,6 +976,132 @@ namespace freelan
 		);
 	}
 
+	void core::async_handle_routes_delta_request(const ep_type& sender, const routes_delta_request_message& msg)
+	{
+		m_router_strand.post(
+			boost::bind(
+				&core::do_handle_routes_delta_request,
+				this,
+				sender,
+				msg.known_version()
+			)
+		);
+	}
+
+	void core::async_handle_routes_delta(const ep_type& sender, const routes_delta_message& msg)
+	{
+		const routes_delta_fragments_type fragment(msg);
+		const size_t fragment_index = msg.fragment_index();
+
+		async_get_tap_addresses([this, sender, fragment, fragment_index](const asiotap::ip_network_address_list& ip_addresses){
+			m_router_strand.post(
+				boost::bind(
+					&core::do_handle_routes_delta,
+					this,
+					ip_addresses,
+					sender,
+					fragment,
+					fragment_index
+				)
+			);
+		});
+	}
+
+	void core::async_send_routes_delta_request(const ep_type& target, const boost::optional<routes_message::version_type>& known_version, simple_handler_type handler)
+	{
+		assert(m_fscp_server);
+
+		if (known_version)
+		{
+			m_logger(fscp::log_level::debug) << "Sending routes delta request to " << target << " (known version " << *known_version << ").";
+		}
+		else
+		{
+			m_logger(fscp::log_level::debug) << "Sending routes snapshot request to " << target << ".";
+		}
+
+		const auto data_buffer = SharedBuffer(2048);
+		const size_t size = routes_delta_request_message::write(
+			buffer_cast<uint8_t*>(data_buffer),
+			buffer_size(data_buffer),
+			known_version
+		);
+
+		m_fscp_server->async_send_data(
+			target,
+			fscp::CHANNEL_NUMBER_1,
+			buffer(data_buffer, size),
+			make_shared_buffer_handler(
+				data_buffer,
+				handler
+			)
+		);
+	}
+
+	void core::async_send_routes_delta_request(const ep_type& target, const boost::optional<routes_message::version_type>& known_version)
+	{
+		async_send_routes_delta_request(target, known_version, boost::bind(&core::do_handle_send_routes_request, this, target, _1));
+	}
+
+	void core::async_send_session_routes_requests(const ep_type& target)
+	{
+		// We don't know yet if the host understands routes deltas: we ask for both and the first answer wins.
+		async_send_routes_request(target);
+		async_send_routes_delta_request(target, boost::none);
+	}
+
+	void core::async_send_routes_delta(const ep_type& target, routes_message::version_type version, routes_message::version_type base_version, bool is_snapshot, const route_delta& routes, const routes_delta_message::dns_servers_delta& dns_servers)
+	{
+		assert(m_fscp_server);
+
+		routes_delta_message::fragment_entries_list_type fragments;
+
+		try
+		{
+			fragments = routes_delta_message::encode_fragments(routes, dns_servers);
+		}
+		catch (std::runtime_error& ex)
+		{
+			m_logger(fscp::log_level::error) << "Unable to send routes version " << version << " to " << target << ": " << ex.what();
+
+			return;
+		}
+
+		if (is_snapshot)
+		{
+			m_logger(fscp::log_level::debug) << "Sending routes snapshot to " << target << ": version " << version << ", " << routes.added.size() << " route(s), " << dns_servers.added.size() << " DNS server(s) in " << fragments.size() << " fragment(s).";
+		}
+		else
+		{
+			m_logger(fscp::log_level::debug) << "Sending routes delta to " << target << ": version " << base_version << " to " << version << ", " << (routes.added.size() + dns_servers.added.size()) << " added, " << (routes.removed.size() + dns_servers.removed.size()) << " removed in " << fragments.size() << " fragment(s).";
+		}
+
+		for (size_t fragment_index = 0; fragment_index < fragments.size(); ++fragment_index)
+		{
+			const auto data_buffer = SharedBuffer(routes_delta_message::MAX_SIZE);
+			const size_t size = routes_delta_message::write(
+				buffer_cast<uint8_t*>(data_buffer),
+				buffer_size(data_buffer),
+				version,
+				base_version,
+				is_snapshot,
+				fragment_index,
+				fragments.size(),
+				fragments[fragment_index]
+			);
+
+			m_fscp_server->async_send_data(
+				target,
+				fscp::CHANNEL_NUMBER_1,
+				buffer(data_buffer, size),
+				make_shared_buffer_handler(
+					data_buffer,
+					boost::bind(&core::do_handle_send_routes_delta, this, target, _1)
+				)
+			);
+		}
+	}
+
 	void core::do_contact(const ep_type& address, duration_handler_type handler)
 	{
 		assert(m_fscp_server);
@@ -1019,7 +1158,10 @@ namespace freelan
 	{
 		if (ec != boost::asio::error::operation_aborted)
 		{
-			async_send_routes_request_to_all();
+			// Hosts that understand routes deltas are only asked for what changed since the version they last applied.
+			m_fscp_server->async_get_session_endpoints([this](const std::set<ep_type>& targets){
+				m_router_strand.post(boost::bind(&core::do_send_routes_requests, this, targets));
+			});
 
 			m_routes_request_timer.expires_from_now(ROUTES_REQUEST_PERIOD);
 			m_routes_request_timer.async_wait(boost::bind(&core::do_handle_periodic_routes_request, this, boost::asio::placeholders::error));
@@ -1074,6 +1216,14 @@ namespace freelan
 		}
 	}
 
+	void core::do_handle_send_routes_delta(const ep_type& target, const boost::system::error_code& ec)
+	{
+		if (ec)
+		{
+			m_logger(fscp::log_level::warning) << "Error sending routes delta to " << target << ": " << ec.message();
+		}
+	}
+
 	bool core::do_handle_hello_received(const ep_type& sender, bool default_accept)
 	{
 		m_logger(fscp::log_level::debug) << "Received HELLO_REQUEST from " << sender << ".";
@@ -1263,12 +1413,12 @@ namespace freelan
 		{
 			if (m_configuration.tap_adapter.type == tap_adapter_configuration::tap_adapter_type::tap)
 			{
-				async_register_switch_port(host, boost::bind(&core::async_send_routes_request, this, host));
+				async_register_switch_port(host, boost::bind(&core::async_send_session_routes_requests, this, host));
 			}
 			else
 			{
 				// We register the router port without any routes, at first.
-				async_register_router_port(host, boost::bind(&core::async_send_routes_request, this, host));
+				async_register_router_port(host, boost::bind(&core::async_send_session_routes_requests, this, host));
 			}
 
 			const auto route = m_route_manager.get_route_for(host.address());
@@ -1302,17 +1452,44 @@ namespace freelan
 		async_clear_client_router_info(host, void_handler_type());
 	}
 
+	void core::do_handle_path_mtu_changed(const ep_type& host, size_t max_datagram_size)
+	{
+		const size_t mtu = fscp::data_message::max_cleartext_size(max_datagram_size);
+
+		if (mtu > 0)
+		{
+			m_logger(fscp::log_level::information) << "Path MTU to " << host << " discovered: frames of up to " << mtu << " byte(s) are sent without fragmentation.";
+		}
+		else
+		{
+			m_logger(fscp::log_level::information) << "Path MTU to " << host << " is unknown again.";
+		}
+
+		async_set_endpoint_mtu(host, mtu);
+	}
+
 	void core::do_handle_data_received(const ep_type& sender, fscp::channel_number_type channel_number, fscp::SharedBuffer buffer, boost::asio::const_buffer data)
 	{
 		switch (channel_number)
 		{
 			// Channel 0 contains ethernet/ip frames
 			case fscp::CHANNEL_NUMBER_0:
-				if (m_configuration.tap_adapter.type == tap_adapter_configuration::tap_adapter_type::tap)
+			{
+				const bool is_tap = (m_configuration.tap_adapter.type == tap_adapter_configuration::tap_adapter_type::tap);
+				const asiotap::osi::packet_meta meta = is_tap ? asiotap::osi::parse_ethernet_packet_meta(data) : asiotap::osi::parse_ip_packet_meta(data);
+
+				if (meta.has_l4() && (meta.protocol == asiotap::osi::TCP_PROTOCOL))
+				{
+					// The frame was deciphered into a buffer that only we hold: it can be clamped in place.
+					m_tcp_mss_morpher.handle(to_mutable_buffer(buffer, data) + meta.l4_offset, asiotap::osi::tcp_mss_morpher::direction::incoming);
+				}
+
+				if (is_tap)
 				{
 					async_write_switch(
 						make_port_index(sender),
 						data,
+						meta,
 						make_shared_buffer_handler(
 							buffer,
 							&null_switch_write_handler
@@ -1324,6 +1501,7 @@ namespace freelan
 					async_write_router(
 						make_port_index(sender),
 						data,
+						meta,
 						make_shared_buffer_handler(
 							buffer,
 							&null_router_write_handler
@@ -1332,6 +1510,7 @@ namespace freelan
 				}
 
 				break;
+			}
 			// Channel 1 contains messages
 			case fscp::CHANNEL_NUMBER_1:
 				try
@@ -1374,6 +1553,24 @@ namespace freelan
 					break;
 				}
 
+			case message::MT_ROUTES_DELTA_REQUEST:
+				{
+					routes_delta_request_message rdr_msg(msg);
+
+					async_handle_routes_delta_request(sender, rdr_msg);
+
+					break;
+				}
+
+			case message::MT_ROUTES_DELTA:
+				{
+					routes_delta_message rd_msg(msg);
+
+					async_handle_routes_delta(sender, rd_msg);
+
+					break;
+				}
+
 			default:
 				m_logger(fscp::log_level::warning) << "Received unhandled message of type " << static_cast<int>(msg.type()) << " on the message channel";
 				break;
@@ -1386,38 +1583,115 @@ namespace freelan
 		if (!m_configuration.router.accept_routes_requests)
 		{
 			m_logger(fscp::log_level::debug) << "Received routes request from " << sender << " but ignoring as specified in the configuration";
+
+			return;
 		}
-		else
+
+		const auto local_routes = get_local_routes();
+
+		if (!local_routes)
 		{
-			if (m_tap_adapter && (m_tap_adapter->layer() == asiotap::tap_adapter_layer::ip))
-			{
-				const auto local_port = m_router.get_port(make_port_index(m_tap_adapter));
+			m_logger(fscp::log_level::debug) << "Received routes request from " << sender << " but no local routes are set. Not sending anything.";
 
-				if (m_local_routes_version.is_initialized())
-				{
-					const auto routes = local_port->local_routes();
-					const auto dns_servers = local_port->local_dns_servers();
+			return;
+		}
 
-					m_logger(fscp::log_level::debug) << "Received routes request from " << sender << ". Replying with version " << *m_local_routes_version << ": " << routes << ". DNS: " << dns_servers;
+		m_logger(fscp::log_level::debug) << "Received routes request from " << sender << ". Replying with version " << local_routes->version << ": " << local_routes->routes << ". DNS: " << local_routes->dns_servers;
 
-					async_send_routes(sender, *m_local_routes_version, routes, dns_servers, &null_simple_write_handler);
-				}
-				else
-				{
-					m_logger(fscp::log_level::debug) << "Received routes request from " << sender << " but no local routes are set. Not sending anything.";
-				}
+		try
+		{
+			async_send_routes(sender, local_routes->version, local_routes->routes, local_routes->dns_servers, &null_simple_write_handler);
+		}
+		catch (std::runtime_error&)
+		{
+			// Hosts that understand routes deltas also sent a routes delta request and will get the routes in fragments.
+			m_logger(fscp::log_level::warning) << "Routes version " << local_routes->version << " are too large for a single routes message: only hosts that support routes deltas will receive them.";
+		}
+	}
+
+	void core::do_send_routes_requests(const std::set<ep_type>& targets)
+	{
+		// All calls to do_send_routes_requests() are done within the m_router_strand, so the following is safe.
+		for (auto&& target : targets)
+		{
+			const auto client_router_info = m_client_router_info_map.find(target);
+
+			if ((client_router_info != m_client_router_info_map.end()) && client_router_info->second.supports_routes_delta)
+			{
+				async_send_routes_delta_request(target, client_router_info->second.version);
 			}
 			else
 			{
-				const auto routes = translate_ip_routes(m_configuration.router.local_ip_routes);
-				const auto dns_servers = m_configuration.router.local_dns_servers;
-				const auto version = 0;
+				async_send_routes_request(target);
+			}
+		}
+	}
+
+	void core::do_handle_routes_delta_request(const ep_type& sender, const boost::optional<routes_message::version_type>& known_version)
+	{
+		// All calls to do_handle_routes_delta_request() are done within the m_router_strand, so the following is safe.
+		if (!m_configuration.router.accept_routes_requests)
+		{
+			m_logger(fscp::log_level::debug) << "Received routes delta request from " << sender << " but ignoring as specified in the configuration";
+
+			return;
+		}
+
+		const auto local_routes = get_local_routes();
+
+		if (!local_routes)
+		{
+			m_logger(fscp::log_level::debug) << "Received routes delta request from " << sender << " but no local routes are set. Not sending anything.";
+
+			return;
+		}
+
+		// Keep the recently advertised versions so that we can compute deltas against them.
+		if (!m_local_routes_history.empty() && (m_local_routes_history.back()->version == local_routes->version))
+		{
+			m_local_routes_history.back() = local_routes;
+		}
+		else
+		{
+			m_local_routes_history.push_back(local_routes);
+
+			while (m_local_routes_history.size() > LOCAL_ROUTES_HISTORY_SIZE)
+			{
+				m_local_routes_history.pop_front();
+			}
+		}
 
-				m_logger(fscp::log_level::debug) << "Received routes request from " << sender << ". Replying with version " << version << ": " << routes;
+		if (known_version)
+		{
+			for (auto&& previous_local_routes : m_local_routes_history)
+			{
+				if (previous_local_routes->version == *known_version)
+				{
+					// If nothing changed, this sends a single empty fragment that acknowledges the version.
+					async_send_routes_delta(
+						sender,
+						local_routes->version,
+						previous_local_routes->version,
+						false,
+						route_delta(previous_local_routes->routes, local_routes->routes),
+						routes_delta_message::dns_servers_delta(previous_local_routes->dns_servers, local_routes->dns_servers)
+					);
 
-				async_send_routes(sender, version, routes, dns_servers, &null_simple_write_handler);
+					return;
+				}
 			}
+
+			m_logger(fscp::log_level::debug) << "Received routes delta request from " << sender << " for unknown version " << *known_version << ". Replying with a snapshot of version " << local_routes->version << ".";
 		}
+
+		async_send_routes_delta(
+			sender,
+			local_routes->version,
+			local_routes->version,
+			true,
+			route_delta(asiotap::ip_route_set(), local_routes->routes),
+			routes_delta_message::dns_servers_delta(asiotap::ip_address_set(), local_routes->dns_servers)
+		);
 	}
 
 	void core::do_handle_routes(const asiotap::ip_network_address_list& tap_addresses, const ep_type& sender, routes_message::version_type version, const asiotap::ip_route_set& routes, const asiotap::ip_address_set& dns_servers)
@@ -1522,9 +1796,10 @@ namespace freelan
 
 					if (port)
 					{
-						port->set_local_routes(filtered_routes);
+						const route_flat_delta delta = port->set_local_routes(asiotap::ip_route_flat_set(filtered_routes));
 
-						m_logger(fscp::log_level::information) << "Received routes from " << sender << " (version " << version << ") were applied: " << filtered_routes;
+						m_logger(fscp::log_level::information) << "Received routes from " << sender << " (version " << version << ") were applied: " << delta.added.size() << " added, " << delta.removed.size() << " removed, " << filtered_routes.size() << " total.";
+						m_logger(fscp::log_level::debug) << "Routes from " << sender << " (version " << version << "): " << filtered_routes;
 					}
 					else
 					{
@@ -1580,7 +1855,15 @@ namespace freelan
 
 		client_router_info_type new_client_router_info;
 		new_client_router_info.saved_system_route = client_router_info.saved_system_route;
-		new_client_router_info.version = client_router_info.version;
+		new_client_router_info.version = version;
+		new_client_router_info.routes = routes;
+		new_client_router_info.dns_servers = dns_servers;
+		new_client_router_info.supports_routes_delta = client_router_info.supports_routes_delta;
+		new_client_router_info.pending_routes_delta = client_router_info.pending_routes_delta;
+
+		// The routes are registered (and the ones we no longer need, unregistered) in batches rather than one at a time. The route manager applies them in the background: the router strand does not wait for the system.
+		const asiotap::route_manager::unregistration_batch route_unregistration_batch(m_route_manager);
+		std::vector<asiotap::route_manager::route_type> system_route_list;
 
 		for (auto&& route : filtered_system_routes)
 		{
@@ -1603,21 +1886,50 @@ namespace freelan
 				const auto route1 = asiotap::ipv4_route(asiotap::ipv4_network_address(boost::asio::ip::address_v4::from_string("0.0.0.0"), 1), ipv4_gateway);
 				const auto route2 = asiotap::ipv4_route(asiotap::ipv4_network_address(boost::asio::ip::address_v4::from_string("128.0.0.0"), 1), ipv4_gateway);
 
-				new_client_router_info.system_route_entries.push_back(m_route_manager.get_route_entry(m_tap_adapter->get_route(route1)));
-				new_client_router_info.system_route_entries.push_back(m_route_manager.get_route_entry(m_tap_adapter->get_route(route2)));
+				system_route_list.push_back(m_tap_adapter->get_route(route1));
+				system_route_list.push_back(m_tap_adapter->get_route(route2));
 			} else {
-				new_client_router_info.system_route_entries.push_back(m_route_manager.get_route_entry(m_tap_adapter->get_route(route)));
+				system_route_list.push_back(m_tap_adapter->get_route(route));
 			}
 #else
-			new_client_router_info.system_route_entries.push_back(m_route_manager.get_route_entry(m_tap_adapter->get_route(route)));
+			system_route_list.push_back(m_tap_adapter->get_route(route));
 #endif
 		}
+
+		// Only the routes that changed since the previous version are registered or unregistered.
+		typedef std::set<asiotap::route_manager::route_type> system_route_set_type;
+
+		const system_route_set_type system_route_set(system_route_list.begin(), system_route_list.end());
+		system_route_set_type previous_system_route_set;
+
+		for (auto&& entry : client_router_info.system_route_entries)
+		{
+			previous_system_route_set.insert(entry->route());
+
+			if (system_route_set.count(entry->route()) > 0)
+			{
+				new_client_router_info.system_route_entries.push_back(entry);
+			}
+		}
+
+		const set_delta<system_route_set_type> system_route_delta(previous_system_route_set, system_route_set);
+		const auto added_system_route_entries = m_route_manager.get_route_entries(std::vector<asiotap::route_manager::route_type>(system_route_delta.added.begin(), system_route_delta.added.end()));
+
+		new_client_router_info.system_route_entries.insert(new_client_router_info.system_route_entries.end(), added_system_route_entries.begin(), added_system_route_entries.end());
+
+		if (!system_route_delta.empty())
+		{
+			m_logger(fscp::log_level::information) << "System routes for " << sender << " (version " << version << "): " << system_route_delta.added.size() << " added, " << system_route_delta.removed.size() << " removed, " << system_route_set.size() << " total.";
+		}
+
 		for (auto&& dns_server : filtered_dns_servers)
 		{
 			new_client_router_info.dns_servers_entries.push_back(m_dns_servers_manager.get_dns_server_entry(m_tap_adapter->get_dns_server(dns_server)));
 		}
 
 		client_router_info = new_client_router_info;
+
+		do_update_proxy_entries();
 	}
 
 	int core::certificate_validation_callback(int ok, X509_STORE_CTX* ctx)
@@ -1631,10 +1943,15 @@ namespace freelan
 
 	void core::build_ca_store(build_ca_store_when condition)
 	{
-		// We can't easily ensure m_ca_store is used only in one strand, so we protect it with a mutex instead.
 		boost::mutex::scoped_lock lock(m_ca_store_mutex);
 
-		if (!!m_ca_store)
+		do_build_ca_store(condition);
+	}
+
+	void core::do_build_ca_store(build_ca_store_when condition)
+	{
+		// All calls to do_build_ca_store() are done with m_ca_store_mutex held: the inputs cannot change and the snapshots are published in order.
+		if (boost::atomic_load(&m_ca_store))
 		{
 			if (condition == build_ca_store_when::it_doesnt_exist)
 			{
@@ -1648,33 +1965,34 @@ namespace freelan
 			m_logger(fscp::log_level::information) << "Building CA store...";
 		}
 
-		m_ca_store = cryptoplus::x509::store::create();
+		// The new store is fully built before being published so that verifications never see it half-built nor wait for it.
+		cryptoplus::x509::store ca_store = cryptoplus::x509::store::create();
 
 		for (const cert_type& cert : m_configuration.security.certificate_authority_list)
 		{
-			m_ca_store.add_certificate(cert);
+			ca_store.add_certificate(cert);
 		}
 
 		for (const cert_type& cert : m_client_certificate_authority_list)
 		{
-			m_ca_store.add_certificate(cert);
+			ca_store.add_certificate(cert);
 		}
 
 		for (const crl_type& crl : m_configuration.security.certificate_revocation_list_list)
 		{
-			m_ca_store.add_certificate_revocation_list(crl);
+			ca_store.add_certificate_revocation_list(crl);
 		}
 
 		switch (m_configuration.security.certificate_revocation_validation_method)
 		{
 			case security_configuration::CRVM_LAST:
 				{
-					m_ca_store.set_verification_flags(X509_V_FLAG_CRL_CHECK);
+					ca_store.set_verification_flags(X509_V_FLAG_CRL_CHECK);
 					break;
 				}
 			case security_configuration::CRVM_ALL:
 				{
-					m_ca_store.set_verification_flags(X509_V_FLAG_CRL_CHECK | X509_V_FLAG_CRL_CHECK_ALL);
+					ca_store.set_verification_flags(X509_V_FLAG_CRL_CHECK | X509_V_FLAG_CRL_CHECK_ALL);
 					break;
 				}
 			case security_configuration::CRVM_NONE:
@@ -1682,38 +2000,119 @@ namespace freelan
 					break;
 				}
 		}
-	}
-	bool core::certificate_validation_method(bool ok, cryptoplus::x509::store_context store_context)
-	{
-		cert_type cert = store_context.get_current_certificate();
 
-		if (!ok)
-		{
-			m_logger(fscp::log_level::warning) << "Error when validating " << cert.subject() << ": " << store_context.get_error_string() << " (depth: " << store_context.get_error_depth() << ")";
-		}
-		else
+		revocation_index_snapshot_type index;
+
+		if (m_configuration.security.certificate_revocation_validation_method != security_configuration::CRVM_NONE)
 		{
-			m_logger(fscp::log_level::information) << cert.subject() << " is valid.";
+			const revocation_index_snapshot_type previous_index = boost::atomic_load(&m_revocation_index);
+
+			index = boost::make_shared<const revocation_index>(m_configuration.security.certificate_revocation_list_list, previous_index.get());
+
+			m_logger(fscp::log_level::information) << "Indexed " << index->revoked_count() << " revoked certificate(s) from " << index->crl_count() << " certificate revocation list(s) (" << index->reused_count() << " unchanged).";
 		}
 
-		return ok;
+		boost::atomic_store(&m_ca_store, boost::make_shared<const cryptoplus::x509::store>(ca_store));
+		boost::atomic_store(&m_revocation_index, index);
+
+		// The certificate authorities or the revocation lists may have changed: the previous verdicts cannot be trusted anymore.
+		m_certificate_validation_cache.invalidate();
 	}
 
-	bool core::certificate_is_valid(cert_type cert)
+	void core::async_reload_certificate_revocation_lists(const crl_list_type& crl_list, void_handler_type handler)
 	{
-		switch (m_configuration.security.certificate_validation_method)
-		{
-			case security_configuration::CVM_DEFAULT:
-				{
-					using namespace cryptoplus;
+		m_io_service.post(boost::bind(&core::do_reload_certificate_revocation_lists, this, crl_list, handler));
+	}
 
-					// We can't easily ensure m_ca_store is used only in one strand, so we protect it with a mutex instead.
-					boost::mutex::scoped_lock lock(m_ca_store_mutex);
+	void core::do_reload_certificate_revocation_lists(const crl_list_type& crl_list, void_handler_type handler)
+	{
+		m_logger(fscp::log_level::information) << "Reloading " << crl_list.size() << " certificate revocation list(s)...";
+
+		{
+			boost::mutex::scoped_lock lock(m_ca_store_mutex);
+
+			m_configuration.security.certificate_revocation_list_list = crl_list;
+
+			do_build_ca_store(build_ca_store_when::always);
+		}
+
+		if (handler)
+		{
+			handler();
+		}
+	}
+
+	bool core::certificate_validation_method(bool ok, cryptoplus::x509::store_context store_context)
+	{
+		cert_type cert = store_context.get_current_certificate();
+
+		if (!ok)
+		{
+			m_logger(fscp::log_level::warning) << "Error when validating " << cert.subject() << ": " << store_context.get_error_string() << " (depth: " << store_context.get_error_depth() << ")";
+		}
+		else
+		{
+			m_logger(fscp::log_level::information) << cert.subject() << " is valid.";
+		}
+
+		return ok;
+	}
+
+	bool core::certificate_is_valid(cert_type cert)
+	{
+		// Hosts present themselves repeatedly so we avoid verifying the same certificate chain (and running the validation script) every time.
+		const fscp::hash_type fingerprint = fscp::get_certificate_hash(cert);
+		certificate_validation_cache::generation_type generation;
+
+		const boost::optional<bool> verdict = m_certificate_validation_cache.get(fingerprint, generation);
+
+		if (verdict)
+		{
+			return *verdict;
+		}
+
+		const bool result = validate_certificate(cert);
+
+		if (m_certificate_validation_cache.set(fingerprint, result, generation, get_not_after(cert)))
+		{
+			m_logger(fscp::log_level::debug) << "Cached validation verdict for " << cert.subject() << ": " << (result ? "valid" : "invalid") << ".";
+		}
+
+		return result;
+	}
+
+	bool core::validate_certificate(cert_type cert)
+	{
+		switch (m_configuration.security.certificate_validation_method)
+		{
+			case security_configuration::CVM_DEFAULT:
+				{
+					using namespace cryptoplus;
+
+					// Verifications only read the store, so any number of them can use the same snapshot concurrently.
+					const ca_store_snapshot_type ca_store = boost::atomic_load(&m_ca_store);
+
+					if (!ca_store)
+					{
+						m_logger(fscp::log_level::warning) << "Unable to validate " << cert.subject() << ": the CA store was not built yet.";
+
+						return false;
+					}
 
 					// Create a store context to proceed to verification
 					x509::store_context store_context = x509::store_context::create();
 
-					store_context.initialize(m_ca_store, cert, NULL);
+					// Most revoked certificates are caught here with a hash lookup, without building a chain. OpenSSL still checks the revocation lists of every certificate it accepts.
+					const revocation_index_snapshot_type index = boost::atomic_load(&m_revocation_index);
+
+					if (index && index->is_revoked(cert))
+					{
+						m_logger(fscp::log_level::warning) << "Error when validating " << cert.subject() << ": certificate revoked.";
+
+						return false;
+					}
+
+					store_context.initialize(*ca_store, cert, NULL);
 
 					// Ensure to set the verification callback *AFTER* you called initialize or it will be ignored.
 					store_context.set_verification_callback(&core::certificate_validation_callback);
@@ -1750,7 +2149,7 @@ namespace freelan
 
 			m_tap_adapter = boost::make_shared<asiotap::tap_adapter>(boost::ref(m_tap_adapter_io_service), tap_adapter_type);
 
-			const auto write_func = [this] (boost::asio::const_buffer data, simple_handler_type handler) {
+			const auto write_func = [this] (boost::asio::const_buffer data, const asiotap::osi::packet_meta&, simple_handler_type handler) {
 				async_write_tap(buffer(data), m_io_service.wrap(handler));
 			};
 
@@ -1766,11 +2165,11 @@ namespace freelan
 			// The MSS override.
 			const size_t max_mss = compute_mss(m_configuration.tap_adapter.mss_override, get_auto_mss_value(tap_config.mtu));
 
+			m_tcp_mss_morpher.set_max_mss(max_mss);
+
 			if (max_mss > 0) {
-				m_tcp_mss_morpher.reset(new asiotap::osi::tcp_mss_morpher(max_mss));
 				m_logger(fscp::log_level::important) << "MSS override enabled with a value of: " << max_mss;
 			} else {
-				m_tcp_mss_morpher.reset();
 				m_logger(fscp::log_level::warning) << "MSS override disabled. You may experience IP fragmentation for encapsulated TCP connections.";
 			}
 
@@ -1907,10 +2306,16 @@ namespace freelan
 					local_routes.insert(asiotap::to_network_address(asiotap::to_ip_address(ip_address)));
 				}
 
-				m_local_routes_version = routes_message::version_type();
-				m_router.get_port(make_port_index(m_tap_adapter))->set_local_routes(local_routes);
+				// A new version lets the hosts that already know our previous routes get the changes.
+				m_local_routes_version = m_local_routes_version ? (*m_local_routes_version + 1) : routes_message::version_type();
+				m_router.get_port(make_port_index(m_tap_adapter))->set_local_routes(asiotap::ip_route_flat_set(local_routes));
 				m_router.get_port(make_port_index(m_tap_adapter))->set_local_dns_servers(local_dns_servers);
 
+				// Drop the routes we converted for a previous adapter or from the configuration.
+				m_router_strand.post([this](){
+					m_local_routes.reset();
+				});
+
 				// Handle ICMPv6 neighbor solicitations. This is required for Windows.
 				m_icmpv6_proxy.reset(new icmpv6_proxy_type());
 				m_icmpv6_proxy->set_neighbor_solicitation_callback(boost::bind(&core::do_handle_icmpv6_neighbor_solicitation, this, _1, _2));
@@ -1962,13 +2367,14 @@ namespace freelan
 		// Clear the endpoint routes, if any.
 		m_router_strand.post([this](){
 			m_client_router_info_map.clear();
+			m_local_routes.reset();
 		});
 
 		m_dhcp_proxy.reset();
 		m_arp_proxy.reset();
 		m_icmpv6_proxy.reset();
 
-		m_tcp_mss_morpher.reset();
+		m_tcp_mss_morpher.set_max_mss(0);
 
 		if (m_tap_adapter)
 		{
@@ -2097,33 +2503,18 @@ namespace freelan
 			std::cerr << "Read " << buffer_size(data) << " byte(s) on " << *m_tap_adapter << std::endl;
 #endif
 
-			bool handled = false;
-
+			// The frame is parsed once, here: every later stage reads its metadata instead.
 			if (m_tap_adapter->layer() == asiotap::tap_adapter_layer::ethernet)
 			{
-				// This line will eventually call the filters callbacks and the mss morpher.
-				m_ethernet_filter.parse(data);
+				const asiotap::osi::packet_meta meta = asiotap::osi::parse_ethernet_packet_meta(data);
 
-				if (m_arp_proxy || m_dhcp_proxy)
-				{
-					if (m_arp_proxy && m_arp_filter.get_last_helper())
-					{
-						handled = true;
-						m_arp_filter.clear_last_helper();
-					}
-
-					if (m_dhcp_proxy && m_dhcp_filter.get_last_helper())
-					{
-						handled = true;
-						m_dhcp_filter.clear_last_helper();
-					}
-				}
-
-				if (!handled)
+				// This line will eventually call the proxies and the mss morpher.
+				if (!do_handle_tap_adapter_frame(data, meta))
 				{
 					async_write_switch(
 						make_port_index(m_tap_adapter),
 						data,
+						meta,
 						make_shared_buffer_handler(
 							receive_buffer,
 							&null_switch_write_handler
@@ -2133,25 +2524,16 @@ namespace freelan
 			}
 			else
 			{
-				// This line will eventually call the filters callbacks and the mss override.
-				m_tun_ipv6_filter.parse(data);
+				// This is a TUN interface. We receive either IPv4 or IPv6 frames.
+				const asiotap::osi::packet_meta meta = asiotap::osi::parse_ip_packet_meta(data);
 
-				if (m_icmpv6_proxy)
+				// This line will eventually call the proxies and the mss override.
+				if (!do_handle_tun_adapter_frame(data, meta))
 				{
-					if (m_tun_icmpv6_filter.get_last_helper())
-					{
-						// We don't want to catch ICMP echo requests or other stuff yet.
-						handled = m_tun_icmpv6_filter.get_last_helper()->type() == asiotap::osi::ICMPV6_NEIGHBOR_SOLICITATION;
-						m_tun_icmpv6_filter.clear_last_helper();
-					}
-				}
-
-				if (!handled)
-				{
-					// This is a TUN interface. We receive either IPv4 or IPv6 frames.
 					async_write_router(
 						make_port_index(m_tap_adapter),
 						data,
+						meta,
 						make_shared_buffer_handler(
 							receive_buffer,
 							&null_router_write_handler
@@ -2177,91 +2559,218 @@ namespace freelan
 		}
 	}
 
-	void core::do_handle_arp_frame(const arp_helper_type& helper)
+	bool core::do_handle_tap_adapter_frame(boost::asio::mutable_buffer data, const asiotap::osi::packet_meta& meta)
+	{
+		namespace ao = asiotap::osi;
+
+		if (meta.has_l4() && (meta.protocol == ao::TCP_PROTOCOL))
+		{
+			m_tcp_mss_morpher.handle(data + meta.l4_offset, ao::tcp_mss_morpher::direction::outgoing);
+
+			return false;
+		}
+
+		// Only ARP and DHCP frames may be answered by the proxies: the others never reach the pipeline.
+		const bool is_arp = (meta.has_l2() && (meta.ethertype == ao::ARP_PROTOCOL));
+		const bool is_dhcp = (meta.has_l4() && (meta.ip_version == 4) && (meta.protocol == ao::UDP_PROTOCOL) && (meta.destination_port == ao::BOOTP_PROTOCOL));
+
+		if (!(is_arp && m_arp_proxy) && !(is_dhcp && m_dhcp_proxy))
+		{
+			return false;
+		}
+
+		// The pipeline holds no state of its own: it is built on the stack for every frame, so the result of a parse never outlives it.
+		bool handled = false;
+
+		auto pipeline = ao::make_static_filter<ao::ethernet_frame>(
+			ao::accept_frame(),
+			ao::make_static_filter<ao::arp_frame>(
+				[this, &handled] (ao::mutable_helper<ao::arp_frame> arp_helper, ao::mutable_helper<ao::ethernet_frame> ethernet_helper)
+				{
+					if (m_arp_proxy)
+					{
+						do_handle_arp_frame(ethernet_helper, arp_helper);
+						handled = true;
+					}
+
+					return true;
+				}
+			),
+			ao::make_static_filter<ao::ipv4_frame>(
+				ao::accept_frame(),
+				ao::make_static_filter<ao::udp_frame>(
+					ao::accept_frame(),
+					ao::make_static_filter<ao::bootp_frame>(
+						ao::accept_frame(),
+						ao::make_static_filter<ao::dhcp_frame>(
+							[this, &handled] (ao::mutable_helper<ao::dhcp_frame> dhcp_helper, ao::mutable_helper<ao::bootp_frame> bootp_helper, ao::mutable_helper<ao::udp_frame> udp_helper, ao::mutable_helper<ao::ipv4_frame> ipv4_helper, ao::mutable_helper<ao::ethernet_frame> ethernet_helper)
+							{
+								if (m_dhcp_proxy)
+								{
+									do_handle_dhcp_frame(ethernet_helper, ipv4_helper, udp_helper, bootp_helper, dhcp_helper);
+									handled = true;
+								}
+
+								return true;
+							}
+						)
+					)
+				)
+			)
+		);
+
+		// The proxies and the DHCP option helpers still throw on some malformed frames: they must not end the tap adapter reads.
+		try
+		{
+			pipeline.parse(data);
+		}
+		catch (const std::logic_error& ex)
+		{
+			m_logger(fscp::log_level::debug) << "Ignoring a malformed frame read on " << m_tap_adapter->name() << ": " << ex.what();
+		}
+
+		return handled;
+	}
+
+	bool core::do_handle_tun_adapter_frame(boost::asio::mutable_buffer data, const asiotap::osi::packet_meta& meta)
+	{
+		namespace ao = asiotap::osi;
+
+		if (meta.has_l4() && (meta.protocol == ao::TCP_PROTOCOL))
+		{
+			m_tcp_mss_morpher.handle(data + meta.l4_offset, ao::tcp_mss_morpher::direction::outgoing);
+
+			return false;
+		}
+
+		// Only neighbor solicitations may be answered by the proxy: the other frames never reach the pipeline.
+		if (!m_icmpv6_proxy || !meta.has_l4() || (meta.ip_version != 6) || (meta.protocol != ao::ICMPV6_HEADER))
+		{
+			return false;
+		}
+
+		bool handled = false;
+
+		auto pipeline = ao::make_static_filter<ao::ipv6_frame>(
+			ao::accept_frame(),
+			ao::make_static_filter<ao::icmpv6_frame>(
+				[this, &handled] (ao::mutable_helper<ao::icmpv6_frame> icmpv6_helper, ao::mutable_helper<ao::ipv6_frame> ipv6_helper)
+				{
+					if (m_icmpv6_proxy)
+					{
+						do_handle_icmpv6_frame(ipv6_helper, icmpv6_helper);
+
+						// We don't want to catch ICMP echo requests or other stuff yet.
+						handled = (icmpv6_helper.type() == ao::ICMPV6_NEIGHBOR_SOLICITATION);
+					}
+
+					return true;
+				}
+			)
+		);
+
+		// The proxy still throws on some malformed frames: they must not end the tap adapter reads.
+		try
+		{
+			pipeline.parse(data);
+		}
+		catch (const std::logic_error& ex)
+		{
+			m_logger(fscp::log_level::debug) << "Ignoring a malformed frame read on " << m_tap_adapter->name() << ": " << ex.what();
+		}
+
+		return handled;
+	}
+
+	void core::do_handle_arp_frame(const ethernet_helper_type& ethernet_helper, const arp_helper_type& helper)
 	{
 		if (m_arp_proxy)
 		{
-			const auto response_buffer = SharedBuffer(2048);
+			const auto response_buffer = get_proxy_buffer();
 			const boost::optional<boost::asio::const_buffer> data = m_arp_proxy->process_frame(
-				*m_arp_filter.parent().get_last_helper(),
+				ethernet_helper,
 				helper,
 				buffer(response_buffer)
 			);
 
-			if (data)
-			{
-				async_write_tap(
-					buffer(*data),
-					make_shared_buffer_handler(
-						response_buffer,
-						boost::bind(
-							&core::do_handle_tap_adapter_write,
-							this,
-							boost::asio::placeholders::error
-						)
-					)
-				);
-			}
+			do_write_proxy_response(response_buffer, data);
 		}
 	}
 
-	void core::do_handle_dhcp_frame(const dhcp_helper_type& helper)
+	void core::do_handle_dhcp_frame(const ethernet_helper_type& ethernet_helper, const ipv4_helper_type& ipv4_helper, const udp_helper_type& udp_helper, const bootp_helper_type& bootp_helper, const dhcp_helper_type& helper)
 	{
 		if (m_dhcp_proxy)
 		{
-			const auto response_buffer = SharedBuffer(2048);
+			const auto response_buffer = get_proxy_buffer();
 			const boost::optional<boost::asio::const_buffer> data = m_dhcp_proxy->process_frame(
-				*m_dhcp_filter.parent().parent().parent().parent().get_last_helper(),
-				*m_dhcp_filter.parent().parent().parent().get_last_helper(),
-				*m_dhcp_filter.parent().parent().get_last_helper(),
-				*m_dhcp_filter.parent().get_last_helper(),
+				ethernet_helper,
+				ipv4_helper,
+				udp_helper,
+				bootp_helper,
 				helper,
 				buffer(response_buffer)
 			);
 
-			if (data)
-			{
-				async_write_tap(
-					buffer(*data),
-					make_shared_buffer_handler(
-						response_buffer,
-						boost::bind(
-							&core::do_handle_tap_adapter_write,
-							this,
-							boost::asio::placeholders::error
-						)
-					)
-				);
-			}
+			do_write_proxy_response(response_buffer, data);
 		}
 	}
 
-	void core::do_handle_icmpv6_frame(const icmpv6_helper_type& helper)
+	void core::do_handle_icmpv6_frame(const ipv6_helper_type& ipv6_helper, const icmpv6_helper_type& helper)
 	{
 		if (m_icmpv6_proxy)
 		{
-			const auto response_buffer = SharedBuffer(2048);
+			const auto response_buffer = get_proxy_buffer();
 			const boost::optional<boost::asio::const_buffer> data = m_icmpv6_proxy->process_frame(
-				*m_tun_icmpv6_filter.parent().get_last_helper(),
+				ipv6_helper,
 				helper,
 				buffer(response_buffer)
 			);
 
-			if (data)
-			{
-				async_write_tap(
-					buffer(*data),
-					make_shared_buffer_handler(
-					response_buffer,
-					boost::bind(
-						&core::do_handle_tap_adapter_write,
-						this,
-						boost::asio::placeholders::error
-					)
-					)
-				);
-			}
+			do_write_proxy_response(response_buffer, data);
+		}
+	}
+
+	SharedBuffer core::get_proxy_buffer()
+	{
+		// All calls to get_proxy_buffer() are done within the m_tap_adapter_io_service, so the following is safe.
+		if (m_proxy_buffers.empty())
+		{
+			return SharedBuffer(PROXY_BUFFER_SIZE);
+		}
+
+		const auto result = m_proxy_buffers.front();
+		m_proxy_buffers.pop_front();
+
+		return result;
+	}
+
+	void core::release_proxy_buffer(SharedBuffer response_buffer)
+	{
+		// All calls to release_proxy_buffer() are done within the m_tap_adapter_io_service, so the following is safe.
+		if (m_proxy_buffers.size() < PROXY_BUFFERS_POOL_SIZE)
+		{
+			m_proxy_buffers.push_back(response_buffer);
+		}
+	}
+
+	void core::do_write_proxy_response(SharedBuffer response_buffer, boost::optional<boost::asio::const_buffer> data)
+	{
+		if (!data)
+		{
+			release_proxy_buffer(response_buffer);
+
+			return;
 		}
+
+		// The write handler is called within the m_tap_adapter_io_service: the buffer can go back to the pool from there.
+		async_write_tap(
+			buffer(*data),
+			[this, response_buffer] (const boost::system::error_code& ec) {
+				release_proxy_buffer(response_buffer);
+
+				do_handle_tap_adapter_write(ec);
+			}
+		);
 	}
 
 	bool core::do_handle_arp_request(const boost::asio::ip::address_v4& logical_address, ethernet_address_type& ethernet_address)
@@ -2297,7 +2806,7 @@ namespace freelan
 	void core::do_register_switch_port(const ep_type& host, void_handler_type handler)
 	{
 		// All calls to do_register_switch_port() are done within the m_router_strand, so the following is safe.
-		m_switch.register_port(make_port_index(host), switch_::port_type(boost::bind(&fscp::server::async_send_data, m_fscp_server, host, fscp::CHANNEL_NUMBER_0, _1, _2), ENDPOINTS_GROUP));
+		m_switch.register_port(make_port_index(host), switch_::port_type(boost::bind(&core::do_write_endpoint, this, host, _1, _2, _3), ENDPOINTS_GROUP));
 
 		if (handler)
 		{
@@ -2309,6 +2818,7 @@ namespace freelan
 	{
 		// All calls to do_unregister_switch_port() are done within the m_router_strand, so the following is safe.
 		m_switch.unregister_port(make_port_index(host));
+		m_endpoint_mtus.erase(host);
 
 		if (handler)
 		{
@@ -2319,7 +2829,7 @@ namespace freelan
 	void core::do_register_router_port(const ep_type& host, void_handler_type handler)
 	{
 		// All calls to do_register_router_port() are done within the m_router_strand, so the following is safe.
-		m_router.register_port(make_port_index(host), router::port_type(boost::bind(&fscp::server::async_send_data, m_fscp_server, host, fscp::CHANNEL_NUMBER_0, _1, _2), ENDPOINTS_GROUP));
+		m_router.register_port(make_port_index(host), router::port_type(boost::bind(&core::do_write_endpoint, this, host, _1, _2, _3), ENDPOINTS_GROUP));
 
 		if (handler)
 		{
@@ -2331,6 +2841,7 @@ namespace freelan
 	{
 		// All calls to do_unregister_router_port() are done within the m_router_strand, so the following is safe.
 		m_router.unregister_port(make_port_index(host));
+		m_endpoint_mtus.erase(host);
 
 		if (handler)
 		{
@@ -2355,7 +2866,10 @@ namespace freelan
 		// All calls to do_clear_client_router_info() are done within the m_router_strand, so the following is safe.
 
 		// This clears the routes, if any.
-		m_client_router_info_map.erase(host);
+		if (m_client_router_info_map.erase(host) > 0)
+		{
+			do_update_proxy_entries();
+		}
 
 		if (handler)
 		{
@@ -2363,16 +2877,260 @@ namespace freelan
 		}
 	}
 
-	void core::do_write_switch(const port_index_type& index, boost::asio::const_buffer data, switch_::multi_write_handler_type handler)
+	void core::do_update_proxy_entries()
+	{
+		// All calls to do_update_proxy_entries() are done within the m_router_strand, so the following is safe.
+		if (!m_tap_adapter)
+		{
+			return;
+		}
+
+		const bool is_ethernet = (m_tap_adapter->layer() == asiotap::tap_adapter_layer::ethernet);
+		const auto& ipv4_address_prefix_length = m_configuration.tap_adapter.ipv4_address_prefix_length;
+		const auto& ipv6_address_prefix_length = m_configuration.tap_adapter.ipv6_address_prefix_length;
+
+		// Only the addresses the proxies callbacks would resolve are loaded.
+		if (is_ethernet ? (!m_configuration.tap_adapter.arp_proxy_enabled || ipv4_address_prefix_length.is_null()) : ipv6_address_prefix_length.is_null())
+		{
+			return;
+		}
+
+		const ethernet_address_type& ethernet_address = m_configuration.tap_adapter.arp_proxy_fake_ethernet_address;
+		std::vector<arp_proxy_type::entry_type> arp_entries;
+		std::vector<icmpv6_proxy_type::entry_type> icmpv6_entries;
+
+		for (auto&& client_router_info : m_client_router_info_map)
+		{
+			for (auto&& route : client_router_info.second.routes)
+			{
+				if (!is_unicast(route))
+				{
+					continue;
+				}
+
+				const boost::asio::ip::address address = to_ip_address(network_address(route));
+
+				if (is_ethernet && address.is_v4() && (address.to_v4() != ipv4_address_prefix_length.address()))
+				{
+					arp_entries.push_back(std::make_pair(address.to_v4(), ethernet_address));
+				}
+				else if (!is_ethernet && address.is_v6() && (address.to_v6() != ipv6_address_prefix_length.address()))
+				{
+					icmpv6_entries.push_back(std::make_pair(address.to_v6(), ethernet_address));
+				}
+			}
+		}
+
+		// The proxies are only used within the m_tap_adapter_io_service.
+		m_tap_adapter_io_service.post([this, arp_entries, icmpv6_entries] () {
+			if (m_arp_proxy)
+			{
+				m_arp_proxy->set_entries(arp_entries.begin(), arp_entries.end());
+			}
+
+			if (m_icmpv6_proxy)
+			{
+				m_icmpv6_proxy->set_entries(icmpv6_entries.begin(), icmpv6_entries.end());
+			}
+		});
+	}
+
+	void core::do_handle_routes_delta(const asiotap::ip_network_address_list& tap_addresses, const ep_type& sender, const routes_delta_fragments_type& fragment, size_t fragment_index)
+	{
+		// All calls to do_handle_routes_delta() are done within the m_router_strand, so the following is safe.
+		client_router_info_type& client_router_info = m_client_router_info_map[sender];
+		client_router_info.supports_routes_delta = true;
+
+		if (!client_router_info.pending_routes_delta || !client_router_info.pending_routes_delta->is_part_of(fragment))
+		{
+			// Fragments of any other delta are dropped: the next routes request will get the whole delta again.
+			client_router_info.pending_routes_delta = routes_delta_fragments_type(fragment);
+			client_router_info.pending_routes_delta->routes = route_delta();
+			client_router_info.pending_routes_delta->dns_servers = routes_delta_message::dns_servers_delta();
+		}
+
+		routes_delta_fragments_type& pending = *client_router_info.pending_routes_delta;
+
+		if (pending.received_fragments[fragment_index])
+		{
+			return;
+		}
+
+		pending.received_fragments[fragment_index] = true;
+		--pending.remaining_fragments;
+		pending.routes.added.insert(fragment.routes.added.begin(), fragment.routes.added.end());
+		pending.routes.removed.insert(fragment.routes.removed.begin(), fragment.routes.removed.end());
+		pending.dns_servers.added.insert(fragment.dns_servers.added.begin(), fragment.dns_servers.added.end());
+		pending.dns_servers.removed.insert(fragment.dns_servers.removed.begin(), fragment.dns_servers.removed.end());
+
+		if (pending.remaining_fragments > 0)
+		{
+			return;
+		}
+
+		const routes_delta_fragments_type delta = pending;
+		client_router_info.pending_routes_delta = boost::none;
+
+		if (!delta.is_snapshot && (!client_router_info.version || (*client_router_info.version != delta.base_version)))
+		{
+			m_logger(fscp::log_level::debug) << "Received routes delta from " << sender << " for version " << delta.base_version << " which is not the one we have. Requesting a snapshot.";
+
+			async_send_routes_delta_request(sender, boost::none);
+
+			return;
+		}
+
+		if (client_router_info.version && (*client_router_info.version == delta.version))
+		{
+			m_logger(fscp::log_level::debug) << "Routes from " << sender << " are still at version " << delta.version << ".";
+
+			return;
+		}
+
+		asiotap::ip_route_set routes;
+		asiotap::ip_address_set dns_servers;
+
+		if (!delta.is_snapshot)
+		{
+			routes = client_router_info.routes;
+			dns_servers = client_router_info.dns_servers;
+		}
+
+		delta.routes.apply_to(routes);
+		delta.dns_servers.apply_to(dns_servers);
+
+		do_handle_routes(tap_addresses, sender, delta.version, routes, dns_servers);
+	}
+
+	void core::do_write_switch(const port_index_type& index, boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, switch_::multi_write_handler_type handler)
 	{
 		// All calls to do_write_switch() are done within the m_router_strand, so the following is safe.
-		m_switch.async_write(index, data, handler);
+		// The ports are written to synchronously, from within async_write().
+		m_writing_from_tap_adapter = (boost::get<tap_adapter_port_index_type>(&index) != nullptr);
+		m_switch.async_write(index, data, meta, handler);
+		m_writing_from_tap_adapter = false;
 	}
 
-	void core::do_write_router(const port_index_type& index, boost::asio::const_buffer data, router::port_type::write_handler_type handler)
+	void core::do_write_router(const port_index_type& index, boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, router::port_type::write_handler_type handler)
 	{
 		// All calls to do_write_router() are done within the m_router_strand, so the following is safe.
-		m_router.async_write(index, data, handler);
+		m_writing_from_tap_adapter = (boost::get<tap_adapter_port_index_type>(&index) != nullptr);
+		m_router.async_write(index, data, meta, handler);
+		m_writing_from_tap_adapter = false;
+	}
+
+	void core::do_set_endpoint_mtu(const ep_type& host, size_t mtu)
+	{
+		// All calls to do_set_endpoint_mtu() are done within the m_router_strand, so the following is safe.
+		if (mtu > 0)
+		{
+			m_endpoint_mtus[host] = mtu;
+		}
+		else
+		{
+			m_endpoint_mtus.erase(host);
+		}
+	}
+
+	void core::do_write_endpoint(const ep_type& host, boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, router::port_type::write_handler_type handler)
+	{
+		// All calls to do_write_endpoint() are done within the m_router_strand, so the following is safe.
+		namespace ao = asiotap::osi;
+
+		const endpoint_mtu_map_type::const_iterator mtu_entry = m_endpoint_mtus.find(host);
+
+		// Until its path MTU is known, an endpoint gets the frames as they are: the system fragments the datagrams if it has to.
+		if (mtu_entry == m_endpoint_mtus.end())
+		{
+			m_fscp_server->async_send_data(host, fscp::CHANNEL_NUMBER_0, data, handler);
+
+			return;
+		}
+
+		const size_t mtu = mtu_entry->second;
+
+		if (!meta.has_l3() || (mtu <= meta.l3_offset))
+		{
+			m_fscp_server->async_send_data(host, fscp::CHANNEL_NUMBER_0, data, handler);
+
+			return;
+		}
+
+		const uint8_t* const frame = buffer_cast<const uint8_t*>(data);
+		const size_t ip_mtu = mtu - meta.l3_offset;
+
+		// Only the frames from our own TAP adapter are refused, as only their sender can be told about it. Relayed frames are forwarded as they are: the system fragments the datagrams if it has to.
+		if (m_writing_from_tap_adapter && (buffer_size(data) > mtu))
+		{
+			// IPv4 packets without the DF bit may still be fragmented and IPv6 links cannot advertise less than the IPv6 minimum MTU.
+			const bool must_refuse = (meta.ip_version == 4) ? ((frame[meta.l3_offset + 6] & 0x40) != 0) : (ip_mtu >= ao::IPV6_MINIMUM_MTU);
+
+			if (must_refuse)
+			{
+				do_send_packet_too_big(data, meta, ip_mtu);
+
+				handler(boost::asio::error::message_size);
+
+				return;
+			}
+		}
+
+		const size_t tcp_overhead = (meta.l4_offset - meta.l3_offset) + 20;
+
+		if (meta.has_l4() && (meta.protocol == ao::TCP_PROTOCOL) && ((frame[meta.l4_offset + 13] & ao::TCP_FLAG_SYN) != 0) && (ip_mtu > tcp_overhead))
+		{
+			// The frame is not ours to modify: SYN segments are rare enough to be copied before being clamped.
+			const size_t size = buffer_size(data);
+			const auto clamped_buffer = SharedBuffer(size);
+
+			boost::asio::buffer_copy(buffer(clamped_buffer), data);
+			m_tcp_mss_morpher.handle(buffer(clamped_buffer, size) + meta.l4_offset, ao::tcp_mss_morpher::direction::outgoing, ip_mtu - tcp_overhead);
+
+			m_fscp_server->async_send_data(host, fscp::CHANNEL_NUMBER_0, buffer(clamped_buffer, size), make_shared_buffer_handler(clamped_buffer, handler));
+
+			return;
+		}
+
+		m_fscp_server->async_send_data(host, fscp::CHANNEL_NUMBER_0, data, handler);
+	}
+
+	void core::do_send_packet_too_big(boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, size_t ip_mtu)
+	{
+		namespace ao = asiotap::osi;
+
+		// The ICMP error is written back as if the destination had sent it: in TAP mode, it keeps the link layer header of the frame, with its addresses swapped.
+		const auto response_buffer = SharedBuffer(2048);
+		const boost::asio::const_buffer packet = data + meta.l3_offset;
+		const boost::asio::mutable_buffer icmp_buffer = buffer(response_buffer) + meta.l3_offset;
+
+		const size_t size = (meta.ip_version == 4) ? ao::write_ipv4_fragmentation_needed(icmp_buffer, packet, static_cast<uint16_t>(std::min<size_t>(ip_mtu, 0xFFFF))) : ao::write_ipv6_packet_too_big(icmp_buffer, packet, static_cast<uint32_t>(ip_mtu));
+
+		if (size == 0)
+		{
+			return;
+		}
+
+		if (meta.has_l2())
+		{
+			uint8_t* const response = buffer_cast<uint8_t*>(response_buffer);
+			const uint8_t* const frame = buffer_cast<const uint8_t*>(data);
+
+			std::copy(meta.ethernet_sender.begin(), meta.ethernet_sender.end(), response);
+			std::copy(meta.ethernet_target.begin(), meta.ethernet_target.end(), response + meta.ethernet_sender.size());
+			std::copy(frame + meta.ethernet_sender.size() + meta.ethernet_target.size(), frame + meta.l3_offset, response + meta.ethernet_sender.size() + meta.ethernet_target.size());
+		}
+
+		async_write_tap(
+			buffer(response_buffer, meta.l3_offset + size),
+			make_shared_buffer_handler(
+				response_buffer,
+				boost::bind(
+					&core::do_handle_tap_adapter_write,
+					this,
+					boost::asio::placeholders::error
+				)
+			)
+		);
 	}
 
 	void core::open_web_server()
@@ -2610,10 +3368,12 @@ namespace freelan
 					m_request_ca_certificate.reset();
 					m_logger(fscp::log_level::information) << "Received CA certificate from server: " << certificate.subject();
 
+					boost::mutex::scoped_lock lock(m_ca_store_mutex);
+
 					m_client_certificate_authority_list.clear();
 					m_client_certificate_authority_list.push_back(certificate);
 
-					build_ca_store(build_ca_store_when::always);
+					do_build_ca_store(build_ca_store_when::always);
 				}
 			});
 		} else {
@@ -2911,6 +3671,43 @@ namespace freelan
 		exponential_backoff_value(period, min, max);
 	}
 
+	core::local_routes_ptr_type core::get_local_routes()
+	{
+		// All calls to get_local_routes() are done within the m_router_strand, so the following is safe.
+		if (m_tap_adapter && (m_tap_adapter->layer() == asiotap::tap_adapter_layer::ip))
+		{
+			if (!m_local_routes_version)
+			{
+				return local_routes_ptr_type();
+			}
+
+			// The converted routes only change with their version: don't rebuild them for every request.
+			if (!m_local_routes || (m_local_routes->version != *m_local_routes_version))
+			{
+				const auto local_port = m_router.get_port(make_port_index(m_tap_adapter));
+				const auto result = boost::make_shared<local_routes_type>();
+
+				result->version = *m_local_routes_version;
+				result->routes = local_port->local_routes().to_set();
+				result->dns_servers = local_port->local_dns_servers();
+
+				m_local_routes = result;
+			}
+		}
+		else if (!m_local_routes)
+		{
+			const auto result = boost::make_shared<local_routes_type>();
+
+			result->version = 0;
+			result->routes = translate_ip_routes(m_configuration.router.local_ip_routes);
+			result->dns_servers = m_configuration.router.local_dns_servers;
+
+			m_local_routes = result;
+		}
+
+		return m_local_routes;
+	}
+
 	asiotap::ip_route_set core::translate_ip_routes(const std::set<ip_route>& routes) const
 	{
 		boost::optional<boost::asio::ip::address_v4> ipv4_gateway;
@@ -0,0 +1,306 @@
+/*
+ * libfreelan - A C++ library to establish peer-to-peer virtual private
+ * networks.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfreelan.
+ *
+ * libfreelan is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfreelan is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfreelan in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file hostname_resolver.cpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief A caching hostname resolver backed by a thread pool.
+ */
+
+#include "hostname_resolver.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <cassert>
+
+namespace freelan
+{
+	const size_t hostname_resolver::MAX_ENTRIES = 1024;
+
+	hostname_resolver::hostname_resolver(boost::asio::io_service& io_service, resolver_type::protocol_type protocol, resolver_type::query::flags flags, const std::string& default_service, size_t thread_count, const boost::posix_time::time_duration& positive_ttl, const boost::posix_time::time_duration& negative_ttl, bool stale_while_revalidate) :
+		m_state(new state_type(io_service, protocol, flags, default_service, positive_ttl, negative_ttl, stale_while_revalidate))
+	{
+		assert(thread_count > 0);
+
+		for (size_t i = 0; i < thread_count; ++i)
+		{
+			boost::thread(boost::bind(&state_type::run, m_state)).detach();
+		}
+	}
+
+	hostname_resolver::~hostname_resolver()
+	{
+		// Joining the pool threads could block the caller for as long as the system resolver takes: they are left to finish on their own instead.
+		{
+			boost::mutex::scoped_lock lock(m_state->mutex);
+
+			m_state->closed = true;
+		}
+
+		m_state->pool_work.reset();
+		m_state->pool_io_service.stop();
+	}
+
+	void hostname_resolver::async_resolve(const asiotap::endpoint& target, resolve_handler_type handler)
+	{
+		const asiotap::hostname_endpoint* const hostname_target = boost::get<asiotap::hostname_endpoint>(&target);
+
+		if (!hostname_target)
+		{
+			// Numeric endpoints never hit the network: there is nothing worth caching or offloading.
+			resolver_type resolver(m_state->io_service);
+			boost::system::error_code ec;
+			ep_type result;
+
+			try
+			{
+				result = boost::apply_visitor(asiotap::endpoint_resolve_visitor(resolver, m_state->protocol, m_state->flags, m_state->default_service), target);
+			}
+			catch (const boost::system::system_error& ex)
+			{
+				ec = ex.code();
+			}
+
+			m_state->io_service.post(boost::bind(handler, ec, result));
+
+			return;
+		}
+
+		const std::string key = boost::lexical_cast<std::string>(*hostname_target);
+
+		boost::mutex::scoped_lock lock(m_state->mutex);
+
+		entry_map_type::iterator entry_it = m_state->entries.find(key);
+
+		if (entry_it == m_state->entries.end())
+		{
+			if (m_state->entries.size() >= MAX_ENTRIES)
+			{
+				m_state->make_room();
+			}
+
+			entry_it = m_state->entries.insert(std::make_pair(key, entry_type())).first;
+		}
+
+		entry_type& entry = entry_it->second;
+
+		if (entry.has_result)
+		{
+			if (boost::posix_time::microsec_clock::universal_time() < entry.expiration)
+			{
+				++m_state->statistics.hits;
+				m_state->io_service.post(boost::bind(handler, entry.error, entry.endpoint));
+
+				return;
+			}
+
+			if (m_state->stale_while_revalidate && !entry.error)
+			{
+				++m_state->statistics.stale_hits;
+				m_state->io_service.post(boost::bind(handler, entry.error, entry.endpoint));
+
+				if (!entry.resolving)
+				{
+					m_state->start_resolution(key, entry, *hostname_target);
+				}
+
+				return;
+			}
+		}
+
+		++m_state->statistics.misses;
+		entry.handlers.push_back(handler);
+
+		if (!entry.resolving)
+		{
+			m_state->start_resolution(key, entry, *hostname_target);
+		}
+	}
+
+	void hostname_resolver::clear()
+	{
+		boost::mutex::scoped_lock lock(m_state->mutex);
+
+		for (entry_map_type::iterator entry = m_state->entries.begin(); entry != m_state->entries.end();)
+		{
+			// Entries with a query in progress are kept so that their handlers are still called.
+			if (entry->second.resolving)
+			{
+				entry->second.has_result = false;
+				++entry;
+			}
+			else
+			{
+				m_state->entries.erase(entry++);
+			}
+		}
+	}
+
+	hostname_resolver::statistics_type hostname_resolver::get_statistics() const
+	{
+		boost::mutex::scoped_lock lock(m_state->mutex);
+
+		return m_state->statistics;
+	}
+
+	hostname_resolver::state_type::state_type(boost::asio::io_service& _io_service, resolver_type::protocol_type _protocol, resolver_type::query::flags _flags, const std::string& _default_service, const boost::posix_time::time_duration& _positive_ttl, const boost::posix_time::time_duration& _negative_ttl, bool _stale_while_revalidate) :
+		io_service(_io_service),
+		protocol(_protocol),
+		flags(_flags),
+		default_service(_default_service),
+		positive_ttl(_positive_ttl),
+		negative_ttl(_negative_ttl),
+		stale_while_revalidate(_stale_while_revalidate && (_positive_ttl > boost::posix_time::time_duration())),
+		mutex(),
+		closed(false),
+		entries(),
+		statistics(),
+		pool_io_service(),
+		pool_work(new boost::asio::io_service::work(pool_io_service))
+	{
+	}
+
+	void hostname_resolver::state_type::run()
+	{
+		// Each pool thread holds a reference to the state for as long as this runs.
+		pool_io_service.run();
+	}
+
+	void hostname_resolver::state_type::make_room()
+	{
+		// Must be called with mutex locked. Entries with a query in progress are never evicted so that their handlers are still called.
+		const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+		entry_map_type::iterator oldest = entries.end();
+
+		for (entry_map_type::iterator entry = entries.begin(); entry != entries.end();)
+		{
+			if (entry->second.resolving)
+			{
+				++entry;
+			}
+			else if (!entry->second.has_result || (entry->second.expiration <= now))
+			{
+				entries.erase(entry++);
+			}
+			else
+			{
+				if ((oldest == entries.end()) || (entry->second.expiration < oldest->second.expiration))
+				{
+					oldest = entry;
+				}
+
+				++entry;
+			}
+		}
+
+		if ((entries.size() >= MAX_ENTRIES) && (oldest != entries.end()))
+		{
+			entries.erase(oldest);
+		}
+	}
+
+	void hostname_resolver::state_type::start_resolution(const std::string& key, entry_type& entry, const asiotap::hostname_endpoint& target)
+	{
+		// Must be called with mutex locked. The queued query does not own the state: it only runs within a pool thread, which does.
+		entry.resolving = true;
+
+		pool_io_service.post(boost::bind(&state_type::do_resolve, this, key, target));
+	}
+
+	void hostname_resolver::state_type::do_resolve(const std::string& key, const asiotap::hostname_endpoint& target)
+	{
+		// This runs on one of the pool threads: the blocking call below does not hold any lock.
+		resolver_type resolver(pool_io_service);
+		boost::system::error_code ec;
+		ep_type result;
+
+		try
+		{
+			result = asiotap::resolve(target, resolver, protocol, flags, default_service);
+		}
+		catch (const boost::system::system_error& ex)
+		{
+			ec = ex.code();
+		}
+
+		boost::mutex::scoped_lock lock(mutex);
+
+		// The resolver was destroyed while the query ran: the io_service of the handlers may be gone too.
+		if (closed)
+		{
+			return;
+		}
+
+		entry_type& entry = entries[key];
+		const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+
+		entry.resolving = false;
+
+		if (!ec)
+		{
+			entry.has_result = true;
+			entry.error = ec;
+			entry.endpoint = result;
+			entry.expiration = now + positive_ttl;
+		}
+		else if (stale_while_revalidate && entry.has_result && !entry.error)
+		{
+			// The refresh failed: keep the last known endpoint and try again once the negative time-to-live expires.
+			entry.expiration = now + negative_ttl;
+			ec = boost::system::error_code();
+			result = entry.endpoint;
+		}
+		else
+		{
+			entry.has_result = true;
+			entry.error = ec;
+			entry.endpoint = ep_type();
+			entry.expiration = now + negative_ttl;
+		}
+
+		// The handlers are posted with the lock held so that the destructor cannot return in the meantime.
+		for (auto&& handler : entry.handlers)
+		{
+			io_service.post(boost::bind(handler, ec, result));
+		}
+
+		entry.handlers.clear();
+	}
+}
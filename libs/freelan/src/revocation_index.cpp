@@ -0,0 +1,182 @@
+/*
+ * libfreelan - A C++ library to establish peer-to-peer virtual private
+ * networks.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfreelan.
+ *
+ * libfreelan is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfreelan is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfreelan in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file revocation_index.cpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief An index of revoked certificate serial numbers.
+ */
+
+#include "revocation_index.hpp"
+
+#include <cryptoplus/hash/message_digest.hpp>
+
+#include <boost/make_shared.hpp>
+
+#include <openssl/x509.h>
+
+namespace freelan
+{
+	namespace
+	{
+		std::string to_string(const cryptoplus::buffer& buf)
+		{
+			return std::string(cryptoplus::buffer_cast<const char*>(buf), cryptoplus::buffer_size(buf));
+		}
+
+		// The DER encoding is canonical, which makes it suitable as a hash key.
+		std::string serial_number_key(const ASN1_INTEGER* serial_number)
+		{
+			const int len = i2d_ASN1_INTEGER(serial_number, NULL);
+
+			if (len <= 0)
+			{
+				return std::string();
+			}
+
+			std::string result(static_cast<size_t>(len), '\0');
+			unsigned char* out = reinterpret_cast<unsigned char*>(&result[0]);
+
+			i2d_ASN1_INTEGER(serial_number, &out);
+
+			return result;
+		}
+
+		cryptoplus::buffer get_crl_fingerprint(revocation_index::crl_type crl)
+		{
+			const cryptoplus::buffer der = crl.write_der();
+
+			return cryptoplus::hash::message_digest(der, cryptoplus::hash::message_digest_algorithm(NID_sha256));
+		}
+	}
+
+	revocation_index::revocation_index() :
+		m_reused_count(0)
+	{
+	}
+
+	revocation_index::revocation_index(const crl_list_type& crl_list, const revocation_index* previous) :
+		m_reused_count(0)
+	{
+		for (const crl_type& crl : crl_list)
+		{
+			const cryptoplus::buffer fingerprint = get_crl_fingerprint(crl);
+
+			if (m_crls.count(fingerprint) > 0)
+			{
+				continue;
+			}
+
+			crl_entry_ptr_type entry;
+
+			if (previous)
+			{
+				const auto it = previous->m_crls.find(fingerprint);
+
+				if (it != previous->m_crls.end())
+				{
+					entry = it->second;
+					++m_reused_count;
+				}
+			}
+
+			if (!entry)
+			{
+				entry = make_crl_entry(crl);
+			}
+
+			m_crls[fingerprint] = entry;
+			m_issuers.insert(std::make_pair(entry->issuer, entry));
+		}
+	}
+
+	bool revocation_index::is_revoked(cert_type cert) const
+	{
+		const std::string issuer = to_string(cert.issuer().write_der());
+		const auto range = m_issuers.equal_range(issuer);
+
+		if (range.first == range.second)
+		{
+			return false;
+		}
+
+		const std::string serial_number = serial_number_key(cert.serial_number().raw());
+
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second->serial_numbers.count(serial_number) > 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	size_t revocation_index::revoked_count() const
+	{
+		size_t result = 0;
+
+		for (const auto& crl : m_crls)
+		{
+			result += crl.second->serial_numbers.size();
+		}
+
+		return result;
+	}
+
+	revocation_index::crl_entry_ptr_type revocation_index::make_crl_entry(crl_type crl)
+	{
+		const boost::shared_ptr<crl_entry_type> entry = boost::make_shared<crl_entry_type>();
+
+		entry->issuer = to_string(cryptoplus::x509::name(X509_CRL_get_issuer(crl.raw())).write_der());
+
+		STACK_OF(X509_REVOKED)* revoked = X509_CRL_get_REVOKED(crl.raw());
+		const int count = revoked ? sk_X509_REVOKED_num(revoked) : 0;
+
+		entry->serial_numbers.reserve(static_cast<size_t>(count));
+
+		for (int i = 0; i < count; ++i)
+		{
+			entry->serial_numbers.insert(serial_number_key(X509_REVOKED_get0_serialNumber(sk_X509_REVOKED_value(revoked, i))));
+		}
+
+		return entry;
+	}
+}
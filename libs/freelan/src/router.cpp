@@ -51,9 +51,6 @@
 
 #include <boost/foreach.hpp>
 
-#include <asiotap/osi/ipv4_helper.hpp>
-#include <asiotap/osi/ipv6_helper.hpp>
-
 namespace freelan
 {
 	namespace
@@ -67,42 +64,69 @@ namespace freelan
 
 			return solicited_node_multicast_address.has_address(addr);
 		}
+
+		template <typename ListType, typename RouteListType, typename IndexType>
+		void append_route_ports(ListType& routes, const RouteListType& port_routes, const IndexType& index)
+		{
+			for (auto&& route : port_routes)
+			{
+				routes.push_back(std::make_pair(route, index));
+			}
+		}
+
+		template <typename ListType, typename RouteListType, typename IndexType>
+		void insert_route_ports(ListType& routes, const RouteListType& port_routes, const IndexType& index)
+		{
+			for (auto&& route : port_routes)
+			{
+				// Identical routes are kept ordered by port index, exactly as a full compilation would do.
+				const typename ListType::value_type entry(route, index);
+
+				routes.insert(std::lower_bound(routes.begin(), routes.end(), entry), entry);
+			}
+		}
+
+		template <typename ListType, typename RouteListType, typename IndexType>
+		void erase_route_ports(ListType& routes, const RouteListType& port_routes, const IndexType& index)
+		{
+			for (auto&& route : port_routes)
+			{
+				const typename ListType::value_type entry(route, index);
+				const auto position = std::lower_bound(routes.begin(), routes.end(), entry);
+
+				if ((position != routes.end()) && !(entry < *position))
+				{
+					routes.erase(position);
+				}
+			}
+		}
 	}
 
 	void router::async_write(port_index_type index, boost::asio::const_buffer data, port_type::write_handler_type handler)
 	{
-		const auto port_entries = get_targets_for(index, data);
+		async_write(index, data, asiotap::osi::parse_ip_packet_meta(data), handler);
+	}
+
+	void router::async_write(port_index_type index, boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, port_type::write_handler_type handler)
+	{
+		const auto port_entries = get_targets_for(index, meta);
 
 		for (auto&& port_entry : port_entries) {
-			port_entry->async_write(data, handler);
+			port_entry->async_write(data, meta, handler);
 		}
 	}
 
-	std::vector<const router::port_type*> router::get_targets_for(port_index_type index, boost::asio::const_buffer data)
+	std::vector<const router::port_type*> router::get_targets_for(port_index_type index, const asiotap::osi::packet_meta& meta)
 	{
-		// Try IPv4 first because it is more likely.
-
-		m_ipv4_filter.parse(data);
-
-		if (m_ipv4_filter.get_last_const_helper())
-		{
-			const boost::asio::ip::address_v4 destination = m_ipv4_filter.get_last_const_helper()->destination();
-
-			m_ipv4_filter.clear_last_helper();
-
-			return get_targets_for(index, destination);
-		}
-		else
+		if (meta.has_l3())
 		{
-			m_ipv6_filter.parse(data);
-
-			if (m_ipv6_filter.get_last_const_helper())
+			if (meta.ip_version == 4)
 			{
-				const boost::asio::ip::address_v6 destination = m_ipv6_filter.get_last_const_helper()->destination();
-
-				m_ipv6_filter.clear_last_helper();
-
-				return get_targets_for(index, destination);
+				return get_targets_for(index, meta.ipv4_destination());
+			}
+			else
+			{
+				return get_targets_for(index, meta.ipv6_destination());
 			}
 		}
 
@@ -131,7 +155,7 @@ namespace freelan
 					}
 				}
 			} else {
-				const auto& routes_ports = routes();
+				const auto& routes_ports = routes().for_address(dest_addr);
 
 				for (auto&& route_port : routes_ports) {
 					if (has_address(route_port.first, dest_addr)) {
@@ -161,18 +185,31 @@ namespace freelan
 			m_routes = routes_port_type();
 
 			// We add all the port routes to the routes list.
-			// These are sorted automatically by the container.
 			for (port_list_type::const_iterator port = m_ports.begin(); port != m_ports.end(); ++port)
 			{
-				const auto& local_routes = port->second.local_routes();
-
-				for (auto&& route : local_routes)
-				{
-					m_routes->insert(std::make_pair(route, port->first));
-				}
+				append_route_ports(m_routes->ipv4, port->second.local_routes().ipv4(), port->first);
+				append_route_ports(m_routes->ipv6, port->second.local_routes().ipv6(), port->first);
 			}
+
+			// Sorting by route then by port index gives the order a std::multimap filled port by port would have.
+			std::sort(m_routes->ipv4.begin(), m_routes->ipv4.end());
+			std::sort(m_routes->ipv6.begin(), m_routes->ipv6.end());
 		}
 
 		return *m_routes;
 	}
+
+	void router::update_routes(const port_index_type& index, const route_flat_delta& delta)
+	{
+		// If the routes are not compiled yet, they will be on the next lookup.
+		if (!m_routes)
+		{
+			return;
+		}
+
+		erase_route_ports(m_routes->ipv4, delta.removed.ipv4(), index);
+		erase_route_ports(m_routes->ipv6, delta.removed.ipv6(), index);
+		insert_route_ports(m_routes->ipv4, delta.added.ipv4(), index);
+		insert_route_ports(m_routes->ipv6, delta.added.ipv6(), index);
+	}
 }
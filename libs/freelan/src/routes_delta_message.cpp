@@ -0,0 +1,265 @@
+/*
+ * libfreelan - A C++ library to establish peer-to-peer virtual private
+ * networks.
+ * Copyright (C) 2010-2011 Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfreelan.
+ *
+ * libfreelan is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfreelan is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfreelan in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file routes_delta_message.cpp
+ * \author Julien KAUFFMANN <julien.kauffmann@freelan.org>
+ * \brief The routes delta messages exchanged by the peers.
+ */
+
+#include "routes_delta_message.hpp"
+
+#include "routes_encoding.hpp"
+
+#include <cassert>
+
+namespace freelan
+{
+	using namespace routes_encoding;
+
+	namespace
+	{
+		// Large enough for the biggest entry: an IPv6 route with a gateway.
+		const size_t MAX_ENTRY_SIZE = 64;
+
+		class fragment_builder
+		{
+			public:
+
+				explicit fragment_builder(size_t max_entries_size) :
+					m_max_entries_size(max_entries_size),
+					m_fragments(1)
+				{
+				}
+
+				void add_route(uint8_t operation, const asiotap::ip_route& route)
+				{
+					uint8_t entry[MAX_ENTRY_SIZE];
+					entry[0] = operation;
+
+					const size_t count = boost::apply_visitor(routes_helper<uint8_t*>(entry + 1, sizeof(entry) - 1), route);
+
+					append(entry, 1 + count);
+				}
+
+				void add_dns_server(uint8_t operation, const asiotap::ip_address& dns_server)
+				{
+					uint8_t entry[MAX_ENTRY_SIZE];
+					entry[0] = operation;
+
+					const size_t count = routes_helper<uint8_t*>(entry + 1, sizeof(entry) - 1).write_dns_server(dns_server.value());
+
+					append(entry, 1 + count);
+				}
+
+				const routes_delta_message::fragment_entries_list_type& fragments() const
+				{
+					return m_fragments;
+				}
+
+			private:
+
+				void append(const uint8_t* entry, size_t entry_size)
+				{
+					if (m_fragments.back().size() + entry_size > m_max_entries_size)
+					{
+						if (m_fragments.size() == routes_delta_message::MAX_FRAGMENT_COUNT)
+						{
+							throw std::runtime_error("Too many fragments for the routes delta");
+						}
+
+						m_fragments.push_back(routes_delta_message::fragment_entries_type());
+						m_fragments.back().reserve(m_max_entries_size);
+					}
+
+					m_fragments.back().insert(m_fragments.back().end(), entry, entry + entry_size);
+				}
+
+				const size_t m_max_entries_size;
+				routes_delta_message::fragment_entries_list_type m_fragments;
+		};
+	}
+
+	const size_t routes_delta_message::MAX_SIZE;
+	const size_t routes_delta_message::MAX_FRAGMENT_COUNT;
+
+	routes_delta_message::fragment_entries_list_type routes_delta_message::encode_fragments(const route_delta& routes, const dns_servers_delta& dns_servers)
+	{
+		fragment_builder builder(MAX_SIZE - HEADER_LENGTH - DELTA_HEADER_LENGTH);
+
+		for (auto&& route : routes.removed)
+		{
+			builder.add_route(OP_REMOVE, route);
+		}
+
+		for (auto&& route : routes.added)
+		{
+			builder.add_route(OP_ADD, route);
+		}
+
+		for (auto&& dns_server : dns_servers.removed)
+		{
+			builder.add_dns_server(OP_REMOVE, dns_server);
+		}
+
+		for (auto&& dns_server : dns_servers.added)
+		{
+			builder.add_dns_server(OP_ADD, dns_server);
+		}
+
+		return builder.fragments();
+	}
+
+	size_t routes_delta_message::write(void* buf, size_t buf_len, version_type _version, version_type _base_version, bool _is_snapshot, size_t _fragment_index, size_t _fragment_count, const fragment_entries_type& entries)
+	{
+		assert(_fragment_index < _fragment_count);
+		assert(_fragment_count <= MAX_FRAGMENT_COUNT);
+
+		const size_t required_size = DELTA_HEADER_LENGTH + entries.size();
+
+		if (buf_len < HEADER_LENGTH + required_size)
+		{
+			throw std::runtime_error("buf_len");
+		}
+
+		uint8_t* const pbuf = static_cast<uint8_t*>(buf) + HEADER_LENGTH;
+
+		fscp::buffer_tools::set<uint32_t>(pbuf, 0, htonl(static_cast<uint32_t>(_version)));
+		fscp::buffer_tools::set<uint32_t>(pbuf, 4, htonl(static_cast<uint32_t>(_is_snapshot ? 0 : _base_version)));
+		fscp::buffer_tools::set<uint8_t>(pbuf, 8, _is_snapshot ? FLAG_SNAPSHOT : 0x00);
+		fscp::buffer_tools::set<uint16_t>(pbuf, 9, htons(static_cast<uint16_t>(_fragment_index)));
+		fscp::buffer_tools::set<uint16_t>(pbuf, 11, htons(static_cast<uint16_t>(_fragment_count)));
+
+		std::copy(entries.begin(), entries.end(), pbuf + DELTA_HEADER_LENGTH);
+
+		return message::write(buf, buf_len, MT_ROUTES_DELTA, required_size);
+	}
+
+	routes_delta_message::version_type routes_delta_message::version() const
+	{
+		return static_cast<version_type>(ntohl(fscp::buffer_tools::get<uint32_t>(payload(), 0)));
+	}
+
+	routes_delta_message::version_type routes_delta_message::base_version() const
+	{
+		return static_cast<version_type>(ntohl(fscp::buffer_tools::get<uint32_t>(payload(), 4)));
+	}
+
+	bool routes_delta_message::is_snapshot() const
+	{
+		return ((fscp::buffer_tools::get<uint8_t>(payload(), 8) & FLAG_SNAPSHOT) != 0);
+	}
+
+	size_t routes_delta_message::fragment_index() const
+	{
+		return ntohs(fscp::buffer_tools::get<uint16_t>(payload(), 9));
+	}
+
+	size_t routes_delta_message::fragment_count() const
+	{
+		return ntohs(fscp::buffer_tools::get<uint16_t>(payload(), 11));
+	}
+
+	routes_delta_message::routes_delta_message(const void* buf, size_t buf_len) :
+		message(buf, buf_len)
+	{
+		read_entries();
+	}
+
+	routes_delta_message::routes_delta_message(const message& _message) :
+		message(_message)
+	{
+		read_entries();
+	}
+
+	void routes_delta_message::read_entries()
+	{
+		if (length() < DELTA_HEADER_LENGTH)
+		{
+			throw std::runtime_error("bad message length");
+		}
+
+		if ((fragment_count() == 0) || (fragment_index() >= fragment_count()))
+		{
+			throw std::runtime_error("bad fragment index");
+		}
+
+		routes_helper<const uint8_t*> deserializer(payload() + DELTA_HEADER_LENGTH, length() - DELTA_HEADER_LENGTH);
+
+		asiotap::ip_route ir;
+		asiotap::ip_address dns_server;
+
+		while (!deserializer.empty())
+		{
+			const uint8_t operation = deserializer.read_next_byte();
+
+			if ((operation != OP_ADD) && (operation != OP_REMOVE))
+			{
+				throw std::runtime_error("Unknown route operation in message");
+			}
+
+			if ((operation == OP_REMOVE) && is_snapshot())
+			{
+				throw std::runtime_error("Unexpected route removal in snapshot");
+			}
+
+			switch (deserializer.read_next(ir, dns_server))
+			{
+				case INAT_IPV4:
+				case INAT_IPV4_GATEWAY:
+				case INAT_IPV6:
+				case INAT_IPV6_GATEWAY:
+				{
+					(operation == OP_ADD ? m_routes.added : m_routes.removed).insert(ir);
+					break;
+				}
+				case INAT_DNS_SERVER_IPV4:
+				case INAT_DNS_SERVER_IPV6:
+				{
+					(operation == OP_ADD ? m_dns_servers.added : m_dns_servers.removed).insert(dns_server);
+					break;
+				}
+				default:
+				{
+					throw std::runtime_error("Missing route after operation in message");
+				}
+			}
+		}
+	}
+}
@@ -45,282 +45,13 @@
 
 #include "routes_message.hpp"
 
+#include "routes_encoding.hpp"
+
 #include <cassert>
 
 namespace freelan
 {
-	namespace
-	{
-		enum ip_network_address_type
-		{
-			INAT_INVALID = 0x00,
-			INAT_IPV4 = 0x01,
-			INAT_IPV4_GATEWAY = 0x02,
-			INAT_IPV6 = 0x03,
-			INAT_IPV6_GATEWAY = 0x04,
-			INAT_DNS_SERVER_IPV4 = 0x05,
-			INAT_DNS_SERVER_IPV6 = 0x06
-		};
-
-		template <typename AddressType>
-		ip_network_address_type get_address_type();
-
-		template <typename AddressType>
-		ip_network_address_type get_address_type(bool has_gateway);
-
-		template <>
-		ip_network_address_type get_address_type<boost::asio::ip::address_v4>()
-		{
-			return INAT_DNS_SERVER_IPV4;
-		}
-
-		template <>
-		ip_network_address_type get_address_type<boost::asio::ip::address_v6>()
-		{
-			return INAT_DNS_SERVER_IPV6;
-		}
-
-		template <>
-		ip_network_address_type get_address_type<boost::asio::ip::address_v4>(bool has_gateway)
-		{
-			return has_gateway ? INAT_IPV4_GATEWAY : INAT_IPV4;
-		}
-
-		template <>
-		ip_network_address_type get_address_type<boost::asio::ip::address_v6>(bool has_gateway)
-		{
-			return has_gateway ? INAT_IPV6_GATEWAY : INAT_IPV6;
-		}
-
-		/**
-		 * \brief A visitor that writes the representation of a network address to a buffer.
-		 */
-		template <typename BufferType>
-		class routes_helper : public boost::static_visitor<size_t>
-		{
-			public:
-
-				/**
-				 * \brief Create a new ip_network_address_representation.
-				 * \param buf The buffer to write the representation to.
-				 * \param buf_len The length of buf.
-				 */
-				routes_helper(BufferType buf, size_t buf_len) :
-					m_buf(buf),
-					m_buf_len(buf_len)
-				{}
-
-				/**
-				 * \brief Get the representation size of the network address.
-				 * \param ir The ip_route.
-				 * \return The representation size.
-				 */
-				template <typename AddressType>
-				result_type operator()(const asiotap::base_ip_route<AddressType>& ir) const
-				{
-					const auto ina = ir.network_address();
-					const auto _gateway = ir.gateway();
-					const uint8_t prefix_length = static_cast<uint8_t>(ina.prefix_length());
-					const auto bytes = ina.address().to_bytes();
-
-					size_t result_size = 2 + bytes.size();
-
-					if (m_buf_len < result_size)
-					{
-						throw std::runtime_error("buf_len");
-					}
-
-					fscp::buffer_tools::set<uint8_t>(m_buf, 0, static_cast<uint8_t>(get_address_type<AddressType>(static_cast<bool>(_gateway))));
-					fscp::buffer_tools::set<uint8_t>(m_buf, 1, static_cast<uint8_t>(prefix_length));
-
-					std::copy(bytes.begin(), bytes.end(), m_buf + 2);
-
-					if (_gateway)
-					{
-						const auto gateway_bytes = _gateway->to_bytes();
-						result_size += gateway_bytes.size();
-
-						if (m_buf_len < result_size)
-						{
-							throw std::runtime_error("buf_len");
-						}
-
-						std::copy(gateway_bytes.begin(), gateway_bytes.end(), m_buf + 2 + bytes.size());
-					}
-
-					return result_size;
-				}
-
-				/**
-				 * \brief Get the representation size of the DNS server address.
-				 * \param dns_server The IP address of the DNS server.
-				 * \return The representation size.
-				 */
-				result_type write_dns_server(const boost::asio::ip::address& dns_server) const
-				{
-					if (dns_server.is_v4()) {
-						return operator()(dns_server.to_v4());
-					} else {
-						return operator()(dns_server.to_v6());
-					}
-				}
-
-				/**
-				 * \brief Get the representation size of the DNS server address.
-				 * \param dns_server The IP address of the DNS server.
-				 * \return The representation size.
-				 */
-				template <typename AddressType>
-				result_type operator()(const AddressType& dns_server) const
-				{
-					const auto bytes = dns_server.to_bytes();
-
-					size_t result_size = 1 + bytes.size();
-
-					if (m_buf_len < result_size)
-					{
-						throw std::runtime_error("buf_len");
-					}
-
-					fscp::buffer_tools::set<uint8_t>(m_buf, 0, static_cast<uint8_t>(get_address_type<AddressType>()));
-
-					std::copy(bytes.begin(), bytes.end(), m_buf + 1);
-
-					return result_size;
-				}
-				
-				/**
-				 * \brief Read the next ip_route contained in the buffer.
-				 * \param has_gateway Whether the function must read a gateway or not.
-				 * \return The IP route.
-				 */
-				template <typename AddressType>
-				asiotap::base_ip_route<AddressType> read_next_ip_route(bool has_gateway)
-				{
-					if (m_buf_len == 0)
-					{
-						throw std::runtime_error("Not enough bytes for the expected prefix length");
-					}
-
-					const unsigned int prefix_length = static_cast<uint8_t>(*m_buf);
-
-					++m_buf;
-					--m_buf_len;
-
-					typename AddressType::bytes_type bytes;
-
-					if (m_buf_len < bytes.size())
-					{
-						throw std::runtime_error("Not enough bytes for the expected IP address");
-					}
-
-					std::copy(m_buf, m_buf + bytes.size(), bytes.begin());
-
-					m_buf += bytes.size();
-					m_buf_len -= bytes.size();
-
-					if (has_gateway)
-					{
-						typename AddressType::bytes_type gateway_bytes;
-
-						if (m_buf_len < gateway_bytes.size())
-						{
-							throw std::runtime_error("Not enough bytes for the expected IP address");
-						}
-
-						std::copy(m_buf, m_buf + gateway_bytes.size(), gateway_bytes.begin());
-
-						m_buf += gateway_bytes.size();
-						m_buf_len -= gateway_bytes.size();
-
-						return asiotap::base_ip_route<AddressType>(asiotap::base_ip_network_address<AddressType>(AddressType(bytes), prefix_length), AddressType(gateway_bytes));
-					}
-					else
-					{
-						return asiotap::base_ip_route<AddressType>(asiotap::base_ip_network_address<AddressType>(AddressType(bytes), prefix_length));
-					}
-				}
-
-				/**
-				 * \brief Read the next DNS server address contained in the buffer.
-				 * \return The DNS server address.
-				 */
-				template <typename AddressType>
-				AddressType read_next_dns_server()
-				{
-					typename AddressType::bytes_type bytes;
-
-					if (m_buf_len < bytes.size())
-					{
-						throw std::runtime_error("Not enough bytes for the expected IP address");
-					}
-
-					std::copy(m_buf, m_buf + bytes.size(), bytes.begin());
-
-					m_buf += bytes.size();
-					m_buf_len -= bytes.size();
-
-					return AddressType(bytes);
-				}
-
-				/**
-				 * \brief Read the next ip_route or dns server address contained in the buffer.
-				 * \param ir The route to read.
-				 * \param dns_server The DNS server address to read.
-				 * \return The type that was read.
-				 */
-				ip_network_address_type read_next(asiotap::ip_route& ir, asiotap::ip_address& dns_server)
-				{
-					if (m_buf_len == 0)
-					{
-						return INAT_INVALID;
-					}
-
-					const auto _type = *m_buf;
-					++m_buf;
-					--m_buf_len;
-
-					switch (_type)
-					{
-						case INAT_IPV4:
-						case INAT_IPV4_GATEWAY:
-						{
-							ir = read_next_ip_route<boost::asio::ip::address_v4>(_type == INAT_IPV4_GATEWAY);
-
-							break;
-						}
-						case INAT_IPV6:
-						case INAT_IPV6_GATEWAY:
-						{
-							ir = read_next_ip_route<boost::asio::ip::address_v6>(_type == INAT_IPV6_GATEWAY);
-
-							break;
-						}
-						case INAT_DNS_SERVER_IPV4:
-						{
-							dns_server = read_next_dns_server<boost::asio::ip::address_v4>();
-							break;
-						}
-						case INAT_DNS_SERVER_IPV6:
-						{
-							dns_server = read_next_dns_server<boost::asio::ip::address_v6>();
-							break;
-						}
-						default:
-						{
-							throw std::runtime_error("Unknown route type in message");
-						}
-					}
-
-					return static_cast<ip_network_address_type>(_type);
-				}
-
-			private:
-
-				BufferType m_buf;
-				size_t m_buf_len;
-		};
-	}
+	using namespace routes_encoding;
 
 	size_t routes_message::write(void* buf, size_t buf_len, version_type _version, const asiotap::ip_route_set& routes, const asiotap::ip_address_set& dns_servers)
 	{
@@ -365,6 +96,11 @@ namespace freelan
 		return ntohl(static_cast<version_type>(fscp::buffer_tools::get<uint32_t>(payload(), 0)));
 	}
 
+	routes_message::entry_range routes_message::entries() const
+	{
+		return entry_range(entry_iterator(payload() + sizeof(uint32_t), length() - sizeof(uint32_t)));
+	}
+
 	const asiotap::ip_route_set& routes_message::routes() const
 	{
 		read_and_cache_results();
@@ -380,56 +116,92 @@ namespace freelan
 	}
 
 	routes_message::routes_message(const void* buf, size_t buf_len) :
-		message(buf, buf_len)
+		message(buf, buf_len),
+		m_route_count(0),
+		m_dns_server_count(0)
 	{
-		routes();
+		check_format();
 	}
 
 	routes_message::routes_message(const message& _message) :
-		message(_message)
+		message(_message),
+		m_route_count(0),
+		m_dns_server_count(0)
 	{
-		routes();
+		check_format();
 	}
 
-	void routes_message::read_and_cache_results() const
+	void routes_message::entry_iterator::read_next()
 	{
-		if (!m_results)
+		if (m_buf_len == 0)
+		{
+			m_buf = NULL;
+
+			return;
+		}
+
+		routes_helper<const uint8_t*> deserializer(m_buf, m_buf_len);
+
+		switch (deserializer.read_next(m_entry.m_route, m_entry.m_dns_server))
 		{
-			routes_and_dns_servers result;
+			case INAT_IPV4:
+			case INAT_IPV4_GATEWAY:
+			case INAT_IPV6:
+			case INAT_IPV6_GATEWAY:
+			{
+				m_entry.m_is_route = true;
+				break;
+			}
+			default:
+			{
+				m_entry.m_is_route = false;
+				break;
+			}
+		}
 
-			const uint8_t* pbuf = payload() + sizeof(uint32_t);
-			size_t pbuf_len = length() - sizeof(uint32_t);
+		m_buf = deserializer.position();
+		m_buf_len = deserializer.remaining();
+	}
 
-			routes_helper<const uint8_t*> deserializer(pbuf, pbuf_len);
+	void routes_message::check_format()
+	{
+		if (length() < sizeof(uint32_t))
+		{
+			throw std::runtime_error("bad message length");
+		}
 
-			asiotap::ip_route ir;
-			asiotap::ip_address dns_server;
+		// Walking the entries validates them without allocating anything.
+		for (auto&& _entry : entries())
+		{
+			if (_entry.is_route())
+			{
+				++m_route_count;
+			}
+			else
+			{
+				++m_dns_server_count;
+			}
+		}
+	}
 
-			for (
-				ip_network_address_type _type = deserializer.read_next(ir, dns_server);
-				_type != INAT_INVALID;
-				_type = deserializer.read_next(ir, dns_server)
-			)
+	void routes_message::read_and_cache_results() const
+	{
+		if (!m_results)
+		{
+			m_results = routes_and_dns_servers();
+
+			// Entries are written in set order: hinting at the end makes each insertion constant time.
+			for (auto&& _entry : entries())
 			{
-				switch (_type) {
-					case INAT_IPV4:
-					case INAT_IPV4_GATEWAY:
-					case INAT_IPV6:
-					case INAT_IPV6_GATEWAY: {
-						result.routes.insert(ir);
-						break;
-					}
-					case INAT_DNS_SERVER_IPV4:
-					case INAT_DNS_SERVER_IPV6: {
-						result.dns_servers.insert(dns_server);
-						break;
-					}
-					default:
-						break;
+				if (_entry.is_route())
+				{
+					m_results->routes.insert(m_results->routes.end(), _entry.route());
+				}
+				else
+				{
+					m_results->dns_servers.insert(m_results->dns_servers.end(), _entry.dns_server());
 				}
 			}
-
-			m_results = result;
 		}
 	}
 }
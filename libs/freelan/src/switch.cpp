@@ -62,8 +62,6 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/make_shared.hpp>
 
-#include <asiotap/osi/ethernet_helper.hpp>
-
 namespace freelan
 {
 	namespace
@@ -115,10 +113,15 @@ namespace freelan
 	const unsigned int switch_::MAX_ENTRIES_DEFAULT = 1024;
 
 	void switch_::async_write(port_index_type index, boost::asio::const_buffer data, multi_write_handler_type handler)
+	{
+		async_write(index, data, asiotap::osi::parse_ethernet_packet_meta(data), handler);
+	}
+
+	void switch_::async_write(port_index_type index, boost::asio::const_buffer data, const asiotap::osi::packet_meta& meta, multi_write_handler_type handler)
 	{
 		typedef results_gatherer<port_index_type, boost::system::error_code, multi_write_handler_type> results_gatherer_type;
 
-		const auto targets = get_targets_for(index, data);
+		const auto targets = get_targets_for(index, meta);
 
 #if FREELAN_DEBUG
 		if (!targets.empty())
@@ -147,12 +150,12 @@ namespace freelan
 			}
 			else
 			{
-				m_ports[target].async_write(data, boost::bind(&results_gatherer_type::gather, rg, target, _1));
+				m_ports[target].async_write(data, meta, boost::bind(&results_gatherer_type::gather, rg, target, _1));
 			}
 		}
 	}
 
-	std::set<port_index_type> switch_::get_targets_for(port_index_type index, boost::asio::const_buffer data)
+	std::set<port_index_type> switch_::get_targets_for(port_index_type index, const asiotap::osi::packet_meta& meta)
 	{
 		const port_list_type::iterator source_port_entry = m_ports.find(index);
 
@@ -166,9 +169,13 @@ namespace freelan
 				}
 				case switch_configuration::RM_SWITCH:
 				{
-					asiotap::osi::const_helper<asiotap::osi::ethernet_frame> ethernet_helper(data);
+					// Frames too short to hold an ethernet header cannot be switched.
+					if (!meta.has_l2())
+					{
+						break;
+					}
 
-					const ethernet_address_type target_address = to_ethernet_address(ethernet_helper.target());
+					const ethernet_address_type& target_address = meta.ethernet_target;
 
 					if (is_multicast_address(target_address))
 					{
@@ -176,7 +183,7 @@ namespace freelan
 					}
 					else
 					{
-						m_ethernet_address_map[to_ethernet_address(ethernet_helper.sender())] = index;
+						m_ethernet_address_map[meta.ethernet_sender] = index;
 
 						// We exceeded the maximum count for entries: we delete random entries to fix it.
 						while (m_ethernet_address_map.size() > m_max_entries)
@@ -248,17 +255,6 @@ namespace freelan
 		return targets;
 	}
 
-	switch_::ethernet_address_type switch_::to_ethernet_address(boost::asio::const_buffer buf)
-	{
-		assert(boost::asio::buffer_size(buf) == ethernet_address_type::static_size);
-
-		ethernet_address_type result;
-
-		std::memcpy(result.c_array(), boost::asio::buffer_cast<const ethernet_address_type::value_type*>(buf), result.size());
-
-		return result;
-	}
-
 	bool switch_::is_multicast_address(const switch_::ethernet_address_type& address)
 	{
 		return ((address[0] & 0x01) != 0x00);
@@ -0,0 +1,132 @@
+/*
+ * libfscp - A C++ library to establish peer-to-peer virtual private networks.
+ * Copyright (C) 2010-2011 Julien Kauffmann <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfscp.
+ *
+ * libfscp is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfscp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfscp in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file certificate_cache.hpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief A cache of parsed certificates.
+ */
+
+#ifndef FSCP_CERTIFICATE_CACHE_HPP
+#define FSCP_CERTIFICATE_CACHE_HPP
+
+#include "constants.hpp"
+
+#include <cryptoplus/x509/certificate.hpp>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <map>
+#include <list>
+
+namespace fscp
+{
+	/**
+	 * \brief A bounded cache of parsed certificates, keyed by the hash of their DER representation.
+	 *
+	 * When the cache is full, the least recently used certificate is evicted.
+	 *
+	 * All the public methods are thread-safe.
+	 */
+	class certificate_cache : public boost::noncopyable
+	{
+		public:
+
+			/**
+			 * \brief The certificate type.
+			 */
+			typedef cryptoplus::x509::certificate cert_type;
+
+			/**
+			 * \brief The default capacity.
+			 */
+			static const size_t DEFAULT_CAPACITY = 256;
+
+			/**
+			 * \brief Create a certificate cache.
+			 * \param capacity The maximum count of certificates to keep. Must be non-zero.
+			 */
+			explicit certificate_cache(size_t capacity = DEFAULT_CAPACITY);
+
+			/**
+			 * \brief Get a certificate from its DER representation.
+			 * \param der The DER representation of the certificate.
+			 * \param der_len The length of der.
+			 * \param hash The hash of the DER representation, as returned by get_certificate_hash().
+			 * \return The certificate. It is parsed and cached only if it was not already in the cache.
+			 *
+			 * If der cannot be parsed, an exception is thrown and nothing is cached.
+			 */
+			cert_type get(const void* der, size_t der_len, const hash_type& hash);
+
+			/**
+			 * \brief Find a certificate from its hash.
+			 * \param hash The certificate hash.
+			 * \return The certificate, or a null certificate if it is not in the cache.
+			 */
+			cert_type find(const hash_type& hash);
+
+			/**
+			 * \brief Add a certificate to the cache.
+			 * \param cert The certificate. Cannot be null.
+			 * \param hash The certificate hash.
+			 */
+			void insert(cert_type cert, const hash_type& hash);
+
+			/**
+			 * \brief Get the count of cached certificates.
+			 * \return The count of cached certificates.
+			 */
+			size_t size() const;
+
+		private:
+
+			typedef std::list<hash_type> lru_list_type;
+			typedef std::map<hash_type, std::pair<cert_type, lru_list_type::iterator> > certificate_map_type;
+
+			void do_insert(cert_type cert, const hash_type& hash);
+
+			const size_t m_capacity;
+			mutable boost::mutex m_mutex;
+			certificate_map_type m_certificates;
+			lru_list_type m_lru_list;
+	};
+}
+
+#endif /* FSCP_CERTIFICATE_CACHE_HPP */
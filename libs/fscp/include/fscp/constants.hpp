@@ -224,6 +224,7 @@ namespace fscp
 		MESSAGE_TYPE_PRESENTATION = 0x02,
 		MESSAGE_TYPE_SESSION_REQUEST = 0x03,
 		MESSAGE_TYPE_SESSION = 0x04,
+		MESSAGE_TYPE_PRESENTATION_HASH = 0x05,
 		MESSAGE_TYPE_DATA_0 = 0x70,
 		MESSAGE_TYPE_DATA_1 = 0x71,
 		MESSAGE_TYPE_DATA_2 = 0x72,
@@ -560,11 +561,93 @@ namespace fscp
 	 */
 	const boost::posix_time::time_duration SESSION_TIMEOUT = SESSION_KEEP_ALIVE_PERIOD * 3;
 
+	/**
+	 * \brief The maximum random deviation applied to each keep-alive period, to avoid sending all the keep-alives at once.
+	 */
+	const boost::posix_time::time_duration SESSION_KEEP_ALIVE_JITTER = SESSION_KEEP_ALIVE_PERIOD / 5;
+
+	/**
+	 * \brief The resolution of the keep-alive and session timeout checks.
+	 */
+	const boost::posix_time::time_duration SESSION_KEEP_ALIVE_TICK = boost::posix_time::seconds(1);
+
+	/**
+	 * \brief The count of slots of the keep-alive timer wheel.
+	 */
+	const size_t SESSION_KEEP_ALIVE_WHEEL_SIZE = 64;
+
 	/**
 	 * \brief The keep-alive data size.
 	 */
 	const size_t SESSION_KEEP_ALIVE_DATA_SIZE = 32;
 
+	/**
+	 * \brief The smallest datagram size probed by the path MTU discovery.
+	 *
+	 * A host that does not acknowledge a probe of this size is considered as not supporting the path MTU discovery.
+	 */
+	const size_t PATH_MTU_MIN_DATAGRAM_SIZE = 1200;
+
+	/**
+	 * \brief The largest datagram size probed by the path MTU discovery over IPv4: an ethernet MTU minus the IPv4 and UDP headers.
+	 */
+	const size_t PATH_MTU_MAX_IPV4_DATAGRAM_SIZE = 1500 - 20 - 8;
+
+	/**
+	 * \brief The largest datagram size probed by the path MTU discovery over IPv6: an ethernet MTU minus the IPv6 and UDP headers.
+	 */
+	const size_t PATH_MTU_MAX_IPV6_DATAGRAM_SIZE = 1500 - 40 - 8;
+
+	/**
+	 * \brief The search stops when the discovered datagram size is known with this precision.
+	 */
+	const size_t PATH_MTU_SEARCH_PRECISION = 8;
+
+	/**
+	 * \brief The count of times a probe is sent before its size is considered too big for the path.
+	 */
+	const unsigned int PATH_MTU_PROBE_ATTEMPTS = 3;
+
+	/**
+	 * \brief The time to wait for a probe acknowledgement before sending the probe again.
+	 */
+	const boost::posix_time::time_duration PATH_MTU_PROBE_TIMEOUT = boost::posix_time::seconds(2);
+
+	/**
+	 * \brief The time after which a complete search is started again, to detect path changes.
+	 */
+	const boost::posix_time::time_duration PATH_MTU_SEARCH_PERIOD = boost::posix_time::minutes(10);
+
+	/**
+	 * \brief The default maximum age of a session before it gets renewed.
+	 */
+	const boost::posix_time::time_duration SESSION_RENEWAL_PERIOD = boost::posix_time::hours(1);
+
+	/**
+	 * \brief The default maximum count of bytes ciphered or deciphered with a session before it gets renewed.
+	 */
+	const uint64_t SESSION_RENEWAL_DATA_SIZE = static_cast<uint64_t>(1) << 36;
+
+	/**
+	 * \brief The time during which a replaced session can still decipher incoming messages.
+	 */
+	const boost::posix_time::time_duration SESSION_RENEWAL_GRACE_PERIOD = SESSION_KEEP_ALIVE_PERIOD;
+
+	/**
+	 * \brief The time to wait before retrying a session renewal that did not complete.
+	 */
+	const boost::posix_time::time_duration SESSION_RENEWAL_RETRY_PERIOD = SESSION_KEEP_ALIVE_PERIOD;
+
+	/**
+	 * \brief The number of seconds worth of unauthenticated messages a host can send at once.
+	 */
+	const size_t UNAUTHENTICATED_MESSAGES_BURST_FACTOR = 10;
+
+	/**
+	 * \brief The count of hosts behind a single address (a NAT, typically) that can exchange session messages at their full rate at the same time.
+	 */
+	const size_t SESSION_MESSAGES_HOSTS_PER_ADDRESS = 16;
+
 	/**
 	 * \brief Check if a message type is a DATA type message.
 	 * \param type The message type.
@@ -602,6 +685,14 @@ namespace fscp
 	 * \param cert The certificate.
 	 */
 	hash_type get_certificate_hash(cryptoplus::x509::certificate cert);
+
+	/**
+	 * \brief Gives a hash for a DER-encoded certificate.
+	 * \param der The DER representation of the certificate.
+	 * \param der_len The length of der.
+	 * \return The hash, which is the same as the one get_certificate_hash() returns for the parsed certificate.
+	 */
+	hash_type get_certificate_hash(const void* der, size_t der_len);
 }
 
 #endif /* FSCP_CONSTANTS_HPP */
@@ -112,13 +112,26 @@ namespace fscp
 			 */
 			static size_t write_contact(void* buf, size_t buf_len, sequence_number_type sequence_number, data_message::calg_t cipher_algorithm, const contact_map_type& contact_map, const void* enc_key, size_t enc_key_len, const void* nonce_prefix, size_t nonce_prefix_len);
 
+			/**
+			 * \brief The maximum length of the random content of a keep-alive message.
+			 */
+			static const size_t MAX_KEEP_ALIVE_RANDOM_LENGTH = 1024;
+
+			/**
+			 * \brief Get the buffer size required to write a message.
+			 * \param cleartext_len The length of the cleartext.
+			 * \param cipher_algorithm The cipher algorithm to use.
+			 * \return The minimum size of the buffer to give to the write functions.
+			 */
+			static size_t required_buffer_size(size_t cleartext_len, data_message::calg_t cipher_algorithm);
+
 			/**
 			 * \brief Write a keep-alive message to a buffer.
 			 * \param buf The buffer to write to.
 			 * \param buf_len The length of buf.
 			 * \param sequence_number The sequence number.
 			 * \param cipher_algorithm The cipher algorithm to use.
-			 * \param random_len The length of the random content to send.
+			 * \param random_len The length of the random content to send. Cannot exceed MAX_KEEP_ALIVE_RANDOM_LENGTH.
 			 * \param enc_key The encryption key.
 			 * \param enc_key_len The encryption key length.
 			 * \param nonce_prefix The nonce prefix.
@@ -127,6 +140,57 @@ namespace fscp
 			 */
 			static size_t write_keep_alive(void* buf, size_t buf_len, sequence_number_type sequence_number, data_message::calg_t cipher_algorithm, size_t random_len, const void* enc_key, size_t enc_key_len, const void* nonce_prefix, size_t nonce_prefix_len);
 
+			/**
+			 * \brief The path MTU probe types.
+			 *
+			 * Probes and their acknowledgements are keep-alive messages: hosts that do not know about them just ignore them.
+			 */
+			enum class path_mtu_probe_type : uint8_t
+			{
+				probe = 0x01, /**< A probe, padded to the datagram size it tests. */
+				acknowledgement = 0x02 /**< The acknowledgement of a probe that arrived intact. */
+			};
+
+			/**
+			 * \brief Get the size of the datagram that carries a data message.
+			 * \param cleartext_len The length of the cleartext.
+			 * \return The size of the UDP payload.
+			 */
+			static size_t datagram_size(size_t cleartext_len);
+
+			/**
+			 * \brief Get the largest cleartext that fits in a datagram.
+			 * \param datagram_size The size of the UDP payload.
+			 * \return The largest cleartext length, or 0 if datagram_size cannot even hold an empty data message.
+			 */
+			static size_t max_cleartext_size(size_t datagram_size);
+
+			/**
+			 * \brief Write a path MTU probe or probe acknowledgement to a buffer.
+			 * \param buf The buffer to write to.
+			 * \param buf_len The length of buf. Must be at least required_buffer_size(max_cleartext_size(probe_size)) for a probe.
+			 * \param sequence_number The sequence number.
+			 * \param cipher_algorithm The cipher algorithm to use.
+			 * \param type The probe type.
+			 * \param probe_size The datagram size tested by the probe. A probe is padded to exactly that size while an acknowledgement stays small.
+			 * \param enc_key The encryption key.
+			 * \param enc_key_len The encryption key length.
+			 * \param nonce_prefix The nonce prefix.
+			 * \param nonce_prefix_len The nonce prefix length.
+			 * \return The count of bytes written.
+			 */
+			static size_t write_path_mtu_probe(void* buf, size_t buf_len, sequence_number_type sequence_number, data_message::calg_t cipher_algorithm, path_mtu_probe_type type, size_t probe_size, const void* enc_key, size_t enc_key_len, const void* nonce_prefix, size_t nonce_prefix_len);
+
+			/**
+			 * \brief Parse the cleartext of a keep-alive message as a path MTU probe.
+			 * \param buf The cleartext.
+			 * \param buflen The length of the cleartext.
+			 * \param type The probe type, set on success.
+			 * \param probe_size The datagram size tested by the probe, set on success.
+			 * \return true if the keep-alive is a path MTU probe or probe acknowledgement. Regular keep-alives, whose content is random, give false.
+			 */
+			static bool parse_path_mtu_probe(const void* buf, size_t buflen, path_mtu_probe_type& type, size_t& probe_size);
+
 			/**
 			 * \brief Parse the hash list.
 			 * \param buf The buffer to parse.
@@ -230,6 +294,16 @@ namespace fscp
 			void check_format() const;
 	};
 
+	inline size_t data_message::datagram_size(size_t cleartext_len)
+	{
+		return HEADER_LENGTH + MIN_BODY_LENGTH + cleartext_len;
+	}
+
+	inline size_t data_message::max_cleartext_size(size_t _datagram_size)
+	{
+		return (_datagram_size > HEADER_LENGTH + MIN_BODY_LENGTH) ? (_datagram_size - HEADER_LENGTH - MIN_BODY_LENGTH) : 0;
+	}
+
 	inline sequence_number_type data_message::sequence_number() const
 	{
 		return ntohl(buffer_tools::get<sequence_number_type>(payload(), 0));
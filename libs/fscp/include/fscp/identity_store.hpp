@@ -45,6 +45,8 @@
 #ifndef FSCP_IDENTITY_STORE_HPP
 #define FSCP_IDENTITY_STORE_HPP
 
+#include "constants.hpp"
+
 #include <cryptoplus/x509/certificate.hpp>
 #include <cryptoplus/pkey/pkey.hpp>
 
@@ -84,6 +86,15 @@ namespace fscp
 				return m_sig_cert;
 			}
 
+			/**
+			 * \brief Get the signature certificate hash.
+			 * \return The signature certificate hash, if there is a signature certificate.
+			 */
+			const boost::optional<hash_type>& signature_certificate_hash() const
+			{
+				return m_sig_hash;
+			}
+
 			/**
 			 * \brief Get the signature key.
 			 * \return The signature key.
@@ -105,6 +116,7 @@ namespace fscp
 		private:
 
 			cert_type m_sig_cert;
+			boost::optional<hash_type> m_sig_hash;
 			key_type m_sig_key;
 			cryptoplus::buffer m_pre_shared_key;
 	};
@@ -0,0 +1,129 @@
+/*
+ * libfscp - A C++ library to establish peer-to-peer virtual private networks.
+ * Copyright (C) 2010-2011 Julien Kauffmann <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfscp.
+ *
+ * libfscp is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfscp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfscp in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file path_mtu_discovery.hpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief The path MTU discovery state of a peer.
+ */
+
+#ifndef FSCP_PATH_MTU_DISCOVERY_HPP
+#define FSCP_PATH_MTU_DISCOVERY_HPP
+
+#include "coarse_clock.hpp"
+
+#include <boost/optional.hpp>
+
+#include <cstddef>
+
+namespace fscp
+{
+	/**
+	 * \brief The path MTU discovery state of a peer.
+	 *
+	 * This implements a packetization layer path MTU discovery (RFC 4821): the largest datagram size that reaches the peer is searched for by sending padded probes and waiting for their acknowledgements, without relying on ICMP messages.
+	 *
+	 * The search starts with the minimum size, then the maximum size and then goes on with a binary search between the two. A size is considered too big once PATH_MTU_PROBE_ATTEMPTS probes of that size were lost. When the search completes, it is started again after PATH_MTU_SEARCH_PERIOD, beginning with a probe of the discovered size so that a path that shrank is detected too.
+	 *
+	 * The class only keeps the state: sending the probes is up to the caller. It is not thread-safe.
+	 */
+	class path_mtu_discovery
+	{
+		public:
+
+			/**
+			 * \brief Create a stopped path MTU discovery.
+			 */
+			path_mtu_discovery();
+
+			/**
+			 * \brief Start a new search, forgetting any previous result.
+			 * \param min_size The smallest datagram size to probe. A peer that does not acknowledge it is never given a result.
+			 * \param max_size The largest datagram size to probe.
+			 */
+			void start(size_t min_size, size_t max_size);
+
+			/**
+			 * \brief Stop the search and forget any previous result.
+			 */
+			void stop();
+
+			/**
+			 * \brief Check whether the search was started.
+			 * \return true if the search was started.
+			 */
+			bool is_started() const { return (m_max_size != 0); }
+
+			/**
+			 * \brief Get the largest datagram size known to reach the peer.
+			 * \return The discovered size, or 0 if none was acknowledged yet.
+			 */
+			size_t max_datagram_size() const { return m_confirmed_size; }
+
+			/**
+			 * \brief Get the size of the probe to send now, if any.
+			 * \param now The current time.
+			 * \return The datagram size of the probe to send. If a value is returned, the caller is expected to send the probe.
+			 *
+			 * This should be called regularly, and right after probe_acknowledged() to keep the search going. It also accounts for lost probes: the discovered size may decrease after a call.
+			 */
+			boost::optional<size_t> next_probe(const coarse_clock::time_point& now);
+
+			/**
+			 * \brief Account for a probe acknowledgement.
+			 * \param size The datagram size of the acknowledged probe.
+			 * \return true if the discovered size changed.
+			 */
+			bool probe_acknowledged(size_t size);
+
+		private:
+
+			boost::optional<size_t> send_probe(size_t size, const coarse_clock::time_point& now);
+
+			size_t m_min_size;
+			size_t m_max_size;
+			size_t m_confirmed_size;
+			size_t m_upper_bound;
+			size_t m_probe_size;
+			unsigned int m_probe_attempts;
+			coarse_clock::time_point m_probe_date;
+			coarse_clock::time_point m_next_search_date;
+	};
+}
+
+#endif /* FSCP_PATH_MTU_DISCOVERY_HPP */
@@ -46,6 +46,8 @@
 #define FSCP_PEER_SESSION_HPP
 
 #include "constants.hpp"
+#include "coarse_clock.hpp"
+#include "path_mtu_discovery.hpp"
 
 #include <cryptoplus/buffer.hpp>
 #include <cryptoplus/random/random.hpp>
@@ -95,14 +97,24 @@ namespace fscp
 				explicit current_session_type(const session_parameters& _parameters) :
 					parameters(_parameters),
 					local_sequence_number(),
-					remote_sequence_number()
+					remote_sequence_number(),
+					creation_date(coarse_clock::now()),
+					data_size()
 				{}
 
-				bool is_old() const;
+				/**
+				 * \brief Check if the session should be renewed.
+				 * \param max_age The maximum age of the session.
+				 * \param max_data_size The maximum count of bytes that can be ciphered or deciphered with the session keys.
+				 * \return true if any of the sequence numbers reached half its range or if one of the specified thresholds was reached.
+				 */
+				bool is_old(const boost::posix_time::time_duration& max_age, uint64_t max_data_size) const;
 
 				session_parameters parameters;
 				sequence_number_type local_sequence_number;
 				sequence_number_type remote_sequence_number;
+				coarse_clock::time_point creation_date;
+				uint64_t data_size;
 				cryptoplus::buffer local_session_key;
 				cryptoplus::buffer remote_session_key;
 				cryptoplus::buffer local_nonce_prefix;
@@ -112,7 +124,11 @@ namespace fscp
 			peer_session() :
 				m_local_host_identifier(),
 				m_remote_host_identifier(),
-				m_last_sign_of_life(boost::posix_time::microsec_clock::local_time())
+				m_last_sign_of_life(coarse_clock::now()),
+				m_last_data_sent(boost::posix_time::not_a_date_time),
+				m_previous_session_expiration(),
+				m_renewal_date(boost::posix_time::not_a_date_time),
+				m_path_mtu_discovery()
 			{
 				// Generate a random host identifier.
 				cryptoplus::random::get_random_bytes(m_local_host_identifier.data.data(), m_local_host_identifier.data.size());
@@ -149,7 +165,7 @@ namespace fscp
 			 */
 			bool has_timed_out(const boost::posix_time::time_duration& timeout) const
 			{
-				return (boost::posix_time::microsec_clock::local_time() > m_last_sign_of_life + timeout);
+				return (coarse_clock::now() > m_last_sign_of_life + timeout);
 			}
 
 			/**
@@ -157,9 +173,29 @@ namespace fscp
 			 */
 			void keep_alive()
 			{
-				m_last_sign_of_life = boost::posix_time::microsec_clock::local_time();
+				m_last_sign_of_life = coarse_clock::now();
 			}
 
+			/**
+			 * \brief Get the last time the session was kept alive.
+			 * \return The last time the session was kept alive.
+			 */
+			const coarse_clock::time_point& last_sign_of_life() const { return m_last_sign_of_life; }
+
+			/**
+			 * \brief Mark that a message was just sent to the remote host.
+			 */
+			void data_sent()
+			{
+				m_last_data_sent = coarse_clock::now();
+			}
+
+			/**
+			 * \brief Get the last time a message was sent to the remote host.
+			 * \return The last time a message was sent to the remote host. If no message was ever sent, the value is not_a_date_time.
+			 */
+			const coarse_clock::time_point& last_data_sent() const { return m_last_data_sent; }
+
 			/**
 			 * \brief Prepare the next session.
 			 * \param _session_number The next session number.
@@ -169,13 +205,27 @@ namespace fscp
 			 */
 			bool prepare_session(session_number_type _session_number, cipher_suite_type _cipher_suite, elliptic_curve_type _elliptic_curve);
 
+			/**
+			 * \brief Set the next session from an already prepared one.
+			 * \param next_session The next session, usually prepared outside of the session strand.
+			 * \return true if the next session was replaced. If a session with the same parameters is already in preparation, it is kept so that the private DH key stays the same.
+			 */
+			bool set_next_session(boost::shared_ptr<next_session_type> next_session);
+
+			/**
+			 * \brief Check if a session is in preparation.
+			 * \return true if a session is in preparation.
+			 */
+			bool has_next_session() const { return static_cast<bool>(m_next_session); }
+
 			/**
 			 * \brief Complete the next session.
 			 * \param remote_public_key The remote public key.
 			 * \param remote_public_key_size The remote public key size.
+			 * \param grace_period The time during which the replaced session, if any, can still be used to decipher incoming messages.
 			 * \return true if the session was completed.
 			 */
-			bool complete_session(const void* remote_public_key, size_t remote_public_key_size);
+			bool complete_session(const void* remote_public_key, size_t remote_public_key_size, const boost::posix_time::time_duration& grace_period = SESSION_RENEWAL_GRACE_PERIOD);
 
 			/**
 			 * \brief Get the next session number.
@@ -213,6 +263,12 @@ namespace fscp
 			 */
 			sequence_number_type increment_local_sequence_number() { return ++m_current_session->local_sequence_number; }
 
+			/**
+			 * \brief Account for data ciphered or deciphered with the current session keys.
+			 * \param size The count of bytes.
+			 */
+			void increment_data_size(size_t size) { m_current_session->data_size += size; }
+
 			/**
 			 * \brief Set the remote sequence number.
 			 * \param sequence_number The remote sequence number.
@@ -220,6 +276,50 @@ namespace fscp
 			 */
 			bool set_remote_sequence_number(sequence_number_type sequence_number);
 
+			/**
+			 * \brief Check if a previous session is still usable to decipher incoming messages.
+			 * \return true if a previous session exists and its grace period is not over yet.
+			 */
+			bool has_previous_session() const;
+
+			/**
+			 * \brief Get the previous session.
+			 * \return The previous session. If there is no previous session, the behavior is undefined.
+			 */
+			const current_session_type& previous_session() const { return *m_previous_session; }
+
+			/**
+			 * \brief Set the remote sequence number of the previous session.
+			 * \param sequence_number The remote sequence number.
+			 * \return true if the sequence number was incremented with the new value, false is the current sequence number is greater than sequence_number.
+			 */
+			bool set_previous_remote_sequence_number(sequence_number_type sequence_number);
+
+			/**
+			 * \brief Check if the current session must be renewed.
+			 * \param max_age The maximum age of the session.
+			 * \param max_data_size The maximum count of bytes that can be ciphered or deciphered with the session keys.
+			 * \return true if the current session is old and no renewal was started recently.
+			 */
+			bool must_renew(const boost::posix_time::time_duration& max_age, uint64_t max_data_size) const;
+
+			/**
+			 * \brief Mark the start of a session renewal.
+			 */
+			void start_renewal() { m_renewal_date = coarse_clock::now(); }
+
+			/**
+			 * \brief Get the path MTU discovery state.
+			 * \return The path MTU discovery state.
+			 */
+			path_mtu_discovery& path_mtu() { return m_path_mtu_discovery; }
+
+			/**
+			 * \brief Get the path MTU discovery state.
+			 * \return The path MTU discovery state.
+			 */
+			const path_mtu_discovery& path_mtu() const { return m_path_mtu_discovery; }
+
 			/**
 			 * \brief Clear the current session.
 			 * \return True if the session was cleared. False is there was no active session.
@@ -231,10 +331,16 @@ namespace fscp
 			host_identifier_type m_local_host_identifier;
 			boost::optional<host_identifier_type> m_remote_host_identifier;
 
-			boost::posix_time::ptime m_last_sign_of_life;
+			coarse_clock::time_point m_last_sign_of_life;
+			coarse_clock::time_point m_last_data_sent;
 
 			boost::shared_ptr<next_session_type> m_next_session;
 			boost::shared_ptr<current_session_type> m_current_session;
+			boost::shared_ptr<current_session_type> m_previous_session;
+			coarse_clock::time_point m_previous_session_expiration;
+			coarse_clock::time_point m_renewal_date;
+
+			path_mtu_discovery m_path_mtu_discovery;
 	};
 }
 
@@ -53,6 +53,8 @@ namespace fscp
 {
 	/**
 	 * \brief A presentation message class.
+	 *
+	 * A presentation message either carries the full signature certificate (MESSAGE_TYPE_PRESENTATION) or only its hash (MESSAGE_TYPE_PRESENTATION_HASH), for hosts that already know it.
 	 */
 	class presentation_message : public message
 	{
@@ -72,6 +74,15 @@ namespace fscp
 			 */
 			static size_t write(void* buf, size_t buf_len, cert_type sig_cert);
 
+			/**
+			 * \brief Write a short presentation message to a buffer.
+			 * \param buf The buffer to write to.
+			 * \param buf_len The length of buf.
+			 * \param sig_cert_hash The hash of the signature certificate.
+			 * \return The count of bytes written.
+			 */
+			static size_t write_hash(void* buf, size_t buf_len, const hash_type& sig_cert_hash);
+
 			/**
 			 * \brief Create a presentation_message and map it on a buffer.
 			 * \param buf The buffer.
@@ -87,13 +98,40 @@ namespace fscp
 			 */
 			presentation_message(const message& message);
 
+			/**
+			 * \brief Check if the message only carries the hash of the signature certificate.
+			 * \return true if the message only carries the hash of the signature certificate.
+			 */
+			bool is_hash_only() const
+			{
+				return (type() == MESSAGE_TYPE_PRESENTATION_HASH);
+			}
+
 			/**
 			 * \brief Get the signature certificate.
-			 * \return The signature certificate.
+			 * \return The signature certificate. If is_hash_only() is true, a null certificate is returned.
 			 * \warning The returned certificate is parsed from the underlying buffer on every call so storing the result might be a good idea.
 			 */
 			cert_type signature_certificate() const;
 
+			/**
+			 * \brief Get the DER representation of the signature certificate.
+			 * \return The DER representation of the signature certificate. If is_hash_only() is true or if there is no certificate, the returned pointer is null.
+			 */
+			const uint8_t* signature_certificate_der() const;
+
+			/**
+			 * \brief Get the size of the DER representation of the signature certificate.
+			 * \return The size of the DER representation of the signature certificate.
+			 */
+			size_t signature_certificate_der_size() const;
+
+			/**
+			 * \brief Get the hash of the signature certificate.
+			 * \return The hash of the signature certificate, if there is one. For full presentation messages, the hash is computed on every call.
+			 */
+			boost::optional<hash_type> signature_certificate_hash() const;
+
 		protected:
 
 			/**
@@ -78,6 +78,14 @@ namespace fscp
 			 */
 			explicit presentation_store(cert_type sig_cert, const cryptoplus::buffer& pre_shared_key);
 
+			/**
+			 * \brief Create a new presentation store from an already hashed certificate.
+			 * \param sig_cert The signature certificate.
+			 * \param sig_hash The signature certificate hash. Must match sig_cert.
+			 * \param pre_shared_key The pre-shared key.
+			 */
+			presentation_store(cert_type sig_cert, const boost::optional<hash_type>& sig_hash, const cryptoplus::buffer& pre_shared_key);
+
 			/**
 			 * \brief Check if the presentation store is empty.
 			 * \return true if the presentation store is empty.
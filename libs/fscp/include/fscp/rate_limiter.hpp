@@ -0,0 +1,167 @@
+/*
+ * libfscp - A C++ library to establish peer-to-peer virtual private networks.
+ * Copyright (C) 2010-2011 Julien Kauffmann <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfscp.
+ *
+ * libfscp is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfscp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfscp in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file rate_limiter.hpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief A fixed-memory rate limiter for unauthenticated messages.
+ */
+
+#ifndef FSCP_RATE_LIMITER_HPP
+#define FSCP_RATE_LIMITER_HPP
+
+#include "constants.hpp"
+#include "coarse_clock.hpp"
+
+#include <boost/asio.hpp>
+#include <boost/array.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <vector>
+#include <map>
+
+#include <stdint.h>
+
+namespace fscp
+{
+	/**
+	 * \brief A token-bucket rate limiter keyed by source address prefix and message type.
+	 *
+	 * The buckets are stored in a fixed number of hashed rows, just like a count-min sketch: a message is accepted if any of the buckets it maps to still holds a token. Colliding sources may thus share some budget but a single flooding source cannot starve another one unless it collides with it on every row.
+	 *
+	 * All the public methods are thread-safe.
+	 */
+	class rate_limiter
+	{
+		public:
+
+			/**
+			 * \brief The statistics type: the count of rejected messages, per message type.
+			 */
+			typedef std::map<message_type, uint64_t> statistics_type;
+
+			/**
+			 * \brief The default number of buckets per row.
+			 */
+			static const size_t DEFAULT_WIDTH = 4096;
+
+			/**
+			 * \brief The number of rows.
+			 */
+			static const size_t DEPTH = 2;
+
+			/**
+			 * \brief Create a new rate limiter.
+			 * \param width The number of buckets per row. Must be a power of two.
+			 * \param ipv4_prefix_length The IPv4 prefix length to key the buckets with.
+			 * \param ipv6_prefix_length The IPv6 prefix length to key the buckets with.
+			 */
+			explicit rate_limiter(size_t width = DEFAULT_WIDTH, unsigned int ipv4_prefix_length = 32, unsigned int ipv6_prefix_length = 64);
+
+			/**
+			 * \brief Set the rate for a given message type.
+			 * \param type The message type.
+			 * \param per_second The count of messages allowed per second, per source. A value of 0 disables the limit for this message type.
+			 * \param burst The maximum count of messages that can be accepted at once, per source.
+			 */
+			void set_rate(message_type type, double per_second, double burst);
+
+			/**
+			 * \brief Try to take a token for a message.
+			 * \param source The source address.
+			 * \param type The message type.
+			 * \return true if the message should be handled, false if it must be dropped.
+			 */
+			bool consume(const boost::asio::ip::address& source, message_type type);
+
+			/**
+			 * \brief Try to take a token for a message, keyed by the full source endpoint.
+			 * \param source The source endpoint. Hosts behind a single address but on different ports get different buckets.
+			 * \param type The message type.
+			 * \return true if the message should be handled, false if it must be dropped.
+			 */
+			bool consume(const boost::asio::ip::udp::endpoint& source, message_type type);
+
+			/**
+			 * \brief Get the rejection statistics.
+			 * \return The count of rejected messages, for each message type that was rejected at least once.
+			 */
+			statistics_type get_statistics() const;
+
+		private:
+
+			struct rate_type
+			{
+				rate_type() :
+					per_second(),
+					burst()
+				{}
+
+				double per_second;
+				double burst;
+			};
+
+			struct bucket_type
+			{
+				bucket_type() :
+					tokens(),
+					last_update(boost::posix_time::not_a_date_time)
+				{}
+
+				double tokens;
+				coarse_clock::time_point last_update;
+			};
+
+			uint64_t get_key(const boost::asio::ip::address& source, message_type type) const;
+			uint64_t get_key(const boost::asio::ip::udp::endpoint& source, message_type type) const;
+			bool consume_key(uint64_t key, message_type type);
+			size_t get_index(size_t row, uint64_t key) const;
+			static void refill(bucket_type& bucket, const rate_type& rate, const coarse_clock::time_point& now);
+
+			const size_t m_width;
+			const unsigned int m_ipv4_prefix_length;
+			const unsigned int m_ipv6_prefix_length;
+			boost::array<uint64_t, DEPTH> m_seeds;
+			mutable boost::mutex m_mutex;
+			boost::array<rate_type, 256> m_rates;
+			boost::array<uint64_t, 256> m_rejected;
+			std::vector<bucket_type> m_buckets;
+	};
+}
+
+#endif /* FSCP_RATE_LIMITER_HPP */
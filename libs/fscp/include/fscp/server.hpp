@@ -51,6 +51,10 @@
 #include "shared_buffer.hpp"
 #include "presentation_store.hpp"
 #include "peer_session.hpp"
+#include "data_message.hpp"
+#include "certificate_cache.hpp"
+#include "rate_limiter.hpp"
+#include "timer_wheel.hpp"
 #include "logger.hpp"
 
 #ifdef USE_UPNP
@@ -60,10 +64,12 @@
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
 #include <boost/optional.hpp>
+#include <boost/random/mersenne_twister.hpp>
 
 #include <set>
 #include <map>
 #include <queue>
+#include <vector>
 #include <iostream>
 
 #include <stdint.h>
@@ -237,6 +243,13 @@ namespace fscp
 			 */
 			typedef boost::function<void (const ep_type& host, session_loss_reason)> session_lost_handler_type;
 
+			/**
+			 * \brief A handler for when the path MTU to a host changed.
+			 * \param host The host.
+			 * \param max_datagram_size The largest UDP payload known to reach host, or 0 if it is unknown again.
+			 */
+			typedef boost::function<void (const ep_type& host, size_t max_datagram_size)> path_mtu_changed_handler_type;
+
 			/**
 			 * \brief A handler for when data is available.
 			 * \param sender The endpoint that sent the data message.
@@ -427,11 +440,13 @@ namespace fscp
 
 			/**
 			 * \brief Set maximum hello message from one host per second.
-			 * \param max_per_second value to set.
+			 * \param max_per_second value to set. A value of 0 disables the limit.
+			 *
+			 * A host may send up to UNAUTHENTICATED_MESSAGES_BURST_FACTOR times this value at once, after which it is limited to the specified rate.
 			 */
 			void set_hello_max_per_second(size_t max_per_second)
 			{
-				m_hello_max_per_second = max_per_second;
+				m_unauthenticated_messages_limiter.set_rate(MESSAGE_TYPE_HELLO_REQUEST, static_cast<double>(max_per_second), static_cast<double>(max_per_second * UNAUTHENTICATED_MESSAGES_BURST_FACTOR));
 			}
 
 			/**
@@ -568,11 +583,58 @@ namespace fscp
 
 			/**
 			 * \brief Set maximum presentation message from one host per second.
-			 * \param max_per_second value to set.
+			 * \param max_per_second value to set. A value of 0 disables the limit.
+			 *
+			 * A host may send up to UNAUTHENTICATED_MESSAGES_BURST_FACTOR times this value at once, after which it is limited to the specified rate.
 			 */
 			void set_presentation_max_per_second(size_t max_per_second)
 			{
-				m_presentation_max_per_second = max_per_second;
+				m_unauthenticated_messages_limiter.set_rate(MESSAGE_TYPE_PRESENTATION, static_cast<double>(max_per_second), static_cast<double>(max_per_second * UNAUTHENTICATED_MESSAGES_BURST_FACTOR));
+				m_unauthenticated_messages_limiter.set_rate(MESSAGE_TYPE_PRESENTATION_HASH, static_cast<double>(max_per_second), static_cast<double>(max_per_second * UNAUTHENTICATED_MESSAGES_BURST_FACTOR));
+			}
+
+			/**
+			 * \brief Set whether to send hash-only presentations to the hosts that already know our certificate.
+			 * \param value If true, introducing ourselves to a host we have a session with only sends the hash of our signature certificate. The default is false.
+			 * \warning This method is *NOT* thread-safe and should be called only before the server is started.
+			 *
+			 * Hosts that do not support hash-only presentations simply ignore them.
+			 */
+			void set_hash_only_presentation(bool value)
+			{
+				m_hash_only_presentation = value;
+			}
+
+			/**
+			 * \brief Set maximum session request and session message from one host per second.
+			 * \param max_per_second value to set. A value of 0 disables the limit.
+			 *
+			 * A host may send up to UNAUTHENTICATED_MESSAGES_BURST_FACTOR times this value at once, after which it is limited to the specified rate.
+			 *
+			 * Unlike the other messages, session messages are limited per endpoint: several hosts behind one address each get this rate. The address as a whole is limited to SESSION_MESSAGES_HOSTS_PER_ADDRESS times this rate, so that changing the source port does not lift the limit.
+			 */
+			void set_session_max_per_second(size_t max_per_second)
+			{
+				m_unauthenticated_messages_limiter.set_rate(MESSAGE_TYPE_SESSION_REQUEST, static_cast<double>(max_per_second), static_cast<double>(max_per_second * UNAUTHENTICATED_MESSAGES_BURST_FACTOR));
+				m_unauthenticated_messages_limiter.set_rate(MESSAGE_TYPE_SESSION, static_cast<double>(max_per_second), static_cast<double>(max_per_second * UNAUTHENTICATED_MESSAGES_BURST_FACTOR));
+				m_session_messages_address_limiter.set_rate(MESSAGE_TYPE_SESSION_REQUEST, static_cast<double>(max_per_second * SESSION_MESSAGES_HOSTS_PER_ADDRESS), static_cast<double>(max_per_second * UNAUTHENTICATED_MESSAGES_BURST_FACTOR * SESSION_MESSAGES_HOSTS_PER_ADDRESS));
+				m_session_messages_address_limiter.set_rate(MESSAGE_TYPE_SESSION, static_cast<double>(max_per_second * SESSION_MESSAGES_HOSTS_PER_ADDRESS), static_cast<double>(max_per_second * UNAUTHENTICATED_MESSAGES_BURST_FACTOR * SESSION_MESSAGES_HOSTS_PER_ADDRESS));
+			}
+
+			/**
+			 * \brief Get the count of unauthenticated messages that were dropped because their sender exceeded its rate.
+			 * \return The count of dropped messages, per message type.
+			 */
+			rate_limiter::statistics_type get_unauthenticated_messages_statistics() const
+			{
+				rate_limiter::statistics_type result = m_unauthenticated_messages_limiter.get_statistics();
+
+				for (auto&& item : m_session_messages_address_limiter.get_statistics())
+				{
+					result[item.first] += item.second;
+				}
+
+				return result;
 			}
 
 			/**
@@ -937,6 +999,64 @@ namespace fscp
 			 */
 			void sync_set_session_lost_callback(session_lost_handler_type callback);
 
+			/**
+			 * \brief Set the path MTU changed callback.
+			 * \param callback The callback.
+			 * \warning This method is *NOT* thread-safe and should be called only before the server is started.
+			 */
+			void set_path_mtu_changed_callback(path_mtu_changed_handler_type callback)
+			{
+				m_path_mtu_changed_handler = callback;
+			}
+
+			/**
+			 * \brief Set the path MTU changed callback.
+			 * \param callback The callback.
+			 * \param handler The handler to call when the change was made effective.
+			 */
+			void async_set_path_mtu_changed_callback(path_mtu_changed_handler_type callback, void_handler_type handler = void_handler_type())
+			{
+				m_session_strand.post(boost::bind(&server::do_set_path_mtu_changed_callback, this, callback, handler));
+			}
+
+			/**
+			 * \brief Set the path MTU changed callback.
+			 * \param callback The callback.
+			 * \warning If the io_service is not being run, the call will block undefinitely.
+			 * \warning This function must **NEVER** be called from inside a thread that runs one of the server's handlers.
+			 */
+			void sync_set_path_mtu_changed_callback(path_mtu_changed_handler_type callback);
+
+			/**
+			 * \brief Enable or disable the path MTU discovery.
+			 * \param enabled If true, the largest datagram size that reaches each host is probed for once its session is established. Hosts always answer the probes of others, whatever this setting.
+			 * \warning This method is *NOT* thread-safe and should be called only before the server is started.
+			 */
+			void set_path_mtu_discovery_enabled(bool enabled)
+			{
+				m_path_mtu_discovery_enabled = enabled;
+			}
+
+			/**
+			 * \brief Set the maximum age of a session before it gets renewed.
+			 * \param period The maximum age.
+			 * \warning This method is *NOT* thread-safe and should be called only before the server is started.
+			 */
+			void set_session_renewal_period(const boost::posix_time::time_duration& period)
+			{
+				m_session_renewal_period = period;
+			}
+
+			/**
+			 * \brief Set the maximum count of bytes ciphered or deciphered with a session before it gets renewed.
+			 * \param data_size The maximum count of bytes.
+			 * \warning This method is *NOT* thread-safe and should be called only before the server is started.
+			 */
+			void set_session_renewal_data_size(uint64_t data_size)
+			{
+				m_session_renewal_data_size = data_size;
+			}
+
 			/**
 			 * \brief Send data to a host.
 			 * \param target The target host.
@@ -1300,20 +1420,36 @@ namespace fscp
 			void handle_receive_from(const identity_store&, boost::shared_ptr<ep_type>, SharedBuffer, const boost::system::error_code&, size_t);
 
 			ep_type to_socket_format(const ep_type& ep);
+			bool check_unauthenticated_message_rate(const ep_type&, message_type);
 
 			void async_send_to(const SharedBuffer& data, const size_t size, const ep_type& target, simple_handler_type handler)
 			{
 				const void_handler_type write_handler = [this, data, size, target, handler] () {
-					m_socket.async_send_to(buffer(data, size), to_socket_format(target), 0, [data, handler] (const boost::system::error_code& ec, size_t) {
+					m_socket.async_send_to(buffer(data, size), to_socket_format(target), 0, [this, data, handler] (const boost::system::error_code& ec, size_t) {
+						m_write_queue_strand.post(boost::bind(&server::write_done, this));
+
 						handler(ec);
 					});
 				};
 
-				m_write_queue_strand.post(boost::bind(&server::push_write, this, write_handler));
+				m_write_queue_strand.post(boost::bind(&server::push_write, this, write_handler, false));
 			}
 
-			void push_write(void_handler_type);
+			/**
+			 * \brief A queued write.
+			 *
+			 * An exclusive write is a synchronous one that only starts once all the previous writes have completed.
+			 */
+			struct write_type
+			{
+				void_handler_type handler;
+				bool exclusive;
+			};
+
+			void push_write(void_handler_type, bool);
+			void start_write();
 			void pop_write();
+			void write_done();
 
 			socket_type m_socket;
 #if BOOST_ASIO_VERSION >= 101200 // Boost 1.66+
@@ -1323,9 +1459,16 @@ namespace fscp
 			boost::asio::strand m_socket_strand;
 			boost::asio::strand m_write_queue_strand;
 #endif
-			std::queue<void_handler_type> m_write_queue;
+			std::queue<write_type> m_write_queue;
+			// The count of writes that were started but did not complete yet. It can be transiently negative when a write completes before it is popped.
+			int m_writes_in_flight;
 			std::list<SharedBuffer> m_socket_buffers;
 
+			// Shared by all unauthenticated message types: it has its own lock.
+			rate_limiter m_unauthenticated_messages_limiter;
+			// Session messages are limited per endpoint by the limiter above, and per address by this one.
+			rate_limiter m_session_messages_address_limiter;
+
 		private: // HELLO messages
 
 			/**
@@ -1426,12 +1569,6 @@ namespace fscp
 			void do_set_accept_hello_messages_default(bool, void_handler_type);
 			void do_set_hello_message_received_callback(hello_message_received_handler_type, void_handler_type);
 
-			/**
-			 * \brief Reset hello limit.
-			 * \param ec error code.
-			 */
-			void do_hello_reset_limit(const boost::system::error_code& ec);
-
 			ep_hello_context_map m_ep_hello_contexts;
 #if BOOST_ASIO_VERSION >= 101200 // Boost 1.66+
 			boost::asio::io_context::strand m_greet_strand;
@@ -1441,42 +1578,21 @@ namespace fscp
 			bool m_accept_hello_messages_default;
 			hello_message_received_handler_type m_hello_message_received_handler;
 
-			/**
-			 * \brief Current number of session request sent per endpoint.
-			 */
-			std::map<ep_type, size_t> m_hello_requests_map;
-
-			/**
-			 * \brief Timer for reesting hello requests limit.
-			 */
-			boost::asio::deadline_timer m_hello_limit_timer;
-
-			/**
-			 * \brief Maximum hello message from one host per second.
-			 */
-			size_t m_hello_max_per_second;
-
 		private: // PRESENTATION messages
 
 			typedef std::map<ep_type, presentation_store> presentation_store_map;
 
 			bool has_presentation_store_for(const ep_type&) const;
-			void do_introduce_to(const ep_type&, simple_handler_type);
+			void do_introduce_to(const ep_type&, bool, simple_handler_type);
 			void do_reintroduce_to_all(multiple_endpoints_handler_type);
 			void do_get_presentation(const ep_type&, optional_presentation_store_handler_type);
 			void do_set_presentation(const ep_type&, cert_type, const cryptoplus::buffer&, void_handler_type);
 			void do_clear_presentation(const ep_type&, void_handler_type);
 			void handle_presentation_message_from(const identity_store&, const presentation_message&, const ep_type&);
-			void do_handle_presentation(const identity_store& identity, const ep_type&, bool, cert_type);
+			void do_handle_presentation(const identity_store& identity, const ep_type&, bool, cert_type, const boost::optional<hash_type>&);
 
 			void do_set_presentation_message_received_callback(presentation_message_received_handler_type, void_handler_type);
 
-			/**
-			 * \brief Reset presentation limit.
-			 * \param ec error code.
-			 */
-			void do_presentation_reset_limit(const boost::system::error_code& ec);
-
 			// This strand is also used by session requests and session messages during the cipherment/decipherment phase.
 #if BOOST_ASIO_VERSION >= 101200 // Boost 1.66+
 			boost::asio::io_context::strand m_presentation_strand;
@@ -1485,21 +1601,8 @@ namespace fscp
 #endif
 			presentation_store_map m_presentation_store_map;
 			presentation_message_received_handler_type m_presentation_message_received_handler;
-
-			/**
-			 * \brief Current number of session request sent per endpoint.
-			 */
-			std::map<ep_type, size_t> m_presentation_requests_map;
-
-			/**
-			 * \brief Timer for reesting presentation requests limit.
-			 */
-			boost::asio::deadline_timer m_presentation_limit_timer;
-
-			/**
-			 * \brief Maximum presentation message from one host per second.
-			 */
-			size_t m_presentation_max_per_second;
+			bool m_hash_only_presentation;
+			certificate_cache m_certificate_cache;
 
 		private: // SESSION_REQUEST messages
 
@@ -1539,9 +1642,19 @@ namespace fscp
 
 		private: // SESSION messages
 
+			/**
+			 * \brief The handler type for the sessions prepared outside of the session strand.
+			 */
+			typedef boost::function<void (boost::shared_ptr<peer_session::next_session_type>)> next_session_handler_type;
+
 			void do_send_session(const identity_store&, const ep_type&, const peer_session::session_parameters&);
 			void do_handle_session(SharedBuffer, const identity_store&, const ep_type&, const session_message&);
 			void do_handle_verified_session(const identity_store&, const ep_type&, const session_message&);
+			void do_complete_session(const identity_store&, const ep_type&, peer_session&, const void*, size_t);
+			void do_prepare_and_send_session(const identity_store&, const ep_type&, peer_session&, session_number_type, cipher_suite_type, elliptic_curve_type);
+			void do_prepare_next_session(const ep_type&, session_number_type, cipher_suite_type, elliptic_curve_type, next_session_handler_type);
+			void do_send_prepared_session(const identity_store&, const ep_type&, boost::shared_ptr<peer_session::next_session_type>);
+			void do_complete_prepared_session(const identity_store&, const ep_type&, boost::shared_ptr<peer_session::next_session_type>, const std::vector<uint8_t>&);
 
 			void do_set_accept_session_messages_default(bool, void_handler_type);
 			void do_set_session_message_received_callback(session_received_handler_type, void_handler_type);
@@ -1549,6 +1662,9 @@ namespace fscp
 			void do_set_session_error_callback(session_error_handler_type, void_handler_type);
 			void do_set_session_established_callback(session_established_handler_type, void_handler_type);
 			void do_set_session_lost_callback(session_lost_handler_type, void_handler_type);
+			void do_check_session_renewal(const ep_type&, peer_session&);
+			void do_prepare_session_renewal(const ep_type&, session_number_type, cipher_suite_type, elliptic_curve_type);
+			void do_renew_session(const identity_store&, const ep_type&, boost::shared_ptr<peer_session::next_session_type>);
 
 			bool m_accept_session_messages_default;
 			session_received_handler_type m_session_message_received_handler;
@@ -1556,6 +1672,8 @@ namespace fscp
 			session_error_handler_type m_session_error_handler;
 			session_established_handler_type m_session_established_handler;
 			session_lost_handler_type m_session_lost_handler;
+			boost::posix_time::time_duration m_session_renewal_period;
+			uint64_t m_session_renewal_data_size;
 
 		private: // DATA messages
 
@@ -1572,7 +1690,7 @@ namespace fscp
 			void do_send_contact_to_all(const contact_map_type&, multiple_endpoints_handler_type);
 			void do_send_contact_to_session(peer_session&, const ep_type&, const contact_map_type&, simple_handler_type);
 			void handle_data_message_from(const identity_store&, SharedBuffer, const data_message&, const ep_type&);
-			void do_handle_data(const identity_store&, const ep_type&, const data_message&);
+			void do_handle_data(const ep_type&, const data_message&);
 			void do_handle_data_message(const ep_type&, message_type, SharedBuffer, boost::asio::const_buffer);
 			void do_handle_contact_request(const ep_type&, const std::set<hash_type>&);
 			void do_handle_contact(const ep_type&, const contact_map_type&);
@@ -1593,10 +1711,26 @@ namespace fscp
 
 		private: // Keep-alive
 
+			void do_schedule_keep_alive(const ep_type&, peer_session&);
 			void do_check_keep_alive(const boost::system::error_code&);
+			void do_check_keep_alive_for(const ep_type&);
 			void do_send_keep_alive(const ep_type&, simple_handler_type);
 
 			boost::asio::deadline_timer m_keep_alive_timer;
+			timer_wheel<ep_type> m_keep_alive_wheel;
+			boost::random::mt19937 m_keep_alive_jitter_generator;
+
+		private: // Path MTU discovery
+
+			void do_set_path_mtu_changed_callback(path_mtu_changed_handler_type, void_handler_type);
+			void do_start_path_mtu_discovery(const ep_type&, peer_session&);
+			void do_check_path_mtu(const ep_type&, peer_session&);
+			void do_handle_path_mtu_probe(const ep_type&, peer_session&, data_message::path_mtu_probe_type, size_t, size_t);
+			void do_send_path_mtu_probe(const ep_type&, peer_session&, data_message::path_mtu_probe_type, size_t);
+			void async_send_unfragmented_to(const SharedBuffer&, size_t, const ep_type&);
+
+			bool m_path_mtu_discovery_enabled;
+			path_mtu_changed_handler_type m_path_mtu_changed_handler;
 
 		private: // Misc
 
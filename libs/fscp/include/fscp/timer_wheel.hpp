@@ -0,0 +1,199 @@
+/*
+ * libfscp - A C++ library to establish peer-to-peer virtual private networks.
+ * Copyright (C) 2010-2011 Julien Kauffmann <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfscp.
+ *
+ * libfscp is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfscp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfscp in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file timer_wheel.hpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief A hashed timing wheel.
+ */
+
+#ifndef FSCP_TIMER_WHEEL_HPP
+#define FSCP_TIMER_WHEEL_HPP
+
+#include <boost/noncopyable.hpp>
+
+#include <vector>
+#include <set>
+#include <map>
+#include <cassert>
+
+namespace fscp
+{
+	/**
+	 * \brief A hashed timing wheel.
+	 *
+	 * Each key is stored in the slot its deadline falls into. Advancing the wheel by one tick only visits the keys of one slot, which spreads the expirations over time instead of handling all of them at once. Deadlines beyond one revolution are supported through a rounds counter.
+	 *
+	 * A key can only be scheduled once: scheduling it again replaces its previous deadline.
+	 *
+	 * This class is NOT thread-safe.
+	 */
+	template <typename KeyType>
+	class timer_wheel : public boost::noncopyable
+	{
+		public:
+
+			/**
+			 * \brief The key type.
+			 */
+			typedef KeyType key_type;
+
+			/**
+			 * \brief Create a timer wheel.
+			 * \param slot_count The count of slots. Must be non-zero.
+			 */
+			explicit timer_wheel(size_t slot_count) :
+				m_slots(slot_count),
+				m_current_slot(0)
+			{
+				assert(slot_count > 0);
+			}
+
+			/**
+			 * \brief Schedule a key.
+			 * \param key The key.
+			 * \param ticks The count of ticks after which the key expires. A value of 0 is treated as 1.
+			 */
+			void schedule(const key_type& key, size_t ticks)
+			{
+				cancel(key);
+
+				if (ticks == 0)
+				{
+					ticks = 1;
+				}
+
+				const size_t slot = (m_current_slot + ticks) % m_slots.size();
+				const entry_type entry = { slot, (ticks - 1) / m_slots.size() };
+
+				m_slots[slot].insert(key);
+				m_entries[key] = entry;
+			}
+
+			/**
+			 * \brief Cancel a key.
+			 * \param key The key.
+			 * \return true if the key was scheduled.
+			 */
+			bool cancel(const key_type& key)
+			{
+				const typename entry_map::iterator it = m_entries.find(key);
+
+				if (it == m_entries.end())
+				{
+					return false;
+				}
+
+				m_slots[it->second.slot].erase(key);
+				m_entries.erase(it);
+
+				return true;
+			}
+
+			/**
+			 * \brief Check if a key is scheduled.
+			 * \param key The key.
+			 * \return true if the key is scheduled.
+			 */
+			bool is_scheduled(const key_type& key) const
+			{
+				return (m_entries.find(key) != m_entries.end());
+			}
+
+			/**
+			 * \brief Get the count of scheduled keys.
+			 * \return The count of scheduled keys.
+			 */
+			size_t size() const
+			{
+				return m_entries.size();
+			}
+
+			/**
+			 * \brief Advance the wheel by one tick.
+			 * \param handler The handler to call for each expired key. Its signature must be void (const key_type&). Expired keys are unscheduled before the handler is called, so the handler may schedule them again.
+			 */
+			template <typename Handler>
+			void tick(Handler handler)
+			{
+				m_current_slot = (m_current_slot + 1) % m_slots.size();
+
+				std::vector<key_type> expired;
+				key_set& keys = m_slots[m_current_slot];
+
+				for (typename key_set::iterator it = keys.begin(); it != keys.end();)
+				{
+					entry_type& entry = m_entries[*it];
+
+					if (entry.rounds > 0)
+					{
+						--entry.rounds;
+						++it;
+					}
+					else
+					{
+						expired.push_back(*it);
+						m_entries.erase(*it);
+						keys.erase(it++);
+					}
+				}
+
+				for (typename std::vector<key_type>::const_iterator it = expired.begin(); it != expired.end(); ++it)
+				{
+					handler(*it);
+				}
+			}
+
+		private:
+
+			struct entry_type
+			{
+				size_t slot;
+				size_t rounds;
+			};
+
+			typedef std::set<key_type> key_set;
+			typedef std::map<key_type, entry_type> entry_map;
+
+			std::vector<key_set> m_slots;
+			size_t m_current_slot;
+			entry_map m_entries;
+	};
+}
+
+#endif /* FSCP_TIMER_WHEEL_HPP */
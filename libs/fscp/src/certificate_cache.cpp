@@ -0,0 +1,128 @@
+/*
+ * libfscp - A C++ library to establish peer-to-peer virtual private networks.
+ * Copyright (C) 2010-2011 Julien Kauffmann <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfscp.
+ *
+ * libfscp is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfscp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfscp in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file certificate_cache.cpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief A cache of parsed certificates.
+ */
+
+#include "certificate_cache.hpp"
+
+#include <cassert>
+
+namespace fscp
+{
+	certificate_cache::certificate_cache(size_t capacity) :
+		m_capacity(capacity)
+	{
+		assert(m_capacity > 0);
+	}
+
+	certificate_cache::cert_type certificate_cache::get(const void* der, size_t der_len, const hash_type& hash)
+	{
+		{
+			const cert_type result = find(hash);
+
+			if (!result.is_null())
+			{
+				return result;
+			}
+		}
+
+		// Parsing is done outside of the lock: another thread might parse the same certificate concurrently but that is harmless.
+		const cert_type result = cert_type::from_der(der, der_len);
+
+		insert(result, hash);
+
+		return result;
+	}
+
+	certificate_cache::cert_type certificate_cache::find(const hash_type& hash)
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		const certificate_map_type::iterator it = m_certificates.find(hash);
+
+		if (it == m_certificates.end())
+		{
+			return cert_type();
+		}
+
+		m_lru_list.splice(m_lru_list.begin(), m_lru_list, it->second.second);
+
+		return it->second.first;
+	}
+
+	void certificate_cache::insert(cert_type cert, const hash_type& hash)
+	{
+		assert(!cert.is_null());
+
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		do_insert(cert, hash);
+	}
+
+	size_t certificate_cache::size() const
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		return m_certificates.size();
+	}
+
+	void certificate_cache::do_insert(cert_type cert, const hash_type& hash)
+	{
+		const certificate_map_type::iterator it = m_certificates.find(hash);
+
+		if (it != m_certificates.end())
+		{
+			m_lru_list.splice(m_lru_list.begin(), m_lru_list, it->second.second);
+
+			return;
+		}
+
+		if (m_certificates.size() >= m_capacity)
+		{
+			m_certificates.erase(m_lru_list.back());
+			m_lru_list.pop_back();
+		}
+
+		m_lru_list.push_front(hash);
+		m_certificates[hash] = std::make_pair(cert, m_lru_list.begin());
+	}
+}
@@ -0,0 +1,75 @@
+/*
+ * libfscp - A C++ library to establish peer-to-peer virtual private networks.
+ * Copyright (C) 2010-2011 Julien Kauffmann <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfscp.
+ *
+ * libfscp is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfscp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfscp in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file coarse_clock.cpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief A cheap monotonic clock.
+ */
+
+#include "coarse_clock.hpp"
+
+#include <cryptoplus/os.hpp>
+
+#if defined(WINDOWS)
+#include <windows.h>
+#elif defined(LINUX)
+#include <time.h>
+#else
+#include <chrono>
+#endif
+
+namespace fscp
+{
+	coarse_clock::time_point coarse_clock::now()
+	{
+#if defined(WINDOWS)
+		return boost::posix_time::milliseconds(static_cast<int64_t>(::GetTickCount64()));
+#elif defined(LINUX)
+		struct timespec ts;
+
+		::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+
+		return boost::posix_time::seconds(static_cast<long>(ts.tv_sec)) + boost::posix_time::microseconds(ts.tv_nsec / 1000);
+#else
+		const std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch());
+
+		return boost::posix_time::milliseconds(static_cast<int64_t>(ms.count()));
+#endif
+	}
+}
@@ -102,4 +102,18 @@ namespace fscp
 
 		return result;
 	}
+
+	hash_type get_certificate_hash(const void* der, size_t der_len)
+	{
+		assert(!!der);
+
+		hash_type result;
+
+		cryptoplus::hash::message_digest_context mdctx;
+		mdctx.initialize(get_default_digest_algorithm());
+		mdctx.update(der, der_len);
+		mdctx.finalize(&result.data[0], result.data.size());
+
+		return result;
+	}
 }
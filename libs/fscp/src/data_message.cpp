@@ -49,8 +49,12 @@
 #include <cryptoplus/random/random.hpp>
 
 #include <boost/iterator/transform_iterator.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/array.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
 #include <stdexcept>
 
 namespace fscp
@@ -69,10 +73,63 @@ namespace fscp
 			return result;
 		}
 
+		// A path MTU probe starts with this magic, then its type, a reserved byte and the tested datagram size.
+		const uint8_t PATH_MTU_PROBE_MAGIC[8] = { 'F', 'S', 'C', 'P', 'P', 'M', 'T', 'U' };
+		const size_t PATH_MTU_PROBE_HEADER_LENGTH = sizeof(PATH_MTU_PROBE_MAGIC) + 2 + sizeof(uint16_t);
+
 		const hash_type::data_type& hash_to_data(const hash_type& hash)
 		{
 			return hash.data;
 		}
+
+		/**
+		 * \brief A per-thread stream of random bytes.
+		 *
+		 * The pool is refilled with a single call to the CSPRNG when exhausted and each byte is only handed out once.
+		 */
+		class random_stream
+		{
+			public:
+
+				static const size_t POOL_SIZE = 4096;
+
+				random_stream() :
+					m_offset(POOL_SIZE)
+				{}
+
+				const uint8_t* get(size_t len)
+				{
+					assert(len <= POOL_SIZE);
+
+					if (m_offset + len > POOL_SIZE)
+					{
+						cryptoplus::random::get_random_bytes(m_pool.data(), POOL_SIZE);
+						m_offset = 0;
+					}
+
+					const uint8_t* const result = m_pool.data() + m_offset;
+					m_offset += len;
+
+					return result;
+				}
+
+			private:
+
+				boost::array<uint8_t, POOL_SIZE> m_pool;
+				size_t m_offset;
+		};
+
+		boost::thread_specific_ptr<random_stream> thread_random_stream;
+
+		random_stream& get_random_stream()
+		{
+			if (!thread_random_stream.get())
+			{
+				thread_random_stream.reset(new random_stream());
+			}
+
+			return *thread_random_stream;
+		}
 	}
 
 	using boost::make_transform_iterator;
@@ -84,9 +141,60 @@ namespace fscp
 
 	size_t data_message::write_keep_alive(void* buf, size_t buf_len, sequence_number_type _sequence_number, data_message::calg_t cipher_algorithm, size_t random_len, const void* enc_key, size_t enc_key_len, const void* nonce_prefix, size_t nonce_prefix_len)
 	{
-		const cryptoplus::buffer random = cryptoplus::random::get_random_bytes(random_len);
+		if (random_len > MAX_KEEP_ALIVE_RANDOM_LENGTH)
+		{
+			throw std::runtime_error("random_len");
+		}
+
+		// Keep-alives are frequent: we take the padding from a per-thread pool rather than calling the CSPRNG for each of them.
+		const uint8_t* const random = get_random_stream().get(random_len);
+
+		return raw_write(buf, buf_len, _sequence_number, cipher_algorithm, random, random_len, enc_key, enc_key_len, nonce_prefix, nonce_prefix_len, MESSAGE_TYPE_KEEP_ALIVE);
+	}
+
+	size_t data_message::write_path_mtu_probe(void* buf, size_t buf_len, sequence_number_type _sequence_number, data_message::calg_t cipher_algorithm, path_mtu_probe_type type, size_t probe_size, const void* enc_key, size_t enc_key_len, const void* nonce_prefix, size_t nonce_prefix_len)
+	{
+		if ((probe_size > std::numeric_limits<uint16_t>::max()) || (max_cleartext_size(probe_size) < PATH_MTU_PROBE_HEADER_LENGTH))
+		{
+			throw std::runtime_error("probe_size");
+		}
 
-		return raw_write(buf, buf_len, _sequence_number, cipher_algorithm, cryptoplus::buffer_cast<const uint8_t*>(random), cryptoplus::buffer_size(random), enc_key, enc_key_len, nonce_prefix, nonce_prefix_len, MESSAGE_TYPE_KEEP_ALIVE);
+		const size_t cleartext_len = (type == path_mtu_probe_type::probe) ? max_cleartext_size(probe_size) : PATH_MTU_PROBE_HEADER_LENGTH;
+
+		// The padding is never read: zeros are as good as anything once enciphered.
+		std::vector<uint8_t> cleartext(cleartext_len, 0x00);
+
+		std::copy(PATH_MTU_PROBE_MAGIC, PATH_MTU_PROBE_MAGIC + sizeof(PATH_MTU_PROBE_MAGIC), cleartext.begin());
+		cleartext[sizeof(PATH_MTU_PROBE_MAGIC)] = static_cast<uint8_t>(type);
+		buffer_tools::set<uint16_t>(&cleartext[0], sizeof(PATH_MTU_PROBE_MAGIC) + 2, htons(static_cast<uint16_t>(probe_size)));
+
+		return raw_write(buf, buf_len, _sequence_number, cipher_algorithm, &cleartext[0], cleartext.size(), enc_key, enc_key_len, nonce_prefix, nonce_prefix_len, MESSAGE_TYPE_KEEP_ALIVE);
+	}
+
+	bool data_message::parse_path_mtu_probe(const void* buf, size_t buflen, path_mtu_probe_type& type, size_t& probe_size)
+	{
+		const uint8_t* const cleartext = static_cast<const uint8_t*>(buf);
+
+		if ((buflen < PATH_MTU_PROBE_HEADER_LENGTH) || !std::equal(PATH_MTU_PROBE_MAGIC, PATH_MTU_PROBE_MAGIC + sizeof(PATH_MTU_PROBE_MAGIC), cleartext))
+		{
+			return false;
+		}
+
+		switch (cleartext[sizeof(PATH_MTU_PROBE_MAGIC)])
+		{
+			case static_cast<uint8_t>(path_mtu_probe_type::probe):
+				type = path_mtu_probe_type::probe;
+				break;
+			case static_cast<uint8_t>(path_mtu_probe_type::acknowledgement):
+				type = path_mtu_probe_type::acknowledgement;
+				break;
+			default:
+				return false;
+		}
+
+		probe_size = ntohs(buffer_tools::get<uint16_t>(cleartext, sizeof(PATH_MTU_PROBE_MAGIC) + 2));
+
+		return true;
 	}
 
 	size_t data_message::write_contact_request(void* buf, size_t buf_len, sequence_number_type sequence_number, data_message::calg_t cipher_algorithm, const hash_list_type& hash_list, const void* enc_key, size_t enc_key_len, const void* nonce_prefix, size_t nonce_prefix_len)
@@ -287,13 +395,18 @@ namespace fscp
 		}
 	}
 
+	size_t data_message::required_buffer_size(size_t cleartext_len, data_message::calg_t cipher_algorithm)
+	{
+		return HEADER_LENGTH + MIN_BODY_LENGTH + cleartext_len + cipher_algorithm.block_size();
+	}
+
 	size_t data_message::raw_write(void* buf, size_t buf_len, sequence_number_type _sequence_number, data_message::calg_t cipher_algorithm, const void* _cleartext, size_t cleartext_len, const void* enc_key, size_t enc_key_len, const void* nonce_prefix, size_t nonce_prefix_len, message_type type)
 	{
 		assert(enc_key);
 
 		const iv_type iv = compute_iv(nonce_prefix, nonce_prefix_len, _sequence_number);
 
-		if (buf_len < HEADER_LENGTH + sizeof(sequence_number_type) + GCM_TAG_LENGTH + sizeof(uint16_t) + (cleartext_len + cipher_algorithm.block_size()))
+		if (buf_len < required_buffer_size(cleartext_len, cipher_algorithm))
 		{
 			throw std::runtime_error("buf_len");
 		}
@@ -312,7 +425,7 @@ namespace fscp
 
 		cipher_context.initialize(data_message::calg_t(), cryptoplus::cipher::cipher_context::unchanged, enc_key, enc_key_len, iv.data());
 
-		const size_t max_ciphertext_len = buf_len - HEADER_LENGTH - sizeof(sequence_number_type) - GCM_TAG_LENGTH - sizeof(uint16_t) - cipher_algorithm.block_size();
+		const size_t max_ciphertext_len = buf_len - HEADER_LENGTH - MIN_BODY_LENGTH;
 
 		const cryptoplus::buffer cleartext(_cleartext, cleartext_len);
 
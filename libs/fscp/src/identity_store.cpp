@@ -51,6 +51,7 @@ namespace fscp
 {
 	identity_store::identity_store(identity_store::cert_type sig_cert, identity_store::key_type sig_key, const cryptoplus::buffer& psk) :
 		m_sig_cert(sig_cert),
+		m_sig_hash(m_sig_cert.is_null() ? boost::none : boost::optional<hash_type>(get_certificate_hash(m_sig_cert))),
 		m_sig_key(sig_key),
 		m_pre_shared_key(psk)
 	{
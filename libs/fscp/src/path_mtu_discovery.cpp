@@ -0,0 +1,193 @@
+/*
+ * libfscp - A C++ library to establish peer-to-peer virtual private networks.
+ * Copyright (C) 2010-2011 Julien Kauffmann <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfscp.
+ *
+ * libfscp is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfscp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfscp in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file path_mtu_discovery.cpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief The path MTU discovery state of a peer.
+ */
+
+#include "path_mtu_discovery.hpp"
+
+#include "constants.hpp"
+
+namespace fscp
+{
+	path_mtu_discovery::path_mtu_discovery() :
+		m_min_size(0),
+		m_max_size(0),
+		m_confirmed_size(0),
+		m_upper_bound(0),
+		m_probe_size(0),
+		m_probe_attempts(0),
+		m_probe_date(boost::posix_time::not_a_date_time),
+		m_next_search_date(boost::posix_time::not_a_date_time)
+	{
+	}
+
+	void path_mtu_discovery::start(size_t min_size, size_t max_size)
+	{
+		m_min_size = min_size;
+		m_max_size = max_size;
+		m_confirmed_size = 0;
+		m_upper_bound = max_size;
+		m_probe_size = 0;
+		m_probe_attempts = 0;
+		m_probe_date = boost::posix_time::not_a_date_time;
+		m_next_search_date = boost::posix_time::not_a_date_time;
+	}
+
+	void path_mtu_discovery::stop()
+	{
+		start(0, 0);
+	}
+
+	boost::optional<size_t> path_mtu_discovery::next_probe(const coarse_clock::time_point& now)
+	{
+		if (!is_started())
+		{
+			return boost::none;
+		}
+
+		if (m_probe_size != 0)
+		{
+			if (now < m_probe_date + PATH_MTU_PROBE_TIMEOUT)
+			{
+				return boost::none;
+			}
+
+			if (m_probe_attempts < PATH_MTU_PROBE_ATTEMPTS)
+			{
+				++m_probe_attempts;
+				m_probe_date = now;
+
+				return m_probe_size;
+			}
+
+			// All the attempts were lost: the size is too big for the path.
+			const size_t lost_size = m_probe_size;
+
+			m_probe_size = 0;
+			m_upper_bound = lost_size - 1;
+
+			if (lost_size <= m_confirmed_size)
+			{
+				// The path shrank since the last search: what we knew is wrong.
+				m_confirmed_size = 0;
+			}
+
+			if (lost_size == m_min_size)
+			{
+				// Either the path is really small or the peer ignores the probes: we try again later.
+				m_next_search_date = now + PATH_MTU_SEARCH_PERIOD;
+
+				return boost::none;
+			}
+		}
+
+		if (!m_next_search_date.is_not_a_date_time())
+		{
+			if (now < m_next_search_date)
+			{
+				return boost::none;
+			}
+
+			m_next_search_date = boost::posix_time::not_a_date_time;
+			m_upper_bound = m_max_size;
+
+			// Check that the size we know still works before looking for a bigger one.
+			return send_probe((m_confirmed_size != 0) ? m_confirmed_size : m_min_size, now);
+		}
+
+		if (m_confirmed_size == 0)
+		{
+			return send_probe(m_min_size, now);
+		}
+
+		if (m_upper_bound < m_confirmed_size + PATH_MTU_SEARCH_PRECISION)
+		{
+			m_next_search_date = now + PATH_MTU_SEARCH_PERIOD;
+
+			return boost::none;
+		}
+
+		// Most paths allow the largest size: we try it first so that they converge at once.
+		if (m_upper_bound == m_max_size)
+		{
+			return send_probe(m_max_size, now);
+		}
+
+		return send_probe(m_confirmed_size + (m_upper_bound - m_confirmed_size + 1) / 2, now);
+	}
+
+	bool path_mtu_discovery::probe_acknowledged(size_t size)
+	{
+		if (!is_started() || (size < m_min_size) || (size > m_max_size))
+		{
+			return false;
+		}
+
+		if (size == m_probe_size)
+		{
+			m_probe_size = 0;
+		}
+
+		if (size > m_upper_bound)
+		{
+			m_upper_bound = size;
+		}
+
+		if (size > m_confirmed_size)
+		{
+			m_confirmed_size = size;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	boost::optional<size_t> path_mtu_discovery::send_probe(size_t size, const coarse_clock::time_point& now)
+	{
+		m_probe_size = size;
+		m_probe_attempts = 1;
+		m_probe_date = now;
+
+		return size;
+	}
+}
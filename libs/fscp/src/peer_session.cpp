@@ -48,10 +48,21 @@
 
 namespace fscp
 {
-	bool peer_session::current_session_type::is_old() const
+	bool peer_session::current_session_type::is_old(const boost::posix_time::time_duration& max_age, uint64_t max_data_size) const
 	{
 		const auto max = std::numeric_limits<sequence_number_type>::max() / 2;
-		return ((local_sequence_number > max) || (remote_sequence_number > max));
+
+		if ((local_sequence_number > max) || (remote_sequence_number > max))
+		{
+			return true;
+		}
+
+		if (data_size > max_data_size)
+		{
+			return true;
+		}
+
+		return (coarse_clock::now() > creation_date + max_age);
 	}
 
 	bool peer_session::set_first_remote_host_identifier(const host_identifier_type& _host_identifier)
@@ -82,7 +93,25 @@ namespace fscp
 		return true;
 	}
 
-	bool peer_session::complete_session(const void* _remote_public_key, size_t remote_public_key_size)
+	bool peer_session::set_next_session(boost::shared_ptr<next_session_type> next_session)
+	{
+		assert(next_session);
+
+		if (m_next_session)
+		{
+			if ((m_next_session->parameters.session_number == next_session->parameters.session_number) && (m_next_session->parameters.cipher_suite == next_session->parameters.cipher_suite) && (m_next_session->parameters.elliptic_curve == next_session->parameters.elliptic_curve))
+			{
+				// The session in preparation matches the requested one: not replacing it to ensure the private DH key stays the same.
+				return false;
+			}
+		}
+
+		m_next_session = next_session;
+
+		return true;
+	}
+
+	bool peer_session::complete_session(const void* _remote_public_key, size_t remote_public_key_size, const boost::posix_time::time_duration& grace_period)
 	{
 		using cryptoplus::buffer_cast;
 
@@ -142,6 +171,11 @@ namespace fscp
 		m_next_session.reset();
 		swap(m_current_session, _current_session);
 
+		// The replaced session is kept for a little while so that the messages that were sent before the remote host switched to the new session can still be deciphered.
+		m_previous_session = _current_session;
+		m_previous_session_expiration = coarse_clock::now() + grace_period;
+		m_renewal_date = boost::posix_time::not_a_date_time;
+
 		keep_alive();
 
 		return true;
@@ -189,6 +223,33 @@ namespace fscp
 		return false;
 	}
 
+	bool peer_session::has_previous_session() const
+	{
+		return (m_previous_session && (coarse_clock::now() <= m_previous_session_expiration));
+	}
+
+	bool peer_session::set_previous_remote_sequence_number(sequence_number_type sequence_number)
+	{
+		if (sequence_number > m_previous_session->remote_sequence_number)
+		{
+			m_previous_session->remote_sequence_number = sequence_number;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool peer_session::must_renew(const boost::posix_time::time_duration& max_age, uint64_t max_data_size) const
+	{
+		if (!m_current_session || !m_current_session->is_old(max_age, max_data_size))
+		{
+			return false;
+		}
+
+		return (m_renewal_date.is_not_a_date_time() || (coarse_clock::now() > m_renewal_date + SESSION_RENEWAL_RETRY_PERIOD));
+	}
+
 	bool peer_session::clear()
 	{
 		clear_remote_host_identifier();
@@ -197,6 +258,10 @@ namespace fscp
 
 		m_current_session.reset();
 		m_next_session.reset();
+		m_previous_session.reset();
+		m_last_data_sent = boost::posix_time::not_a_date_time;
+		m_renewal_date = boost::posix_time::not_a_date_time;
+		m_path_mtu_discovery.stop();
 
 		return result;
 	}
@@ -74,6 +74,20 @@ namespace fscp
 		return pbuf - static_cast<char*>(buf);
 	}
 
+	size_t presentation_message::write_hash(void* buf, size_t buf_len, const hash_type& sig_cert_hash)
+	{
+		if (buf_len < HEADER_LENGTH + hash_type::data_type::static_size)
+		{
+			throw std::runtime_error("buf_len");
+		}
+
+		std::memcpy(static_cast<char*>(buf) + HEADER_LENGTH, sig_cert_hash.data.data(), sig_cert_hash.data.size());
+
+		message::write(buf, buf_len, CURRENT_PROTOCOL_VERSION, MESSAGE_TYPE_PRESENTATION_HASH, hash_type::data_type::static_size);
+
+		return HEADER_LENGTH + hash_type::data_type::static_size;
+	}
+
 	presentation_message::presentation_message(const void* buf, size_t buf_len) :
 		message(buf, buf_len)
 	{
@@ -88,7 +102,7 @@ namespace fscp
 
 	presentation_message::cert_type presentation_message::signature_certificate() const
 	{
-		uint16_t sig_len = ntohs(buffer_tools::get<uint16_t>(payload(), 0));
+		const size_t sig_len = signature_certificate_der_size();
 
 		if (sig_len == 0)
 		{
@@ -96,25 +110,71 @@ namespace fscp
 		}
 		else
 		{
-			return cert_type::from_der(payload() + sizeof(uint16_t), sig_len);
+			return cert_type::from_der(signature_certificate_der(), sig_len);
 		}
 	}
 
-	void presentation_message::check_format() const
+	const uint8_t* presentation_message::signature_certificate_der() const
 	{
-		if (length() < MIN_BODY_LENGTH)
+		if (signature_certificate_der_size() == 0)
 		{
-			throw std::runtime_error("bad message length");
+			return nullptr;
 		}
 
-		uint16_t sig_len = ntohs(buffer_tools::get<uint16_t>(payload(), 0));
+		return payload() + sizeof(uint16_t);
+	}
 
-		if (sig_len != 0)
+	size_t presentation_message::signature_certificate_der_size() const
+	{
+		if (is_hash_only())
 		{
-			// Test that the certificate can be parsed.
-			cert_type::from_der(payload() + sizeof(uint16_t), sig_len);
+			return 0;
 		}
 
+		return ntohs(buffer_tools::get<uint16_t>(payload(), 0));
+	}
+
+	boost::optional<hash_type> presentation_message::signature_certificate_hash() const
+	{
+		if (is_hash_only())
+		{
+			hash_type result;
+
+			std::memcpy(result.data.data(), payload(), result.data.size());
+
+			return result;
+		}
+
+		const size_t sig_len = signature_certificate_der_size();
+
+		if (sig_len == 0)
+		{
+			return boost::none;
+		}
+
+		return get_certificate_hash(signature_certificate_der(), sig_len);
+	}
+
+	void presentation_message::check_format() const
+	{
+		if (is_hash_only())
+		{
+			if (length() != hash_type::data_type::static_size)
+			{
+				throw std::runtime_error("bad message length");
+			}
+
+			return;
+		}
+
+		if (length() < MIN_BODY_LENGTH)
+		{
+			throw std::runtime_error("bad message length");
+		}
+
+		const uint16_t sig_len = ntohs(buffer_tools::get<uint16_t>(payload(), 0));
+
+		// The certificate itself is only parsed when needed, which saves some work for the already known ones.
 		if (length() < MIN_BODY_LENGTH + sig_len)
 		{
 			throw std::runtime_error("sig_len value mismatch");
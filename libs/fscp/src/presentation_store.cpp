@@ -55,4 +55,12 @@ namespace fscp
 		m_pre_shared_key(psk)
 	{
 	}
+
+	presentation_store::presentation_store(presentation_store::cert_type sig_cert, const boost::optional<hash_type>& sig_hash, const cryptoplus::buffer& psk) :
+		m_sig_cert(sig_cert),
+		m_sig_hash(sig_hash),
+		m_pre_shared_key(psk)
+	{
+		assert(m_sig_cert.is_null() == !m_sig_hash);
+	}
 }
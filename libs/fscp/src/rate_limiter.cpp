@@ -0,0 +1,233 @@
+/*
+ * libfscp - A C++ library to establish peer-to-peer virtual private networks.
+ * Copyright (C) 2010-2011 Julien Kauffmann <julien.kauffmann@freelan.org>
+ *
+ * This file is part of libfscp.
+ *
+ * libfscp is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libfscp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ *
+ * If you intend to use libfscp in a commercial software, please
+ * contact me : we may arrange this for a small fee or no fee at all,
+ * depending on the nature of your project.
+ */
+
+/**
+ * \file rate_limiter.cpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief A fixed-memory rate limiter for unauthenticated messages.
+ */
+
+#include "rate_limiter.hpp"
+
+#include <cryptoplus/random/random.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace fscp
+{
+	namespace
+	{
+		template <typename BytesType>
+		uint64_t hash_prefix(const BytesType& bytes, unsigned int prefix_length, uint64_t hash)
+		{
+			for (size_t i = 0; i < bytes.size(); ++i)
+			{
+				const unsigned int bits = (prefix_length > i * 8) ? std::min(prefix_length - static_cast<unsigned int>(i * 8), 8u) : 0;
+				const uint8_t mask = static_cast<uint8_t>(0xFF << (8 - bits));
+
+				// FNV-1a
+				hash ^= (bytes[i] & mask);
+				hash *= 0x100000001b3ULL;
+			}
+
+			return hash;
+		}
+
+		uint64_t mix(uint64_t value)
+		{
+			// splitmix64 finalizer
+			value ^= value >> 30;
+			value *= 0xbf58476d1ce4e5b9ULL;
+			value ^= value >> 27;
+			value *= 0x94d049bb133111ebULL;
+			value ^= value >> 31;
+
+			return value;
+		}
+	}
+
+	const size_t rate_limiter::DEFAULT_WIDTH;
+	const size_t rate_limiter::DEPTH;
+
+	rate_limiter::rate_limiter(size_t width, unsigned int ipv4_prefix_length, unsigned int ipv6_prefix_length) :
+		m_width(width),
+		m_ipv4_prefix_length(std::min(ipv4_prefix_length, 32u)),
+		m_ipv6_prefix_length(std::min(ipv6_prefix_length, 128u)),
+		m_seeds(),
+		m_mutex(),
+		m_rates(),
+		m_rejected(),
+		m_buckets(width * DEPTH)
+	{
+		// The width must be a power of two.
+		assert((m_width > 0) && ((m_width & (m_width - 1)) == 0));
+
+		// Random seeds prevent a remote host from crafting colliding sources on purpose.
+		cryptoplus::random::get_random_bytes(m_seeds.data(), m_seeds.size() * sizeof(uint64_t));
+	}
+
+	void rate_limiter::set_rate(message_type type, double per_second, double burst)
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		m_rates[type].per_second = per_second;
+		m_rates[type].burst = std::max(burst, 1.0);
+	}
+
+	bool rate_limiter::consume(const boost::asio::ip::address& source, message_type type)
+	{
+		return consume_key(get_key(source, type), type);
+	}
+
+	bool rate_limiter::consume(const boost::asio::ip::udp::endpoint& source, message_type type)
+	{
+		return consume_key(get_key(source, type), type);
+	}
+
+	bool rate_limiter::consume_key(uint64_t key, message_type type)
+	{
+		const coarse_clock::time_point now = coarse_clock::now();
+
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		const rate_type& rate = m_rates[type];
+
+		if (rate.per_second <= 0)
+		{
+			return true;
+		}
+
+		bool accept = false;
+
+		for (size_t row = 0; row < DEPTH; ++row)
+		{
+			bucket_type& bucket = m_buckets[row * m_width + get_index(row, key)];
+
+			refill(bucket, rate, now);
+
+			if (bucket.tokens >= 1.0)
+			{
+				accept = true;
+			}
+		}
+
+		if (!accept)
+		{
+			++m_rejected[type];
+
+			return false;
+		}
+
+		for (size_t row = 0; row < DEPTH; ++row)
+		{
+			bucket_type& bucket = m_buckets[row * m_width + get_index(row, key)];
+
+			bucket.tokens = std::max(bucket.tokens - 1.0, 0.0);
+		}
+
+		return true;
+	}
+
+	rate_limiter::statistics_type rate_limiter::get_statistics() const
+	{
+		statistics_type result;
+
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		for (size_t type = 0; type < m_rejected.size(); ++type)
+		{
+			if (m_rejected[type] > 0)
+			{
+				result[static_cast<message_type>(type)] = m_rejected[type];
+			}
+		}
+
+		return result;
+	}
+
+	uint64_t rate_limiter::get_key(const boost::asio::ip::address& source, message_type type) const
+	{
+		// FNV-1a offset basis, with the message type as the first byte.
+		const uint64_t hash = (0xcbf29ce484222325ULL ^ static_cast<uint8_t>(type)) * 0x100000001b3ULL;
+
+		if (source.is_v4())
+		{
+			return hash_prefix(source.to_v4().to_bytes(), m_ipv4_prefix_length, hash);
+		}
+		else
+		{
+			return hash_prefix(source.to_v6().to_bytes(), m_ipv6_prefix_length, hash ^ 0x06);
+		}
+	}
+
+	uint64_t rate_limiter::get_key(const boost::asio::ip::udp::endpoint& source, message_type type) const
+	{
+		// FNV-1a, continued with the port bytes.
+		uint64_t hash = get_key(source.address(), type);
+
+		hash ^= static_cast<uint8_t>(source.port() >> 8);
+		hash *= 0x100000001b3ULL;
+		hash ^= static_cast<uint8_t>(source.port());
+		hash *= 0x100000001b3ULL;
+
+		return hash;
+	}
+
+	size_t rate_limiter::get_index(size_t row, uint64_t key) const
+	{
+		return static_cast<size_t>(mix(key ^ m_seeds[row])) & (m_width - 1);
+	}
+
+	void rate_limiter::refill(bucket_type& bucket, const rate_type& rate, const coarse_clock::time_point& now)
+	{
+		if (bucket.last_update.is_not_a_date_time())
+		{
+			// A bucket that was never used starts full.
+			bucket.tokens = rate.burst;
+		}
+		else if (now > bucket.last_update)
+		{
+			const double elapsed = static_cast<double>((now - bucket.last_update).total_microseconds()) / 1000000.0;
+
+			bucket.tokens = std::min(bucket.tokens + elapsed * rate.per_second, rate.burst);
+		}
+
+		bucket.last_update = now;
+	}
+}
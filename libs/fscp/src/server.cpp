@@ -99,6 +99,104 @@ namespace fscp
 			return result;
 		}
 
+#if defined(IP_MTU_DISCOVER) && defined(IP_PMTUDISC_PROBE)
+		// Set the DF bit and ignore the path MTU cached by the system.
+		typedef boost::asio::detail::socket_option::integer<IPPROTO_IP, IP_MTU_DISCOVER> ipv4_dont_fragment_option;
+		const int IPV4_DONT_FRAGMENT = IP_PMTUDISC_PROBE;
+#define FSCP_HAS_DONT_FRAGMENT
+#elif defined(IP_DONTFRAGMENT)
+		typedef boost::asio::detail::socket_option::integer<IPPROTO_IP, IP_DONTFRAGMENT> ipv4_dont_fragment_option;
+		const int IPV4_DONT_FRAGMENT = 1;
+#define FSCP_HAS_DONT_FRAGMENT
+#elif defined(IP_DONTFRAG)
+		typedef boost::asio::detail::socket_option::integer<IPPROTO_IP, IP_DONTFRAG> ipv4_dont_fragment_option;
+		const int IPV4_DONT_FRAGMENT = 1;
+#define FSCP_HAS_DONT_FRAGMENT
+#endif
+
+#ifdef FSCP_HAS_DONT_FRAGMENT
+#if defined(IPV6_MTU_DISCOVER) && defined(IPV6_PMTUDISC_PROBE)
+		typedef boost::asio::detail::socket_option::integer<IPPROTO_IPV6, IPV6_MTU_DISCOVER> ipv6_dont_fragment_option;
+		const int IPV6_DONT_FRAGMENT = IPV6_PMTUDISC_PROBE;
+#elif defined(IPV6_DONTFRAG)
+		typedef boost::asio::detail::socket_option::integer<IPPROTO_IPV6, IPV6_DONTFRAG> ipv6_dont_fragment_option;
+		const int IPV6_DONT_FRAGMENT = 1;
+#else
+#undef FSCP_HAS_DONT_FRAGMENT
+#endif
+#endif
+
+		/**
+		 * \brief Forbid the fragmentation of the datagrams sent on a socket for the lifetime of the instance.
+		 *
+		 * The system usually fragments the datagrams that are bigger than the MTU it knows: a path MTU probe must never be, or it would be acknowledged even when too big for the path.
+		 */
+		class dont_fragment_guard : public boost::noncopyable
+		{
+			public:
+
+				explicit dont_fragment_guard(boost::asio::ip::udp::socket& socket) :
+					m_socket(socket)
+				{
+#ifdef FSCP_HAS_DONT_FRAGMENT
+					// An IPv6 socket also sends to IPv4-mapped addresses: both options are set when possible and restored only if they could be read.
+					boost::system::error_code ec;
+
+					m_socket.get_option(m_ipv4_option, ec);
+					m_ipv4_saved = !ec;
+
+					if (m_ipv4_saved)
+					{
+						m_socket.set_option(ipv4_dont_fragment_option(IPV4_DONT_FRAGMENT), ec);
+					}
+
+					m_socket.get_option(m_ipv6_option, ec);
+					m_ipv6_saved = !ec;
+
+					if (m_ipv6_saved)
+					{
+						m_socket.set_option(ipv6_dont_fragment_option(IPV6_DONT_FRAGMENT), ec);
+					}
+#endif
+				}
+
+				~dont_fragment_guard()
+				{
+#ifdef FSCP_HAS_DONT_FRAGMENT
+					boost::system::error_code ec;
+
+					if (m_ipv4_saved)
+					{
+						m_socket.set_option(m_ipv4_option, ec);
+					}
+
+					if (m_ipv6_saved)
+					{
+						m_socket.set_option(m_ipv6_option, ec);
+					}
+#endif
+				}
+
+				static bool is_supported()
+				{
+#ifdef FSCP_HAS_DONT_FRAGMENT
+					return true;
+#else
+					return false;
+#endif
+				}
+
+			private:
+
+				boost::asio::ip::udp::socket& m_socket;
+#ifdef FSCP_HAS_DONT_FRAGMENT
+				ipv4_dont_fragment_option m_ipv4_option;
+				ipv6_dont_fragment_option m_ipv6_option;
+				bool m_ipv4_saved;
+				bool m_ipv6_saved;
+#endif
+		};
+
 		template <typename Handler, typename CausalHandler>
 		class causal_handler
 		{
@@ -210,17 +308,6 @@ namespace fscp
 				map_type m_results;
 		};
 
-		bool compare_certificates(const server::cert_type& lhs, const server::cert_type& rhs)
-		{
-			if (!!lhs && !!rhs)
-			{
-				return (lhs.write_der() == rhs.write_der());
-			}
-			else
-			{
-				return (!lhs && !rhs);
-			}
-		}
 	}
 
 	// Public methods
@@ -231,15 +318,14 @@ namespace fscp
 		m_socket(io_service),
 		m_socket_strand(io_service),
 		m_write_queue_strand(io_service),
+		m_writes_in_flight(0),
 		m_greet_strand(io_service),
 		m_accept_hello_messages_default(true),
 		m_hello_message_received_handler(),
-		m_hello_limit_timer(io_service, boost::posix_time::seconds(10)),
-		m_hello_max_per_second(1),
 		m_presentation_strand(io_service),
 		m_presentation_message_received_handler(),
-		m_presentation_limit_timer(io_service, boost::posix_time::seconds(10)),
-		m_presentation_max_per_second(1),
+		m_hash_only_presentation(false),
+		m_certificate_cache(),
 		m_session_strand(io_service),
 		m_accept_session_request_messages_default(true),
 		m_cipher_suites(get_default_cipher_suites()),
@@ -251,14 +337,24 @@ namespace fscp
 		m_session_error_handler(),
 		m_session_established_handler(),
 		m_session_lost_handler(),
+		m_session_renewal_period(SESSION_RENEWAL_PERIOD),
+		m_session_renewal_data_size(SESSION_RENEWAL_DATA_SIZE),
 		m_contact_strand(io_service),
 		m_data_received_handler(),
 		m_contact_request_message_received_handler(),
 		m_contact_message_received_handler(),
-		m_keep_alive_timer(io_service, SESSION_KEEP_ALIVE_PERIOD)
+		m_keep_alive_timer(io_service, SESSION_KEEP_ALIVE_TICK),
+		m_keep_alive_wheel(SESSION_KEEP_ALIVE_WHEEL_SIZE),
+		m_keep_alive_jitter_generator(static_cast<uint32_t>(time(0))),
+		m_path_mtu_discovery_enabled(false),
+		m_path_mtu_changed_handler()
 	{
 		// These calls are needed in C++03 to ensure that static initializations are done in a single thread.
 		server_category();
+
+		set_hello_max_per_second(1);
+		set_presentation_max_per_second(1);
+		set_session_max_per_second(1);
 	}
 
 	elliptic_curve_list_type server::get_supported_elliptic_curves(
@@ -319,13 +415,8 @@ namespace fscp
 
 		async_receive_from();
 
+		m_keep_alive_timer.expires_from_now(SESSION_KEEP_ALIVE_TICK);
 		m_keep_alive_timer.async_wait(m_session_strand.wrap(boost::bind(&server::do_check_keep_alive, this, boost::asio::placeholders::error)));
-		m_hello_limit_timer.async_wait(m_greet_strand.wrap(
-					boost::bind(&server::do_hello_reset_limit, this,
-						boost::asio::placeholders::error)));
-		m_presentation_limit_timer.async_wait(m_presentation_strand.wrap(
-					boost::bind(&server::do_presentation_reset_limit, this,
-						boost::asio::placeholders::error)));
 	}
 
 	void server::close()
@@ -334,9 +425,6 @@ namespace fscp
 
 		m_keep_alive_timer.cancel();
 
-		m_hello_limit_timer.cancel();
-		m_presentation_limit_timer.cancel();
-
 		m_socket.close();
 	}
 
@@ -400,7 +488,15 @@ namespace fscp
 
 	void server::async_introduce_to(const ep_type& target, simple_handler_type handler)
 	{
-		m_socket_strand.post(boost::bind(&server::do_introduce_to, this, normalize(target), handler));
+		if (m_hash_only_presentation && get_identity().signature_certificate_hash())
+		{
+			// Only the hosts we have a session with are known to have our certificate.
+			async_has_session_with_endpoint(normalize(target), m_socket_strand.wrap(boost::bind(&server::do_introduce_to, this, normalize(target), _1, handler)));
+		}
+		else
+		{
+			m_socket_strand.post(boost::bind(&server::do_introduce_to, this, normalize(target), false, handler));
+		}
 	}
 
 	boost::system::error_code server::sync_introduce_to(const ep_type& target)
@@ -675,6 +771,16 @@ namespace fscp
 		return promise.get_future().wait();
 	}
 
+	void server::sync_set_path_mtu_changed_callback(path_mtu_changed_handler_type callback)
+	{
+		typedef boost::promise<void> promise_type;
+		promise_type promise;
+
+		async_set_path_mtu_changed_callback(callback, boost::bind(&promise_type::set_value, &promise));
+
+		return promise.get_future().wait();
+	}
+
 	void server::async_send_data(const ep_type& target, channel_number_type channel_number, boost::asio::const_buffer data, simple_handler_type handler)
 	{
 		m_session_strand.post(boost::bind(&server::do_send_data, this, normalize(target), channel_number, data, handler));
@@ -935,6 +1041,11 @@ namespace fscp
 				{
 					message message(buffer_cast<const uint8_t*>(data), bytes_received);
 
+					if (!check_unauthenticated_message_rate(*sender, message.type()))
+					{
+						return;
+					}
+
 					switch (message.type())
 					{
 						case MESSAGE_TYPE_DATA_0:
@@ -965,7 +1076,6 @@ namespace fscp
 									boost::bind(
 										&server::do_handle_data,
 										this,
-										identity,
 										*sender,
 										data_message
 									)
@@ -984,6 +1094,7 @@ namespace fscp
 							break;
 						}
 						case MESSAGE_TYPE_PRESENTATION:
+						case MESSAGE_TYPE_PRESENTATION_HASH:
 						{
 							presentation_message presentation_message(message);
 
@@ -1044,26 +1155,94 @@ namespace fscp
 		}
 	}
 
-	void server::push_write(void_handler_type handler)
+	bool server::check_unauthenticated_message_rate(const ep_type& sender, message_type type)
+	{
+		switch (type)
+		{
+			case MESSAGE_TYPE_HELLO_REQUEST:
+			case MESSAGE_TYPE_PRESENTATION:
+			case MESSAGE_TYPE_PRESENTATION_HASH:
+			{
+				if (!m_unauthenticated_messages_limiter.consume(sender.address(), type))
+				{
+					m_logger(log_level::trace) << "Received too many messages of type " << static_cast<int>(type) << " from " << sender << ". Ignoring.";
+
+					return false;
+				}
+
+				return true;
+			}
+			case MESSAGE_TYPE_SESSION_REQUEST:
+			case MESSAGE_TYPE_SESSION:
+			{
+				// Hosts behind a NAT share one address: they must not use up each other's budget for session setups and renewals.
+				if (!m_unauthenticated_messages_limiter.consume(sender, type) || !m_session_messages_address_limiter.consume(sender.address(), type))
+				{
+					m_logger(log_level::trace) << "Received too many messages of type " << static_cast<int>(type) << " from " << sender << ". Ignoring.";
+
+					return false;
+				}
+
+				return true;
+			}
+			default:
+			{
+				return true;
+			}
+		}
+	}
+
+	void server::push_write(void_handler_type handler, bool exclusive)
 	{
 		// All push_write() calls are done in the same strand so the following is thread-safe.
-		if (m_write_queue.empty())
+		const write_type write = { handler, exclusive };
+		m_write_queue.push(write);
+
+		if (m_write_queue.size() == 1)
 		{
 			// Nothing is being written, lets start the write immediately.
-			m_socket_strand.post(make_causal_handler(handler, m_write_queue_strand.wrap(boost::bind(&server::pop_write, this))));
+			start_write();
+		}
+	}
+
+	void server::start_write()
+	{
+		// All start_write() calls are done in the same strand so the following is thread-safe.
+		const write_type& write = m_write_queue.front();
+
+		// The previous writes were only started: an exclusive write waits for them to complete. write_done() starts it later.
+		if (write.exclusive && (m_writes_in_flight > 0))
+		{
+			return;
 		}
 
-		m_write_queue.push(handler);
+		m_socket_strand.post(make_causal_handler(write.handler, m_write_queue_strand.wrap(boost::bind(&server::pop_write, this))));
 	}
 
 	void server::pop_write()
 	{
 		// All pop_write() calls are done in the same strand so the following is thread-safe.
+		if (!m_write_queue.front().exclusive)
+		{
+			++m_writes_in_flight;
+		}
+
 		m_write_queue.pop();
 
 		if (!m_write_queue.empty())
 		{
-			m_socket_strand.post(make_causal_handler(m_write_queue.front(), m_write_queue_strand.wrap(boost::bind(&server::pop_write, this))));
+			start_write();
+		}
+	}
+
+	void server::write_done()
+	{
+		// All write_done() calls are done in the same strand so the following is thread-safe.
+		--m_writes_in_flight;
+
+		if ((m_writes_in_flight == 0) && !m_write_queue.empty() && m_write_queue.front().exclusive)
+		{
+			start_write();
 		}
 	}
 
@@ -1268,27 +1447,6 @@ namespace fscp
 	void server::do_handle_hello_request(const ep_type& sender, uint32_t hello_unique_number)
 	{
 		// All do_handle_hello_request() calls are done in the same strand so the following is thread-safe.
-		std::map<ep_type, size_t>::iterator sender_hello = m_hello_requests_map.find(sender);
-
-		if(sender_hello == m_hello_requests_map.end())
-		{
-			// new hello
-			m_hello_requests_map[sender] = 1;
-		}
-		else if(m_hello_requests_map[sender] >= (m_hello_max_per_second * 10))
-		{
-			// in 10s we have reach limits! Presentation flood?
-			m_logger(log_level::warning) <<
-				"Received too many HELLO messages from " << sender <<
-				", limit is " << (m_hello_max_per_second * 10) <<
-				" messages per 10 seconds";
-			return;
-		}
-		else
-		{
-			m_hello_requests_map[sender]++;
-		}
-
 		bool can_reply = m_accept_hello_messages_default;
 
 		if (m_hello_message_received_handler)
@@ -1329,21 +1487,6 @@ namespace fscp
 		}
 	}
 
-	void server::do_hello_reset_limit(const boost::system::error_code& ec)
-	{
-		// All do_hello_reset_limit calls are done in the same strand so the following is thread-safe.
-		if (ec != boost::asio::error::operation_aborted)
-		{
-			m_hello_requests_map.clear();
-
-			// rearm timer again
-			m_hello_limit_timer.expires_from_now(boost::posix_time::seconds(10));
-			m_hello_limit_timer.async_wait(m_greet_strand.wrap(
-						boost::bind(&server::do_hello_reset_limit, this,
-							boost::asio::placeholders::error)));
-		}
-	}
-
 	void server::do_set_hello_message_received_callback(hello_message_received_handler_type callback, void_handler_type handler)
 	{
 		// All do_set_hello_message_received_callback() calls are done in the same strand so the following is thread-safe.
@@ -1368,7 +1511,7 @@ namespace fscp
 		return false;
 	}
 
-	void server::do_introduce_to(const ep_type& target, simple_handler_type handler)
+	void server::do_introduce_to(const ep_type& target, bool hash_only, simple_handler_type handler)
 	{
 		// All do_introduce_to() calls are done in the same strand so the following is thread-safe.
 		if (!m_socket.is_open())
@@ -1383,11 +1526,17 @@ namespace fscp
 
 		try
 		{
-			const size_t size = presentation_message::write(
-				buffer_cast<uint8_t*>(send_buffer),
-				buffer_size(send_buffer),
-				identity.signature_certificate()
-			);
+			const size_t size = (hash_only && identity.signature_certificate_hash()) ?
+				presentation_message::write_hash(
+					buffer_cast<uint8_t*>(send_buffer),
+					buffer_size(send_buffer),
+					*identity.signature_certificate_hash()
+				) :
+				presentation_message::write(
+					buffer_cast<uint8_t*>(send_buffer),
+					buffer_size(send_buffer),
+					identity.signature_certificate()
+				);
 
 			async_send_to(
 				send_buffer,
@@ -1452,9 +1601,24 @@ namespace fscp
 
 	void server::handle_presentation_message_from(const identity_store& identity, const presentation_message& _presentation_message, const ep_type& sender)
 	{
-		const auto signature_certificate = _presentation_message.signature_certificate();
+		const boost::optional<hash_type> signature_certificate_hash = _presentation_message.signature_certificate_hash();
+		cert_type signature_certificate;
+
+		if (signature_certificate_hash)
+		{
+			if (_presentation_message.is_hash_only())
+			{
+				// If the certificate is not in the cache, the presentation store for the sender may still know it.
+				signature_certificate = m_certificate_cache.find(*signature_certificate_hash);
+			}
+			else
+			{
+				// Hosts present themselves repeatedly: we only parse certificates we have not seen recently.
+				signature_certificate = m_certificate_cache.get(_presentation_message.signature_certificate_der(), _presentation_message.signature_certificate_der_size(), *signature_certificate_hash);
+			}
+		}
 
-		async_has_session_with_endpoint(sender, [this, identity, sender, signature_certificate](bool has_session) {
+		async_has_session_with_endpoint(sender, [this, identity, sender, signature_certificate, signature_certificate_hash](bool has_session) {
 			m_presentation_strand.post(
 				boost::bind(
 					&server::do_handle_presentation,
@@ -1462,43 +1626,36 @@ namespace fscp
 					identity,
 					sender,
 					has_session,
-					signature_certificate
+					signature_certificate,
+					signature_certificate_hash
 				)
 			);
 		});
 	}
 
-	void server::do_handle_presentation(const identity_store& identity, const ep_type& sender, bool has_session, cert_type signature_certificate)
+	void server::do_handle_presentation(const identity_store& identity, const ep_type& sender, bool has_session, cert_type signature_certificate, const boost::optional<hash_type>& signature_certificate_hash)
 	{
 		// All do_handle_presentation() calls are done in the same strand so the following is thread-safe.
-		std::map<ep_type, size_t>::iterator sender_presentation = m_presentation_requests_map.find(sender);
+		presentation_status_type presentation_status = PS_FIRST;
 
-		if(sender_presentation == m_presentation_requests_map.end())
-		{
-			// new presentation
-			m_presentation_requests_map[sender] = 1;
-		}
-		else if(m_presentation_requests_map[sender] >= (m_presentation_max_per_second * 10))
-		{
-			// in 10s we have reach limits! Presentation flood?
-			m_logger(log_level::warning) <<
-				"Received too many PRESENTATION messages from " << sender <<
-				", limit is " << (m_presentation_max_per_second * 10) <<
-				" messages per 10 seconds";
-			return;
-		}
-		else
+		const presentation_store_map::iterator entry = m_presentation_store_map.find(sender);
+
+		if (signature_certificate_hash && !signature_certificate)
 		{
-			m_presentation_requests_map[sender]++;
-		}
+			// This is a hash-only presentation for a certificate that is not in the cache.
+			if ((entry == m_presentation_store_map.end()) || (entry->second.signature_certificate_hash() != signature_certificate_hash))
+			{
+				m_logger(log_level::trace) << "Received a hash-only PRESENTATION from " << sender << " for an unknown certificate (" << *signature_certificate_hash << "). Ignoring.";
 
-		presentation_status_type presentation_status = PS_FIRST;
+				return;
+			}
 
-		const presentation_store_map::iterator entry = m_presentation_store_map.find(sender);
+			signature_certificate = entry->second.signature_certificate();
+		}
 
 		if (entry != m_presentation_store_map.end())
 		{
-			if (compare_certificates(entry->second.signature_certificate(), signature_certificate))
+			if (entry->second.signature_certificate_hash() == signature_certificate_hash)
 			{
 				presentation_status = PS_SAME;
 			}
@@ -1516,22 +1673,7 @@ namespace fscp
 			}
 		}
 
-		m_presentation_store_map[sender] = presentation_store(signature_certificate, identity.pre_shared_key());
-	}
-
-	void server::do_presentation_reset_limit(const boost::system::error_code& ec)
-	{
-		// All do_presentation_reset_limit calls are done in the same strand so the following is thread-safe.
-		if (ec != boost::asio::error::operation_aborted)
-		{
-			m_presentation_requests_map.clear();
-
-			// rearm timer again
-			m_presentation_limit_timer.expires_from_now(boost::posix_time::seconds(10));
-			m_presentation_limit_timer.async_wait(m_presentation_strand.wrap(
-						boost::bind(&server::do_presentation_reset_limit, this,
-							boost::asio::placeholders::error)));
-		}
+		m_presentation_store_map[sender] = presentation_store(signature_certificate, signature_certificate_hash, identity.pre_shared_key());
 	}
 
 	void server::do_set_presentation_message_received_callback(presentation_message_received_handler_type callback, void_handler_type handler)
@@ -1770,8 +1912,7 @@ namespace fscp
 			{
 				m_logger(log_level::trace) << "Received a SESSION_REQUEST from " << sender << " with session number " << _session_request_message.session_number() << " and cipher suite " << calg << "_" << ec << ". No current session exist: preparing one and sending it.";
 
-				p_session.prepare_session(_session_request_message.session_number(), calg, ec);
-				do_send_session(identity, sender, p_session.next_session_parameters());
+				do_prepare_and_send_session(identity, sender, p_session, _session_request_message.session_number(), calg, ec);
 			}
 			else
 			{
@@ -1782,8 +1923,7 @@ namespace fscp
 					m_logger(log_level::trace) << "Received a SESSION_REQUEST from " << sender << " with session number " << _session_request_message.session_number() << " and cipher suite " << calg << "_" << ec << ". A current session exists but has the number " << p_session.current_session().parameters.session_number << ": preparing a new session and sending it.";
 
 					// A new session is requested. Sending a new message.
-					p_session.prepare_session(_session_request_message.session_number(), calg, ec);
-					do_send_session(identity, sender, p_session.next_session_parameters());
+					do_prepare_and_send_session(identity, sender, p_session, _session_request_message.session_number(), calg, ec);
 				}
 				else
 				{
@@ -2068,50 +2208,165 @@ namespace fscp
 		}
 		else
 		{
-			bool session_completed = true;
-
-			try
+			if (!p_session.has_next_session())
 			{
-				if (!p_session.complete_session(_session_message.public_key(), _session_message.public_key_size()))
-				{
-					m_logger(log_level::trace) << "Received a SESSION from " << sender << " with session number " << _session_message.session_number() << " but no session was prepared yet. Preparing a new one.";
+				m_logger(log_level::trace) << "Received a SESSION from " << sender << " with session number " << _session_message.session_number() << " but no session was prepared yet. Preparing a new one in the background.";
+
+				// We received a session message but no session was prepared yet: we issue one outside of the session strand and complete it afterwards.
+				const std::vector<uint8_t> public_key(_session_message.public_key(), _session_message.public_key() + _session_message.public_key_size());
+
+				get_io_service().post(
+					boost::bind(
+						&server::do_prepare_next_session,
+						this,
+						sender,
+						_session_message.session_number(),
+						_session_message.cipher_suite(),
+						_session_message.elliptic_curve(),
+						next_session_handler_type(boost::bind(&server::do_complete_prepared_session, this, identity, sender, _1, public_key))
+					)
+				);
 
-					// We received a session message but no session was prepared yet: we issue one and retry.
-					p_session.prepare_session(_session_message.session_number(), _session_message.cipher_suite(), _session_message.elliptic_curve());
+				return;
+			}
 
-					if (!p_session.complete_session(_session_message.public_key(), _session_message.public_key_size()))
-					{
-						// Unable to complete the session.
-						m_logger(log_level::warning) << "Unable to compute the session keys with " << sender << ".";
+			do_complete_session(identity, sender, p_session, _session_message.public_key(), _session_message.public_key_size());
+		}
+	}
 
-						return;
-					}
-				}
+	void server::do_complete_session(const identity_store& identity, const ep_type& sender, peer_session& p_session, const void* public_key, size_t public_key_size)
+	{
+		// All do_complete_session() calls are done in the session strand so the following is thread-safe.
+		const bool session_is_new = !p_session.has_current_session();
+		bool session_completed = true;
+
+		try
+		{
+			if (!p_session.complete_session(public_key, public_key_size))
+			{
+				// Unable to complete the session.
+				m_logger(log_level::warning) << "Unable to compute the session keys with " << sender << ".";
+
+				return;
 			}
-			catch (const std::exception& ex)
+		}
+		catch (const std::exception& ex)
+		{
+			session_completed = false;
+
+			m_logger(log_level::error) << "Exception while computing the session keys with " << sender << ": " << ex.what() << ".";
+
+			if (m_session_error_handler)
 			{
-				session_completed = false;
+				m_session_error_handler(sender, session_is_new, ex);
+			}
+		}
 
-				m_logger(log_level::error) << "Exception while computing the session keys with " << sender << ": " << ex.what() << ".";
+		if (session_completed)
+		{
+			m_logger(log_level::trace) << "Session established with " << sender << ". Sending acknowledgement session message back.";
 
-				if (m_session_error_handler)
-				{
-					m_session_error_handler(sender, session_is_new, ex);
-				}
+			do_send_session(identity, sender, p_session.current_session_parameters());
+
+			do_schedule_keep_alive(sender, p_session);
+
+			if (!p_session.path_mtu().is_started())
+			{
+				do_start_path_mtu_discovery(sender, p_session);
 			}
 
-			if (session_completed)
+			if (m_session_established_handler)
 			{
-				m_logger(log_level::trace) << "Session established with " << sender << ". Sending acknowledgement session message back.";
+				m_session_established_handler(sender, session_is_new, p_session.current_session().parameters.cipher_suite, p_session.current_session().parameters.elliptic_curve);
+			}
+		}
+	}
 
-				do_send_session(identity, sender, p_session.current_session_parameters());
+	void server::do_prepare_and_send_session(const identity_store& identity, const ep_type& target, peer_session& p_session, session_number_type session_number, cipher_suite_type cipher_suite, elliptic_curve_type elliptic_curve)
+	{
+		// All do_prepare_and_send_session() calls are done in the session strand so the following is thread-safe.
+		if (p_session.has_next_session())
+		{
+			const peer_session::session_parameters& parameters = p_session.next_session_parameters();
 
-				if (m_session_established_handler)
-				{
-					m_session_established_handler(sender, session_is_new, p_session.current_session().parameters.cipher_suite, p_session.current_session().parameters.elliptic_curve);
-				}
+			if ((parameters.session_number == session_number) && (parameters.cipher_suite == cipher_suite) && (parameters.elliptic_curve == elliptic_curve))
+			{
+				// The session in preparation matches the requested one: sending it again so that the private DH key stays the same.
+				do_send_session(identity, target, parameters);
+
+				return;
 			}
 		}
+
+		// The ECDHE key generation is expensive: we do it outside of the session strand so that data messages keep flowing with the current session in the meantime.
+		get_io_service().post(
+			boost::bind(
+				&server::do_prepare_next_session,
+				this,
+				target,
+				session_number,
+				cipher_suite,
+				elliptic_curve,
+				next_session_handler_type(boost::bind(&server::do_send_prepared_session, this, identity, target, _1))
+			)
+		);
+	}
+
+	void server::do_prepare_next_session(const ep_type& target, session_number_type session_number, cipher_suite_type cipher_suite, elliptic_curve_type elliptic_curve, next_session_handler_type handler)
+	{
+		// This is called outside of any strand: it must not access any shared member.
+		try
+		{
+			const auto next_session = boost::make_shared<peer_session::next_session_type>(session_number, cipher_suite, elliptic_curve);
+
+			m_session_strand.post(boost::bind(handler, next_session));
+		}
+		catch (const std::exception& ex)
+		{
+			m_logger(log_level::error) << "Error preparing a session with " << target << ": " << ex.what() << ".";
+		}
+	}
+
+	void server::do_send_prepared_session(const identity_store& identity, const ep_type& target, boost::shared_ptr<peer_session::next_session_type> next_session)
+	{
+		// All do_send_prepared_session() calls are done in the session strand so the following is thread-safe.
+		const auto p_session = m_peer_sessions.find(target);
+
+		if (p_session == m_peer_sessions.end())
+		{
+			return;
+		}
+
+		if (p_session->second.has_current_session() && (next_session->parameters.session_number <= p_session->second.current_session().parameters.session_number))
+		{
+			// The session was renewed in the meantime.
+			return;
+		}
+
+		p_session->second.set_next_session(next_session);
+
+		do_send_session(identity, target, p_session->second.next_session_parameters());
+	}
+
+	void server::do_complete_prepared_session(const identity_store& identity, const ep_type& sender, boost::shared_ptr<peer_session::next_session_type> next_session, const std::vector<uint8_t>& public_key)
+	{
+		// All do_complete_prepared_session() calls are done in the session strand so the following is thread-safe.
+		const auto p_session = m_peer_sessions.find(sender);
+
+		if (p_session == m_peer_sessions.end())
+		{
+			return;
+		}
+
+		if (p_session->second.has_current_session() && (next_session->parameters.session_number <= p_session->second.current_session().parameters.session_number))
+		{
+			// The session was renewed in the meantime.
+			return;
+		}
+
+		p_session->second.set_next_session(next_session);
+
+		do_complete_session(identity, sender, p_session->second, &public_key[0], public_key.size());
 	}
 
 	void server::do_set_accept_session_messages_default(bool value, void_handler_type handler)
@@ -2180,6 +2435,68 @@ namespace fscp
 		}
 	}
 
+	void server::do_check_session_renewal(const ep_type& target, peer_session& p_session)
+	{
+		// All do_check_session_renewal() calls are done in the session strand so the following is thread-safe.
+		if (!p_session.must_renew(m_session_renewal_period, m_session_renewal_data_size))
+		{
+			return;
+		}
+
+		p_session.start_renewal();
+
+		m_logger(log_level::trace) << "Session with " << target << " (session number: " << p_session.current_session().parameters.session_number << ") is getting old. Preparing a new session in the background.";
+
+		// The ECDHE key generation is expensive: we do it outside of the session strand so that data messages keep flowing with the current session in the meantime.
+		get_io_service().post(
+			boost::bind(
+				&server::do_prepare_session_renewal,
+				this,
+				target,
+				p_session.next_session_number(),
+				p_session.current_session().parameters.cipher_suite,
+				p_session.current_session().parameters.elliptic_curve
+			)
+		);
+	}
+
+	void server::do_prepare_session_renewal(const ep_type& target, session_number_type session_number, cipher_suite_type cipher_suite, elliptic_curve_type elliptic_curve)
+	{
+		// This is called outside of any strand: it must not access any shared member.
+		try
+		{
+			const auto next_session = boost::make_shared<peer_session::next_session_type>(session_number, cipher_suite, elliptic_curve);
+
+			async_get_identity(m_session_strand.wrap(boost::bind(&server::do_renew_session, this, _1, target, next_session)));
+		}
+		catch (const std::exception& ex)
+		{
+			m_logger(log_level::error) << "Error preparing the session renewal with " << target << ": " << ex.what() << ".";
+		}
+	}
+
+	void server::do_renew_session(const identity_store& identity, const ep_type& target, boost::shared_ptr<peer_session::next_session_type> next_session)
+	{
+		// All do_renew_session() calls are done in the session strand so the following is thread-safe.
+		const auto p_session = m_peer_sessions.find(target);
+
+		if ((p_session == m_peer_sessions.end()) || !p_session->second.has_current_session())
+		{
+			// The session was lost in the meantime.
+			return;
+		}
+
+		if (next_session->parameters.session_number <= p_session->second.current_session().parameters.session_number)
+		{
+			// The remote host renewed the session in the meantime.
+			return;
+		}
+
+		p_session->second.set_next_session(next_session);
+
+		do_send_session(identity, target, p_session->second.next_session_parameters());
+	}
+
 	void server::do_send_data(const ep_type& target, channel_number_type channel_number, boost::asio::const_buffer data, simple_handler_type handler)
 	{
 		// All do_send_data() calls are done in the session strand so the following is thread-safe.
@@ -2251,6 +2568,8 @@ namespace fscp
 				buffer_size(p_session.current_session().local_nonce_prefix)
 			);
 
+			p_session.increment_data_size(buffer_size(data));
+
 			// disable buffer recycling from now (possible issue with SharedBuffer
 			// which references itself due to lambda capture)
 			async_send_to(
@@ -2266,6 +2585,10 @@ namespace fscp
 				target,
 				handler
 			);
+
+			p_session.data_sent();
+
+			do_check_session_renewal(target, p_session);
 		}
 		catch (const boost::system::system_error& ex)
 		{
@@ -2342,6 +2665,8 @@ namespace fscp
 				target,
 				handler
 			);
+
+			p_session.data_sent();
 		}
 		catch (const boost::system::system_error& ex)
 		{
@@ -2418,6 +2743,8 @@ namespace fscp
 				target,
 				handler
 			);
+
+			p_session.data_sent();
 		}
 		catch (const boost::system::system_error& ex)
 		{
@@ -2425,7 +2752,7 @@ namespace fscp
 		}
 	}
 
-	void server::do_handle_data(const identity_store& identity, const ep_type& sender, const data_message& _data_message)
+	void server::do_handle_data(const ep_type& sender, const data_message& _data_message)
 	{
 		// All do_handle_data() calls are done in the same strand so the following is thread-safe.
 		peer_session& p_session = m_peer_sessions[sender];
@@ -2437,14 +2764,6 @@ namespace fscp
 			return;
 		}
 
-		if (_data_message.sequence_number() <= p_session.current_session().remote_sequence_number)
-		{
-			// The message is outdated: we ignore it.
-			m_logger(log_level::trace) << "Received a data message from " << sender << " but its sequence number is outdated (received: " << _data_message.sequence_number() << ", expecting: " << p_session.current_session().remote_sequence_number << "). Ignoring.";
-
-			return;
-		}
-
 		// Get either a new buffer or an old, recycled one if possible.
 		const SharedBuffer cleartext_buffer = m_session_buffers.empty() ? SharedBuffer(65536) : [this]() {
 			const auto result = m_session_buffers.front();
@@ -2453,56 +2772,101 @@ namespace fscp
 			return result;
 		}();
 
-		try
-		{
-			const size_t cleartext_len = _data_message.get_cleartext(
+		const auto get_cleartext = [&cleartext_buffer, &_data_message] (const peer_session::current_session_type& session) {
+			return _data_message.get_cleartext(
 				buffer_cast<uint8_t*>(cleartext_buffer),
 				buffer_size(cleartext_buffer),
-				p_session.current_session().parameters.cipher_suite.to_cipher_algorithm(),
-				buffer_cast<const uint8_t*>(p_session.current_session().remote_session_key),
-				buffer_size(p_session.current_session().remote_session_key),
-				buffer_cast<const uint8_t*>(p_session.current_session().remote_nonce_prefix),
-				buffer_size(p_session.current_session().remote_nonce_prefix)
+				session.parameters.cipher_suite.to_cipher_algorithm(),
+				buffer_cast<const uint8_t*>(session.remote_session_key),
+				buffer_size(session.remote_session_key),
+				buffer_cast<const uint8_t*>(session.remote_nonce_prefix),
+				buffer_size(session.remote_nonce_prefix)
 			);
+		};
 
-			p_session.set_remote_sequence_number(_data_message.sequence_number());
-			p_session.keep_alive();
+		size_t cleartext_len = 0;
+		bool deciphered = false;
 
-			if (p_session.current_session().is_old())
+		if (_data_message.sequence_number() > p_session.current_session().remote_sequence_number)
+		{
+			try
 			{
-				// do_send_clear_session() and do_handle_data() are to be invoked through the same strand, so this is fine.
-				p_session.prepare_session(p_session.next_session_number(), p_session.current_session().parameters.cipher_suite, p_session.current_session().parameters.elliptic_curve);
-				do_send_session(identity, sender, p_session.next_session_parameters());
+				cleartext_len = get_cleartext(p_session.current_session());
+				deciphered = true;
+
+				p_session.set_remote_sequence_number(_data_message.sequence_number());
+				p_session.increment_data_size(cleartext_len);
 			}
+			catch (const boost::system::system_error& ex)
+			{
+				if (!p_session.has_previous_session())
+				{
+					m_logger(log_level::error) << "Error deciphering data message from " << sender << ": " << ex.what();
 
-			const message_type type = _data_message.type();
+					return;
+				}
+			}
+		}
 
-			if (type == MESSAGE_TYPE_KEEP_ALIVE)
+		if (!deciphered)
+		{
+			// The message may have been sent right before the remote host switched to the new session: we try the previous one while its grace period lasts.
+			if (!p_session.has_previous_session() || (_data_message.sequence_number() <= p_session.previous_session().remote_sequence_number))
 			{
-				// If the message is a keep alive then nothing is to be done and we avoid posting an empty call into the data strand.
+				// The message is outdated: we ignore it.
+				m_logger(log_level::trace) << "Received a data message from " << sender << " but its sequence number is outdated (received: " << _data_message.sequence_number() << ", expecting: " << p_session.current_session().remote_sequence_number << "). Ignoring.";
+
 				return;
 			}
 
-			// This call is fast so we hold on to the data_message a bit longer.
-			do_handle_data_message(
-				sender,
-				type,
-				/*
-				SharedBuffer(cleartext_buffer, [this] (const SharedBuffer& buffer) {
-					m_session_strand.post([this, buffer] () {
-						m_session_buffers.push_back(buffer);
-					});
-				}),
-				*/
-				cleartext_buffer,
-				buffer(cleartext_buffer, cleartext_len)
-			);
+			try
+			{
+				cleartext_len = get_cleartext(p_session.previous_session());
+
+				p_session.set_previous_remote_sequence_number(_data_message.sequence_number());
+			}
+			catch (const boost::system::system_error& ex)
+			{
+				m_logger(log_level::error) << "Error deciphering data message from " << sender << ": " << ex.what();
+
+				return;
+			}
 		}
-		catch (const boost::system::system_error& ex)
+
+		p_session.keep_alive();
+
+		do_check_session_renewal(sender, p_session);
+
+		const message_type type = _data_message.type();
+
+		if (type == MESSAGE_TYPE_KEEP_ALIVE)
 		{
-			// This can happen if a message is decoded after a session rekeying.
-			m_logger(log_level::error) << "Error deciphering data message from " << sender << ": " << ex.what();
+			data_message::path_mtu_probe_type probe_type;
+			size_t probe_size = 0;
+
+			if (data_message::parse_path_mtu_probe(buffer_cast<const uint8_t*>(cleartext_buffer), cleartext_len, probe_type, probe_size))
+			{
+				do_handle_path_mtu_probe(sender, p_session, probe_type, probe_size, _data_message.size());
+			}
+
+			// If the message is a keep alive then nothing else is to be done and we avoid posting an empty call into the data strand.
+			return;
 		}
+
+		// This call is fast so we hold on to the data_message a bit longer.
+		do_handle_data_message(
+			sender,
+			type,
+			/*
+			SharedBuffer(cleartext_buffer, [this] (const SharedBuffer& buffer) {
+				m_session_strand.post([this, buffer] () {
+					m_session_buffers.push_back(buffer);
+				});
+			}),
+			*/
+			cleartext_buffer,
+			buffer(cleartext_buffer, cleartext_len)
+		);
 	}
 
 	void server::do_handle_data_message(const ep_type& sender, message_type type, SharedBuffer buffer, boost::asio::const_buffer data)
@@ -2628,32 +2992,84 @@ namespace fscp
 		}
 	}
 
+	void server::do_schedule_keep_alive(const ep_type& target, peer_session& p_session)
+	{
+		// All do_schedule_keep_alive() calls are done in the same strand so the following is thread-safe.
+		const coarse_clock::time_point now = coarse_clock::now();
+		const int64_t jitter = SESSION_KEEP_ALIVE_JITTER.total_milliseconds();
+		boost::random::uniform_int_distribution<int64_t> jitter_distribution(-jitter, jitter);
+
+		// The next keep-alive is due one jittered period after the last message we sent.
+		coarse_clock::time_point deadline = p_session.last_data_sent();
+
+		if (deadline.is_not_a_date_time() || (deadline > now))
+		{
+			deadline = now;
+		}
+
+		deadline += SESSION_KEEP_ALIVE_PERIOD + boost::posix_time::milliseconds(jitter_distribution(m_keep_alive_jitter_generator));
+
+		// We must wake up in time to detect the session timeout too.
+		deadline = std::min(deadline, p_session.last_sign_of_life() + SESSION_TIMEOUT);
+
+		const int64_t tick = SESSION_KEEP_ALIVE_TICK.total_milliseconds();
+		const int64_t delay = (deadline - now).total_milliseconds();
+
+		m_keep_alive_wheel.schedule(target, static_cast<size_t>(std::max<int64_t>((delay + tick - 1) / tick, 1)));
+	}
+
 	void server::do_check_keep_alive(const boost::system::error_code& ec)
 	{
 		// All do_check_keep_alive() calls are done in the same strand so the following is thread-safe.
 		if (ec != boost::asio::error::operation_aborted)
 		{
-			for (auto&& p_session: m_peer_sessions)
+			// Only the sessions whose deadline falls into the current tick are checked.
+			m_keep_alive_wheel.tick(boost::bind(&server::do_check_keep_alive_for, this, _1));
+
+			m_keep_alive_timer.expires_at(m_keep_alive_timer.expires_at() + SESSION_KEEP_ALIVE_TICK);
+			m_keep_alive_timer.async_wait(m_session_strand.wrap(boost::bind(&server::do_check_keep_alive, this, boost::asio::placeholders::error)));
+		}
+	}
+
+	void server::do_check_keep_alive_for(const ep_type& target)
+	{
+		// All do_check_keep_alive_for() calls are done in the same strand so the following is thread-safe.
+		const peer_session_map_type::iterator p_session = m_peer_sessions.find(target);
+
+		if ((p_session == m_peer_sessions.end()) || !p_session->second.has_current_session())
+		{
+			// The session was closed in the meantime: it will be scheduled again once established.
+			return;
+		}
+
+		if (p_session->second.has_timed_out(SESSION_TIMEOUT))
+		{
+			if (p_session->second.clear())
 			{
-				if (p_session.second.has_timed_out(SESSION_TIMEOUT))
-				{
-					if (p_session.second.clear())
-					{
-						if (m_session_lost_handler)
-						{
-							m_session_lost_handler(p_session.first, session_loss_reason::timeout);
-						}
-					}
-				}
-				else
+				if (m_session_lost_handler)
 				{
-					do_send_keep_alive(p_session.first, &null_simple_handler);
+					m_session_lost_handler(target, session_loss_reason::timeout);
 				}
 			}
 
-			m_keep_alive_timer.expires_from_now(SESSION_KEEP_ALIVE_PERIOD);
-			m_keep_alive_timer.async_wait(m_session_strand.wrap(boost::bind(&server::do_check_keep_alive, this, boost::asio::placeholders::error)));
+			return;
+		}
+
+		const coarse_clock::time_point last_data_sent = p_session->second.last_data_sent();
+
+		// A session that sent some data recently does not need a keep-alive: the remote host already got a sign of life.
+		if (last_data_sent.is_not_a_date_time() || (coarse_clock::now() >= last_data_sent + SESSION_KEEP_ALIVE_PERIOD - SESSION_KEEP_ALIVE_JITTER))
+		{
+			do_send_keep_alive(target, &null_simple_handler);
 		}
+
+		// Idle sessions must also be renewed when they get too old.
+		do_check_session_renewal(target, p_session->second);
+
+		// Lost path MTU probes are sent again at the keep-alive pace.
+		do_check_path_mtu(target, p_session->second);
+
+		do_schedule_keep_alive(target, p_session->second);
 	}
 
 	void server::do_send_keep_alive(const ep_type& target, simple_handler_type handler)
@@ -2675,7 +3091,7 @@ namespace fscp
 			return;
 		}
 
-		const auto send_buffer = SharedBuffer(1024);
+		const auto send_buffer = SharedBuffer(data_message::required_buffer_size(SESSION_KEEP_ALIVE_DATA_SIZE, p_session.current_session().parameters.cipher_suite.to_cipher_algorithm()));
 
 		try
 		{
@@ -2697,6 +3113,8 @@ namespace fscp
 				target,
 				handler
 			);
+
+			p_session.data_sent();
 		}
 		catch (const boost::system::system_error& ex)
 		{
@@ -2704,6 +3122,136 @@ namespace fscp
 		}
 	}
 
+	void server::do_set_path_mtu_changed_callback(path_mtu_changed_handler_type callback, void_handler_type handler)
+	{
+		// All do_set_path_mtu_changed_callback() calls are done in the same strand so the following is thread-safe.
+		set_path_mtu_changed_callback(callback);
+
+		if (handler)
+		{
+			handler();
+		}
+	}
+
+	void server::do_start_path_mtu_discovery(const ep_type& target, peer_session& p_session)
+	{
+		// All do_start_path_mtu_discovery() calls are done in the same strand so the following is thread-safe.
+		if (!m_path_mtu_discovery_enabled)
+		{
+			return;
+		}
+
+		if (!dont_fragment_guard::is_supported())
+		{
+			m_logger(log_level::warning) << "Path MTU discovery is not supported on this system: not probing " << target << ".";
+
+			return;
+		}
+
+		p_session.path_mtu().start(PATH_MTU_MIN_DATAGRAM_SIZE, target.address().is_v4() ? PATH_MTU_MAX_IPV4_DATAGRAM_SIZE : PATH_MTU_MAX_IPV6_DATAGRAM_SIZE);
+
+		do_check_path_mtu(target, p_session);
+	}
+
+	void server::do_check_path_mtu(const ep_type& target, peer_session& p_session)
+	{
+		// All do_check_path_mtu() calls are done in the same strand so the following is thread-safe.
+		const size_t previous_size = p_session.path_mtu().max_datagram_size();
+		const boost::optional<size_t> probe_size = p_session.path_mtu().next_probe(coarse_clock::now());
+
+		// Lost probes may have lowered the discovered size.
+		if ((p_session.path_mtu().max_datagram_size() != previous_size) && m_path_mtu_changed_handler)
+		{
+			m_path_mtu_changed_handler(target, p_session.path_mtu().max_datagram_size());
+		}
+
+		if (probe_size)
+		{
+			do_send_path_mtu_probe(target, p_session, data_message::path_mtu_probe_type::probe, *probe_size);
+		}
+	}
+
+	void server::do_handle_path_mtu_probe(const ep_type& sender, peer_session& p_session, data_message::path_mtu_probe_type type, size_t probe_size, size_t datagram_size)
+	{
+		// All do_handle_path_mtu_probe() calls are done in the same strand so the following is thread-safe.
+		if (type == data_message::path_mtu_probe_type::probe)
+		{
+			// A probe that does not have the size it claims was tampered with or reassembled: acknowledging it would be a lie.
+			if (probe_size == datagram_size)
+			{
+				do_send_path_mtu_probe(sender, p_session, data_message::path_mtu_probe_type::acknowledgement, probe_size);
+			}
+		}
+		else
+		{
+			m_logger(log_level::trace) << "Path MTU probe of " << probe_size << " byte(s) acknowledged by " << sender << ".";
+
+			if (p_session.path_mtu().probe_acknowledged(probe_size) && m_path_mtu_changed_handler)
+			{
+				m_path_mtu_changed_handler(sender, p_session.path_mtu().max_datagram_size());
+			}
+
+			// Only the lost probes wait for the keep-alive timer: the search goes on at once.
+			do_check_path_mtu(sender, p_session);
+		}
+	}
+
+	void server::do_send_path_mtu_probe(const ep_type& target, peer_session& p_session, data_message::path_mtu_probe_type type, size_t probe_size)
+	{
+		// All do_send_path_mtu_probe() calls are done in the same strand so the following is thread-safe.
+		if (!m_socket.is_open() || !p_session.has_current_session())
+		{
+			return;
+		}
+
+		const auto send_buffer = SharedBuffer(data_message::required_buffer_size(data_message::max_cleartext_size(probe_size), p_session.current_session().parameters.cipher_suite.to_cipher_algorithm()));
+
+		try
+		{
+			const size_t size = data_message::write_path_mtu_probe(
+				buffer_cast<uint8_t*>(send_buffer),
+				buffer_size(send_buffer),
+				p_session.increment_local_sequence_number(),
+				p_session.current_session().parameters.cipher_suite.to_cipher_algorithm(),
+				type,
+				probe_size,
+				buffer_cast<const uint8_t*>(p_session.current_session().local_session_key),
+				buffer_size(p_session.current_session().local_session_key),
+				buffer_cast<const uint8_t*>(p_session.current_session().local_nonce_prefix),
+				buffer_size(p_session.current_session().local_nonce_prefix)
+			);
+
+			if (type == data_message::path_mtu_probe_type::probe)
+			{
+				async_send_unfragmented_to(send_buffer, size, target);
+			}
+			else
+			{
+				async_send_to(send_buffer, size, target, &null_simple_handler);
+			}
+
+			p_session.data_sent();
+		}
+		catch (const std::exception& ex)
+		{
+			m_logger(log_level::warning) << "Failed to send a path MTU probe to " << target << ": " << ex.what();
+		}
+	}
+
+	void server::async_send_unfragmented_to(const SharedBuffer& data, size_t size, const ep_type& target)
+	{
+		// This is an exclusive write: it starts once the previous datagrams have left the socket, and the next ones wait for it. No other datagram is sent while the socket forbids fragmentation.
+		const void_handler_type write_handler = [this, data, size, target] () {
+			const dont_fragment_guard guard(m_socket);
+
+			// A probe bigger than the MTU known to the system fails at once: this is the same as a lost probe.
+			boost::system::error_code ec;
+			m_socket.send_to(buffer(data, size), to_socket_format(target), 0, ec);
+		};
+
+		m_write_queue_strand.post(boost::bind(&server::push_write, this, write_handler, true));
+	}
+
 	std::ostream& operator<<(std::ostream& os, server::session_loss_reason value)
 	{
 		switch (value)
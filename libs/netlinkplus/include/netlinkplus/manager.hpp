@@ -46,8 +46,12 @@
 
 #include <boost/asio.hpp>
 #include <boost/optional.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <string>
+#include <vector>
+#include <array>
 
 #include "protocol.hpp"
 
@@ -143,6 +147,42 @@ namespace netlinkplus
 		boost::optional<std::string> label;
 	};
 
+	/**
+	 * \brief A route operation, to be sent along others in a batch.
+	 */
+	struct route_operation
+	{
+		/**
+		 * \brief The action type.
+		 */
+		enum class action_type
+		{
+			add,
+			remove
+		};
+
+		route_operation() :
+			action(action_type::add),
+			destination_length{}
+		{
+		}
+
+		route_operation(action_type action_, const interface_entry& interface_, const boost::asio::ip::address& destination_, unsigned int destination_length_, boost::optional<boost::asio::ip::address> gateway_ = boost::optional<boost::asio::ip::address>()) :
+			action(action_),
+			interface(interface_),
+			destination(destination_),
+			destination_length(destination_length_),
+			gateway(gateway_)
+		{
+		}
+
+		action_type action;
+		interface_entry interface;
+		boost::asio::ip::address destination;
+		unsigned int destination_length;
+		boost::optional<boost::asio::ip::address> gateway;
+	};
+
 	/**
 	 * \brief Manage routes.
 	 */
@@ -150,6 +190,25 @@ namespace netlinkplus
 	{
 		public:
 
+			/**
+			 * \brief The results of a batch: one error code per operation, in the same order.
+			 */
+			typedef std::vector<boost::system::error_code> batch_results_type;
+
+			/**
+			 * \brief The batch handler type.
+			 *
+			 * The first parameter is set if the batch could not be sent or its acknowledgements not received. In that case, the operations that were not acknowledged get that same error.
+			 */
+			typedef boost::function<void (const boost::system::error_code&, const batch_results_type&)> batch_handler_type;
+
+			/**
+			 * \brief The maximum count of operations that are sent in a single datagram.
+			 *
+			 * The kernel queues all the acknowledgements of a datagram before we get a chance to read them: this bounds the space they take in the receive buffer.
+			 */
+			static const size_t MAX_BATCH_SIZE = 64;
+
 			/**
 			 * \brief Create a route manager.
 			 */
@@ -180,6 +239,24 @@ namespace netlinkplus
 			 */
 			void remove_route(const interface_entry& interface, const boost::asio::ip::address& destination, unsigned int destination_length, boost::optional<boost::asio::ip::address> gateway = boost::optional<boost::asio::ip::address>());
 
+			/**
+			 * \brief Add and remove route entries, sending several operations per datagram.
+			 * \param operations The operations.
+			 * \return The result of each operation.
+			 *
+			 * An operation that fails does not prevent the next ones from being applied.
+			 */
+			batch_results_type set_routes(const std::vector<route_operation>& operations);
+
+			/**
+			 * \brief Add and remove route entries asynchronously, sending several operations per datagram.
+			 * \param operations The operations.
+			 * \param handler The handler to call when all the operations were acknowledged.
+			 *
+			 * No other operation must be done on the manager until the handler is called.
+			 */
+			void async_set_routes(const std::vector<route_operation>& operations, batch_handler_type handler);
+
 			/**
 			 * \brief Add an interface address.
 			 * \param interface The interface to set the address on.
@@ -219,6 +296,27 @@ namespace netlinkplus
 			void generic_route(uint16_t type, const interface_entry& interface, const boost::asio::ip::address& destination, unsigned int destination_length, boost::optional<boost::asio::ip::address> gateway);
 			void generic_interface_address(uint16_t type, const interface_entry& interface, const boost::asio::ip::address& address, size_t prefix_length, const boost::asio::ip::address& remote_address);
 
+			struct batch_type
+			{
+				std::vector<route_operation> operations;
+				batch_results_type results;
+				std::vector<bool> acknowledged;
+				size_t offset;
+				size_t count;
+				size_t pending;
+				uint32_t first_sequence;
+				std::vector<char> request_buffer;
+				std::array<char, 8192> response_buffer;
+				batch_handler_type handler;
+			};
+
+			bool prepare_batch(batch_type&);
+			void handle_batch_response(batch_type&, size_t);
+			void async_send_batch(boost::shared_ptr<batch_type>);
+			void async_receive_batch(boost::shared_ptr<batch_type>);
+			void complete_batch(boost::shared_ptr<batch_type>, const boost::system::error_code&);
+
 			netlink_route_protocol::socket m_socket;
+			uint32_t m_sequence;
 	};
 }
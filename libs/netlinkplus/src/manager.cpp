@@ -49,6 +49,10 @@
 #include <net/if.h>
 #include <errno.h>
 
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+
 namespace netlinkplus
 {
 	namespace
@@ -162,6 +166,31 @@ namespace netlinkplus
 
 			return result;
 		}
+
+		route_request_type make_route_request(uint16_t type, int flags, const interface_entry& interface, const boost::asio::ip::address& destination, unsigned int destination_length, boost::optional<boost::asio::ip::address> gateway)
+		{
+			if (type == RTM_NEWROUTE)
+			{
+				flags |= NLM_F_CREATE | NLM_F_EXCL;
+			}
+
+			route_request_type request(type, flags);
+
+			request.subheader().rtm_table = RT_TABLE_MAIN;
+			request.subheader().rtm_scope = RT_SCOPE_UNIVERSE;
+			request.subheader().rtm_type = RTN_UNICAST;
+			request.subheader().rtm_protocol = RTPROT_STATIC;
+
+			request.set_route_destination(destination, destination_length);
+			request.set_output_interface(interface.index());
+
+			if (gateway)
+			{
+				request.set_gateway(*gateway);
+			}
+
+			return request;
+		}
 	}
 
 	std::string interface_entry::name() const
@@ -194,11 +223,15 @@ namespace netlinkplus
 		return result;
 	}
 
+	const size_t manager::MAX_BATCH_SIZE;
+
 	manager::manager(boost::asio::io_service& io_service) :
-		m_socket(io_service, netlink_route_protocol::endpoint())
+		m_socket(io_service, netlink_route_protocol::endpoint()),
+		m_sequence(0)
 	{
 		m_socket.set_option(boost::asio::socket_base::send_buffer_size(32768));
-		m_socket.set_option(boost::asio::socket_base::receive_buffer_size(32768));
+		// Batches get up to MAX_BATCH_SIZE acknowledgements queued at once.
+		m_socket.set_option(boost::asio::socket_base::receive_buffer_size(262144));
 	}
 
 	route_entry manager::get_route_for(const boost::asio::ip::address& host)
@@ -251,6 +284,35 @@ namespace netlinkplus
 		generic_route(RTM_DELROUTE, interface, destination, destination_length, gateway);
 	}
 
+	manager::batch_results_type manager::set_routes(const std::vector<route_operation>& operations)
+	{
+		batch_type batch;
+		batch.operations = operations;
+
+		while (prepare_batch(batch))
+		{
+			m_socket.send(boost::asio::buffer(batch.request_buffer));
+
+			while (batch.pending > 0)
+			{
+				const size_t cnt = m_socket.receive(boost::asio::buffer(batch.response_buffer));
+
+				handle_batch_response(batch, cnt);
+			}
+		}
+
+		return batch.results;
+	}
+
+	void manager::async_set_routes(const std::vector<route_operation>& operations, batch_handler_type handler)
+	{
+		const boost::shared_ptr<batch_type> batch = boost::make_shared<batch_type>();
+		batch->operations = operations;
+		batch->handler = handler;
+
+		async_send_batch(batch);
+	}
+
 	void manager::add_interface_address(const interface_entry& interface, const boost::asio::ip::address& address, size_t prefix_length)
 	{
 		add_interface_address(interface, address, prefix_length, address);
@@ -276,29 +338,9 @@ namespace netlinkplus
 		using boost::asio::buffer_size;
 		using boost::asio::buffer_cast;
 
-		int flags = NLM_F_REQUEST | NLM_F_ACK;
-
-		if (type == RTM_NEWROUTE)
-		{
-			flags |= NLM_F_CREATE | NLM_F_EXCL;
-		}
-
-		route_request_type request(type, flags);
+		const route_request_type request = make_route_request(type, NLM_F_REQUEST | NLM_F_ACK, interface, destination, destination_length, gateway);
 		error_message_type response;
 
-		request.subheader().rtm_table = RT_TABLE_MAIN;
-		request.subheader().rtm_scope = RT_SCOPE_UNIVERSE;
-		request.subheader().rtm_type = RTN_UNICAST;
-		request.subheader().rtm_protocol = RTPROT_STATIC;
-
-		request.set_route_destination(destination, destination_length);
-		request.set_output_interface(interface.index());
-
-		if (gateway)
-		{
-			request.set_gateway(*gateway);
-		}
-
 		m_socket.send(boost::asio::buffer(request.data(), request.size()));
 		const size_t cnt = m_socket.receive(boost::asio::buffer(response.data(), response.max_size()));
 
@@ -348,4 +390,135 @@ namespace netlinkplus
 			throw boost::system::system_error(-response.subheader().error, boost::system::system_category());
 		}
 	}
+
+	bool manager::prepare_batch(batch_type& batch)
+	{
+		if (batch.results.empty())
+		{
+			batch.results.resize(batch.operations.size());
+			batch.acknowledged.resize(batch.operations.size(), false);
+			batch.offset = 0;
+			batch.count = 0;
+		}
+
+		batch.offset += batch.count;
+		batch.count = std::min(batch.operations.size() - batch.offset, MAX_BATCH_SIZE);
+		batch.pending = batch.count;
+		batch.first_sequence = m_sequence + 1;
+		batch.request_buffer.clear();
+
+		// All the messages of a batch go into a single datagram: the kernel processes them in order and acknowledges each of them.
+		for (size_t i = 0; i < batch.count; ++i)
+		{
+			const route_operation& operation = batch.operations[batch.offset + i];
+			const uint16_t type = (operation.action == route_operation::action_type::add) ? RTM_NEWROUTE : RTM_DELROUTE;
+
+			route_request_type request = make_route_request(type, NLM_F_REQUEST | NLM_F_ACK, operation.interface, operation.destination, operation.destination_length, operation.gateway);
+			request.header().nlmsg_seq = ++m_sequence;
+
+			const char* const data = static_cast<const char*>(request.data());
+			batch.request_buffer.insert(batch.request_buffer.end(), data, data + request.size());
+		}
+
+		return (batch.count > 0);
+	}
+
+	void manager::handle_batch_response(batch_type& batch, size_t cnt)
+	{
+		int len = static_cast<int>(cnt);
+
+		for (const ::nlmsghdr* header = reinterpret_cast<const ::nlmsghdr*>(batch.response_buffer.data()); NLMSG_OK(header, len); header = NLMSG_NEXT(header, len))
+		{
+			if ((header->nlmsg_type != NLMSG_ERROR) || (header->nlmsg_len < NLMSG_LENGTH(sizeof(::nlmsgerr))))
+			{
+				continue;
+			}
+
+			const uint32_t index = header->nlmsg_seq - batch.first_sequence;
+
+			// Ignore the acknowledgements of other requests.
+			if (index >= batch.count)
+			{
+				continue;
+			}
+
+			const size_t position = batch.offset + index;
+
+			if (!batch.acknowledged[position])
+			{
+				const ::nlmsgerr* const error = static_cast<const ::nlmsgerr*>(NLMSG_DATA(header));
+
+				if (error->error != 0)
+				{
+					batch.results[position] = boost::system::error_code(-error->error, boost::system::system_category());
+				}
+
+				batch.acknowledged[position] = true;
+				--batch.pending;
+			}
+		}
+	}
+
+	void manager::async_send_batch(boost::shared_ptr<batch_type> batch)
+	{
+		if (!prepare_batch(*batch))
+		{
+			complete_batch(batch, boost::system::error_code());
+
+			return;
+		}
+
+		m_socket.async_send(boost::asio::buffer(batch->request_buffer), [this, batch] (const boost::system::error_code& ec, size_t) {
+			if (ec)
+			{
+				complete_batch(batch, ec);
+			}
+			else
+			{
+				async_receive_batch(batch);
+			}
+		});
+	}
+
+	void manager::async_receive_batch(boost::shared_ptr<batch_type> batch)
+	{
+		m_socket.async_receive(boost::asio::buffer(batch->response_buffer), [this, batch] (const boost::system::error_code& ec, size_t cnt) {
+			if (ec)
+			{
+				complete_batch(batch, ec);
+
+				return;
+			}
+
+			handle_batch_response(*batch, cnt);
+
+			if (batch->pending > 0)
+			{
+				async_receive_batch(batch);
+			}
+			else
+			{
+				async_send_batch(batch);
+			}
+		});
+	}
+
+	void manager::complete_batch(boost::shared_ptr<batch_type> batch, const boost::system::error_code& ec)
+	{
+		if (ec)
+		{
+			for (size_t i = 0; i < batch->results.size(); ++i)
+			{
+				if (!batch->acknowledged[i])
+				{
+					batch->results[i] = ec;
+				}
+			}
+		}
+
+		if (batch->handler)
+		{
+			batch->handler(ec, batch->results);
+		}
+	}
 }
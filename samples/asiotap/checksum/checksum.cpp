@@ -0,0 +1,205 @@
+/**
+ * \file checksum.cpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief A sample that verifies and benchmarks the checksum implementations.
+ */
+
+#include <asiotap/osi/checksum.hpp>
+#include <asiotap/osi/checksum_helper.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock clock_type;
+
+	const asiotap::osi::checksum_implementation implementations[] = {
+		asiotap::osi::CI_SCALAR,
+		asiotap::osi::CI_SSE2,
+		asiotap::osi::CI_AVX2,
+		asiotap::osi::CI_NEON
+	};
+
+	const char* implementation_name(asiotap::osi::checksum_implementation implementation)
+	{
+		switch (implementation)
+		{
+			case asiotap::osi::CI_SCALAR:
+				return "scalar";
+			case asiotap::osi::CI_SSE2:
+				return "sse2";
+			case asiotap::osi::CI_AVX2:
+				return "avx2";
+			case asiotap::osi::CI_NEON:
+				return "neon";
+		}
+
+		return "unknown";
+	}
+
+	// The textbook definition from RFC 1071, byte by byte, in network byte order.
+	uint16_t reference_checksum(const uint8_t* buf, size_t buf_len)
+	{
+		uint32_t sum = 0;
+
+		for (size_t i = 0; i < buf_len; i += 2)
+		{
+			sum += static_cast<uint32_t>(buf[i]) << 8;
+
+			if (i + 1 < buf_len)
+			{
+				sum += buf[i + 1];
+			}
+
+			sum = (sum & 0xFFFF) + (sum >> 16);
+		}
+
+		return static_cast<uint16_t>(~sum);
+	}
+
+	uint16_t network_checksum(const uint8_t* buf, size_t buf_len)
+	{
+		return ntohs(asiotap::osi::compute_checksum(reinterpret_cast<const uint16_t*>(buf), buf_len));
+	}
+
+	void fail(const char* check, asiotap::osi::checksum_implementation implementation, size_t offset, size_t length)
+	{
+		std::cerr << check << " failed for " << implementation_name(implementation) << " (offset " << offset << ", length " << length << ")." << std::endl;
+
+		std::exit(EXIT_FAILURE);
+	}
+
+	void verify(asiotap::osi::checksum_implementation implementation, std::mt19937& generator)
+	{
+		std::vector<uint8_t> data(70000);
+
+		for (size_t round = 0; round < 20000; ++round)
+		{
+			const size_t offset = generator() % 64;
+			const size_t length = (round % 100 == 0) ? (data.size() - offset) : (generator() % 2048);
+
+			for (size_t i = 0; i < offset + length; ++i)
+			{
+				// Saturated data exercises the carries.
+				data[i] = (round % 4 == 0) ? 0xFF : static_cast<uint8_t>(generator());
+			}
+			const uint8_t* const buf = &data[offset];
+			const uint16_t expected = reference_checksum(buf, length);
+
+			if (network_checksum(buf, length) != expected)
+			{
+				fail("Checksum", implementation, offset, length);
+			}
+
+			// Splitting the data anywhere must not change the result.
+			asiotap::osi::checksum_helper helper;
+			size_t position = 0;
+
+			while (position < length)
+			{
+				const size_t chunk = std::min<size_t>(length - position, generator() % 97);
+				helper.update(reinterpret_cast<const uint16_t*>(buf + position), chunk);
+				position += chunk;
+			}
+
+			if (ntohs(static_cast<uint16_t>(helper.compute())) != expected)
+			{
+				fail("Split checksum", implementation, offset, length);
+			}
+
+			// Rewriting a 16-bit field must give the same checksum as summing everything again.
+			if (length >= 2)
+			{
+				const size_t field = generator() % (length - 1);
+				const uint16_t old_value = static_cast<uint16_t>((buf[field] << 8) | buf[field + 1]);
+				const uint16_t new_value = static_cast<uint16_t>(generator());
+
+				data[offset + field] = static_cast<uint8_t>(new_value >> 8);
+				data[offset + field + 1] = static_cast<uint8_t>(new_value);
+
+				const uint16_t updated = (field % 2 == 0)
+					? asiotap::osi::update_checksum(expected, old_value, new_value)
+					: asiotap::osi::update_checksum(expected, static_cast<uint16_t>((old_value << 8) | (old_value >> 8)), static_cast<uint16_t>((new_value << 8) | (new_value >> 8)));
+
+				// 0x0000 and 0xFFFF are the same value in one's complement arithmetic.
+				const uint16_t recomputed = reference_checksum(buf, length);
+
+				if ((updated != recomputed) && !((updated == 0x0000 && recomputed == 0xFFFF) || (updated == 0xFFFF && recomputed == 0x0000)))
+				{
+					fail("Incremental update", implementation, offset, length);
+				}
+			}
+		}
+	}
+
+	double measure(const std::vector<uint8_t>& data, size_t length, size_t& sink)
+	{
+		const size_t iterations = std::max<size_t>(1, 100000000 / length);
+		const auto start = clock_type::now();
+
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			sink += asiotap::osi::compute_checksum(reinterpret_cast<const uint16_t*>(&data[0]), length);
+		}
+
+		const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+		return (static_cast<double>(length) * iterations) / seconds / (1024 * 1024 * 1024);
+	}
+}
+
+int main()
+{
+	const asiotap::osi::checksum_implementation selected = asiotap::osi::get_checksum_implementation();
+	const size_t lengths[] = { 40, 64, 576, 1500, 9000, 65535 };
+
+	std::mt19937 generator(42);
+	std::vector<uint8_t> data(65536);
+
+	for (auto&& byte : data)
+	{
+		byte = static_cast<uint8_t>(generator());
+	}
+
+	std::cout << "Selected implementation: " << implementation_name(selected) << std::endl << std::endl;
+	std::cout << std::left << std::setw(10) << "length";
+
+	for (auto&& implementation : implementations)
+	{
+		if (asiotap::osi::set_checksum_implementation(implementation))
+		{
+			verify(implementation, generator);
+			std::cout << std::right << std::setw(14) << implementation_name(implementation);
+		}
+	}
+
+	std::cout << std::endl;
+
+	size_t sink = 0;
+
+	for (auto&& length : lengths)
+	{
+		std::cout << std::left << std::setw(10) << length << std::right << std::fixed << std::setprecision(2);
+
+		for (auto&& implementation : implementations)
+		{
+			if (asiotap::osi::set_checksum_implementation(implementation))
+			{
+				std::cout << std::setw(9) << measure(data, length, sink) << " GB/s";
+			}
+		}
+
+		std::cout << std::endl;
+	}
+
+	asiotap::osi::set_checksum_implementation(selected);
+
+	std::cout << std::endl << "All implementations match the reference. (" << sink << ")" << std::endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,388 @@
+/**
+ * \file filter_fuzz.cpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief A benchmark that measures the OSI filters throughput on valid, truncated and garbage frames, and checks that malformed DHCP requests are rejected without throwing.
+ */
+
+#include <asiotap/osi/ethernet_filter.hpp>
+#include <asiotap/osi/arp_filter.hpp>
+#include <asiotap/osi/ipv4_filter.hpp>
+#include <asiotap/osi/ipv6_filter.hpp>
+#include <asiotap/osi/udp_filter.hpp>
+#include <asiotap/osi/tcp_filter.hpp>
+#include <asiotap/osi/icmpv6_filter.hpp>
+#include <asiotap/osi/bootp_filter.hpp>
+#include <asiotap/osi/dhcp_filter.hpp>
+#include <asiotap/osi/complex_filter.hpp>
+#include <asiotap/osi/static_filter.hpp>
+#include <asiotap/osi/dhcp_proxy.hpp>
+#include <asiotap/osi/ethernet_address.hpp>
+
+#include <asiotap/osi/ethernet_builder.hpp>
+#include <asiotap/osi/ipv4_builder.hpp>
+#include <asiotap/osi/udp_builder.hpp>
+#include <asiotap/osi/bootp_builder.hpp>
+#include <asiotap/osi/dhcp_builder.hpp>
+
+#include <boost/bind.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace ao = asiotap::osi;
+
+namespace
+{
+	typedef std::chrono::steady_clock clock_type;
+	typedef std::vector<uint8_t> frame_type;
+	typedef std::vector<frame_type> corpus_type;
+
+	const size_t CORPUS_SIZE = 4096;
+	const size_t ITERATIONS = 250;
+
+	void push_u16(frame_type& frame, uint16_t value)
+	{
+		frame.push_back(static_cast<uint8_t>(value >> 8));
+		frame.push_back(static_cast<uint8_t>(value));
+	}
+
+	frame_type make_ipv4_frame(uint8_t protocol, size_t payload_size, std::mt19937& generator)
+	{
+		frame_type frame;
+
+		// Ethernet
+		for (size_t i = 0; i < 12; ++i)
+		{
+			frame.push_back(static_cast<uint8_t>(generator()));
+		}
+
+		push_u16(frame, 0x0800);
+
+		// IPv4
+		const size_t transport_header_size = (protocol == 6) ? 20 : 8;
+
+		frame.push_back(0x45);
+		frame.push_back(0x00);
+		push_u16(frame, static_cast<uint16_t>(20 + transport_header_size + payload_size));
+		push_u16(frame, static_cast<uint16_t>(generator()));
+		push_u16(frame, 0x4000);
+		frame.push_back(64);
+		frame.push_back(protocol);
+		push_u16(frame, 0x0000);
+
+		for (size_t i = 0; i < 8; ++i)
+		{
+			frame.push_back(static_cast<uint8_t>(generator()));
+		}
+
+		// Transport
+		push_u16(frame, static_cast<uint16_t>(generator()));
+		push_u16(frame, (protocol == 6) ? 80 : 67);
+
+		if (protocol == 6)
+		{
+			for (size_t i = 0; i < 8; ++i)
+			{
+				frame.push_back(static_cast<uint8_t>(generator()));
+			}
+
+			push_u16(frame, 0x5002);
+			push_u16(frame, 0xFFFF);
+			push_u16(frame, 0x0000);
+			push_u16(frame, 0x0000);
+		}
+		else
+		{
+			push_u16(frame, static_cast<uint16_t>(8 + payload_size));
+			push_u16(frame, 0x0000);
+		}
+
+		for (size_t i = 0; i < payload_size; ++i)
+		{
+			frame.push_back(static_cast<uint8_t>(generator()));
+		}
+
+		return frame;
+	}
+
+	frame_type make_valid_frame(std::mt19937& generator)
+	{
+		return make_ipv4_frame((generator() % 2) ? 6 : 17, generator() % 1400, generator);
+	}
+
+	corpus_type make_valid_corpus(std::mt19937& generator)
+	{
+		corpus_type corpus;
+
+		for (size_t i = 0; i < CORPUS_SIZE; ++i)
+		{
+			corpus.push_back(make_valid_frame(generator));
+		}
+
+		return corpus;
+	}
+
+	// Valid headers cut anywhere: every layer is reached with too little data.
+	corpus_type make_truncated_corpus(std::mt19937& generator)
+	{
+		corpus_type corpus;
+
+		for (size_t i = 0; i < CORPUS_SIZE; ++i)
+		{
+			frame_type frame = make_valid_frame(generator);
+			frame.resize(generator() % 64);
+			corpus.push_back(frame);
+		}
+
+		return corpus;
+	}
+
+	// Random bytes behind a plausible Ethernet type, so that they go past the first layer.
+	corpus_type make_garbage_corpus(std::mt19937& generator)
+	{
+		const uint16_t protocols[] = { 0x0800, 0x86DD, 0x0806, static_cast<uint16_t>(generator()) };
+		corpus_type corpus;
+
+		for (size_t i = 0; i < CORPUS_SIZE; ++i)
+		{
+			frame_type frame(generator() % 1514);
+
+			for (auto&& byte : frame)
+			{
+				byte = static_cast<uint8_t>(generator());
+			}
+
+			if (frame.size() >= 14)
+			{
+				const uint16_t protocol = protocols[generator() % 4];
+				frame[12] = static_cast<uint8_t>(protocol >> 8);
+				frame[13] = static_cast<uint8_t>(protocol);
+			}
+
+			corpus.push_back(frame);
+		}
+
+		return corpus;
+	}
+
+	const ao::proxy<ao::dhcp_frame>::ethernet_address_type DHCP_CLIENT_ADDRESS = { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+
+	// A DHCP request whose message type option and requested IP address option have the specified lengths.
+	frame_type make_dhcp_frame(uint8_t message_type, size_t message_type_size, size_t requested_ip_address_size)
+	{
+		frame_type frame(1500);
+		const boost::asio::mutable_buffer buf = boost::asio::buffer(frame);
+		const uint8_t value[4] = { message_type, 9, 0, 1 };
+
+		ao::builder<ao::dhcp_frame> dhcp_builder(buf);
+		dhcp_builder.add_option(ao::dhcp_option::dhcp_message_type, value, message_type_size);
+
+		if (requested_ip_address_size > 0)
+		{
+			dhcp_builder.add_option(ao::dhcp_option::requested_ip_address, value, requested_ip_address_size);
+		}
+
+		dhcp_builder.add_option(ao::dhcp_option::end);
+		size_t payload_size = dhcp_builder.write();
+
+		ao::builder<ao::bootp_frame> bootp_builder(buf, payload_size);
+		payload_size = bootp_builder.write(
+			ao::BOOTP_BOOTREQUEST,
+			ao::BOOTP_HARDWARE_TYPE_ETHERNET,
+			ao::ETHERNET_ADDRESS_SIZE,
+			0,
+			0x12345678,
+			0,
+			0,
+			boost::asio::ip::address_v4::any(),
+			boost::asio::ip::address_v4::any(),
+			boost::asio::ip::address_v4::any(),
+			boost::asio::ip::address_v4::any(),
+			boost::asio::buffer(DHCP_CLIENT_ADDRESS),
+			boost::asio::const_buffer(NULL, 0),
+			boost::asio::const_buffer(NULL, 0)
+		);
+
+		ao::builder<ao::udp_frame> udp_builder(buf, payload_size);
+		payload_size = udp_builder.write(ao::BOOTP_PROTOCOL + 1, ao::BOOTP_PROTOCOL);
+
+		ao::builder<ao::ipv4_frame> ipv4_builder(buf, payload_size);
+		payload_size = ipv4_builder.write(0, 0, 0, 0, 64, ao::UDP_PROTOCOL, boost::asio::ip::address_v4::any(), boost::asio::ip::address_v4::broadcast());
+		udp_builder.update_checksum(ipv4_builder.get_helper());
+
+		ao::builder<ao::ethernet_frame> ethernet_builder(buf, payload_size);
+		payload_size = ethernet_builder.write(boost::asio::buffer(ao::ethernet_address::broadcast().data()), boost::asio::buffer(DHCP_CLIENT_ADDRESS), ao::IP_PROTOCOL);
+
+		return frame_type(frame.end() - payload_size, frame.end());
+	}
+
+	// Feed a DHCP request to a DHCP proxy, as the core does. Returns whether the proxy answered.
+	bool process_dhcp_frame(frame_type frame)
+	{
+		ao::proxy<ao::dhcp_frame> dhcp_proxy;
+		dhcp_proxy.set_software_address(boost::asio::ip::address_v4::from_string("9.0.0.254"));
+		dhcp_proxy.add_entry(DHCP_CLIENT_ADDRESS, boost::asio::ip::address_v4::from_string("9.0.0.1"), 24);
+
+		uint8_t response[2048];
+		bool answered = false;
+
+		auto pipeline = ao::make_static_filter<ao::ethernet_frame>(
+			ao::accept_frame(),
+			ao::make_static_filter<ao::ipv4_frame>(
+				ao::accept_frame(),
+				ao::make_static_filter<ao::udp_frame>(
+					ao::accept_frame(),
+					ao::make_static_filter<ao::bootp_frame>(
+						ao::accept_frame(),
+						ao::make_static_filter<ao::dhcp_frame>(
+							[&] (ao::mutable_helper<ao::dhcp_frame> dhcp_helper, ao::mutable_helper<ao::bootp_frame> bootp_helper, ao::mutable_helper<ao::udp_frame> udp_helper, ao::mutable_helper<ao::ipv4_frame> ipv4_helper, ao::mutable_helper<ao::ethernet_frame> ethernet_helper)
+							{
+								answered = static_cast<bool>(dhcp_proxy.process_frame(ethernet_helper, ipv4_helper, udp_helper, bootp_helper, dhcp_helper, boost::asio::buffer(response)));
+
+								return true;
+							}
+						)
+					)
+				)
+			)
+		);
+
+		pipeline.parse(boost::asio::buffer(frame));
+
+		return answered;
+	}
+
+	bool check_malformed_dhcp()
+	{
+		struct case_type
+		{
+			const char* name;
+			uint8_t message_type;
+			size_t message_type_size;
+			size_t requested_ip_address_size;
+			bool answered;
+		};
+
+		const case_type cases[] = {
+			{ "well-formed discover", ao::DHCP_DISCOVER_MESSAGE, 1, 0, true },
+			{ "empty message type", ao::DHCP_DISCOVER_MESSAGE, 0, 0, false },
+			{ "long message type", ao::DHCP_DISCOVER_MESSAGE, 2, 0, false },
+			{ "short requested address", ao::DHCP_REQUEST_MESSAGE, 1, 2, true },
+		};
+
+		bool result = true;
+
+		for (auto&& _case : cases)
+		{
+			bool answered = false;
+
+			try
+			{
+				answered = process_dhcp_frame(make_dhcp_frame(_case.message_type, _case.message_type_size, _case.requested_ip_address_size));
+			}
+			catch (const std::exception& ex)
+			{
+				std::cerr << "dhcp: " << _case.name << ": unexpected exception: " << ex.what() << std::endl;
+				result = false;
+
+				continue;
+			}
+
+			if (answered != _case.answered)
+			{
+				std::cerr << "dhcp: " << _case.name << ": " << (answered ? "unexpected answer" : "no answer") << std::endl;
+				result = false;
+			}
+		}
+
+		std::cout << "dhcp        " << (result ? "malformed options rejected" : "FAILED") << std::endl;
+
+		return result;
+	}
+
+	struct counters_type
+	{
+		counters_type() : ethernet(0), arp(0), ipv4(0), ipv6(0), udp(0), tcp(0), icmpv6(0), dhcp(0) {}
+
+		size_t ethernet;
+		size_t arp;
+		size_t ipv4;
+		size_t ipv6;
+		size_t udp;
+		size_t tcp;
+		size_t icmpv6;
+		size_t dhcp;
+	};
+
+	template <typename HelperType>
+	void count(size_t& counter, HelperType)
+	{
+		++counter;
+	}
+
+	void benchmark(const char* name, corpus_type corpus)
+	{
+		counters_type counters;
+
+		ao::filter<ao::ethernet_frame> ethernet_filter;
+		ao::complex_filter<ao::arp_frame, ao::ethernet_frame>::type arp_filter(ethernet_filter);
+		ao::complex_filter<ao::ipv4_frame, ao::ethernet_frame>::type ipv4_filter(ethernet_filter);
+		ao::complex_filter<ao::ipv6_frame, ao::ethernet_frame>::type ipv6_filter(ethernet_filter);
+		ao::complex_filter<ao::udp_frame, ao::ipv4_frame, ao::ethernet_frame>::type udp_filter(ipv4_filter);
+		ao::complex_filter<ao::tcp_frame, ao::ipv4_frame, ao::ethernet_frame>::type tcp_filter(ipv4_filter);
+		ao::complex_filter<ao::icmpv6_frame, ao::ipv6_frame, ao::ethernet_frame>::type icmpv6_filter(ipv6_filter);
+		ao::complex_filter<ao::bootp_frame, ao::udp_frame, ao::ipv4_frame, ao::ethernet_frame>::type bootp_filter(udp_filter);
+		ao::complex_filter<ao::dhcp_frame, ao::bootp_frame, ao::udp_frame, ao::ipv4_frame, ao::ethernet_frame>::type dhcp_filter(bootp_filter);
+
+		ethernet_filter.add_handler(boost::bind(&count<ao::mutable_helper<ao::ethernet_frame> >, boost::ref(counters.ethernet), _1));
+		arp_filter.add_handler(boost::bind(&count<ao::mutable_helper<ao::arp_frame> >, boost::ref(counters.arp), _1));
+		ipv4_filter.add_handler(boost::bind(&count<ao::mutable_helper<ao::ipv4_frame> >, boost::ref(counters.ipv4), _1));
+		ipv6_filter.add_handler(boost::bind(&count<ao::mutable_helper<ao::ipv6_frame> >, boost::ref(counters.ipv6), _1));
+		udp_filter.add_handler(boost::bind(&count<ao::mutable_helper<ao::udp_frame> >, boost::ref(counters.udp), _1));
+		tcp_filter.add_handler(boost::bind(&count<ao::mutable_helper<ao::tcp_frame> >, boost::ref(counters.tcp), _1));
+		icmpv6_filter.add_handler(boost::bind(&count<ao::mutable_helper<ao::icmpv6_frame> >, boost::ref(counters.icmpv6), _1));
+		dhcp_filter.add_handler(boost::bind(&count<ao::mutable_helper<ao::dhcp_frame> >, boost::ref(counters.dhcp), _1));
+
+		const auto start = clock_type::now();
+
+		for (size_t i = 0; i < ITERATIONS; ++i)
+		{
+			for (auto&& frame : corpus)
+			{
+				ethernet_filter.parse(boost::asio::buffer(frame));
+			}
+		}
+
+		const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+		const double frames = static_cast<double>(corpus.size() * ITERATIONS);
+
+		std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(10) << (frames / seconds / 1000000) << " Mframes/s"
+			<< "   (ethernet " << counters.ethernet / ITERATIONS
+			<< ", arp " << counters.arp / ITERATIONS
+			<< ", ipv4 " << counters.ipv4 / ITERATIONS
+			<< ", ipv6 " << counters.ipv6 / ITERATIONS
+			<< ", udp " << counters.udp / ITERATIONS
+			<< ", tcp " << counters.tcp / ITERATIONS
+			<< ", icmpv6 " << counters.icmpv6 / ITERATIONS
+			<< ", dhcp " << counters.dhcp / ITERATIONS << ")" << std::endl;
+	}
+}
+
+int main()
+{
+	std::mt19937 generator(42);
+
+	std::cout << CORPUS_SIZE << " frames per corpus, " << ITERATIONS << " iterations:" << std::endl;
+
+	benchmark("valid", make_valid_corpus(generator));
+	benchmark("truncated", make_truncated_corpus(generator));
+	benchmark("garbage", make_garbage_corpus(generator));
+
+	return check_malformed_dhcp() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
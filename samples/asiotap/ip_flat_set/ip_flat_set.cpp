@@ -0,0 +1,170 @@
+/**
+ * \file ip_flat_set.cpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief A benchmark that compares flat IP route sets to node-based ones.
+ */
+
+#include <asiotap/types/ip_flat_set.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock clock_type;
+
+	std::vector<asiotap::ip_route> make_routes(size_t count, std::mt19937& generator)
+	{
+		std::vector<asiotap::ip_route> result;
+		result.reserve(count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			// Roughly three IPv4 routes for one IPv6 route, like most deployments.
+			if (generator() % 4 != 0)
+			{
+				const boost::asio::ip::address_v4 address(static_cast<unsigned long>(generator()) & 0xffffff00);
+
+				result.push_back(asiotap::ipv4_route(asiotap::ipv4_network_address(address, 24)));
+			}
+			else
+			{
+				boost::asio::ip::address_v6::bytes_type bytes = {};
+				bytes[0] = 0x20;
+				bytes[1] = 0x01;
+
+				for (size_t j = 2; j < 8; ++j)
+				{
+					bytes[j] = static_cast<unsigned char>(generator());
+				}
+
+				result.push_back(asiotap::ipv6_route(asiotap::ipv6_network_address(boost::asio::ip::address_v6(bytes), 64)));
+			}
+		}
+
+		return result;
+	}
+
+	class contains_visitor : public boost::static_visitor<bool>
+	{
+		public:
+
+			explicit contains_visitor(const asiotap::ip_route_flat_set& values) : m_values(values) {}
+
+			template <typename RouteType>
+			bool operator()(const RouteType& route) const
+			{
+				return m_values.contains(route);
+			}
+
+		private:
+
+			const asiotap::ip_route_flat_set& m_values;
+	};
+
+	template <typename Function>
+	double measure(size_t iterations, Function func)
+	{
+		const auto start = clock_type::now();
+
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			func();
+		}
+
+		return std::chrono::duration<double, std::micro>(clock_type::now() - start).count() / iterations;
+	}
+
+	void report(const char* operation, double set_duration, double flat_set_duration)
+	{
+		std::cout << "  " << std::left << std::setw(12) << operation << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(14) << set_duration << " us"
+			<< std::setw(14) << flat_set_duration << " us"
+			<< std::setw(9) << (set_duration / flat_set_duration) << "x" << std::endl;
+	}
+
+	void benchmark(size_t count)
+	{
+		std::mt19937 generator(static_cast<std::mt19937::result_type>(count));
+
+		const auto values = make_routes(count, generator);
+		const auto other_values = make_routes(count, generator);
+		const size_t iterations = std::max<size_t>(1, 1000000 / count);
+
+		const asiotap::ip_route_set set(values.begin(), values.end());
+		const asiotap::ip_route_set other_set(other_values.begin(), other_values.end());
+		const asiotap::ip_route_flat_set flat_set(values.begin(), values.end());
+		const asiotap::ip_route_flat_set other_flat_set(other_values.begin(), other_values.end());
+
+		if (flat_set.to_set() != set)
+		{
+			std::cerr << "Flat set and set differ for " << count << " routes." << std::endl;
+
+			std::exit(EXIT_FAILURE);
+		}
+
+		std::cout << count << " routes (" << flat_set.ipv4().size() << " IPv4, " << flat_set.ipv6().size() << " IPv6), " << iterations << " iteration(s):" << std::endl;
+		std::cout << "  " << std::left << std::setw(12) << "operation" << std::right << std::setw(17) << "std::set" << std::setw(17) << "flat set" << std::setw(10) << "speedup" << std::endl;
+
+		size_t sink = 0;
+
+		report(
+			"build",
+			measure(iterations, [&](){ sink += asiotap::ip_route_set(values.begin(), values.end()).size(); }),
+			measure(iterations, [&](){ sink += asiotap::ip_route_flat_set(values.begin(), values.end()).size(); })
+		);
+
+		report(
+			"copy",
+			measure(iterations, [&](){ const asiotap::ip_route_set copy(set); sink += copy.size(); }),
+			measure(iterations, [&](){ const asiotap::ip_route_flat_set copy(flat_set); sink += copy.size(); })
+		);
+
+		report(
+			"lookup",
+			measure(iterations, [&](){ for (auto&& value : other_values) { sink += set.count(value); } }),
+			measure(iterations, [&](){ for (auto&& value : other_values) { sink += boost::apply_visitor(contains_visitor(flat_set), value); } })
+		);
+
+		report(
+			"union",
+			measure(iterations, [&](){ asiotap::ip_route_set result; std::set_union(set.begin(), set.end(), other_set.begin(), other_set.end(), std::inserter(result, result.end())); sink += result.size(); }),
+			measure(iterations, [&](){ sink += asiotap::ip_route_flat_set::set_union(flat_set, other_flat_set).size(); })
+		);
+
+		report(
+			"difference",
+			measure(iterations, [&](){ asiotap::ip_route_set result; std::set_difference(set.begin(), set.end(), other_set.begin(), other_set.end(), std::inserter(result, result.end())); sink += result.size(); }),
+			measure(iterations, [&](){ sink += asiotap::ip_route_flat_set::set_difference(flat_set, other_flat_set).size(); })
+		);
+
+		const asiotap::ip_network_address network = asiotap::ipv4_network_address(boost::asio::ip::address_v4::from_string("10.0.0.0"), 8);
+		const asiotap::in_network_predicate in_network(network);
+
+		report(
+			"filter",
+			measure(iterations, [&](){ asiotap::ip_route_set result; for (auto&& route : set) { if (boost::apply_visitor(in_network, route)) { result.insert(result.end(), route); } } sink += result.size(); }),
+			measure(iterations, [&](){ sink += asiotap::filter_by_network(flat_set, network).size(); })
+		);
+
+		std::cout << "  (" << sink << ")" << std::endl << std::endl;
+	}
+}
+
+int main()
+{
+	const size_t counts[] = { 10, 100, 1000, 10000, 100000 };
+
+	for (auto&& count : counts)
+	{
+		benchmark(count);
+	}
+
+	return EXIT_SUCCESS;
+}
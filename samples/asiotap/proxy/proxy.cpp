@@ -7,7 +7,7 @@
 #include <asiotap/asiotap.hpp>
 #include <asiotap/osi/arp_proxy.hpp>
 #include <asiotap/osi/dhcp_proxy.hpp>
-#include <asiotap/osi/complex_filter.hpp>
+#include <asiotap/osi/static_filter.hpp>
 
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
@@ -66,7 +66,7 @@ static bool register_signal_handlers()
 
 static boost::array<char, 2048> read_buffer;
 static boost::array<char, 2048> write_buffer;
-asiotap::osi::filter<asiotap::osi::ethernet_frame> ethernet_filter;
+static boost::function<void (boost::asio::mutable_buffer)> parse_frame = 0;
 
 void write_done(asiotap::tap_adapter& tap_adapter, const boost::system::error_code& ec, size_t cnt)
 {
@@ -81,7 +81,7 @@ void read_done(asiotap::tap_adapter& tap_adapter, const boost::system::error_cod
 
 	if (!ec)
 	{
-		ethernet_filter.parse(boost::asio::buffer(read_buffer, cnt));
+		parse_frame(boost::asio::buffer(read_buffer, cnt));
 
 		tap_adapter.async_read(boost::asio::buffer(read_buffer, sizeof(read_buffer)), boost::bind(&read_done, boost::ref(tap_adapter), _1, _2));
 	}
@@ -92,9 +92,9 @@ void do_write(asiotap::tap_adapter& tap_adapter, boost::asio::const_buffer buffe
 	tap_adapter.async_write(boost::asio::buffer(buffer), boost::bind(&write_done, boost::ref(tap_adapter), _1, _2));
 }
 
-void arp_frame_available(asiotap::tap_adapter& tap_adapter, const asiotap::osi::proxy<asiotap::osi::arp_frame>& arp_proxy, const asiotap::osi::complex_filter<asiotap::osi::arp_frame, asiotap::osi::ethernet_frame>::type& arp_filter, asiotap::osi::const_helper<asiotap::osi::arp_frame> arp_helper)
+void arp_frame_available(asiotap::tap_adapter& tap_adapter, const asiotap::osi::proxy<asiotap::osi::arp_frame>& arp_proxy, asiotap::osi::const_helper<asiotap::osi::ethernet_frame> ethernet_helper, asiotap::osi::const_helper<asiotap::osi::arp_frame> arp_helper)
 {
-	boost::optional<boost::asio::const_buffer> buffer = arp_proxy.process_frame(*arp_filter.parent().get_last_helper(), arp_helper, boost::asio::buffer(write_buffer));
+	boost::optional<boost::asio::const_buffer> buffer = arp_proxy.process_frame(ethernet_helper, arp_helper, boost::asio::buffer(write_buffer));
 
 	if (buffer)
 	{
@@ -102,13 +102,13 @@ void arp_frame_available(asiotap::tap_adapter& tap_adapter, const asiotap::osi::
 	}
 }
 
-void dhcp_frame_available(asiotap::tap_adapter& tap_adapter, const asiotap::osi::proxy<asiotap::osi::dhcp_frame>& dhcp_proxy, const asiotap::osi::complex_filter<asiotap::osi::dhcp_frame, asiotap::osi::bootp_frame, asiotap::osi::udp_frame, asiotap::osi::ipv4_frame, asiotap::osi::ethernet_frame>::type& dhcp_filter, asiotap::osi::const_helper<asiotap::osi::dhcp_frame> dhcp_helper)
+void dhcp_frame_available(asiotap::tap_adapter& tap_adapter, const asiotap::osi::proxy<asiotap::osi::dhcp_frame>& dhcp_proxy, asiotap::osi::const_helper<asiotap::osi::ethernet_frame> ethernet_helper, asiotap::osi::const_helper<asiotap::osi::ipv4_frame> ipv4_helper, asiotap::osi::const_helper<asiotap::osi::udp_frame> udp_helper, asiotap::osi::const_helper<asiotap::osi::bootp_frame> bootp_helper, asiotap::osi::const_helper<asiotap::osi::dhcp_frame> dhcp_helper)
 {
 	boost::optional<boost::asio::const_buffer> buffer = dhcp_proxy.process_frame(
-		*dhcp_filter.parent().parent().parent().parent().get_last_helper(),
-		*dhcp_filter.parent().parent().parent().get_last_helper(),
-		*dhcp_filter.parent().parent().get_last_helper(),
-		*dhcp_filter.parent().get_last_helper(),
+		ethernet_helper,
+		ipv4_helper,
+		udp_helper,
+		bootp_helper,
 		dhcp_helper,
 		boost::asio::buffer(write_buffer)
 	);
@@ -147,34 +147,55 @@ int main()
 		tap_adapter.open();
 		tap_adapter.set_connected_state(true);
 
-		tap_adapter.async_read(ba::buffer(read_buffer, sizeof(read_buffer)), boost::bind(&read_done, boost::ref(tap_adapter), _1, _2));
-
 		// The requested address
 		ba::ip::address_v4 dhcp_server_ipv4_address = ba::ip::address_v4::from_string("9.0.0.0");
 		ba::ip::address_v4 my_ipv4_address = ba::ip::address_v4::from_string("9.0.0.1");
 		unsigned long my_ipv4_prefix_length = 24;
 		ba::ip::address_v4 other_ipv4_address = ba::ip::address_v4::from_string("9.0.0.2");
 
-		// We need some filters
-		ao::complex_filter<ao::arp_frame, ao::ethernet_frame>::type arp_filter(ethernet_filter);
-		ao::complex_filter<ao::ipv4_frame, ao::ethernet_frame>::type ipv4_filter(ethernet_filter);
-		ao::complex_filter<ao::udp_frame, ao::ipv4_frame, ao::ethernet_frame>::type udp_filter(ipv4_filter);
-		ao::complex_filter<ao::bootp_frame, ao::udp_frame, ao::ipv4_frame, ao::ethernet_frame>::type bootp_filter(udp_filter);
-		ao::complex_filter<ao::dhcp_frame, ao::bootp_frame, ao::udp_frame, ao::ipv4_frame, ao::ethernet_frame>::type dhcp_filter(bootp_filter);
-
 		// We add the ARP proxy
 		ao::proxy<ao::arp_frame> arp_proxy;
 		arp_proxy.add_entry(other_ipv4_address, tap_adapter.ethernet_address().data());
 
-		arp_filter.add_handler(boost::bind(&arp_frame_available, boost::ref(tap_adapter), boost::cref(arp_proxy), boost::cref(arp_filter), _1));
-
 		// We add the DHCP proxy
 		ao::proxy<ao::dhcp_frame> dhcp_proxy;
 		dhcp_proxy.set_hardware_address(tap_adapter.ethernet_address().data());
 		dhcp_proxy.set_software_address(dhcp_server_ipv4_address);
 		dhcp_proxy.add_entry(tap_adapter.ethernet_address().data(), my_ipv4_address, my_ipv4_prefix_length);
 
-		dhcp_filter.add_handler(boost::bind(&dhcp_frame_available, boost::ref(tap_adapter), boost::cref(dhcp_proxy), boost::cref(dhcp_filter), _1));
+		// We need some filters
+		auto pipeline = ao::make_static_filter<ao::ethernet_frame>(
+			ao::accept_frame(),
+			ao::make_static_filter<ao::arp_frame>(
+				[&tap_adapter, &arp_proxy] (ao::mutable_helper<ao::arp_frame> arp_helper, ao::mutable_helper<ao::ethernet_frame> ethernet_helper)
+				{
+					arp_frame_available(tap_adapter, arp_proxy, ethernet_helper, arp_helper);
+
+					return true;
+				}
+			),
+			ao::make_static_filter<ao::ipv4_frame>(
+				ao::accept_frame(),
+				ao::make_static_filter<ao::udp_frame>(
+					ao::accept_frame(),
+					ao::make_static_filter<ao::bootp_frame>(
+						ao::accept_frame(),
+						ao::make_static_filter<ao::dhcp_frame>(
+							[&tap_adapter, &dhcp_proxy] (ao::mutable_helper<ao::dhcp_frame> dhcp_helper, ao::mutable_helper<ao::bootp_frame> bootp_helper, ao::mutable_helper<ao::udp_frame> udp_helper, ao::mutable_helper<ao::ipv4_frame> ipv4_helper, ao::mutable_helper<ao::ethernet_frame> ethernet_helper)
+							{
+								dhcp_frame_available(tap_adapter, dhcp_proxy, ethernet_helper, ipv4_helper, udp_helper, bootp_helper, dhcp_helper);
+
+								return true;
+							}
+						)
+					)
+				)
+			)
+		);
+
+		parse_frame = [&pipeline] (ba::mutable_buffer buf) { pipeline.parse(buf); };
+
+		tap_adapter.async_read(ba::buffer(read_buffer, sizeof(read_buffer)), boost::bind(&read_done, boost::ref(tap_adapter), _1, _2));
 
 		// Let's run !
 		_io_service.run();
@@ -0,0 +1,304 @@
+/**
+ * \file static_filter.cpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief A benchmark that compares static filter pipelines to dynamic ones.
+ */
+
+#include <asiotap/osi/ethernet_filter.hpp>
+#include <asiotap/osi/arp_filter.hpp>
+#include <asiotap/osi/ipv4_filter.hpp>
+#include <asiotap/osi/udp_filter.hpp>
+#include <asiotap/osi/tcp_filter.hpp>
+#include <asiotap/osi/bootp_filter.hpp>
+#include <asiotap/osi/dhcp_filter.hpp>
+#include <asiotap/osi/complex_filter.hpp>
+#include <asiotap/osi/static_filter.hpp>
+
+#include <boost/bind.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace ao = asiotap::osi;
+
+namespace
+{
+	typedef std::chrono::steady_clock clock_type;
+	typedef std::vector<uint8_t> frame_type;
+	typedef std::vector<frame_type> corpus_type;
+
+	const size_t CORPUS_SIZE = 1024;
+
+	struct counters_type
+	{
+		counters_type() : arp(0), tcp(0), dhcp(0) {}
+
+		bool operator==(const counters_type& other) const
+		{
+			return (arp == other.arp) && (tcp == other.tcp) && (dhcp == other.dhcp);
+		}
+
+		size_t arp;
+		size_t tcp;
+		size_t dhcp;
+	};
+
+	void push_u16(frame_type& frame, uint16_t value)
+	{
+		frame.push_back(static_cast<uint8_t>(value >> 8));
+		frame.push_back(static_cast<uint8_t>(value));
+	}
+
+	void push_random(frame_type& frame, size_t count, std::mt19937& generator)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			frame.push_back(static_cast<uint8_t>(generator()));
+		}
+	}
+
+	// A third of ARP requests, a third of TCP segments and a third of DHCP messages. All but the DHCP messages are padded to the specified size: walking a kilobyte of padding options would dwarf the filters cost.
+	frame_type make_frame(size_t size, std::mt19937& generator)
+	{
+		frame_type frame;
+		const unsigned int kind = generator() % 3;
+
+		push_random(frame, 12, generator);
+
+		if (kind == 0)
+		{
+			push_u16(frame, 0x0806);
+			push_u16(frame, 0x0001);
+			push_u16(frame, 0x0800);
+			frame.push_back(6);
+			frame.push_back(4);
+			push_u16(frame, 0x0001);
+			push_random(frame, 20, generator);
+		}
+		else
+		{
+			// DHCP messages never fit in a minimal frame.
+			const bool is_dhcp = (kind == 2) && (size >= 14 + 20 + 8 + 240);
+			const size_t ip_size = is_dhcp ? (20 + 8 + 241) : (size - 14);
+
+			push_u16(frame, 0x0800);
+			frame.push_back(0x45);
+			frame.push_back(0x00);
+			push_u16(frame, static_cast<uint16_t>(ip_size));
+			push_u16(frame, static_cast<uint16_t>(generator()));
+			push_u16(frame, 0x4000);
+			frame.push_back(64);
+			frame.push_back(is_dhcp ? 17 : 6);
+			push_u16(frame, 0x0000);
+			push_random(frame, 8, generator);
+
+			if (is_dhcp)
+			{
+				push_u16(frame, 68);
+				push_u16(frame, 67);
+				push_u16(frame, static_cast<uint16_t>(ip_size - 20));
+				push_u16(frame, 0x0000);
+				frame.push_back(1);
+				frame.push_back(1);
+				frame.push_back(6);
+				push_random(frame, 233, generator);
+				push_u16(frame, 0x6382);
+				push_u16(frame, 0x5363);
+				frame.push_back(255);
+			}
+			else
+			{
+				push_random(frame, 4, generator);
+				push_random(frame, 8, generator);
+				push_u16(frame, 0x5002);
+				push_u16(frame, 0xFFFF);
+				push_u16(frame, 0x0000);
+				push_u16(frame, 0x0000);
+			}
+		}
+
+		while ((frame.size() < size) && (frame.size() != 14 + 20 + 8 + 241))
+		{
+			frame.push_back(0);
+		}
+
+		return frame;
+	}
+
+	template <typename HelperType>
+	void count(size_t& counter, HelperType)
+	{
+		++counter;
+	}
+
+	class dynamic_pipeline
+	{
+		public:
+
+			dynamic_pipeline() :
+				m_arp_filter(m_ethernet_filter),
+				m_ipv4_filter(m_ethernet_filter),
+				m_udp_filter(m_ipv4_filter),
+				m_tcp_filter(m_ipv4_filter),
+				m_bootp_filter(m_udp_filter),
+				m_dhcp_filter(m_bootp_filter)
+			{
+				m_arp_filter.add_handler(boost::bind(&count<ao::mutable_helper<ao::arp_frame> >, boost::ref(m_counters.arp), _1));
+				m_tcp_filter.add_handler(boost::bind(&count<ao::mutable_helper<ao::tcp_frame> >, boost::ref(m_counters.tcp), _1));
+				m_dhcp_filter.add_handler(boost::bind(&count<ao::mutable_helper<ao::dhcp_frame> >, boost::ref(m_counters.dhcp), _1));
+			}
+
+			void parse(boost::asio::mutable_buffer buf)
+			{
+				m_ethernet_filter.parse(buf);
+			}
+
+			const counters_type& counters() const
+			{
+				return m_counters;
+			}
+
+		private:
+
+			counters_type m_counters;
+			ao::filter<ao::ethernet_frame> m_ethernet_filter;
+			ao::complex_filter<ao::arp_frame, ao::ethernet_frame>::type m_arp_filter;
+			ao::complex_filter<ao::ipv4_frame, ao::ethernet_frame>::type m_ipv4_filter;
+			ao::complex_filter<ao::udp_frame, ao::ipv4_frame, ao::ethernet_frame>::type m_udp_filter;
+			ao::complex_filter<ao::tcp_frame, ao::ipv4_frame, ao::ethernet_frame>::type m_tcp_filter;
+			ao::complex_filter<ao::bootp_frame, ao::udp_frame, ao::ipv4_frame, ao::ethernet_frame>::type m_bootp_filter;
+			ao::complex_filter<ao::dhcp_frame, ao::bootp_frame, ao::udp_frame, ao::ipv4_frame, ao::ethernet_frame>::type m_dhcp_filter;
+	};
+
+	class counting_handler
+	{
+		public:
+
+			explicit counting_handler(size_t& counter) : m_counter(&counter) {}
+
+			template <typename... HelperTypes>
+			bool operator()(HelperTypes...) const
+			{
+				++*m_counter;
+
+				return true;
+			}
+
+		private:
+
+			size_t* m_counter;
+	};
+
+	class static_pipeline
+	{
+		public:
+
+			static_pipeline() :
+				m_counters(),
+				m_filter(
+					ao::accept_frame(),
+					ao::make_static_filter<ao::arp_frame>(counting_handler(m_counters.arp)),
+					ao::make_static_filter<ao::ipv4_frame>(
+						ao::accept_frame(),
+						ao::make_static_filter<ao::udp_frame>(
+							ao::accept_frame(),
+							ao::make_static_filter<ao::bootp_frame>(
+								ao::accept_frame(),
+								ao::make_static_filter<ao::dhcp_frame>(counting_handler(m_counters.dhcp))
+							)
+						),
+						ao::make_static_filter<ao::tcp_frame>(counting_handler(m_counters.tcp))
+					)
+				)
+			{
+			}
+
+			void parse(boost::asio::mutable_buffer buf)
+			{
+				m_filter.parse(buf);
+			}
+
+			const counters_type& counters() const
+			{
+				return m_counters;
+			}
+
+		private:
+
+			typedef ao::static_filter<ao::dhcp_frame, counting_handler> dhcp_filter_type;
+			typedef ao::static_filter<ao::bootp_frame, ao::accept_frame, dhcp_filter_type> bootp_filter_type;
+			typedef ao::static_filter<ao::udp_frame, ao::accept_frame, bootp_filter_type> udp_filter_type;
+			typedef ao::static_filter<ao::tcp_frame, counting_handler> tcp_filter_type;
+			typedef ao::static_filter<ao::ipv4_frame, ao::accept_frame, udp_filter_type, tcp_filter_type> ipv4_filter_type;
+			typedef ao::static_filter<ao::arp_frame, counting_handler> arp_filter_type;
+			typedef ao::static_filter<ao::ethernet_frame, ao::accept_frame, arp_filter_type, ipv4_filter_type> ethernet_filter_type;
+
+			counters_type m_counters;
+			ethernet_filter_type m_filter;
+	};
+
+	template <typename PipelineType>
+	double measure(PipelineType& pipeline, corpus_type& corpus, size_t iterations)
+	{
+		const auto start = clock_type::now();
+
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			for (auto&& frame : corpus)
+			{
+				pipeline.parse(boost::asio::buffer(frame));
+			}
+		}
+
+		const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+		return static_cast<double>(corpus.size() * iterations) / seconds / 1000000;
+	}
+
+	void benchmark(size_t size)
+	{
+		std::mt19937 generator(static_cast<std::mt19937::result_type>(size));
+		corpus_type corpus;
+
+		for (size_t i = 0; i < CORPUS_SIZE; ++i)
+		{
+			corpus.push_back(make_frame(size, generator));
+		}
+
+		const size_t iterations = 2000;
+		dynamic_pipeline dynamic;
+		static_pipeline static_;
+
+		const double dynamic_rate = measure(dynamic, corpus, iterations);
+		const double static_rate = measure(static_, corpus, iterations);
+
+		if (!(dynamic.counters() == static_.counters()))
+		{
+			std::cerr << "Static and dynamic pipelines disagree for " << size << "-byte frames." << std::endl;
+
+			std::exit(EXIT_FAILURE);
+		}
+
+		std::cout << std::setw(6) << size << " bytes" << std::fixed << std::setprecision(2)
+			<< std::setw(12) << dynamic_rate << " Mframes/s"
+			<< std::setw(12) << static_rate << " Mframes/s"
+			<< std::setw(9) << (static_rate / dynamic_rate) << "x"
+			<< "   (arp " << static_.counters().arp / iterations
+			<< ", tcp " << static_.counters().tcp / iterations
+			<< ", dhcp " << static_.counters().dhcp / iterations << ")" << std::endl;
+	}
+}
+
+int main()
+{
+	std::cout << std::setw(12) << "frame size" << std::setw(22) << "dynamic" << std::setw(22) << "static" << std::setw(10) << "speedup" << std::endl;
+
+	benchmark(64);
+	benchmark(1500);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,66 @@
+/**
+ * \file execute.cpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief Test the execution with a timeout: exit status and output reporting, spawn errors and timeouts.
+ */
+
+#include <executeplus/posix_system.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace
+{
+	bool check(bool condition, const std::string& description)
+	{
+		std::cerr << (condition ? "[ OK ] " : "[FAIL] ") << description << std::endl;
+
+		return condition;
+	}
+}
+
+int main()
+{
+	const boost::posix_time::time_duration timeout = boost::posix_time::seconds(1);
+	const std::map<std::string, std::string> env = executeplus::get_current_environment();
+
+	bool spawned = false;
+	bool failed = false;
+	bool timed_out = false;
+	bool closed_output = false;
+
+	{
+		boost::system::error_code ec;
+		std::string output;
+		const int exit_status = executeplus::execute_with_timeout({ "/bin/sh", "-c", "echo hello; exit 3" }, env, timeout, ec, &output);
+
+		spawned = check(!ec, "The process was spawned: " + ec.message());
+		spawned = check(exit_status == 3, "The exit status is reported: " + std::to_string(exit_status)) && spawned;
+		spawned = check(output == "hello\n", "The output is captured: " + output) && spawned;
+	}
+
+	{
+		boost::system::error_code ec;
+		const int exit_status = executeplus::execute_with_timeout({}, env, timeout, ec);
+
+		failed = check(ec == boost::system::errc::invalid_argument, "An empty command line fails to spawn: " + ec.message());
+		failed = check(exit_status == -1, "No exit status is reported for a failed spawn") && failed;
+	}
+
+	{
+		boost::system::error_code ec;
+		executeplus::execute_with_timeout({ "/bin/sh", "-c", "sleep 10" }, env, timeout, ec);
+
+		timed_out = check(ec == boost::system::errc::timed_out, "A process that runs for too long is killed: " + ec.message());
+	}
+
+	{
+		boost::system::error_code ec;
+		executeplus::execute_with_timeout({ "/bin/sh", "-c", "exec >/dev/null 2>&1; sleep 10" }, env, timeout, ec);
+
+		closed_output = check(ec == boost::system::errc::timed_out, "A process that closes its output and runs for too long is killed: " + ec.message());
+	}
+
+	return (spawned && failed && timed_out && closed_output) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,58 @@
+/**
+ * \file rate_limiter.cpp
+ * \author Julien Kauffmann <julien.kauffmann@freelan.org>
+ * \brief Test the rate limiter: per address and per endpoint budgets, with two hosts behind one address.
+ */
+
+#include <fscp/rate_limiter.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace
+{
+	bool check(bool condition, const std::string& description)
+	{
+		std::cerr << (condition ? "[ OK ] " : "[FAIL] ") << description << std::endl;
+
+		return condition;
+	}
+}
+
+int main()
+{
+	const boost::asio::ip::address nat_address = boost::asio::ip::address::from_string("203.0.113.7");
+	const boost::asio::ip::udp::endpoint alice(nat_address, 12000);
+	const boost::asio::ip::udp::endpoint bob(nat_address, 12001);
+
+	bool result = true;
+
+	{
+		// One message per second, no burst: the address budget is shared by everything behind it.
+		fscp::rate_limiter limiter;
+		limiter.set_rate(fscp::MESSAGE_TYPE_HELLO_REQUEST, 1.0, 1.0);
+
+		result = check(limiter.consume(alice.address(), fscp::MESSAGE_TYPE_HELLO_REQUEST), "The first message from an address is accepted") && result;
+		result = check(!limiter.consume(bob.address(), fscp::MESSAGE_TYPE_HELLO_REQUEST), "A second host behind the same address shares its budget") && result;
+	}
+
+	{
+		fscp::rate_limiter limiter;
+		limiter.set_rate(fscp::MESSAGE_TYPE_SESSION_REQUEST, 1.0, 1.0);
+		limiter.set_rate(fscp::MESSAGE_TYPE_SESSION, 1.0, 1.0);
+
+		result = check(limiter.consume(alice, fscp::MESSAGE_TYPE_SESSION_REQUEST), "The session request of the first host is accepted") && result;
+		result = check(limiter.consume(bob, fscp::MESSAGE_TYPE_SESSION_REQUEST), "The session request of the second host behind the same address is accepted") && result;
+		result = check(limiter.consume(alice, fscp::MESSAGE_TYPE_SESSION), "The session of the first host is accepted") && result;
+		result = check(limiter.consume(bob, fscp::MESSAGE_TYPE_SESSION), "The session of the second host is accepted") && result;
+		result = check(!limiter.consume(alice, fscp::MESSAGE_TYPE_SESSION_REQUEST), "A host that exceeds its own budget is limited") && result;
+		result = check(!limiter.consume(bob, fscp::MESSAGE_TYPE_SESSION_REQUEST), "The second host is limited by its own budget only") && result;
+
+		const fscp::rate_limiter::statistics_type statistics = limiter.get_statistics();
+
+		result = check((statistics.size() == 1) && (statistics.begin()->second == 2), "The rejected messages are counted") && result;
+	}
+
+	return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}